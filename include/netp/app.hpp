@@ -47,15 +47,21 @@ namespace netp {
 		netp::condition m_cond;
 
 		u32_t m_loop_count;
+		io_poller_type m_poller_type; //of the default loop group
 		u32_t m_channel_read_buf_size; //in bytes
+		bool m_channel_read_right_size; //copy small read into a small packet, refer to f_channel_read_right_size
 		u32_t m_channel_tx_limit_clock; //in millis
+		u32_t m_busy_poll_us; //refer to event_loop_cfg::busy_poll_us
 		bool m_is_cfg_json_loaded;
 		bool m_should_exit;
 
 		std::atomic<app_state> m_app_state;
 		std::vector<std::tuple<int,i64_t>> m_signo_tuple_vec;
-		std::vector<std::string> m_dns_hosts; //dotip
+		std::vector<std::string> m_dns_hosts; //dotip[:port] of name server, or "dotip name [alias ...]" of static host
 		std::string m_logfilepathname;
+		bool m_log_async; //refer to file_logger_cfg::async
+		u64_t m_log_rotate_size; //in bytes
+		u32_t m_log_rotate_interval; //in seconds
 
 		void _app_thread_init();
 		void _app_thread_deinit();
@@ -94,7 +100,12 @@ namespace netp {
 		~app();
 
 		void cfg_loop_count(u32_t c);
+		//"epoll"|"io_uring", takes effect if given before init() returns
+		void cfg_poller(std::string const& name);
 		void cfg_channel_read_buf(u32_t buf_in_kbytes);
+		void cfg_channel_read_right_size(bool onoff) { m_channel_read_right_size = onoff; }
+		//spin budget of the loops of the default loop group, 0 to disable, takes effect if given before init() returns
+		void cfg_busy_poll(u32_t us);
 
 		__NETP_FORCE_INLINE
 		u32_t channel_tx_limit_clock() const { return m_channel_tx_limit_clock; }
@@ -102,6 +113,8 @@ namespace netp {
 		void cfg_channel_tx_limit_clock(u32_t clock_in_millis);
 		void cfg_add_dns(std::string const& dns_ns);
 		void cfg_log_filepathname(std::string const& logfilepathname_);
+		void cfg_log_async(bool onoff) { m_log_async = onoff; }
+		void cfg_log_rotate(u64_t size_in_bytes, u32_t interval_in_seconds) { m_log_rotate_size = size_in_bytes; m_log_rotate_interval = interval_in_seconds; }
 		void dns_hosts(std::vector<netp::string_t, netp::allocator<netp::string_t>>&) const ;
 
 		std::string app_name() const;
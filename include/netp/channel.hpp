@@ -86,7 +86,8 @@ namespace netp {
 		F_TIMER_2 = 1 << 25,
 
 		F_USE_DEFAULT_READ=1<<26,
-		F_USE_DEFAULT_WRITE = 1<<27
+		F_USE_DEFAULT_WRITE = 1<<27,
+		F_DRAINED_PENDING = 1<<28 //outbound q drained in a write barrier, notify once the barrier is left
 	};
 
 	struct channel_buf_cfg {
@@ -106,6 +107,7 @@ namespace netp {
 
 	class channel;
 	typedef std::function<void(NRP<channel>const& ch)> fn_channel_initializer_t;
+	typedef std::function<void(NRP<channel>const& ch)> fn_channel_drained_t;
 
 	typedef netp::promise<std::tuple<int, NRP<netp::channel>>> channel_dial_promise;
 	typedef netp::promise<std::tuple<int, NRP<netp::channel>>> channel_listen_promise;
@@ -133,6 +135,8 @@ namespace netp {
 		NRP<ref_base>	m_ctx;
 
 	protected:
+		fn_channel_drained_t m_fn_drained;
+
 		#define CH_FIRE_ACTION_IMPL_PACKET_1(_NAME, _IN) \
 			__NETP_FORCE_INLINE void ch_fire_##_NAME(NRP<packet> const& _IN) const { \
 				m_pipeline->fire_##_NAME(_IN); \
@@ -163,6 +167,10 @@ namespace netp {
 			CH_FIRE_ACTION_IMPL_0(read_closed)
 			CH_FIRE_ACTION_IMPL_0(write_closed)
 
+			inline void ch_fire_error(int code) const {
+				m_pipeline->fire_error(code);
+			}
+
 			inline void ch_fire_closed(int code) const {
 				NETP_ASSERT(L->in_event_loop());
 
@@ -206,7 +214,8 @@ namespace netp {
 			m_cherrno(0),
 			m_pipeline(nullptr),
 			m_ch_close_p(nullptr),
-			m_ctx(nullptr)
+			m_ctx(nullptr),
+			m_fn_drained(nullptr)
 		{
 			NETP_TRACE_CHANNEL_CREATION("channel::channel()");
 		}
@@ -241,6 +250,13 @@ namespace netp {
 			m_chflag |= int(channel_flag::F_CONNECTED);
 		}
 		inline bool ch_is_connected() { return m_chflag & int(channel_flag::F_CONNECTED); }
+
+		//notified on the loop thread once the outbound q becomes empty, nullptr to cancel
+		inline void ch_on_drained(fn_channel_drained_t const& fn) {
+			L->execute([_ch = NRP<channel>(this), fn]() {
+				_ch->m_fn_drained = fn;
+			});
+		}
 		
 #define CH_FUTURE_ACTION_IMPL_CH_PROMISE_1(NAME) \
 private: \
@@ -271,7 +287,7 @@ public: \
 private: \
 		inline void __ch_##NAME(NRP<promise<int>> const& intp, NRP<packet> const& outlet) {\
 			if (m_pipeline == nullptr) { \
-				intp->set(netp::E_CHANNEL_CLOSED); \
+				if (intp != nullptr) { intp->set(netp::E_CHANNEL_CLOSED); } \
 				return; \
 			} \
 			m_pipeline->NAME(intp,outlet); \
@@ -287,9 +303,44 @@ public: \
 				_ch->__ch_##NAME(intp, outlet); \
 			}); \
 		} \
+		inline void ch_post_##NAME(NRP<packet> const& outlet) {\
+			L->execute([_ch=NRP<channel>(this), outlet]() { \
+				_ch->__ch_##NAME(nullptr, outlet); \
+			}); \
+		} \
 
+		//ch_post_write: no promise, the write error goes to the error event of the pipeline, refer to ch_on_drained for the completion
 		CH_FUTURE_ACTION_IMPL_PACKET(write);
 
+#define CH_FUTURE_ACTION_IMPL_PACKET_CHAIN(NAME) \
+private: \
+		inline void __ch_##NAME(NRP<promise<int>> const& intp, NRP<packet_chain> const& chain) {\
+			if (m_pipeline == nullptr) { \
+				if (intp != nullptr) { intp->set(netp::E_CHANNEL_CLOSED); } \
+				return; \
+			} \
+			m_pipeline->NAME(intp,chain); \
+		} \
+public: \
+		inline NRP<promise<int>> ch_##NAME(NRP<packet_chain> const& chain) {\
+			const NRP<promise<int>> intp = netp::make_ref<promise<int>>(); \
+			ch_##NAME(intp,chain); \
+			return intp; \
+		} \
+		inline void ch_##NAME(NRP<promise<int>> const& intp, NRP<packet_chain> const& chain) {\
+			L->execute([_ch=NRP<channel>(this), intp, chain]() { \
+				_ch->__ch_##NAME(intp, chain); \
+			}); \
+		} \
+		inline void ch_post_##NAME(NRP<packet_chain> const& chain) {\
+			L->execute([_ch=NRP<channel>(this), chain]() { \
+				_ch->__ch_##NAME(nullptr, chain); \
+			}); \
+		} \
+
+		//write the chain as one message, the write promise is set once all the bytes of the chain have been written
+		CH_FUTURE_ACTION_IMPL_PACKET_CHAIN(write_chain);
+
 #define CH_FUTURE_ACTION_IMPL_PACKET_ADDR(NAME) \
 private: \
 		inline void __ch_##NAME(NRP<promise<int>> const& intp, NRP<packet> const& outlet, NRP<address> const& to) {\
@@ -352,6 +403,10 @@ public: \
 			(void)to;
 			(void)intp;
 		};
+		//coalesce by default, the channel that could write the slices out as they are should override
+		virtual void ch_write_chain_impl(NRP<promise<int>> const& intp, NRP<packet_chain> const& chain) {
+			ch_write_impl(intp, chain->to_packet());
+		}
 
 		virtual void ch_close_read_impl(NRP<promise<int>> const& chp) = 0;
 		virtual void ch_close_write_impl(NRP<promise<int>> const& chp) = 0;
@@ -27,10 +27,11 @@ namespace netp {
 		CH_OUTBOUND_CLOSE_WRITE	= 1 << 11,
 
 		CH_OUTBOUND_WRITE_TO		= 1 << 12,
+		CH_OUTBOUND_WRITE_CHAIN	= 1 << 13,
 		CH_CTX_DEATTACHED = 1 << 14,
 
 		CH_ACTIVITY = (CH_ACTIVITY_CONNECTED|CH_ACTIVITY_CLOSED | CH_ACTIVITY_ERROR | CH_ACTIVITY_READ_CLOSED | CH_ACTIVITY_WRITE_CLOSED ),
-		CH_OUTBOUND = (CH_OUTBOUND_WRITE|CH_OUTBOUND_FLUSH | CH_OUTBOUND_CLOSE | CH_OUTBOUND_CLOSE_READ | CH_OUTBOUND_CLOSE_WRITE| CH_OUTBOUND_WRITE_TO),
+		CH_OUTBOUND = (CH_OUTBOUND_WRITE|CH_OUTBOUND_FLUSH | CH_OUTBOUND_CLOSE | CH_OUTBOUND_CLOSE_READ | CH_OUTBOUND_CLOSE_WRITE| CH_OUTBOUND_WRITE_TO| CH_OUTBOUND_WRITE_CHAIN),
 		CH_INBOUND = (CH_INBOUND_READ|CH_INBOUND_READ_FROM)
 
 	};
@@ -70,6 +71,9 @@ namespace netp {
 
 		//for outbound_to
 		virtual void write_to(NRP<promise<int>> const& intp, NRP<channel_handler_context> const& ctx, NRP<packet> const& outlet, NRP<address> const& to);
+
+		//for outbound chain, a handler that has CH_OUTBOUND_WRITE but not CH_OUTBOUND_WRITE_CHAIN gets chain->to_packet() by write
+		virtual void write_chain(NRP<promise<int>> const& intp, NRP<channel_handler_context> const& ctx, NRP<packet_chain> const& chain);
 	};
 
 	class channel_handler_head :
@@ -86,6 +90,7 @@ namespace netp {
 		void close_write(NRP<promise<int>> const& intp, NRP<channel_handler_context> const& ctx);
 
 		void write_to(NRP<promise<int>> const& intp, NRP<channel_handler_context> const& ctx, NRP<packet> const& outlet, NRP<address> const& to );
+		void write_chain(NRP<promise<int>> const& intp, NRP<channel_handler_context> const& ctx, NRP<packet_chain> const& chain);
 	};
 
 	class channel_handler_tail:
@@ -113,7 +113,7 @@ __ctx_iterate_begin: \
 private:\
 	inline void __##NAME(NRP<promise<int>> const& intp, NRP<packet> const& pkt) { \
 		if( NETP_UNLIKELY(H_FLAG&CH_CTX_DEATTACHED) ) {\
-			intp->set(netp::E_CHANNEL_CONTEXT_DEATTACHED); \
+			if (intp != nullptr) { intp->set(netp::E_CHANNEL_CONTEXT_DEATTACHED); } \
 			return; \
 		} \
 		CH_PROMISE_INVOKE_PREV_PACKET_CH_PROMISE(NAME,HANDLER_FLAG) \
@@ -134,6 +134,9 @@ public:\
 		NAME(intp,pkt); \
 		return intp; \
 	} \
+	inline void post_##NAME(NRP<packet> const& pkt) { \
+		NAME(nullptr,pkt); \
+	} \
 
 #define CH_PROMISE_INVOKE_PREV_PACKET_ADDR_CH_PROMISE(NAME,HANDLER_FLAG) \
 	NRP<channel_handler_context> _ctx = P; \
@@ -144,7 +147,7 @@ public:\
 private:\
 	inline void __##NAME(NRP<promise<int>> const& intp, NRP<packet> const& pkt, NRP<address> const& to) { \
 		if( NETP_UNLIKELY(H_FLAG&CH_CTX_DEATTACHED) ) {\
-			intp->set(netp::E_CHANNEL_CONTEXT_DEATTACHED); \
+			if (intp != nullptr) { intp->set(netp::E_CHANNEL_CONTEXT_DEATTACHED); } \
 			return; \
 		} \
 		CH_PROMISE_INVOKE_PREV_PACKET_ADDR_CH_PROMISE(NAME,HANDLER_FLAG) \
@@ -165,6 +168,44 @@ public:\
 		return intp;\
 	} \
 
+//stop at the first handler that has write|write_chain, coalesce the chain for the one that knows nothing of chain
+#define CH_PROMISE_INVOKE_PREV_PACKET_CHAIN_CH_PROMISE(NAME,HANDLER_FLAG) \
+	NRP<channel_handler_context> _ctx = P; \
+	CHANNEL_HANDLER_CONTEXT_ITERATE_CTX((HANDLER_FLAG|CH_OUTBOUND_WRITE),P) \
+	if (_ctx->H_FLAG&HANDLER_FLAG) { \
+		_ctx->H->NAME(intp,_ctx,chain); \
+	} else { \
+		_ctx->H->write(intp,_ctx,chain->to_packet()); \
+	} \
+
+#define CH_PROMISE_ACTION_HANDLER_CONTEXT_IMPL_T_TO_H_PACKET_CHAIN_CH_PROMISE(NAME,HANDLER_FLAG) \
+private:\
+	inline void __##NAME(NRP<promise<int>> const& intp, NRP<packet_chain> const& chain) { \
+		if( NETP_UNLIKELY(H_FLAG&CH_CTX_DEATTACHED) ) {\
+			if (intp != nullptr) { intp->set(netp::E_CHANNEL_CONTEXT_DEATTACHED); } \
+			return; \
+		} \
+		CH_PROMISE_INVOKE_PREV_PACKET_CHAIN_CH_PROMISE(NAME,HANDLER_FLAG) \
+	} \
+public:\
+	inline void NAME(NRP<promise<int>> const& intp, NRP<packet_chain> const& chain) { \
+		if(L->in_event_loop()) { \
+			__##NAME(intp, chain); \
+		} else {\
+			L->schedule([ctx=NRP<channel_handler_context>(this),intp, chain]() { \
+				ctx->__##NAME(intp,chain); \
+			}); \
+		}\
+	} \
+	inline NRP<promise<int>> NAME(NRP<packet_chain> const& chain) { \
+		NRP<promise<int>> intp = netp::make_ref<promise<int>>();\
+		NAME(intp,chain); \
+		return intp; \
+	} \
+	inline void post_##NAME(NRP<packet_chain> const& chain) { \
+		NAME(nullptr,chain); \
+	} \
+
 #define CH_PROMISE_INVOKE_PREV_CH_PROMISE(NAME,HANDLER_FLAG) \
 	NRP<channel_handler_context> _ctx = P; \
 	CHANNEL_HANDLER_CONTEXT_ITERATE_CTX(HANDLER_FLAG,P) \
@@ -174,7 +215,7 @@ public:\
 private:\
 	inline void __##NAME(NRP<promise<int>> const& intp) { \
 		if( NETP_UNLIKELY(H_FLAG&CH_CTX_DEATTACHED) ) {\
-			intp->set(netp::E_CHANNEL_CONTEXT_DEATTACHED); \
+			if (intp != nullptr) { intp->set(netp::E_CHANNEL_CONTEXT_DEATTACHED); } \
 			return; \
 		} \
 		CH_PROMISE_INVOKE_PREV_CH_PROMISE(NAME,HANDLER_FLAG) \
@@ -241,12 +282,14 @@ namespace netp {
 
 		VOID_FIRE_HANDLER_CONTEXT_IMPL_H_TO_T_PACKET_ADDR(readfrom, CH_INBOUND_READ_FROM)
 
+		//post_write|post_write_chain: no promise, the write error goes to the error event of the pipeline
 		CH_PROMISE_ACTION_HANDLER_CONTEXT_IMPL_T_TO_H_PACKET_CH_PROMISE(write, CH_OUTBOUND_WRITE)
 		CH_PROMISE_ACTION_HANDLER_CONTEXT_IMPL_T_TO_H_PROMISE(close, CH_OUTBOUND_CLOSE)
 		CH_PROMISE_ACTION_HANDLER_CONTEXT_IMPL_T_TO_H_PROMISE(close_read, CH_OUTBOUND_CLOSE_READ)
 		CH_PROMISE_ACTION_HANDLER_CONTEXT_IMPL_T_TO_H_PROMISE(close_write, CH_OUTBOUND_CLOSE_WRITE)
 
 		CH_PROMISE_ACTION_HANDLER_CONTEXT_IMPL_T_TO_H_PACKET_ADDR_CH_PROMISE(write_to, CH_OUTBOUND_WRITE_TO);
+		CH_PROMISE_ACTION_HANDLER_CONTEXT_IMPL_T_TO_H_PACKET_CHAIN_CH_PROMISE(write_chain, CH_OUTBOUND_WRITE_CHAIN)
 	};
 }
 #endif
\ No newline at end of file
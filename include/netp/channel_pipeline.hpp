@@ -50,6 +50,16 @@
 		return intp; \
 	}\
 
+#define PIPELINE_ACTION_PACKET_CHAIN(NAME) \
+	__NETP_FORCE_INLINE void NAME(NRP<promise<int>> const& intp,NRP<packet_chain> const& chain) const {\
+		m_tail->NAME(intp,chain); \
+	}\
+	NRP<promise<int>> NAME(NRP<packet_chain> const& chain) {\
+		NRP<promise<int>> intp = netp::make_ref<promise<int>>(); \
+		m_tail->NAME(intp,chain); \
+		return intp; \
+	}\
+
 #define PIPELINE_CH_FUTURE_ACTION_VOID(NAME) \
 	NRP<promise<int>> NAME() {\
 		NRP<promise<int>> intp = netp::make_ref<promise<int>>(); \
@@ -120,6 +130,7 @@ namespace netp {
 
 		PIPELINE_ACTION_PACKET(write)
 		PIPELINE_ACTION_PACKET_ADDR(write_to)
+		PIPELINE_ACTION_PACKET_CHAIN(write_chain)
 
 		PIPELINE_CH_FUTURE_ACTION_VOID(close)
 		PIPELINE_CH_FUTURE_ACTION_VOID(close_read)
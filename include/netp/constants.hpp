@@ -576,6 +576,12 @@ namespace netp {
 	const int E_HTTP_CLIENT_CLOSING					= -41008;
 	const int E_HTTP_EMPTY_FILED_NAME				= -41009;
 
+	const int E_WEBSOCKET_FRAME_INCOMPLETE			= -42001;
+	const int E_WEBSOCKET_FRAME_PROTOCOL_ERROR	= -42002;
+	const int E_WEBSOCKET_FRAME_TOO_BIG			= -42003;
+	const int E_WEBSOCKET_DEFLATE_FAILED			= -42004;
+	const int E_WEBSOCKET_EXTENSION_DECLINED		= -42005;
+
 } //endif netp ns
 
 #endif //END OF NETP_ERROR_HEADER
@@ -88,7 +88,26 @@
 // for epoll using
 #ifdef NETP_ENABLE_EPOLL
 	#define NETP_EPOLL_CREATE_HINT_SIZE			(1024)	///< max size of epoll control
-	#define NETP_EPOLL_PER_HANDLE_SIZE			(128)	///< max size of per epoll_wait
+	#define NETP_EPOLL_PER_HANDLE_SIZE			(128)	///< initial size of per epoll_wait, doubles on a full batch
+	#define NETP_EPOLL_PER_HANDLE_SIZE_MAX		(4096)	///< max size of per epoll_wait
+	//@note: interest changes are applied by one epoll_ctl per fd right before epoll_wait, a watch and unwatch in the same round cost nothing
+	#define NETP_EPOLL_COALESCE_CTL
+#endif
+
+//io_uring is selected by io_poller_type::T_IO_URING, epoll stays the default
+#if defined(NETP_HAS_POLLER_EPOLL) && defined(_NETP_GNU_LINUX) && !defined(NETP_DISABLE_IO_URING) && defined(__has_include)
+	#if __has_include(<linux/io_uring.h>)
+		#include <linux/io_uring.h>
+		//the poller needs the multishot poll with in place update (5.13) and the deferred task run (5.19), an older uapi header stays on epoll
+		#if defined(IORING_SETUP_COOP_TASKRUN) && defined(IORING_SETUP_TASKRUN_FLAG) && defined(IORING_SQ_TASKRUN) && defined(IORING_POLL_ADD_MULTI) && defined(IORING_POLL_UPDATE_EVENTS) && defined(IORING_ENTER_EXT_ARG)
+			#define NETP_HAS_POLLER_IO_URING
+			#define NETP_IO_URING_ENTRIES				(1024)	///< sq size, cq is twice of it
+			#define NETP_IO_URING_PBUF_COUNT			(128)	///< provided buffers of the multishot recv of a loop, power of 2
+			#define NETP_IO_URING_PBUF_SIZE				(16*1024)	///< bytes of a provided buffer
+			#define NETP_IO_URING_PBUF_GID				(0)	///< buffer group id of the provided buffers
+			#define NETP_IO_URING_SEND_IOV_MAX			(64)	///< iov of one sendmsg of a channel
+		#endif
+	#endif
 #endif
 
 //#define NETP_ENABLE_TASK_TRACK
@@ -28,10 +28,25 @@
 	#define __NETP_ENABLE_SO_INCOMING_CPU
 #endif
 
+//recvmmsg (since Linux 2.6.33), sendmmsg (since Linux 3.0)
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,0,0)
+	#define __NETP_ENABLE_MMSG
+#endif
+
+//eventfd with EFD_NONBLOCK|EFD_CLOEXEC (since Linux 2.6.27)
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,27)
+	#include <sys/eventfd.h>
+	#define __NETP_ENABLE_EVENTFD
+#endif
+
 #define NETP_CLOSE_SOCKET	::close
 #define NETP_DUP						dup
 #define NETP_DUP2					dup2
 #define NETP_USE_PIPE_AS_INTRFD				1
+#ifdef __NETP_ENABLE_EVENTFD
+	//one fd, 8 bytes counter, no pipe buffer
+	#define NETP_USE_EVENTFD_AS_INTRFD			1
+#endif
 
 #define netp_last_errno() NETP_NEGATIVE((int)errno)
 #define netp_set_last_errno(e) (errno=(NETP_ABS(e)))
@@ -12,22 +12,50 @@
 #include <netp/promise.hpp>
 #include <netp/io_monitor.hpp>
 
+//@note: max entries of the answer cache of one resolver
+#define NETP_DNS_CACHE_MAX (4096)
+//@note: ttl of a positive answer is clamped into [MIN, MAX] (in seconds)
+#define NETP_DNS_CACHE_TTL_MIN (1)
+#define NETP_DNS_CACHE_TTL_MAX (3600)
+//@note: ttl of NXDOMAIN|NODATA (in seconds)
+#define NETP_DNS_CACHE_NEGATIVE_TTL (30)
+//@note: ttl of an answer from the hosts file of the system (in seconds)
+#define NETP_DNS_CACHE_HOSTS_FILE_TTL (60)
+
 namespace netp {
 	class event_loop;
 	class socket_channel;
 	struct io_ctx;
 
-	typedef netp::promise< std::tuple<int, std::vector<netp::ipv4_t,netp::allocator<netp::ipv4_t>>>> dns_query_promise;
+	typedef std::vector<netp::ipv4_t, netp::allocator<netp::ipv4_t>> dns_ipv4s_t;
+	typedef netp::promise< std::tuple<int, dns_ipv4s_t>> dns_query_promise;
 
 	class dns_resolver;
 	struct async_dns_query
 	{
 		NRP<dns_resolver> dnsr;
-		NRP<dns_query_promise> dnsquery_p;
-
-#ifdef _NETP_DEBUG
 		netp::string_t host;
-#endif
+	};
+
+	//might be read from any thread, the counters are relaxed
+	struct dns_cache_stat {
+		u64_t hit; //answered by the cache, negative ones included
+		u64_t negative_hit; //answered by a cached NXDOMAIN|NODATA
+		u64_t static_hit; //answered by the static hosts
+		u64_t miss; //sent to c-ares
+		u64_t coalesced; //merged into the in-flight query of the same name
+		u32_t size;
+	};
+
+	//fnv-1a, names are lower cased before lookup
+	struct dns_name_hash {
+		std::size_t operator()(netp::string_t const& name) const {
+			u64_t h = 14695981039346656037ULL;
+			for (std::size_t i = 0; i < name.length(); ++i) {
+				h = (h ^ u8_t(name[i])) * 1099511628211ULL;
+			}
+			return std::size_t(h);
+		}
 	};
 
 	enum ares_fd_monitor_flag {
@@ -67,6 +95,11 @@ namespace netp {
 		f_drf_timeout_barrier = 1 << 6 //pending restart action
 	};
 
+	//answer cache of one resolver (one loop), loop thread only
+	//1, static hosts go first, they never expire
+	//2, a positive answer lives for the min ttl of its A records, NXDOMAIN|NODATA lives for NETP_DNS_CACHE_NEGATIVE_TTL
+	//3, queries of the same name are merged into one c-ares query while it is in flight
+	//4, the expired ones are swept once the cache is full, refer to NETP_DNS_CACHE_MAX
 	class event_loop;
 	class dns_resolver :
 		public netp::ref_base
@@ -74,7 +107,18 @@ namespace netp {
 		friend class event_loop;
 		friend struct ares_fd_monitor;
 		friend struct async_dns_query;
-		
+
+		struct dns_cache_entry {
+			int code;
+			dns_ipv4s_t ipv4s;
+			i64_t expire; //steady clock, in millis
+		};
+
+		typedef std::vector<NRP<dns_query_promise>, netp::allocator<NRP<dns_query_promise>>> dns_query_promises_t;
+		typedef std::unordered_map<netp::string_t, dns_cache_entry, dns_name_hash, std::equal_to<netp::string_t>, netp::allocator<std::pair<const netp::string_t, dns_cache_entry>>> dns_cache_map_t;
+		typedef std::unordered_map<netp::string_t, dns_ipv4s_t, dns_name_hash, std::equal_to<netp::string_t>, netp::allocator<std::pair<const netp::string_t, dns_ipv4s_t>>> dns_static_map_t;
+		typedef std::unordered_map<netp::string_t, dns_query_promises_t, dns_name_hash, std::equal_to<netp::string_t>, netp::allocator<std::pair<const netp::string_t, dns_query_promises_t>>> dns_inflight_map_t;
+
 		NRP<event_loop> L;
 
 		void* m_ares_channel;
@@ -88,6 +132,17 @@ namespace netp {
 		typedef std::pair<SOCKET, NRP<ares_fd_monitor>> ares_fd_monitor_pair_t;
 		ares_fd_monitor_map_t m_ares_fd_monitor_map;
 
+		dns_static_map_t m_static;
+		dns_cache_map_t m_cache;
+		dns_inflight_map_t m_inflight;
+
+		std::atomic<u64_t> m_stat_hit;
+		std::atomic<u64_t> m_stat_negative_hit;
+		std::atomic<u64_t> m_stat_static_hit;
+		std::atomic<u64_t> m_stat_miss;
+		std::atomic<u64_t> m_stat_coalesced;
+		std::atomic<u32_t> m_stat_size;
+
 	public:
 		SOCKET __ares_socket_create(int af, int type, int proto);
 		int __ares_socket_close(SOCKET fd);
@@ -109,6 +164,10 @@ namespace netp {
 		void cb_dns_timeout(NRP<netp::timer> const& t);
 		void _do_resolve(string_t const& domain, NRP<dns_query_promise> const& p);
 
+		bool _cache_lookup(string_t const& name, NRP<dns_query_promise> const& p);
+		void _cache_insert(string_t const& name, int code, dns_ipv4s_t const& ipv4s, u32_t ttl);
+		void _query_done(string_t const& name, int code, dns_ipv4s_t const& ipv4s);
+
 	public:
 		dns_resolver(NRP<event_loop> const& L_);
 		~dns_resolver();
@@ -116,10 +175,17 @@ namespace netp {
 		void init();
 		void deinit();
 
+		//dotip, or dotip:port
 		NRP<netp::promise<int>> add_name_server(std::vector<netp::string_t, netp::allocator<netp::string_t>> const& ns);
+		//hosts file style: "dotip name [alias ...]"
+		NRP<netp::promise<int>> add_static_host(netp::string_t const& line);
 		NRP<dns_query_promise> resolve(string_t const& domain);
 
-		static void __ares_gethostbyname_cb(void* arg, int status, int timeouts, struct hostent* hostent);
+		void cache_stat(dns_cache_stat& st) const;
+		//drop all the cached answers, the static hosts are kept
+		void cache_flush();
+
+		static void __ares_search_cb(void* arg, int status, int timeouts, unsigned char* abuf, int alen);
 	};
 }
 
@@ -10,7 +10,10 @@
 #include <netp/mutex.hpp>
 
 #include <netp/promise.hpp>
+#include <netp/mpsc_queue.hpp>
 #include <netp/packet.hpp>
+#include <netp/packet_pool.hpp>
+#include <netp/address.hpp>
 #include <netp/poller_abstract.hpp>
 #include <netp/timer.hpp>
 #include <netp/dns_resolver.hpp>
@@ -31,7 +34,27 @@
 	#error "unknown poller type"
 #endif
 
-//#define NETP_DEBUG_LOOP_TIME
+//the loops of io_uring serve socket_channel by the same readiness contract as the default poller
+#if defined(NETP_HAS_POLLER_IO_URING)
+	#define NETP_IS_SOCKET_POLLER_TYPE(t) (((t) == NETP_DEFAULT_POLLER_TYPE) || ((t) == netp::io_poller_type::T_IO_URING))
+#else
+	#define NETP_IS_SOCKET_POLLER_TYPE(t) ((t) == NETP_DEFAULT_POLLER_TYPE)
+#endif
+
+#ifdef __NETP_ENABLE_MMSG
+	//max datagrams received by one recvmmsg|sent by one sendmmsg
+	#define NETP_UDP_MMSG_BATCH (16)
+	//udp payload can not exceed 0xffff, no need to reserve channel_read_buf_size for each slot
+	#define NETP_UDP_MMSG_SLOT_SIZE (0xffff)
+#endif
+
+//the spin budget of a busy poll loop is halved by every spin that catches nothing, down to busy_poll_us/NETP_BUSY_POLL_SHRINK_MIN, and doubled by every catch, up to busy_poll_us
+#define NETP_BUSY_POLL_SHRINK_MIN (8)
+
+//the busy permille of a loop is sampled once per window, the sample is taken as 0 if it is older than two windows (the loop is blocked in the poller)
+#define NETP_LOOP_LOAD_WINDOW (10*1000*1000LL)
+//f_group_next_by_load scans all the loops of a group up to this size, power of two choices for a larger one
+#define NETP_LOOP_NEXT_BY_LOAD_SCAN_MAX (8)
 
 namespace netp {
 
@@ -42,7 +65,10 @@ namespace netp {
 		f_th_thread_affinity =1<<0,
 		f_th_priority_above_normal =1<<1,
 		f_th_priority_time_critical = 1 << 2,
-		f_enable_dns_resolver =1<<3
+		f_enable_dns_resolver =1<<3,
+		f_channel_read_right_size =1<<4, //a read of min(packet_pool::small_size(), channel_read_buf_size/4) bytes at most is copied into a small packet, the read buffer is kept for the next read
+		f_channel_busy_poll =1<<5, //set SO_BUSY_POLL of busy_poll_us on the sockets of the loop, it needs CAP_NET_ADMIN to go above net.core.busy_read
+		f_group_next_by_load =1<<6 //event_loop_group::next picks a loop by event_loop::load instead of round robin
 	};
 
 	struct event_loop_cfg {
@@ -51,7 +77,9 @@ namespace netp {
 			flag(flag_),
 			thread_affinity(0),
 			no_wait_us(1),
-			channel_read_buf_size(read_buf_)
+			timer_broker_type(T_TIMER_HEAP),
+			channel_read_buf_size(read_buf_),
+			busy_poll_us(0)
 		{}
 
 		//u16_t no_wait_us wide used construct 
@@ -60,17 +88,48 @@ namespace netp {
 			flag(flag_),
 			thread_affinity(0),
 			no_wait_us(u8_t(no_wait_us_)),
-			channel_read_buf_size(read_buf_)
+			timer_broker_type(T_TIMER_HEAP),
+			channel_read_buf_size(read_buf_),
+			busy_poll_us(0)
 		{}
 
 		u8_t type;
 		u8_t flag;
 		u8_t thread_affinity;
 		u8_t no_wait_us;
+		u8_t timer_broker_type; //refer to netp::timer_broker_type
 		u32_t channel_read_buf_size;
+		//keep polling with zero timeout for up to busy_poll_us after the last io|task before blocking in the poller, 0 to disable
+		u32_t busy_poll_us;
+		//dotip[:port] of a name server, or a hosts file style static entry: "dotip name [alias ...]"
 		std::vector<netp::string_t, netp::allocator<netp::string_t>> dns_hosts;
 	};
 
+	//counters of a loop since it runs, the time ones are in nano of steady clock
+	//a round runs the queued tasks, the expired timers, and polls once, poll_ns + task_ns + io_ns is the time of all the rounds
+	struct event_loop_stat {
+		u64_t rounds;
+		u64_t poll_ns; //blocked in the poller, or a round that has nothing done
+		u64_t task_ns; //running the tasks and the timers
+		u64_t io_ns; //dispatching the polled io events
+		u64_t tasks; //tasks run
+		u64_t timers; //timers fired
+		u64_t io_events;
+		u64_t io_wakeups; //polls that return any event, io_events/io_wakeups is the events per wakeup
+		u64_t interrupts; //wakeups of the poller sent by the tasks scheduled from other threads
+		u64_t coalesced; //tasks scheduled from other threads without a wakeup, the loop is awake or a wakeup is on the way
+		u64_t spin_rounds; //refer to event_loop::spin_rounds
+		u64_t sleep_rounds;
+		i64_t round_tp; //begin of the current round, the loop stalls in a task|timer|callback if it is far behind while the loop is not waiting
+		u32_t tq_max; //max tasks queued at the begin of a round
+		u32_t io_events_max; //max events of one poll
+		u32_t tq; //tasks queued
+		u32_t io_ctx; //fds watched
+		u32_t busy; //busy permille of the last NETP_LOOP_LOAD_WINDOW
+		u32_t load; //refer to event_loop::load
+		bool waiting; //blocked in the poller
+	};
+
 	class event_loop;
 	class event_loop_group;
 	typedef std::function<NRP<event_loop>(NRP<netp::event_loop_group> const& g, event_loop_cfg const& cfg) > fn_event_loop_maker_t;
@@ -109,24 +168,53 @@ namespace netp {
 		const NRP<poller_abstract> m_poller;
 		NRP<timer_broker> m_tb;
 		NRP<dns_resolver> m_dns_resolver;
+		//buffers of read, and the packets delivered by read, refer to packet_pool.hpp
+		NRP<netp::packet_pool> m_channel_rcv_pool;
 		NRP<netp::packet> m_channel_rcv_buf;
+		u32_t m_channel_rcv_right_size_max;
+#ifdef __NETP_ENABLE_MMSG
+		//shared by all udp channel of this loop, slot would be refilled lazily once it has been fired to pipeline
+		NRP<netp::packet> m_channel_rcv_mmsg_buf[NETP_UDP_MMSG_BATCH];
+		NRP<netp::address> m_channel_rcv_mmsg_addr[NETP_UDP_MMSG_BATCH];
+#endif
 		NRP<netp::thread> m_th;
 		NRP<netp::event_loop_group> m_group;
 
-		int m_io_ctx_count;
+		//written by the loop only, read by event_loop_group::next
+		std::atomic<int> m_io_ctx_count;
 		int m_io_ctx_count_before_running;
 		std::atomic<long> m_internal_ref_count;
-#ifdef NETP_DEBUG_LOOP_TIME
-		long long m_loop_last_tp;
-		long long m_last_wait;
-#endif
-
-		//@note: deque,vector, vector with reserved capacity performance test metric as below
-		//https://baptiste-wicht.com/posts/2012/12/cpp-benchmark-vector-list-deque.html
-		spin_mutex m_tq_mutex;
-		io_task_q_t* m_tq_standby;
-		io_task_q_t* m_tq;
-		io_task_q_t m_tqs[2];
+		//busy poll, refer to event_loop_cfg::busy_poll_us
+		i64_t m_busy_last_active;
+		i64_t m_busy_budget;
+		bool m_busy_spinning;
+		std::atomic<u64_t> m_spin_rounds;
+		std::atomic<u64_t> m_sleep_rounds;
+		//load, refer to f_group_next_by_load
+		i64_t m_load_window_begin;
+		i64_t m_load_busy_ns;
+		std::atomic<u32_t> m_load_busy;
+		std::atomic<i64_t> m_load_stamp;
+		//refer to event_loop_stat, written by the loop only
+		std::atomic<u64_t> m_stat_rounds;
+		std::atomic<u64_t> m_stat_poll_ns;
+		std::atomic<u64_t> m_stat_task_ns;
+		std::atomic<u64_t> m_stat_io_ns;
+		std::atomic<u64_t> m_stat_tasks;
+		std::atomic<u64_t> m_stat_timers;
+		std::atomic<u64_t> m_stat_io_events;
+		std::atomic<u64_t> m_stat_io_wakeups;
+		std::atomic<i64_t> m_stat_round_tp;
+		std::atomic<u32_t> m_stat_tq_max;
+		std::atomic<u32_t> m_stat_io_events_max;
+
+		//@note: lock free for producers, the callable is stored in the queue node, refer to mpsc_queue.hpp
+		//m_tq_count: tasks scheduled but not finished yet, increased before push, decreased after run
+		mpsc_queue m_tq;
+		std::atomic<u32_t> m_tq_count;
+		//written by the producers, next to m_tq_count that they have written already
+		std::atomic<u64_t> m_stat_interrupts;
+		std::atomic<u64_t> m_stat_coalesced;
 
 		//timer_timepoint_t m_wait_until;
 		event_loop_cfg m_cfg;
@@ -139,6 +227,60 @@ namespace netp {
 		inline void store_internal_ref_count( long count ) { m_internal_ref_count.store( count, std::memory_order_relaxed); }
 		inline void inc_internal_ref_count() { m_internal_ref_count.fetch_add(1, std::memory_order_relaxed); }
 
+		//for the counter of a single writer
+		template <class T>
+		__NETP_FORCE_INLINE static void __stat_add(std::atomic<T>& c, T n) {
+			c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+		}
+		template <class T>
+		__NETP_FORCE_INLINE static void __stat_max(std::atomic<T>& c, T n) {
+			if (n > c.load(std::memory_order_relaxed)) {
+				c.store(n, std::memory_order_relaxed);
+			}
+		}
+
+		//spin if the last io|task is within the budget, no m_waiting is set for a spin, the task pushed meanwhile is seen by the next round without an interrupt
+		bool __busy_poll_spin() {
+			const i64_t now = netp::now<std::chrono::nanoseconds, netp::steady_clock_t>().time_since_epoch().count();
+			if ((now - m_busy_last_active) < m_busy_budget) {
+				m_busy_spinning = true;
+				__stat_add(m_spin_rounds, u64_t(1));
+				return true;
+			}
+			if (m_busy_spinning) {
+				//the whole budget is spun for nothing
+				m_busy_spinning = false;
+				m_busy_budget = NETP_MAX(m_busy_budget >> 1, i64_t(m_cfg.busy_poll_us) * 1000LL / NETP_BUSY_POLL_SHRINK_MIN);
+			}
+			__stat_add(m_sleep_rounds, u64_t(1));
+			return false;
+		}
+
+		//nwork: tasks run and events polled by the last round
+		__NETP_FORCE_INLINE
+		void __busy_poll_update(u32_t nwork, i64_t now) {
+			if (nwork == 0) {
+				return;
+			}
+			if (m_busy_spinning) {
+				m_busy_budget = NETP_MIN(m_busy_budget << 1, i64_t(m_cfg.busy_poll_us) * 1000LL);
+			}
+			m_busy_last_active = now;
+		}
+
+		//add the task_ns + io_ns of a round, publish its permille every NETP_LOOP_LOAD_WINDOW
+		__NETP_FORCE_INLINE
+		void __load_round_end(i64_t now, i64_t busy_ns) {
+			m_load_busy_ns += busy_ns;
+			const i64_t window = now - m_load_window_begin;
+			if (window >= NETP_LOOP_LOAD_WINDOW) {
+				m_load_busy.store(u32_t((m_load_busy_ns * 1000) / window), std::memory_order_relaxed);
+				m_load_stamp.store(now, std::memory_order_relaxed);
+				m_load_window_begin = now;
+				m_load_busy_ns = 0;
+			}
+		}
+
 		//0,	NO WAIT
 		//~0,	INFINITE WAIT
 		//>0,	WAIT nanosecond
@@ -152,28 +294,20 @@ namespace netp {
 			//@note: select, epoll_wait cost too much time to return (ms level)
 			if ( (ndelayns != TIMER_TIME_INFINITE) && (ndelayns <= (i64_t(m_cfg.no_wait_us)*1000LL)) ) {
 				//less than 1us
-#ifdef NETP_DEBUG_LOOP_TIME
-				m_last_wait = 0;
-#endif
+				return 0;
+			}
+			if ((m_cfg.busy_poll_us != 0) && __busy_poll_spin()) {
 				return 0;
 			}
 
-			m_tq_mutex.lock();
-			if (m_tq_standby->empty()) {
-				//the following line must be guard by m_tq_mutex.lock
-				NETP_POLLER_WAIT_ENTER(m_waiting);
-				m_tq_mutex.unlock();
-				
-#ifdef NETP_DEBUG_LOOP_TIME
-				m_last_wait = ndelayns;
-#endif
+			//pair with the fence in __tq_push: either we see the task, or the producer see m_waiting and interrupt us
+			NETP_POLLER_WAIT_ENTER(m_waiting);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (m_tq_count.load(std::memory_order_relaxed) == 0) {
 				return ndelayns;
 			}
 
-			m_tq_mutex.unlock();
-#ifdef NETP_DEBUG_LOOP_TIME
-			m_last_wait = 0;
-#endif
+			m_waiting.store(false, std::memory_order_relaxed);
 			return 0;
 		}
 
@@ -195,25 +329,122 @@ namespace netp {
 		__NETP_FORCE_INLINE
 		u8_t thread_affinity() const { return m_cfg.thread_affinity; }
 
+		__NETP_FORCE_INLINE
+		bool has_thread_affinity() const { return (m_cfg.flag&f_th_thread_affinity) != 0; }
+
 		__NETP_FORCE_INLINE
 		u8_t poller_type() const { return m_cfg.type; }
 
+		__NETP_FORCE_INLINE
+		NRP<poller_abstract> const& poller() const { return m_poller; }
+
+		//SO_BUSY_POLL of the sockets of the loop, 0 if f_channel_busy_poll is not set
+		__NETP_FORCE_INLINE
+		u32_t channel_busy_poll_us() const { return (m_cfg.flag & f_channel_busy_poll) ? m_cfg.busy_poll_us : 0; }
+
+		//rounds polled with zero timeout by busy poll, and rounds that might block in the poller, the ratio tells how busy the spin is
+		__NETP_FORCE_INLINE
+		u64_t spin_rounds() const { return m_spin_rounds.load(std::memory_order_relaxed); }
+		__NETP_FORCE_INLINE
+		u64_t sleep_rounds() const { return m_sleep_rounds.load(std::memory_order_relaxed); }
+
+		//busy permille of the last window + live io ctx + queued tasks, a busy loop weighs as 1000 idle channels
+		__NETP_FORCE_INLINE
+		u32_t load(i64_t now) const {
+			const u32_t busy = ((now - m_load_stamp.load(std::memory_order_relaxed)) < (NETP_LOOP_LOAD_WINDOW << 1)) ? m_load_busy.load(std::memory_order_relaxed) : 0;
+			return busy + u32_t(m_io_ctx_count.load(std::memory_order_relaxed) - m_io_ctx_count_before_running) + m_tq_count.load(std::memory_order_relaxed);
+		}
+
+		//a snapshot of the counters, safe to call from any thread, the fields are read one by one without a lock
+		void stat(event_loop_stat& st) const;
+
 		__NETP_FORCE_INLINE
 		NRP<netp::packet>& channel_rcv_buf() {
 			return m_channel_rcv_buf;
 		}
 
+		__NETP_FORCE_INLINE
+		NRP<netp::packet_pool> const& channel_rcv_pool() const {
+			return m_channel_rcv_pool;
+		}
+
+		//0 if f_channel_read_right_size is not set
+		__NETP_FORCE_INLINE
+		u32_t channel_rcv_right_size_max() const {
+			return m_channel_rcv_right_size_max;
+		}
+
+		//take the read buffer of nbytes out to the pipeline, a small one is copied out, otherwise the read buffer itself is taken and refilled from the pool
+		NRP<netp::packet> channel_rcv_buf_take(u32_t nbytes) {
+			NRP<netp::packet> pkt;
+			if (nbytes <= m_channel_rcv_right_size_max) {
+				pkt = m_channel_rcv_pool->get(nbytes);
+				pkt->write(m_channel_rcv_buf->head(), nbytes);
+				return pkt;
+			}
+			pkt = m_channel_rcv_pool->get(m_cfg.channel_read_buf_size);
+			m_channel_rcv_buf->incre_write_idx(nbytes);
+			pkt.swap(m_channel_rcv_buf);
+			return pkt;
+		}
+
 		__NETP_FORCE_INLINE
 		u32_t channel_rcv_buf_size() const {
 			return m_cfg.channel_read_buf_size;
 		}
 
+#ifdef __NETP_ENABLE_MMSG
+		__NETP_FORCE_INLINE
+		u32_t channel_rcv_mmsg_slot_size() const {
+			return NETP_MIN(m_cfg.channel_read_buf_size, u32_t(NETP_UDP_MMSG_SLOT_SIZE));
+		}
+
+		//refill the consumed slot, and point msgvec[i] to slot i
+		void channel_rcv_mmsg_prepare(struct mmsghdr* msgvec, struct iovec* iov) {
+			const u32_t slot_size = channel_rcv_mmsg_slot_size();
+			for (u32_t i = 0; i < NETP_UDP_MMSG_BATCH; ++i) {
+				if (m_channel_rcv_mmsg_buf[i] == nullptr) {
+					m_channel_rcv_mmsg_buf[i] = m_channel_rcv_pool->get(slot_size);
+				}
+				if (m_channel_rcv_mmsg_addr[i] == nullptr) {
+					m_channel_rcv_mmsg_addr[i] = netp::make_ref<netp::address>();
+				}
+				NETP_ASSERT(m_channel_rcv_mmsg_buf[i]->len() == 0);
+				iov[i].iov_base = m_channel_rcv_mmsg_buf[i]->head();
+				iov[i].iov_len = slot_size;
+				msgvec[i].msg_hdr.msg_name = m_channel_rcv_mmsg_addr[i]->sockaddr_v4();
+				msgvec[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+				msgvec[i].msg_hdr.msg_iov = &iov[i];
+				msgvec[i].msg_hdr.msg_iovlen = 1;
+				msgvec[i].msg_hdr.msg_control = NULL;
+				msgvec[i].msg_hdr.msg_controllen = 0;
+				msgvec[i].msg_hdr.msg_flags = 0;
+				msgvec[i].msg_len = 0;
+			}
+		}
+
+		__NETP_FORCE_INLINE
+		NRP<netp::packet>& channel_rcv_mmsg_buf(u32_t i) {
+			return m_channel_rcv_mmsg_buf[i];
+		}
+
+		__NETP_FORCE_INLINE
+		NRP<netp::address>& channel_rcv_mmsg_addr(u32_t i) {
+			return m_channel_rcv_mmsg_addr[i];
+		}
+#endif
+
 		__NETP_FORCE_INLINE
 		NRP<dns_query_promise> resolve(string_t const& domain) {
 			NETP_ASSERT(m_cfg.flag & f_enable_dns_resolver);
 			return m_dns_resolver->resolve(domain);
 		}
 
+		void dns_stat(dns_cache_stat& st) const {
+			NETP_ASSERT(m_cfg.flag & f_enable_dns_resolver);
+			m_dns_resolver->cache_stat(st);
+		}
+
 		NRP<event_loop_group> group() const;
 
 //#define _NETP_DUMP_SCHEDULE_COST
@@ -237,32 +468,65 @@ namespace netp {
 		[event_loop]schedule, cost: 100 ns, interrupted: 0
 		*/
 
+	private:
+		//the release store of mpsc_queue::push and acquire load of mpsc_queue::pop works as the memory barrier for memory accesses across loops in between task caller and task callee
+		//only the producer who make m_tq_count from 0 to non-zero need to check m_waiting, the others would be seen by the loop before it enter waiting
+		__NETP_FORCE_INLINE
+		bool __tq_push(task_node* first, task_node* last, u32_t n) {
+			const u32_t prev = m_tq_count.fetch_add(n, std::memory_order_relaxed);
+			m_tq.push(first, last);
+			if (in_event_loop()) {
+				return false;
+			}
+			if (prev == 0) {
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (m_waiting.load(std::memory_order_relaxed)) {
+					m_poller->interrupt_wait();
+					m_stat_interrupts.fetch_add(1, std::memory_order_relaxed);
+					return true;
+				}
+			}
+			m_stat_coalesced.fetch_add(n, std::memory_order_relaxed);
+			return false;
+		}
+
+	public:
 		template <class fn_task_t>
 		inline void schedule(fn_task_t&& f) {
-			//NOTE: upate on 2021/04/03
-			//lock_guard of m_tq_mutex also works as a memory barrier for memory accesses across loops in between task caller and task callee
-
-			//NOTE: update on 2021/03/28
-			//lock_guard of m_tq_mutex would pose a load/store memory barrier at least
-			//these kinds of barrier could make sure that the compiler would not reorder the instruction around the barrier, so interrupt_poller would always have a false initial value
-			//as  a per thread variable, the reorder brought by CPU should not be a issue for _interrupt_poller
 #ifdef _NETP_DUMP_SCHEDULE_COST
 			long long __begin = netp::now<std::chrono::nanoseconds, netp::steady_clock_t>().time_since_epoch().count();
 #endif
-			m_tq_mutex.lock();
-			m_tq_standby->emplace_back(std::forward<fn_task_t>(f));
-			if(m_tq_standby->size() == 1 && !in_event_loop() && m_waiting.load(std::memory_order_relaxed)) {
-				m_tq_mutex.unlock();
-				m_poller->interrupt_wait();
-				return;
-			}
-			m_tq_mutex.unlock();
+			task_node* n = task_node::make(std::forward<fn_task_t>(f));
 #ifdef _NETP_DUMP_SCHEDULE_COST
+			const bool _interrupt_poller = __tq_push(n, n, 1);
 			long long __end = netp::now<std::chrono::nanoseconds, netp::steady_clock_t>().time_since_epoch().count();
 			printf("[event_loop]schedule, cost: %llu ns, interrupted: %d\n", __end - __begin, _interrupt_poller);
+#else
+			__tq_push(n, n, 1);
 #endif
 		}
 
+		//schedule a batch of tasks with one push (and one wake up at most), the element of tasks would be moved
+		template <class fn_task_container_t>
+		inline void schedule_n(fn_task_container_t&& tasks) {
+			task_node* first = nullptr;
+			task_node* last = nullptr;
+			u32_t n = 0;
+			for (auto& f : tasks) {
+				task_node* node = task_node::make(std::move(f));
+				if (first == nullptr) {
+					first = node;
+				} else {
+					last->next.store(node, std::memory_order_relaxed);
+				}
+				last = node;
+				++n;
+			}
+			if (n > 0) {
+				__tq_push(first, last, n);
+			}
+		}
+
 		template <class fn_task_t>
 		inline void execute(fn_task_t&& f) {
 			if (in_event_loop()) {
@@ -283,11 +547,14 @@ namespace netp {
 			return std::this_thread::get_id() == m_tid;
 		}
 
+		//the loop that runs on the calling thread, nullptr if it is not a loop thread
+		static event_loop* this_loop();
+
 		template <class timer_t>
 		void launch(timer_t&& tm , NRP<netp::promise<int>> const& lf = nullptr ) {
 			if(!in_event_loop()) {
 				tm->update_expiration();
-				schedule([L = NRP<event_loop>(this), _tm=std::move(tm),lf]() {
+				schedule([L = NRP<event_loop>(this), _tm=std::forward<timer_t>(tm),lf]() {
 					L->launch((_tm), lf);
 				});
 				return;
@@ -301,6 +568,19 @@ namespace netp {
 			}
 		}
 
+		//the callee would not be invoked if the timer has not been fired yet
+		void cancel(NRP<timer> const& tm) {
+			if (!in_event_loop()) {
+				schedule([L = NRP<event_loop>(this), tm]() {
+					L->cancel(tm);
+				});
+				return;
+			}
+			if (m_tb != nullptr) {
+				m_tb->cancel(tm);
+			}
+		}
+
 		inline int io_do(io_action act, io_ctx* ctx) {
 #ifdef _NETP_DEBUG
 			NETP_ASSERT(in_event_loop());
@@ -318,7 +598,7 @@ namespace netp {
 			if (m_state.load(std::memory_order_acquire) < u8_t(loop_state::S_TERMINATING)) {
 				io_ctx* _ctx= m_poller->io_begin(fd, iom);
 				if (NETP_LIKELY(_ctx != nullptr)) {
-					++m_io_ctx_count;
+					m_io_ctx_count.store(m_io_ctx_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
 				}
 				return _ctx;
 			}
@@ -330,7 +610,9 @@ namespace netp {
 #endif
 			m_poller->io_end(ctx);
 
-			if ( (--m_io_ctx_count == m_io_ctx_count_before_running) && m_state.load(std::memory_order_acquire) == u8_t(loop_state::S_TERMINATING)) {
+			const int io_ctx_count = m_io_ctx_count.load(std::memory_order_relaxed) - 1;
+			m_io_ctx_count.store(io_ctx_count, std::memory_order_relaxed);
+			if ( (io_ctx_count == m_io_ctx_count_before_running) && m_state.load(std::memory_order_acquire) == u8_t(loop_state::S_TERMINATING)) {
 				__do_enter_terminated();
 			}
 		}
@@ -338,6 +620,19 @@ namespace netp {
 
 	class app;
 	typedef std::vector<NRP<event_loop>, netp::allocator<NRP<event_loop>>> event_loop_vector_t;
+
+	//event_loop_stat of the loops in start order, and the sum of them, refer to event_loop_group::stat
+	struct event_loop_group_stat {
+		i64_t now;
+		event_loop_stat total;
+		std::vector<event_loop_stat, netp::allocator<event_loop_stat>> L;
+	};
+
+	//immutable once published, the loops are owned by event_loop_group
+	struct event_loop_snapshot {
+		std::vector<event_loop*, netp::allocator<event_loop*>> L;
+	};
+
 	class event_loop_group:
 		public ref_base
 	{
@@ -354,6 +649,12 @@ namespace netp {
 		std::atomic<u32_t> m_curr_loop_idx;
 		event_loop_vector_t m_loop;
 
+		//next() reads m_loop by the snapshot without m_loop_mtx, it counts itself in m_snapshot_readers[epoch&1] from the load of the snapshot to the ref of the loop it picks
+		//a replaced snapshot is released after __snapshot_synchronize(), the readers of both epochs have drained by then (rcu style, new readers go to the other counter, no writer starvation)
+		std::atomic<event_loop_snapshot*> m_snapshot;
+		std::atomic<u32_t> m_snapshot_epoch;
+		std::atomic<u32_t> m_snapshot_readers[2];
+
 		std::atomic<bye_event_loop_state> m_bye_state;
 		NRP<event_loop> m_bye_event_loop;
 		long m_bye_ref_count;
@@ -361,6 +662,25 @@ namespace netp {
 		fn_event_loop_maker_t m_fn_loop_maker;
 
 		void _wait_loop();
+		//with m_loop_mtx locked
+		void __bye_launch();
+		void __snapshot_update();
+		void __snapshot_synchronize();
+
+		inline u32_t __snapshot_read_enter() {
+			const u32_t e = m_snapshot_epoch.load(std::memory_order_seq_cst) & 1;
+			m_snapshot_readers[e].fetch_add(1, std::memory_order_seq_cst);
+			return e;
+		}
+		inline void __snapshot_read_leave(u32_t e) {
+			m_snapshot_readers[e].fetch_sub(1, std::memory_order_release);
+		}
+		//with the snapshot read entered, a loop that is terminating takes no new channel or task from next()
+		inline static bool __is_terminating(event_loop const* L) {
+			return L->m_state.load(std::memory_order_acquire) >= u8_t(loop_state::S_TERMINATING);
+		}
+		NRP<event_loop> __next_bye();
+		event_loop* __next_by_load(event_loop_snapshot const* s);
 	public:
 		event_loop_group(event_loop_cfg const& cfg, fn_event_loop_maker_t const& fn_maker);
 		~event_loop_group();
@@ -372,6 +692,10 @@ namespace netp {
 		void stop();
 
 		netp::size_t size();
+		//a copy of the current loops, in start order
+		event_loop_vector_t loops();
+		//the counters of the current loops, the total sums them up except that: the max ones are the max, round_tp is the oldest one of the loops not waiting (0 if all are waiting), waiting is set if all are waiting
+		void stat(event_loop_group_stat& st);
 
 		NRP<event_loop> next(std::set<NRP<event_loop>> const& exclude_this_set_if_have_more);
 		NRP<event_loop> next();
@@ -17,8 +17,9 @@ namespace netp { namespace handler {
 		util_hlen<size_width_t> m_util_hlen;
 		NRP<netp::packet> m_tmp_for_fire;
 	public:
-		hlen_basic() :
-			channel_handler_abstract(CH_INBOUND_READ| CH_OUTBOUND_WRITE|CH_ACTIVITY_CONNECTED|CH_ACTIVITY_READ_CLOSED),
+		//outbound_framing: false for a decode only hlen, the upper handler frames the outbound bytes by util_hlen itself (refer to rpc)
+		explicit hlen_basic(bool outbound_framing = true) :
+			channel_handler_abstract(CH_INBOUND_READ|CH_ACTIVITY_CONNECTED|CH_ACTIVITY_READ_CLOSED| (outbound_framing ? (CH_OUTBOUND_WRITE|CH_OUTBOUND_WRITE_CHAIN) : 0)),
 			m_read_closed(true),
 			m_util_hlen(),
 			m_tmp_for_fire(nullptr)
@@ -56,9 +57,17 @@ namespace netp { namespace handler {
 	#ifdef _NETP_DEBUG
 			NETP_ASSERT(outlet->len() > 0 );
 	#endif
-			NRP<netp::packet> lenoutlet = netp::make_ref<netp::packet>(outlet->head(), outlet->len());
-			m_util_hlen.encode(lenoutlet);
-			ctx->write(intp, lenoutlet);
+			ctx->write(intp, m_util_hlen.encode_to(outlet));
+		}
+
+		void write_chain(NRP<promise<int>> const& intp, NRP<channel_handler_context> const& ctx, NRP<packet_chain> const& chain) override
+		{
+	#ifdef _NETP_DEBUG
+			NETP_ASSERT(chain->len() > 0);
+	#endif
+			NRP<packet_chain> framed = netp::make_ref<packet_chain>(m_util_hlen.encode_header(chain->len()));
+			framed->push_back(chain);
+			ctx->write_chain(intp, framed);
 		}
 	};
 
@@ -1,11 +1,15 @@
 #ifndef _NETP_HANDLER_WEBSOCKET_HPP
 #define _NETP_HANDLER_WEBSOCKET_HPP
 
+#include <deque>
+
 #include <netp/core.hpp>
 
 #include <netp/channel_handler.hpp>
 #include <netp/http/message.hpp>
 #include <netp/http/parser.hpp>
+#include <netp/handler/websocket_frame.hpp>
+#include <netp/handler/websocket_deflate.hpp>
 
 #ifdef NETP_WITH_BOTAN
 
@@ -41,101 +45,28 @@ namespace netp { namespace handler {
 			S_WAIT_CLIENT_HANDSHAKE_REQ,
 			S_HANDSHAKING,
 			S_UPGRADE_REQ_MESSAGE_DONE,
-			S_MESSAGE_BEGIN,
-			S_FRAME_BEGIN,
-			S_FRAME_READ_H_B1,
-			S_FRAME_READ_H_B2,
-			S_FRAME_READ_PAYLOAD_LEN,
-			S_FRAME_READ_MASKING_KEY,
-			S_FRAME_READ_PAYLOAD,
-			S_FRAME_END,
-			S_MESSAGE_END,
+			S_MESSAGE_BEGIN, //upgraded, frames go to m_decoder
 			S_FRAME_CLOSE_RECEIVED,
 			S_CLOSING
 		};
 
-		enum frame_opcode {
-			OP_CONTINUE = 0x0,
-			OP_TEXT = 0x1,
-			OP_BINARY = 0x2,
-			OP_X3 = 0x3,
-			OP_X4 = 0x4,
-			OP_X5 = 0x5,
-			OP_X6 = 0x6,
-			OP_X7 = 0x7,
-			OP_CLOSE = 0x8,
-			OP_PING = 0x9,
-			OP_PONG = 0xA,
-			OP_B = 0xB,
-			OP_C = 0xC,
-			OP_D = 0xD,
-			OP_E = 0xE,
-			OP_F = 0xF
-		};
+		using in_packet_q_t = netp::packet_queue_t;
 
-		struct ws_frame {
-			struct _H {
-				union _B1 {
-					struct _Bit {
-#ifdef __NETP_IS_LITTLE_ENDIAN
-						u8_t opcode : 4;
-						u8_t rsv3 : 1;
-						u8_t rsv2 : 1;
-						u8_t rsv1 : 1;
-						u8_t fin : 1;
-#else
-						u8_t fin : 1;
-						u8_t rsv1 : 1;
-						u8_t rsv2 : 1;
-						u8_t rsv3 : 1;
-						u8_t opcode : 4;
-#endif
-					} Bit;
-					u8_t B;
-				} B1;
-				union _B2 {
-					struct _Bit {
-#ifdef __NETP_IS_LITTLE_ENDIAN
-						u8_t len : 7;
-						u8_t mask : 1;
-#else
-						u8_t mask : 1;
-						u8_t len : 7;
-#endif
-					} Bit;
-					u8_t B;
-				} B2;
-			} H;
-
-			u64_t payload_len;
-			u8_t masking_key_arr[4];
-
-			NRP<packet> extdata;
-			NRP<packet> appdata;
-
-			void reset() {
-				H.B1.B = 0;
-				H.B2.B = 0;
-
-				payload_len = 0;
-				::memset(masking_key_arr, 0, 4);
-				extdata->reset();
-				appdata->reset();
-			}
+		struct deflate_outbound_entry {
+			NRP<promise<int>> chp;
+			NRP<packet> outlet;
+			u8_t opcode;
 		};
-
-		using in_packet_q_t = netp::packet_queue_t;
+		typedef std::deque<deflate_outbound_entry, netp::allocator<deflate_outbound_entry>> deflate_outbound_q_t;
 		
 		std::string m_tmp_for_field;
 		NRP<netp::http::message> m_upgrade_req;
 		NRP<netp::http::parser> m_http_parser;
 
-		in_packet_q_t m_in_q;
+		in_packet_q_t m_in_q; //for handshake only
 		u32_t m_in_q_nbytes;
 
-		//NRP<netp::packet> m_income_prev;
-		NSP<ws_frame> m_tmp_frame;
-
+		websocket_frame_decoder m_decoder;
 		NRP<packet> m_tmp_message; //for fragmented message
 		websocket_type m_type;
 		state m_state;
@@ -145,6 +76,24 @@ namespace netp { namespace handler {
 		websocket_close_code m_close_code;
 		std::string m_close_reason;
 
+		//permessage-deflate
+		websocket_deflate_cfg m_deflate_cfg;
+		NRP<websocket_deflate_codec> m_deflate; //non-null once negotiated
+		bool m_message_compressed;
+		//messages wait here in order while one of them is being compressed by m_deflate_cfg.offload
+		deflate_outbound_q_t m_deflate_q;
+		bool m_deflate_offloading;
+
+		void _frame_read(NRP<channel_handler_context> const& ctx, NRP<packet> const& income);
+		void _frame_error(NRP<channel_handler_context> const& ctx, int rt);
+		void _message_read(NRP<channel_handler_context> const& ctx, NRP<packet> const& message);
+		void _frame_write(NRP<promise<int>> const& chp, NRP<channel_handler_context> const& ctx, NRP<packet> const& outlet, u8_t opcode, bool compressed);
+
+		void _deflate_negotiate(NRP<netp::http::message> const& reply);
+		void _deflate_write(NRP<channel_handler_context> const& ctx);
+		void _deflate_offload_done(NRP<channel_handler_context> const& ctx, int rt, NRP<packet> const& out);
+		void _deflate_write_failed(NRP<promise<int>> const& chp, NRP<channel_handler_context> const& ctx, int rt);
+
 	protected:
 			int http_on_headers_complete(NRP<netp::http::parser> const& p, NRP<netp::http::message> const& m);
 			int http_on_body(NRP<netp::http::parser> const& p,const char* data, u32_t len);
@@ -154,7 +103,7 @@ namespace netp { namespace handler {
 			int http_on_chunk_complete(NRP<netp::http::parser> const& p);
 
 			public:
-				websocket(websocket_type t) :
+				websocket(websocket_type t, websocket_deflate_cfg const& deflate_cfg = websocket_deflate_cfg()) :
 					channel_handler_abstract(CH_ACTIVITY_CONNECTED|CH_ACTIVITY_CLOSED | CH_INBOUND_READ | CH_OUTBOUND_WRITE|CH_OUTBOUND_CLOSE),
 					m_http_parser(nullptr),
 					m_in_q_nbytes(0),
@@ -163,7 +112,11 @@ namespace netp { namespace handler {
 					m_message_opcode(OP_TEXT),
 					m_fragmented_begin(false),
 					m_close_sent(false),
-					m_close_code(websocket_close_code::C_NO_CLOSE_CODE)
+					m_close_code(websocket_close_code::C_NO_CLOSE_CODE),
+					m_deflate_cfg(deflate_cfg),
+					m_deflate(nullptr),
+					m_message_compressed(false),
+					m_deflate_offloading(false)
 				{}
 
 				virtual ~websocket() {}
@@ -0,0 +1,101 @@
+#ifndef _NETP_HANDLER_WEBSOCKET_DEFLATE_HPP
+#define _NETP_HANDLER_WEBSOCKET_DEFLATE_HPP
+
+#include <functional>
+
+#include <netp/core.hpp>
+#include <netp/smart_ptr.hpp>
+#include <netp/string.hpp>
+#include <netp/packet.hpp>
+
+//@note: messages shorter than this go uncompressed (in bytes)
+#define NETP_WEBSOCKET_DEFLATE_THRESHOLD (256)
+//@note: messages not shorter than this are compressed by websocket_deflate_cfg::offload if it is set (in bytes)
+#define NETP_WEBSOCKET_DEFLATE_OFFLOAD_THRESHOLD (256*1024)
+//@note: zlib memory of one connection, deflate and inflate (in bytes), the window bits and mem level are lowered to fit it
+#define NETP_WEBSOCKET_DEFLATE_MEMORY_MAX (256*1024)
+
+namespace netp { namespace handler {
+
+	//the permessage-deflate parameters in effect, refer to https://tools.ietf.org/html/rfc7692#section-7.1
+	struct websocket_deflate_params {
+		bool server_no_context_takeover;
+		bool client_no_context_takeover;
+		u8_t server_max_window_bits;
+		u8_t client_max_window_bits;
+		u8_t mem_level;
+	};
+
+	//one direction for deflate, the other for inflate, the endpoint role is resolved by the handler
+	struct websocket_deflate_codec_cfg {
+		u8_t deflate_window_bits;
+		bool deflate_no_context_takeover;
+		u8_t inflate_window_bits;
+		bool inflate_no_context_takeover;
+		u8_t mem_level;
+	};
+
+	//compress|decompress of whole messages, one codec for one connection
+	//it is called by one thread at a time, but not always by the loop thread if offload is used
+	class websocket_deflate_codec :
+		public netp::ref_base
+	{
+	public:
+		virtual ~websocket_deflate_codec() {}
+
+		//deflate a whole message, without the trailing 0x00 0x00 0xff 0xff, refer to https://tools.ietf.org/html/rfc7692#section-7.2.1
+		virtual int compress(byte_t const* in, u32_t len, NRP<packet>& out) = 0;
+
+		//inflate a whole message, E_WEBSOCKET_FRAME_TOO_BIG if it inflates to more than max
+		virtual int decompress(byte_t const* in, u32_t len, NRP<packet>& out, u32_t max) = 0;
+	};
+
+	typedef std::function<NRP<websocket_deflate_codec>(websocket_deflate_codec_cfg const& cfg)> fn_websocket_deflate_codec_maker_t;
+	//run the task off the loop, for example: [](netp::fn_task_t&& t) { netp::scheduler::instance()->schedule(std::move(t)); }
+	typedef std::function<void(std::function<void()>&&)> fn_websocket_deflate_offload_t;
+
+#ifdef NETP_WITH_ZLIB
+	extern NRP<websocket_deflate_codec> websocket_deflate_zlib_maker(websocket_deflate_codec_cfg const& cfg);
+#endif
+
+	struct websocket_deflate_cfg {
+		//nullptr to decline permessage-deflate, zlib by default if NETP_WITH_ZLIB is defined
+		fn_websocket_deflate_codec_maker_t codec_maker;
+		bool server_no_context_takeover;
+		bool client_no_context_takeover;
+		u8_t server_max_window_bits;
+		u8_t client_max_window_bits;
+		u8_t mem_level;
+		u32_t memory_max;
+		u32_t threshold;
+
+		fn_websocket_deflate_offload_t offload;
+		u32_t offload_threshold;
+
+		websocket_deflate_cfg() :
+#ifdef NETP_WITH_ZLIB
+			codec_maker(websocket_deflate_zlib_maker),
+#else
+			codec_maker(nullptr),
+#endif
+			server_no_context_takeover(false),
+			client_no_context_takeover(false),
+			server_max_window_bits(15),
+			client_max_window_bits(15),
+			mem_level(8),
+			memory_max(NETP_WEBSOCKET_DEFLATE_MEMORY_MAX),
+			threshold(NETP_WEBSOCKET_DEFLATE_THRESHOLD),
+			offload(nullptr),
+			offload_threshold(NETP_WEBSOCKET_DEFLATE_OFFLOAD_THRESHOLD)
+		{}
+	};
+
+	//zlib memory of a codec by the formula of zconf.h, a few KB of the stream state included
+	extern u32_t websocket_deflate_memory(websocket_deflate_codec_cfg const& cfg);
+
+	//server side, pick the first acceptable permessage-deflate offer of Sec-WebSocket-Extensions
+	//return netp::OK with the params and the response line, E_WEBSOCKET_EXTENSION_DECLINED if none is acceptable within cfg.memory_max
+	extern int websocket_deflate_negotiate(websocket_deflate_cfg const& cfg, string_t const& offers, websocket_deflate_params& params, string_t& response);
+}}
+
+#endif
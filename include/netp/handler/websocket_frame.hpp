@@ -0,0 +1,132 @@
+#ifndef _NETP_HANDLER_WEBSOCKET_FRAME_HPP
+#define _NETP_HANDLER_WEBSOCKET_FRAME_HPP
+
+#include <netp/core.hpp>
+#include <netp/packet.hpp>
+
+//@note: max payload of one frame, and max length of one reassembled message
+#define NETP_WEBSOCKET_MESSAGE_MAX (64*1024*1024)
+
+namespace netp { namespace handler {
+
+	enum websocket_frame_opcode {
+		OP_CONTINUE = 0x0,
+		OP_TEXT = 0x1,
+		OP_BINARY = 0x2,
+		OP_X3 = 0x3,
+		OP_X4 = 0x4,
+		OP_X5 = 0x5,
+		OP_X6 = 0x6,
+		OP_X7 = 0x7,
+		OP_CLOSE = 0x8,
+		OP_PING = 0x9,
+		OP_PONG = 0xA,
+		OP_B = 0xB,
+		OP_C = 0xC,
+		OP_D = 0xD,
+		OP_E = 0xE,
+		OP_F = 0xF
+	};
+
+	struct ws_frame {
+		struct _H {
+			union _B1 {
+				struct _Bit {
+#ifdef __NETP_IS_LITTLE_ENDIAN
+					u8_t opcode : 4;
+					u8_t rsv3 : 1;
+					u8_t rsv2 : 1;
+					u8_t rsv1 : 1;
+					u8_t fin : 1;
+#else
+					u8_t fin : 1;
+					u8_t rsv1 : 1;
+					u8_t rsv2 : 1;
+					u8_t rsv3 : 1;
+					u8_t opcode : 4;
+#endif
+				} Bit;
+				u8_t B;
+			} B1;
+			union _B2 {
+				struct _Bit {
+#ifdef __NETP_IS_LITTLE_ENDIAN
+					u8_t len : 7;
+					u8_t mask : 1;
+#else
+					u8_t mask : 1;
+					u8_t len : 7;
+#endif
+				} Bit;
+				u8_t B;
+			} B2;
+		} H;
+
+		u64_t payload_len;
+		u8_t masking_key_arr[4];
+	};
+
+	//decode the frame header from contiguous bytes
+	//return the header length, 0 if [b, b+len) does not hold the whole header yet
+	inline u32_t websocket_frame_header_decode(byte_t const* b, u32_t len, ws_frame& f) {
+		static_assert(sizeof(ws_frame::H) == 2, "check ws_frame header size");
+		if (len < 2) {
+			return 0;
+		}
+		f.H.B1.B = b[0];
+		f.H.B2.B = b[1];
+		u32_t hlen = 2;
+		if (f.H.B2.Bit.len == 126) {
+			if (len < hlen + 2) { return 0; }
+			f.payload_len = netp::bytes_helper::read<u16_t, byte_t const*, netp::bytes_helper::big_endian>(b + hlen);
+			hlen += 2;
+		} else if (f.H.B2.Bit.len == 127) {
+			if (len < hlen + 8) { return 0; }
+			f.payload_len = netp::bytes_helper::read<u64_t, byte_t const*, netp::bytes_helper::big_endian>(b + hlen);
+			hlen += 8;
+		} else {
+			f.payload_len = f.H.B2.Bit.len;
+		}
+		if (f.H.B2.Bit.mask == 0x1) {
+			if (len < hlen + 4) { return 0; }
+			std::memcpy(f.masking_key_arr, b + hlen, 4);
+			hlen += 4;
+		}
+		return hlen;
+	}
+
+	//frames out of a stream of packets
+	//1, the header is parsed in place if it is contiguous in the input, the payload is unmasked in place
+	//2, a frame that ends the input is delivered by the input packet itself, the others by slices of it, no copy
+	//3, only the frame split across packets is copied into a buffer, reserved by its length once the header is known, the buffer takes no more than the bytes of that frame from the next packet
+	class websocket_frame_decoder {
+		NRP<packet> m_in;
+		NRP<packet> m_income; //the packet fed while m_in is buffered
+		bool m_in_buffered; //m_in is our own buffer
+		bool m_rsv1_allowed; //permessage-deflate negotiated
+
+		void _buffer_reserve(u64_t need);
+		int _check(ws_frame const& f) const;
+
+	public:
+		websocket_frame_decoder() :
+			m_in(nullptr),
+			m_income(nullptr),
+			m_in_buffered(false),
+			m_rsv1_allowed(false)
+		{}
+
+		void feed(NRP<packet> const& income);
+
+		//return netp::OK with a frame in f and its unmasked payload in payload
+		//return E_WEBSOCKET_FRAME_INCOMPLETE if more bytes are needed, the rest has been buffered
+		//return E_WEBSOCKET_FRAME_PROTOCOL_ERROR|E_WEBSOCKET_FRAME_TOO_BIG on a bad frame
+		int next(ws_frame& f, NRP<packet>& payload);
+
+		//rsv1 marks the first frame of a compressed message, refer to https://tools.ietf.org/html/rfc7692#section-6
+		void allow_rsv1(bool allow) { m_rsv1_allowed = allow; }
+		void reset() { m_in = nullptr; m_income = nullptr; m_in_buffered = false; m_rsv1_allowed = false; }
+	};
+}}
+
+#endif
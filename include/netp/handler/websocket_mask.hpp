@@ -0,0 +1,17 @@
+#ifndef _NETP_HANDLER_WEBSOCKET_MASK_HPP
+#define _NETP_HANDLER_WEBSOCKET_MASK_HPP
+
+#include <netp/core.hpp>
+
+namespace netp { namespace handler {
+
+	//xor data with the 4 bytes masking key in place, refer to https://tools.ietf.org/html/rfc6455#section-5.3
+	//offset: count of the payload bytes that have been masked before data, for a payload delivered by more than one buffer
+	//avx2|sse2|scalar, picked at runtime by netp::CPUID
+	extern void websocket_mask(byte_t* data, u32_t len, u8_t const key[4], u64_t offset = 0);
+
+	//one byte at a time, for reference and benchmark
+	extern void websocket_mask_scalar(byte_t* data, u32_t len, u8_t const key[4], u64_t offset = 0);
+}}
+
+#endif
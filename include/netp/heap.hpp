@@ -27,6 +27,29 @@ namespace netp {
 			m_capacity = count;
 		}
 
+		inline void __sift_down__(netp::size_t i_) {
+			T t = std::move(m_arr[i_]);
+			while (true) {
+				const netp::size_t r = BHEAP_R(i_);
+				netp::size_t l = r - 1;
+
+				if (NETP_LIKELY(r < m_size)) {
+					if (__fn_cmp__(m_arr[r], m_arr[l])) {
+						l = r;
+					}
+				} else if (l < m_size) {
+				} else {
+					break;
+				}
+				if (!__fn_cmp__(m_arr[l], t)) {
+					break;
+				}
+				m_arr[i_] = std::move(m_arr[l]);
+				i_ = l;
+			}
+			m_arr[i_] = std::move(t);
+		}
+
 	public:
 		binary_heap() :
 			m_arr(nullptr),
@@ -105,6 +128,28 @@ namespace netp {
 			}
 			m_arr[i_] = std::move(m_arr[m_size]);
 		}
+
+		//drop the elements that match pred, then heapify the rest, O(n)
+		template <class _Pred>
+		void remove_if(_Pred&& pred) {
+			netp::size_t n = 0;
+			for (netp::size_t i = 0; i < m_size; ++i) {
+				if (pred(m_arr[i])) {
+					continue;
+				}
+				if (n != i) {
+					m_arr[n] = std::move(m_arr[i]);
+				}
+				++n;
+			}
+			for (netp::size_t i = n; i < m_size; ++i) {
+				m_arr[i] = T();
+			}
+			m_size = n;
+			for (netp::size_t i = (n >> 1); i > 0; --i) {
+				__sift_down__(i - 1);
+			}
+		}
 	};
 
 	template <class T>
@@ -2,8 +2,7 @@
 #define _NETP_HTTP_MESSAGE_HPP
 
 #include <string>
-#include <list>
-#include <unordered_map>
+#include <vector>
 
 #include <netp/core.hpp>
 #include <netp/packet.hpp>
@@ -18,6 +17,10 @@
 
 #define NETP_HTTP_METHOD_NAME_MAX_LEN 7
 
+//@note: initial capacity of the name|value bytes and of the lines of a header
+#define NETP_HTTP_HEADER_ARENA_INIT_SIZE 1024
+#define NETP_HTTP_HEADER_LINES_INIT_SIZE 16
+
 namespace netp { namespace http {
 
 	enum message_type {
@@ -75,119 +78,219 @@ namespace netp { namespace http {
 	//1, all header fileds order from the src
 	//2, do not merge multi line header field when do forwarding
 
+	//@date 2026-10-18
+	// header lines are kept in a flat vector in the order they are received, name and value bytes live in a per-header arena
+	// 1, the parser appends the bytes of a field into the arena as they come, a field split across reads ends up contiguous
+	// 2, no allocation per line once the arena and the vector have grown to the size of a typical header
+	// 3, a lookup is a linear scan by the hash of the name, a header rarely holds more than a few dozen lines
+	// 4, lines with the same name are never merged, get() merges them on demand
+
 	struct header final:
 		public netp::ref_base
 	{
-		struct mul_hfv_pos {
-			size_t begin;
-			size_t len;
+		//bytes owned by the header, valid until the header is changed
+		struct view {
+			char const* data;
+			u32_t len;
+
+			bool empty() const { return len == 0; }
+			string_t to_string() const { return string_t(data, len); }
 		};
 
-		typedef std::list<mul_hfv_pos> mul_header_filed_with_same_name_pos_list_t;
-		struct _header_line {
-			netp::string_t name;
-			netp::string_t value;
-			mul_header_filed_with_same_name_pos_list_t mul_hf_pos_list;
+		struct line {
+			size_t key;
+			u32_t name_begin;
+			u32_t name_len;
+			u32_t value_begin;
+			u32_t value_len;
 		};
 
+		typedef std::vector<char, netp::allocator<char>> arena_t;
+		typedef std::vector<line, netp::allocator<line>> lines_t;
+
+		const static inline netp::size_t H_key(char const* field, size_t len) {
+			return ihash_seq((const unsigned char*)field, len);
+		}
+
 		const static inline netp::size_t H_key(netp::string_t const& field) {
-			return ihash_seq((const unsigned char*)field.c_str(), field.length());
+			return H_key(field.c_str(), field.length());
 		}
 
-		typedef std::unordered_map<size_t, _header_line, std::hash<size_t>, std::equal_to<size_t>, netp::allocator<std::pair<const size_t, _header_line>>>	header_map;
-		typedef std::pair<size_t, _header_line>	header_pair;
-		typedef std::list<netp::string_t, netp::allocator<netp::string_t>> keys_order_list_t;
+		static inline bool _name_equals(char const* a, char const* b, u32_t len) {
+			for (u32_t i = 0; i < len; ++i) {
+				if (tolower(a[i]) != tolower(b[i])) {
+					return false;
+				}
+			}
+			return true;
+		}
 
-		header_map map;
-		keys_order_list_t keys_order;
+		arena_t arena;
+		lines_t lines;
+		bool line_open; //a line is being appended by the parser
 
-		header() {}
+		header():
+			line_open(false)
+		{
+			arena.reserve(NETP_HTTP_HEADER_ARENA_INIT_SIZE);
+			lines.reserve(NETP_HTTP_HEADER_LINES_INIT_SIZE);
+		}
 		~header() {}
 
 		void reset() {
-			map.clear();
-			keys_order.clear();
+			arena.clear();
+			lines.clear();
+			line_open = false;
+		}
+
+		inline view name(line const& l) const { return { arena.data() + l.name_begin, l.name_len }; }
+		inline view value(line const& l) const { return { arena.data() + l.value_begin, l.value_len }; }
+
+		//index of the idx-th line with the given name, -1 if there is none
+		int find(char const* field, u32_t len, u32_t idx = 0) const {
+			const size_t key = H_key(field, len);
+			for (size_t i = 0; i < lines.size(); ++i) {
+				line const& l = lines[i];
+				if (l.key == key && l.name_len == len && _name_equals(arena.data() + l.name_begin, field, len)) {
+					if (idx == 0) {
+						return int(i);
+					}
+					--idx;
+				}
+			}
+			return -1;
+		}
+
+		inline int find(netp::string_t const& field, u32_t idx = 0) const {
+			return find(field.c_str(), u32_t(field.length()), idx);
 		}
 
 		bool have(netp::string_t const& field) const {
-			header_map::const_iterator&& it = map.find(H_key(field));
-			return it != map.end();
+			return find(field) != -1;
 		}
 
 		void remove(netp::string_t const& field) {
-			size_t key = H_key(field);
-			header_map::iterator it = map.find(key);
-			if (it != map.end()) {
-				keys_order_list_t::iterator it_key = std::find_if(keys_order.begin(), keys_order.end(), [name = it->second.name](netp::string_t const& key) {
-					return key == name;
-				});
-				NETP_ASSERT(it_key != keys_order.end());
-				keys_order.erase(it_key);
-				map.erase(it);
-
-				it = map.find(key);
+			int i;
+			while ((i = find(field)) != -1) {
+				lines.erase(lines.begin() + i);
 			}
 		}
 
+		//value of the first line with the given name, no copy
+		view get_view(string_t const& field) const {
+			const int i = find(field);
+			if (i == -1) {
+				return { "", 0 };
+			}
+			return value(lines[i]);
+		}
+
 		//return merged field value automatically
 		string_t get(string_t const& field) const {
-			header_map::const_iterator&& it = map.find(H_key(field));
-			if (it != map.end()) {
-				return it->second.value;
+			int i = find(field);
+			if (i == -1) {
+				return "";
 			}
-			return "";
-		}
-
-		void add_header_line(string_t const& field, string_t const& value) {
-			const size_t _key = H_key(field);
-			header_map::iterator&& it = map.find(_key);
-			if (it != map.end()) {
-				mul_hfv_pos hf_pos = {value.length() + 2 /*netp::strlen(", ")*/, value.length()  };
-				it->second.value += ", " + value;
-				it->second.mul_hf_pos_list.push_back(hf_pos);
-
-#ifdef _NETP_DEBUG
-				keys_order_list_t::iterator kit = std::find_if(keys_order.begin(), keys_order.end(), [name=it->second.name](netp::string_t const& key) {
-					return key == name;
-				});
-				NETP_ASSERT( kit != keys_order.end() );
-#endif
-				return;
+			string_t merged(arena.data() + lines[i].value_begin, lines[i].value_len);
+			u32_t idx = 1;
+			while ((i = find(field, idx++)) != -1) {
+				merged.append(", ", 2);
+				merged.append(arena.data() + lines[i].value_begin, lines[i].value_len);
 			}
+			return merged;
+		}
 
-			mul_header_filed_with_same_name_pos_list_t hf_pos_list;
-			hf_pos_list.push_back({ 0, value.length() });
-			map.insert({ _key, { field,value, hf_pos_list } });
-			keys_order.push_front(field);
+		void add_header_line(char const* field, u32_t field_len, char const* value, u32_t value_len) {
+			NETP_ASSERT(line_open == false);
+			line l;
+			l.key = H_key(field, field_len);
+			l.name_begin = _arena_append(field, field_len);
+			l.name_len = field_len;
+			l.value_begin = _arena_append(value, value_len);
+			l.value_len = value_len;
+			lines.push_back(l);
 		}
 
+		inline void add_header_line(string_t const& field, string_t const& value) {
+			add_header_line(field.c_str(), u32_t(field.length()), value.c_str(), u32_t(value.length()));
+		}
+
+		//the first line with the given name takes the value, the others are removed
 		void replace(string_t const& field, string_t const& value) {
-			header_map::iterator&& it = map.find(H_key(field));
-			if (it != map.end()) {
-				it->second.value = value;
-				it->second.mul_hf_pos_list.clear();
-				it->second.mul_hf_pos_list.push_back({ 0, value.length() });
+			const int i = find(field);
+			if (i == -1) {
+				return;
 			}
+			int j;
+			while ((j = find(field, 1)) != -1) {
+				lines.erase(lines.begin() + j);
+			}
+			lines[i].value_begin = _arena_append(value.c_str(), u32_t(value.length()));
+			lines[i].value_len = u32_t(value.length());
 		}
 
+		//for the parser, the bytes of a line come by pieces, field first
+		void _field_append(char const* data, u32_t len) {
+			if (!line_open) {
+				lines.push_back({ 0, u32_t(arena.size()), 0, 0, 0 });
+				line_open = true;
+			}
+			line& l = lines.back();
+			NETP_ASSERT(l.value_len == 0);
+			_arena_append(data, len);
+			l.name_len += len;
+		}
+
+		void _value_append(char const* data, u32_t len) {
+			NETP_ASSERT(line_open);
+			line& l = lines.back();
+			if (l.value_len == 0) {
+				l.value_begin = u32_t(arena.size());
+			}
+			_arena_append(data, len);
+			l.value_len += len;
+		}
+
+		void _line_done() {
+			NETP_ASSERT(line_open);
+			line& l = lines.back();
+			if (l.value_len == 0) {
+				l.value_begin = u32_t(arena.size());
+			}
+			l.key = H_key(arena.data() + l.name_begin, l.name_len);
+			line_open = false;
+		}
+
+		inline u32_t _arena_append(char const* data, u32_t len) {
+			const u32_t begin = u32_t(arena.size());
+			arena.insert(arena.end(), data, data + len);
+			return begin;
+		}
+
+		//bytes of the encoded lines
+		u32_t encode_len() const {
+			u32_t n = 0;
+			for (line const& l : lines) {
+				n += l.name_len + l.value_len + 4;
+			}
+			return n;
+		}
+
+		//every line in order, straight from the arena into the packet
 		void encode(NRP<packet>& packet_o) const {
+			const u32_t n = encode_len();
 			if (packet_o == nullptr) {
-				packet_o = netp::make_ref<packet>();
+				packet_o = netp::make_ref<packet>(n);
+			} else {
+				packet_o->reserve(n);
+			}
+			NETP_ASSERT(line_open == false);
+			for (line const& l : lines) {
+				packet_o->write((netp::byte_t*)(arena.data() + l.name_begin), l.name_len);
+				packet_o->write((netp::byte_t*)NETP_HTTP_COLON_SP, 2);
+				packet_o->write((netp::byte_t*)(arena.data() + l.value_begin), l.value_len);
+				packet_o->write((netp::byte_t*)NETP_HTTP_CRLF, 2);
 			}
-
-			std::for_each(keys_order.rbegin(), keys_order.rend(), [&](string_t const& key) {
-				header_map::const_iterator&& it = map.find(H_key(key));
-				NETP_ASSERT(it != map.end());
-				const char* value_cstr = it->second.value.c_str();
-				mul_header_filed_with_same_name_pos_list_t::const_iterator&& it_hf_pos = it->second.mul_hf_pos_list.begin();
-				while (it_hf_pos != it->second.mul_hf_pos_list.end()) {
-					packet_o->write((netp::byte_t*)key.c_str(), (netp::u32_t)key.length());
-					packet_o->write((netp::byte_t*)NETP_HTTP_COLON_SP, 2);
-					packet_o->write((netp::byte_t*)(value_cstr + it_hf_pos->begin), u32_t(it_hf_pos->len) );
-					packet_o->write((netp::byte_t*)NETP_HTTP_CRLF, (netp::u32_t)netp::strlen(NETP_HTTP_CRLF));
-					++it_hf_pos;
-				}
-			});
 		}
 	};
 
@@ -49,8 +49,6 @@ namespace netp { namespace http {
 		NRP<netp::http::message> message_tmp;
 
 		last_header_element last_h;
-		string_t field_tmp;//for header field
-		string_t field_value_tmp;
 
 		parser();
 		~parser();
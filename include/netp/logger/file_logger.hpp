@@ -1,19 +1,100 @@
 #ifndef _NETP_LOGGER_FILE_LOGGER_HPP_
 #define _NETP_LOGGER_FILE_LOGGER_HPP_
 
+#include <atomic>
+#include <vector>
+
 #include <netp/logger/logger_abstract.hpp>
+#include <netp/mutex.hpp>
+#include <netp/condition.hpp>
+
+//@note: bytes of the record ring of one producer thread (async mode), must be power of 2
+#define NETP_FILE_LOGGER_RING_SIZE (256*1024)
+//@note: a ring holds one full record of logger_broker at least, refer to NETP_LOGGER_RECORD_MAX
+#define NETP_FILE_LOGGER_RING_SIZE_MIN (16*1024)
+//@note: the writer thread drains the rings at least once per this interval (in millis)
+#define NETP_FILE_LOGGER_FLUSH_INTERVAL (50)
+//@note: max iovec count of one writev
+#define NETP_FILE_LOGGER_IOV_MAX (64)
+//@note: max count of async file_logger that one thread could write to by its own ring, the others go sync
+#define NETP_FILE_LOGGER_TLS_SLOT_MAX (4)
+
+namespace netp {
+	class thread;
+}
 
 namespace netp { namespace logger {
+
+	struct file_logger_cfg {
+		bool async; //format on the caller thread, write by a background thread
+		u32_t ring_size; //bytes of the ring of one producer thread, round up to power of 2, NETP_FILE_LOGGER_RING_SIZE_MIN at least
+		u32_t flush_interval; //in millis
+		u64_t rotate_size; //rotate once the file reaches this size (in bytes), 0 for never
+		u32_t rotate_interval; //rotate once the file has been opened for this long (in seconds), 0 for never
+
+		file_logger_cfg() :
+			async(false),
+			ring_size(NETP_FILE_LOGGER_RING_SIZE),
+			flush_interval(NETP_FILE_LOGGER_FLUSH_INTERVAL),
+			rotate_size(0),
+			rotate_interval(0)
+		{}
+	};
+
+	//sync mode: one write per record, no stdio buffer
+	//async mode:
+	//1, each producer thread owns a spsc byte ring, a record is copied into the ring as a whole, no lock, no syscall
+	//2, one writer thread gathers all the rings by writev, then frees the consumed bytes
+	//3, the record is dropped if the ring of the thread is full, refer to dropped(), a record larger than the ring is written sync
+	//4, rotate by size|time, the old file is renamed to <file>.<yyyymmdd_hhmmss>
 	class file_logger: public logger_abstract {
+		NETP_DECLARE_NONCOPYABLE(file_logger)
 
 	public:
-		file_logger(string_t const& log_file );
+		struct record_ring;
+		typedef std::vector<record_ring*> record_rings_t;
+
+		file_logger(string_t const& log_file, file_logger_cfg const& cfg = file_logger_cfg());
 		~file_logger();
 
 		void write( log_mask mask, char const* log, netp::u32_t len ) ;
 
+		//records dropped by a full ring
+		u64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+		//times of rotation
+		u32_t rotated() const { return m_rotated.load(std::memory_order_relaxed); }
+
 	private:
+		int _open();
+		void _rotate_check(u64_t incoming);
+
+		record_ring* _ring_of_this_thread();
+		void _writer_notify();
+		void _writer_run();
+		bool _writer_drain();
+
+		string_t m_file;
+		file_logger_cfg m_cfg;
 		FILE* m_fp;
+		u64_t m_file_size;
+		i64_t m_file_open_time;
+
+		//guard m_fp, rotation, and the writes of sync mode
+		netp::mutex m_file_mtx;
+
+		//async mode
+		const u64_t m_id;
+		spin_mutex m_rings_mtx;
+		record_rings_t m_rings;
+		NRP<netp::thread> m_writer;
+		netp::mutex m_writer_mtx;
+		netp::condition_variable m_writer_cond;
+		std::atomic<bool> m_writer_notified;
+		std::atomic<bool> m_writer_exit;
+
+		std::atomic<u64_t> m_dropped;
+		u64_t m_dropped_reported;
+		std::atomic<u32_t> m_rotated;
 	};
 }}
 #endif
\ No newline at end of file
@@ -33,6 +33,9 @@ namespace netp { namespace logger {
 		'E'
 	};
 
+	//@note: max bytes of one record formatted by logger_broker, the '\0' included
+	#define NETP_LOGGER_RECORD_MAX (8192)
+
 	#define LOG_LEVELS_ERR				( netp::logger::LOG_MASK_ERR)
 	#define LOG_LEVELS_WARN			( LOG_LEVELS_ERR | netp::logger::LOG_MASK_WARN )
 	#define LOG_LEVELS_INFO				( LOG_LEVELS_WARN | netp::logger::LOG_MASK_INFO )
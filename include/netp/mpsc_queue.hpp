@@ -0,0 +1,140 @@
+#ifndef _NETP_MPSC_QUEUE_HPP_
+#define _NETP_MPSC_QUEUE_HPP_
+
+#include <atomic>
+#include <type_traits>
+
+#include <netp/core.hpp>
+#include <netp/memory.hpp>
+
+//@note: size of the padding in between producer side and consumer side
+#define NETP_MPSC_QUEUE_FALSE_SHARING_PAD (64)
+
+namespace netp {
+
+	struct mpsc_node {
+		std::atomic<mpsc_node*> next;
+	};
+
+	//intrusive multi-producer single-consumer queue
+	//refer to: https://www.1024cores.net/home/lock-free-algorithms/queues/intrusive-mpsc-node-based-queue
+	//push: wait-free, one xchg for one node or a pre-linked chain
+	//pop: lock-free, consumer thread only, might return nullptr if a producer is in between xchg and link, the node would be visible soon
+	class mpsc_queue {
+		NETP_DECLARE_NONCOPYABLE(mpsc_queue)
+
+		std::atomic<mpsc_node*> m_tail;
+		byte_t __pad[NETP_MPSC_QUEUE_FALSE_SHARING_PAD - sizeof(std::atomic<mpsc_node*>)];
+		mpsc_node* m_head;
+		mpsc_node m_stub;
+
+	public:
+		mpsc_queue() :
+			m_tail(&m_stub),
+			m_head(&m_stub)
+		{
+			m_stub.next.store(nullptr, std::memory_order_relaxed);
+		}
+
+		__NETP_FORCE_INLINE void push(mpsc_node* n) {
+			push(n, n);
+		}
+
+		//[first, last] must be linked by the caller
+		__NETP_FORCE_INLINE void push(mpsc_node* first, mpsc_node* last) {
+			last->next.store(nullptr, std::memory_order_relaxed);
+			mpsc_node* prev = m_tail.exchange(last, std::memory_order_acq_rel);
+			prev->next.store(first, std::memory_order_release);
+		}
+
+		mpsc_node* pop() {
+			mpsc_node* head = m_head;
+			mpsc_node* next = head->next.load(std::memory_order_acquire);
+			if (head == &m_stub) {
+				if (next == nullptr) {
+					return nullptr;
+				}
+				m_head = next;
+				head = next;
+				next = next->next.load(std::memory_order_acquire);
+			}
+			if (next != nullptr) {
+				m_head = next;
+				return head;
+			}
+			if (head != m_tail.load(std::memory_order_acquire)) {
+				//producer in progress
+				return nullptr;
+			}
+			push(&m_stub);
+			next = head->next.load(std::memory_order_acquire);
+			if (next != nullptr) {
+				m_head = next;
+				return head;
+			}
+			return nullptr;
+		}
+	};
+
+	//the callable is stored in the node itself, one allocation for one task, no std::function
+	class task_node :
+		public mpsc_node
+	{
+		typedef void(*fn_task_node_run_t)(task_node* n, bool invoke);
+		fn_task_node_run_t m_fn_run;
+
+		template <class fn_t>
+		struct task_node_impl;
+
+	protected:
+		task_node(fn_task_node_run_t fn) :
+			m_fn_run(fn)
+		{}
+
+	public:
+		//invoke the callable, then release the node
+		__NETP_FORCE_INLINE void run() {
+			m_fn_run(this, true);
+		}
+		//release the node without invoke
+		__NETP_FORCE_INLINE void drop() {
+			m_fn_run(this, false);
+		}
+
+		template <class fn_task_t>
+		static task_node* make(fn_task_t&& f);
+	};
+
+	template <class fn_t>
+	struct task_node::task_node_impl final :
+		public task_node
+	{
+		fn_t fn;
+
+		template <class _fn_t>
+		task_node_impl(_fn_t&& f) :
+			task_node(&task_node_impl::__run),
+			fn(std::forward<_fn_t>(f))
+		{}
+
+		static void __run(task_node* n, bool invoke) {
+			struct __trash_guard {
+				task_node_impl* impl;
+				~__trash_guard() { netp::allocator<task_node_impl>::trash(impl); }
+			} _guard = { static_cast<task_node_impl*>(n) };
+			if (invoke) {
+				_guard.impl->fn();
+			}
+		}
+	};
+
+	template <class fn_task_t>
+	inline task_node* task_node::make(fn_task_t&& f) {
+		typedef task_node_impl<typename std::decay<fn_task_t>::type> impl_t;
+		static_assert(alignof(impl_t) <= NETP_DEFAULT_ALIGN, "task alignment check failed");
+		impl_t* impl = netp::allocator<impl_t>::make(std::forward<fn_task_t>(f));
+		NETP_ALLOC_CHECK(impl, sizeof(impl_t));
+		return impl;
+	}
+}
+#endif
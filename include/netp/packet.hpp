@@ -2,6 +2,7 @@
 #define _NETP_PACKET_HPP_
 
 #include <queue>
+#include <vector>
 
 #include <netp/core.hpp>
 #include <netp/smart_ptr.hpp>
@@ -31,8 +32,52 @@ namespace netp {
 	 * 2, read forward only
 	 * 3, write_left from head, write from tail, 
 	 * 4, always read from head, 
+	 * 5, slice shares the buffer with its parent, the buffer is released by the last one of them
+	 *		a) write_left|write|fill into a shared range result in a copy of the buffer (copy on write)
+	 *		b) a slice has no right capacity, and no left capacity unless it takes the consumed bytes of its parent as headroom
+	 *		c) bytes modified by head()|tail() directly are visible to all the slices that share them
+	 *		d) [tail, end) is never shared, reset|decre_write_idx unshare the buffer first, so a write by tail()+incre_write_idx stays private
 	 */
 
+	//the buffer of a holder goes back to its recycler instead of being freed, refer to packet_pool
+	class packet_buffer_recycler:
+		public ref_base
+	{
+	public:
+		//might be called from any thread
+		virtual void recycle(byte_t* buf, u32_t cookie) = 0;
+	};
+
+	//owner of a shared buffer
+	template<class _ref_base>
+	class packet_buffer_holder final:
+		public _ref_base
+	{
+		byte_t* m_buffer;
+		NRP<packet_buffer_recycler> m_recycler;
+		u32_t m_cookie;
+	public:
+		explicit packet_buffer_holder(byte_t* buf) :
+			m_buffer(buf),
+			m_cookie(0)
+		{}
+		explicit packet_buffer_holder(byte_t* buf, NRP<packet_buffer_recycler> const& recycler, u32_t cookie) :
+			m_buffer(buf),
+			m_recycler(recycler),
+			m_cookie(cookie)
+		{}
+		~packet_buffer_holder() {
+			if (m_recycler != nullptr) {
+				m_recycler->recycle(m_buffer, m_cookie);
+			} else {
+				netp::allocator<byte_t>::free(m_buffer);
+			}
+		}
+	};
+
+	struct packet_slice_tag {};
+	struct packet_pooled_tag {};
+
 	template<class _ref_base, class buf_size_width_t, u32_t DEF_LEFT_RESERVE, u32_t DEF_RIGHT_CAPACITY, u32_t AGN>
 	class cap_fix_packet:
 		public _ref_base
@@ -43,10 +88,16 @@ namespace netp {
 		static_assert(u32_t(buf_size_width_t(-1)) >= DEF_LEFT_RESERVE, "DEF_LEFT_RESERVE check failed ");
 
 	protected:
+		typedef packet_buffer_holder<_ref_base> buffer_holder_t;
+
 		byte_t* m_buffer;
 		buf_size_width_t	m_read_idx; //read index
 		buf_size_width_t	m_write_idx; //write index
 		buf_size_width_t	m_capacity; //the total buffer size
+		//[m_shared_lo, m_shared_hi) has been referenced by slice
+		buf_size_width_t	m_shared_lo;
+		buf_size_width_t	m_shared_hi;
+		NRP<buffer_holder_t> m_buffer_holder;
 
 		void _init_buffer(buf_size_width_t left, buf_size_width_t right) {
 			if (right == 0) {
@@ -59,11 +110,68 @@ namespace netp {
 			NETP_ALLOC_CHECK(m_buffer, sizeof(byte_t) * m_capacity);
 		}
 
+		//free the buffer, or leave it to the holder if it is shared
+		__NETP_FORCE_INLINE void _release_buffer() {
+			if (m_buffer_holder != nullptr) {
+				m_buffer_holder = nullptr;
+				m_shared_lo = m_shared_hi = 0;
+			} else {
+				netp::allocator<byte_t>::free(m_buffer);
+			}
+			m_buffer = nullptr;
+		}
+
+		//copy to a private buffer with the same layout
+		void _unshare_buffer() {
+			NETP_ASSERT(m_buffer_holder != nullptr);
+			byte_t* _newbuffer = netp::allocator<byte_t>::malloc(sizeof(byte_t) * m_capacity, AGN);
+			NETP_ALLOC_CHECK(_newbuffer, sizeof(byte_t) * m_capacity);
+			if (len() > 0) {
+				std::memcpy(_newbuffer + m_read_idx, m_buffer + m_read_idx, len());
+			}
+			_release_buffer();
+			m_buffer = _newbuffer;
+		}
+
+		//drop the content for a private buffer of the same capacity, the slices keep the shared one
+		void _detach_buffer() {
+			NETP_ASSERT(m_buffer_holder != nullptr);
+			byte_t* _newbuffer = netp::allocator<byte_t>::malloc(sizeof(byte_t) * m_capacity, AGN);
+			NETP_ALLOC_CHECK(_newbuffer, sizeof(byte_t) * m_capacity);
+			_release_buffer();
+			m_buffer = _newbuffer;
+		}
+
+		//copy on write check for [lo, hi)
+		__NETP_FORCE_INLINE void _cow_check(buf_size_width_t lo, buf_size_width_t hi) {
+			if (NETP_UNLIKELY(m_buffer_holder != nullptr) && (lo < m_shared_hi) && (hi > m_shared_lo)) {
+				_unshare_buffer();
+			}
+		}
+
+		//mark [lo, hi) as shared, return the holder for the slice
+		NRP<buffer_holder_t> const& _share_range(buf_size_width_t lo, buf_size_width_t hi) {
+			if (m_buffer_holder == nullptr) {
+				m_buffer_holder = netp::make_ref<buffer_holder_t>(m_buffer);
+				m_shared_lo = lo;
+				m_shared_hi = hi;
+			} else if (m_shared_lo == m_shared_hi) {
+				m_shared_lo = lo;
+				m_shared_hi = hi;
+			} else {
+				m_shared_lo = NETP_MIN(m_shared_lo, lo);
+				m_shared_hi = NETP_MAX(m_shared_hi, hi);
+			}
+			return m_buffer_holder;
+		}
+
 	public:
 		explicit cap_fix_packet(buf_size_width_t right_capacity = DEF_RIGHT_CAPACITY, buf_size_width_t left_capacity = DEF_LEFT_RESERVE) :
 			m_buffer(nullptr),
 			m_read_idx(0),
-			m_write_idx(0)
+			m_write_idx(0),
+			m_shared_lo(0),
+			m_shared_hi(0)
 		{
 			_init_buffer(left_capacity, right_capacity);
 		}
@@ -71,20 +179,59 @@ namespace netp {
 		explicit cap_fix_packet(void const* const buf, buf_size_width_t len, buf_size_width_t left_cap = DEF_LEFT_RESERVE) :
 			m_buffer(nullptr),
 			m_read_idx(0),
-			m_write_idx(0)
+			m_write_idx(0),
+			m_shared_lo(0),
+			m_shared_hi(0)
 		{
 			_init_buffer(left_cap, len);
 			write(buf, len);
 		}
 
+		//[buf+headroom, buf+headroom+len) of holder, [buf, buf+headroom) is the left capacity of this slice, no right capacity
+		//the content is shared with the parent
+		explicit cap_fix_packet(packet_slice_tag, NRP<buffer_holder_t> const& holder, byte_t* buf, buf_size_width_t headroom, buf_size_width_t len) :
+			m_buffer(buf),
+			m_read_idx(headroom),
+			m_write_idx(headroom+len),
+			m_capacity(headroom+len),
+			m_shared_lo(headroom),
+			m_shared_hi(headroom+len),
+			m_buffer_holder(holder)
+		{
+		}
+
+		//the buffer of holder, not shared yet, it goes back to where it comes from once it is released
+		explicit cap_fix_packet(packet_pooled_tag, NRP<buffer_holder_t>&& holder, byte_t* buf, buf_size_width_t capacity, buf_size_width_t left_capacity) :
+			m_buffer(buf),
+			m_read_idx(left_capacity),
+			m_write_idx(left_capacity),
+			m_capacity(capacity),
+			m_shared_lo(0),
+			m_shared_hi(0),
+			m_buffer_holder(std::move(holder))
+		{
+		}
+
 		~cap_fix_packet() {
-			netp::allocator<byte_t>::free(m_buffer);
+			_release_buffer();
+		}
+
+		__NETP_FORCE_INLINE bool is_buffer_shared() const {
+			return m_buffer_holder != nullptr;
 		}
 
 		__NETP_FORCE_INLINE void reset(buf_size_width_t left_capacity = DEF_LEFT_RESERVE) {
 #ifdef _NETP_DEBUG
 			NETP_ASSERT(left_capacity < m_capacity);
 #endif
+			if (NETP_UNLIKELY(m_buffer_holder != nullptr) && (m_shared_lo != m_shared_hi)) {
+				if (m_buffer_holder.ref_count() == 1) {
+					//the slices are gone
+					m_shared_lo = m_shared_hi = 0;
+				} else {
+					_detach_buffer();
+				}
+			}
 			m_read_idx = m_write_idx = left_capacity;
 		}
 
@@ -107,6 +254,7 @@ namespace netp {
 
 		__NETP_FORCE_INLINE void decre_write_idx(buf_size_width_t bytes) {
 			NETP_ASSERT((m_write_idx) >= bytes);
+			_cow_check(m_write_idx - bytes, m_write_idx);
 			m_write_idx -= bytes;
 		}
 
@@ -133,6 +281,7 @@ namespace netp {
 		__NETP_FORCE_INLINE
 		void write_left(byte_t const* buf, buf_size_width_t len) {
 			NETP_ASSERT(m_read_idx >= len);
+			_cow_check(m_read_idx - len, m_read_idx);
 			m_read_idx -= len;
 			std::memcpy(m_buffer + m_read_idx, buf, len);
 		}
@@ -141,6 +290,7 @@ namespace netp {
 		template <class T, class endian = NETP_DEF_ENDIAN>
 		inline void write_left(T t) {
 			NETP_ASSERT( m_read_idx >= sizeof(T) );
+			_cow_check(m_read_idx - buf_size_width_t(sizeof(T)), m_read_idx);
 			m_read_idx -= sizeof(T);
 			buf_size_width_t wnbytes = buf_size_width_t(netp::bytes_helper::write<T,netp::byte_t*, endian>((m_buffer + m_read_idx),t));
 			NETP_ASSERT(wnbytes == sizeof(T));
@@ -150,17 +300,20 @@ namespace netp {
 		template <class T, class endian = NETP_DEF_ENDIAN>
 		inline void write(T t) {
 			NETP_ASSERT( left_right_capacity() >= sizeof(T) ) ;
+			_cow_check(m_write_idx, m_write_idx + buf_size_width_t(sizeof(T)));
 			m_write_idx += buf_size_width_t(netp::bytes_helper::write<T,netp::byte_t*,endian>((m_buffer + m_write_idx),t));
 		}
 
 		inline void write(void const* const buf, buf_size_width_t len) {
 			NETP_ASSERT(left_right_capacity() >= len, "left_right_capacity: %u, len: %u", left_right_capacity(), len);
+			_cow_check(m_write_idx, m_write_idx + len);
 			std::memcpy(m_buffer + m_write_idx, buf, len);
 			m_write_idx += len;
 		}
 
 		inline void fill(u8_t b, buf_size_width_t len) {
 			NETP_ASSERT(left_right_capacity() >= len, "left_right_capacity: %u, len: %u", left_right_capacity(), len );
+			_cow_check(m_write_idx, m_write_idx + len);
 			std::memset(m_buffer + m_write_idx, b, len);
 			m_write_idx += len;
 		}
@@ -252,7 +405,7 @@ namespace netp {
 			cap_fix_packet_t::m_read_idx = new_left;
 			cap_fix_packet_t::m_write_idx = cap_fix_packet_t::m_read_idx+_len;
 			
-			netp::allocator<byte_t>::free(cap_fix_packet_t::m_buffer);
+			cap_fix_packet_t::_release_buffer();
 			cap_fix_packet_t::m_buffer = _newbuffer;
 		}
 
@@ -261,11 +414,25 @@ namespace netp {
 			NETP_ASSERT(cap_fix_packet_t::m_buffer != nullptr);
 			NETP_ASSERT((cap_fix_packet_t::m_capacity + increment) <= PACK_MAX_CAPACITY);
 			cap_fix_packet_t::m_capacity += increment;
+			if (NETP_UNLIKELY(cap_fix_packet_t::m_buffer_holder != nullptr)) {
+				byte_t* _newbuffer = netp::allocator<byte_t>::malloc(cap_fix_packet_t::m_capacity, AGN);
+				NETP_ALLOC_CHECK(_newbuffer, cap_fix_packet_t::m_capacity);
+				if (cap_fix_packet_t::len() > 0) {
+					std::memcpy(_newbuffer + cap_fix_packet_t::m_read_idx, cap_fix_packet_t::m_buffer + cap_fix_packet_t::m_read_idx, cap_fix_packet_t::len());
+				}
+				cap_fix_packet_t::_release_buffer();
+				cap_fix_packet_t::m_buffer = _newbuffer;
+				return;
+			}
 			byte_t* _newbuffer = netp::allocator<byte_t>::realloc(cap_fix_packet_t::m_buffer, cap_fix_packet_t::m_capacity, AGN);
 			NETP_ALLOC_CHECK(_newbuffer, cap_fix_packet_t::m_capacity);
 			cap_fix_packet_t::m_buffer = _newbuffer;
 		}
 
+		__NETP_FORCE_INLINE bool __is_range_shared(_buf_width_t lo, _buf_width_t hi) const {
+			return (cap_fix_packet_t::m_buffer_holder != nullptr) && (lo < cap_fix_packet_t::m_shared_hi) && (hi > cap_fix_packet_t::m_shared_lo);
+		}
+
 	public:
 		explicit cap_expandable_packet(_buf_width_t right_capacity = DEF_RIGHT_CAPACITY, _buf_width_t left_capacity = DEF_LEFT_CAPACITY) :
 			cap_fix_packet_t(right_capacity, left_capacity)
@@ -277,6 +444,46 @@ namespace netp {
 		{
 		}
 
+		explicit cap_expandable_packet(packet_slice_tag tag, NRP<typename cap_fix_packet_t::buffer_holder_t> const& holder, byte_t* buf, _buf_width_t headroom, _buf_width_t len) :
+			cap_fix_packet_t(tag, holder, buf, headroom, len)
+		{
+		}
+
+		explicit cap_expandable_packet(packet_pooled_tag tag, NRP<typename cap_fix_packet_t::buffer_holder_t>&& holder, byte_t* buf, _buf_width_t capacity, _buf_width_t left_capacity) :
+			cap_fix_packet_t(tag, std::move(holder), buf, capacity, left_capacity)
+		{
+		}
+
+		//make sure there are at least n bytes of right capacity
+		inline void reserve(_buf_width_t n) {
+			if (n > cap_fix_packet_t::left_right_capacity()) {
+				_extend_rightbuffer_capacity__(n - cap_fix_packet_t::left_right_capacity());
+			}
+		}
+
+		//[head()+off, head()+off+len_) without copy
+		//headroom: the consumed bytes right before head() would be the left capacity of the slice (off must be 0), if they are not shared yet
+		inline NRP<expandable_packet_t> slice(_buf_width_t off, _buf_width_t len_, _buf_width_t headroom = 0) {
+			NETP_ASSERT((off + len_) <= cap_fix_packet_t::len(), "off: %u, len: %u, packet len: %u", off, len_, cap_fix_packet_t::len());
+			const _buf_width_t lo = cap_fix_packet_t::m_read_idx + off;
+			if ((off != 0) || (lo < headroom) || __is_range_shared(lo - headroom, lo)) {
+				headroom = 0;
+			}
+			return netp::make_ref<expandable_packet_t>(packet_slice_tag(), cap_fix_packet_t::_share_range(lo - headroom, lo + len_), cap_fix_packet_t::m_buffer + lo - headroom, headroom, len_);
+		}
+
+		//write [buf, buf+len_) into the headroom, return the slice of [headroom, tail)
+		//return nullptr if there is no enough headroom, or the headroom has been shared, this packet is not modified
+		inline NRP<expandable_packet_t> slice_prepend(byte_t const* buf, _buf_width_t len_) {
+			const _buf_width_t ridx = cap_fix_packet_t::m_read_idx;
+			if ((ridx < len_) || __is_range_shared(ridx - len_, ridx)) {
+				return nullptr;
+			}
+			const _buf_width_t lo = ridx - len_;
+			std::memcpy(cap_fix_packet_t::m_buffer + lo, buf, len_);
+			return netp::make_ref<expandable_packet_t>(packet_slice_tag(), cap_fix_packet_t::_share_range(lo, cap_fix_packet_t::m_write_idx), cap_fix_packet_t::m_buffer + lo, 0, cap_fix_packet_t::m_write_idx - lo);
+		}
+
 		void write_left( byte_t const* buf, _buf_width_t len ) {
 			while ( NETP_UNLIKELY(len > (cap_fix_packet_t::left_left_capacity())) ) {
 				_extend_leftbuffer_capacity__( ((len - (cap_fix_packet_t::left_left_capacity() ))<<1));
@@ -285,6 +492,7 @@ namespace netp {
 #ifdef _NETP_DEBUG
 			NETP_ASSERT(cap_fix_packet_t::m_read_idx >= len);
 #endif
+			cap_fix_packet_t::_cow_check(cap_fix_packet_t::m_read_idx - len, cap_fix_packet_t::m_read_idx);
 			cap_fix_packet_t::m_read_idx -= len;
 			std::memcpy(cap_fix_packet_t::m_buffer + cap_fix_packet_t::m_read_idx, buf, len) ;
 		}
@@ -296,6 +504,7 @@ namespace netp {
 				_extend_leftbuffer_capacity__(PACK_INCREMENT_SIZE_LEFT);
 			}
 
+			cap_fix_packet_t::_cow_check(cap_fix_packet_t::m_read_idx - _buf_width_t(sizeof(T)), cap_fix_packet_t::m_read_idx);
 			cap_fix_packet_t::m_read_idx -= sizeof(T);
 			_buf_width_t wnbytes = netp::bytes_helper::write<T, netp::byte_t*, endian>((cap_fix_packet_t::m_buffer + cap_fix_packet_t::m_read_idx),t );
 #ifdef _NETP_DEBUG
@@ -310,6 +519,7 @@ namespace netp {
 				_extend_rightbuffer_capacity__(PACK_INCREMENT_SIZE_RIGHT);
 			}
 
+			cap_fix_packet_t::_cow_check(cap_fix_packet_t::m_write_idx, cap_fix_packet_t::m_write_idx + _buf_width_t(sizeof(T)));
 			cap_fix_packet_t::m_write_idx += netp::bytes_helper::write<T, netp::byte_t*, endian>((cap_fix_packet_t::m_buffer + cap_fix_packet_t::m_write_idx), t );
 		}
 
@@ -317,6 +527,7 @@ namespace netp {
 			while ( NETP_UNLIKELY(len > (cap_fix_packet_t::left_right_capacity())) ) {
 				_extend_rightbuffer_capacity__(((len - (cap_fix_packet_t::left_right_capacity()))<<1));
 			}
+			cap_fix_packet_t::_cow_check(cap_fix_packet_t::m_write_idx, cap_fix_packet_t::m_write_idx + len);
 			std::memcpy(cap_fix_packet_t::m_buffer + cap_fix_packet_t::m_write_idx, buf, len) ;
 			cap_fix_packet_t::m_write_idx += len;
 		}
@@ -325,6 +536,7 @@ namespace netp {
 			while (NETP_UNLIKELY(len > (cap_fix_packet_t::left_right_capacity()))) {
 				_extend_rightbuffer_capacity__(((len - (cap_fix_packet_t::left_right_capacity())) << 1));
 			}
+			cap_fix_packet_t::_cow_check(cap_fix_packet_t::m_write_idx, cap_fix_packet_t::m_write_idx + len);
 			std::memset(cap_fix_packet_t::m_buffer + cap_fix_packet_t::m_write_idx, b, len);
 			cap_fix_packet_t::m_write_idx += len;
 		}
@@ -355,5 +567,73 @@ namespace netp {
 
 	typedef std::deque<NRP<netp::packet>, netp::allocator<NRP<netp::packet>>> packet_deque_t;
 	typedef std::queue<NRP<netp::packet>, std::deque<NRP<netp::packet>, netp::allocator<NRP<netp::packet>>>> packet_queue_t;
+
+	//a list of packets (usually slices) that is written out as one message, no copy in between them, refer to channel::ch_write_chain
+	//1, stream socket gathers them into sendv, others get the coalesced packet
+	//2, a handler that does not impl write_chain gets the coalesced packet by write
+	//3, len() is summed on push, do not modify a packet after it has been pushed
+	class packet_chain final:
+		public ref_base
+	{
+		typedef std::vector<NRP<packet>, netp::allocator<NRP<packet>>> packet_vector_t;
+		packet_vector_t m_pkts;
+		u32_t m_len;
+
+	public:
+		typedef packet_vector_t::const_iterator const_iterator;
+
+		packet_chain() :
+			m_len(0)
+		{}
+
+		explicit packet_chain(NRP<packet> const& pkt) :
+			m_len(0)
+		{
+			push_back(pkt);
+		}
+
+		//zero-len packet is ignored
+		inline void push_back(NRP<packet> const& pkt) {
+			if (pkt->len() == 0) { return; }
+			m_pkts.push_back(pkt);
+			m_len += pkt->len();
+		}
+
+		inline void push_front(NRP<packet> const& pkt) {
+			if (pkt->len() == 0) { return; }
+			m_pkts.insert(m_pkts.begin(), pkt);
+			m_len += pkt->len();
+		}
+
+		inline void push_back(NRP<packet_chain> const& chain) {
+			m_pkts.insert(m_pkts.end(), chain->m_pkts.begin(), chain->m_pkts.end());
+			m_len += chain->m_len;
+		}
+
+		inline void clear() {
+			m_pkts.clear();
+			m_len = 0;
+		}
+
+		__NETP_FORCE_INLINE u32_t len() const { return m_len; }
+		__NETP_FORCE_INLINE u32_t count() const { return u32_t(m_pkts.size()); }
+		__NETP_FORCE_INLINE bool empty() const { return m_pkts.empty(); }
+
+		__NETP_FORCE_INLINE NRP<packet> const& operator[](u32_t i) const { return m_pkts[i]; }
+		__NETP_FORCE_INLINE const_iterator begin() const { return m_pkts.begin(); }
+		__NETP_FORCE_INLINE const_iterator end() const { return m_pkts.end(); }
+
+		//one packet of all the bytes, the only one is returned as it is
+		NRP<packet> to_packet() const {
+			if (m_pkts.size() == 1) {
+				return m_pkts[0];
+			}
+			NRP<packet> pkt = netp::make_ref<packet>(m_len);
+			for (const_iterator it = m_pkts.begin(); it != m_pkts.end(); ++it) {
+				pkt->write((*it)->head(), (*it)->len());
+			}
+			return pkt;
+		}
+	};
 }
 #endif
\ No newline at end of file
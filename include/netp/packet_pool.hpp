@@ -0,0 +1,152 @@
+#ifndef _NETP_PACKET_POOL_HPP_
+#define _NETP_PACKET_POOL_HPP_
+
+#include <atomic>
+
+#include <netp/core.hpp>
+#include <netp/packet.hpp>
+#include <netp/mpsc_queue.hpp>
+
+//@note: size class i holds buffers of (NETP_PACKET_POOL_CLASS_MIN<<(NETP_PACKET_POOL_CLASS_SHIFT*i)) bytes of right capacity
+//the last class is the read buffer size of the loop, refer to event_loop_cfg::channel_read_buf_size
+//512, 2k, 8k, read_buf_size
+#define NETP_PACKET_POOL_CLASS_COUNT (4)
+#define NETP_PACKET_POOL_CLASS_MIN (512)
+#define NETP_PACKET_POOL_CLASS_SHIFT (2)
+
+//@note: max bytes cached by one size class, the buffer would be freed if the class is full
+#define NETP_PACKET_POOL_CLASS_CACHE_BYTES (4*1024*1024)
+
+namespace netp {
+
+	struct packet_pool_class_stat {
+		u32_t size;
+		u32_t cached;
+		u64_t hit; //get from cache
+		u64_t miss; //get by malloc
+		u64_t recycled; //back to cache
+		u64_t dropped; //freed cuz of the cache is full
+	};
+
+	//packet pool of one event_loop
+	//1, get: loop thread only, packet's buffer comes from the first class that fits, pop from the cache of the class, or malloc if it is empty
+	//2, the buffer goes back to its class once the packet|slices of it have been released, from any thread (mpsc_queue)
+	//3, size beyond the last class is not pooled
+	class packet_pool final :
+		public packet_buffer_recycler
+	{
+		NETP_DECLARE_NONCOPYABLE(packet_pool)
+
+		typedef packet_buffer_holder<ref_base> holder_t;
+
+		struct size_class {
+			mpsc_queue q;
+			std::atomic<u32_t> cached;
+			u32_t size;
+			u32_t cache_max;
+			std::atomic<u64_t> hit;
+			std::atomic<u64_t> miss;
+			std::atomic<u64_t> recycled;
+			std::atomic<u64_t> dropped;
+		};
+
+		size_class m_classes[NETP_PACKET_POOL_CLASS_COUNT];
+
+		static_assert(sizeof(mpsc_node) <= PACK_DEF_LEFT_CAPACITY, "mpsc_node size check failed");
+
+		__NETP_FORCE_INLINE static u32_t __buffer_size(u32_t size) {
+			return u32_t(PACK_DEF_LEFT_CAPACITY) + size;
+		}
+
+		__NETP_FORCE_INLINE u32_t __class_of(u32_t size) const {
+			u32_t i = 0;
+			while ((i < NETP_PACKET_POOL_CLASS_COUNT) && (m_classes[i].size < size)) { ++i; }
+			return i;
+		}
+
+	public:
+		explicit packet_pool(u32_t max_size) {
+			for (u32_t i = 0; i < NETP_PACKET_POOL_CLASS_COUNT; ++i) {
+				size_class& c = m_classes[i];
+				c.size = (i == (NETP_PACKET_POOL_CLASS_COUNT - 1)) ?
+					NETP_MAX(max_size, u32_t(NETP_PACKET_POOL_CLASS_MIN << (NETP_PACKET_POOL_CLASS_SHIFT * i))) :
+					u32_t(NETP_PACKET_POOL_CLASS_MIN << (NETP_PACKET_POOL_CLASS_SHIFT * i));
+				c.cache_max = NETP_MAX(u32_t(NETP_PACKET_POOL_CLASS_CACHE_BYTES / __buffer_size(c.size)), 1u);
+				c.cached.store(0, std::memory_order_relaxed);
+				c.hit.store(0, std::memory_order_relaxed);
+				c.miss.store(0, std::memory_order_relaxed);
+				c.recycled.store(0, std::memory_order_relaxed);
+				c.dropped.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		~packet_pool() {
+			//no more holder alive
+			for (u32_t i = 0; i < NETP_PACKET_POOL_CLASS_COUNT; ++i) {
+				mpsc_node* n;
+				while ((n = m_classes[i].q.pop()) != nullptr) {
+					netp::allocator<byte_t>::free((byte_t*)n);
+				}
+			}
+		}
+
+		//the largest size that would be pooled
+		__NETP_FORCE_INLINE u32_t max_size() const {
+			return m_classes[NETP_PACKET_POOL_CLASS_COUNT - 1].size;
+		}
+
+		//the size of the class next to the last one, a read less than this is worth a copy
+		__NETP_FORCE_INLINE u32_t small_size() const {
+			return m_classes[NETP_PACKET_POOL_CLASS_COUNT - 2].size;
+		}
+
+		//loop thread only, a empty packet of at least size bytes of right capacity
+		NRP<packet> get(u32_t size) {
+			const u32_t ci = __class_of(size);
+			if (ci == NETP_PACKET_POOL_CLASS_COUNT) {
+				return netp::make_ref<packet>(size);
+			}
+			size_class& c = m_classes[ci];
+			byte_t* buf = (byte_t*)c.q.pop();
+			if (buf != nullptr) {
+				c.cached.fetch_sub(1, std::memory_order_relaxed);
+				c.hit.fetch_add(1, std::memory_order_relaxed);
+			} else {
+				buf = netp::allocator<byte_t>::malloc(__buffer_size(c.size), NETP_DEFAULT_ALIGN);
+				NETP_ALLOC_CHECK(buf, __buffer_size(c.size));
+				c.miss.fetch_add(1, std::memory_order_relaxed);
+			}
+			return netp::make_ref<packet>(packet_pooled_tag(), netp::make_ref<holder_t>(buf, NRP<packet_buffer_recycler>(this), ci), buf, __buffer_size(c.size), u32_t(PACK_DEF_LEFT_CAPACITY));
+		}
+
+		void recycle(byte_t* buf, u32_t ci) override {
+			NETP_ASSERT(ci < NETP_PACKET_POOL_CLASS_COUNT);
+			size_class& c = m_classes[ci];
+			if (c.cached.fetch_add(1, std::memory_order_relaxed) >= c.cache_max) {
+				c.cached.fetch_sub(1, std::memory_order_relaxed);
+				c.dropped.fetch_add(1, std::memory_order_relaxed);
+				netp::allocator<byte_t>::free(buf);
+				return;
+			}
+			c.recycled.fetch_add(1, std::memory_order_relaxed);
+			c.q.push(::new ((void*)buf) mpsc_node());
+		}
+
+		__NETP_FORCE_INLINE u32_t class_count() const {
+			return NETP_PACKET_POOL_CLASS_COUNT;
+		}
+
+		//might be called from any thread, the counters are relaxed
+		void class_stat(u32_t ci, packet_pool_class_stat& st) const {
+			NETP_ASSERT(ci < NETP_PACKET_POOL_CLASS_COUNT);
+			size_class const& c = m_classes[ci];
+			st.size = c.size;
+			st.cached = c.cached.load(std::memory_order_relaxed);
+			st.hit = c.hit.load(std::memory_order_relaxed);
+			st.miss = c.miss.load(std::memory_order_relaxed);
+			st.recycled = c.recycled.load(std::memory_order_relaxed);
+			st.dropped = c.dropped.load(std::memory_order_relaxed);
+		}
+	};
+}
+#endif
@@ -13,7 +13,13 @@
 //in nano
 //ENTER HAS A lock_gurard to sure the compiler would not reorder it
 #define NETP_POLLER_WAIT_ENTER(W) ((W).store(true,std::memory_order_relaxed))
-#define NETP_POLLER_WAIT_EXIT(wt_in_nano,W) ((wt_in_nano!=0) ? (W).store(false,std::memory_order_release) : (void)0);
+//the return of a blocking wait is stamped, refer to poller_abstract::wait_exit_tp
+#define NETP_POLLER_WAIT_EXIT(wt_in_nano,W) do { \
+		if (wt_in_nano!=0) { \
+			(W).store(false,std::memory_order_release); \
+			m_wait_exit_tp = netp::now<std::chrono::nanoseconds, netp::steady_clock_t>().time_since_epoch().count(); \
+		} \
+	} while(0)
 
 namespace netp {
 
@@ -22,6 +28,7 @@ namespace netp {
 		T_IOCP, //win
 		T_EPOLL, //linux,epoll,et
 		T_KQUEUE,//bsd
+		T_IO_URING,//linux,io_uring multishot poll
 		T_POLLER_MAX,
 		T_NONE
 	};
@@ -31,7 +38,8 @@ namespace netp {
 		IO_WRITE = 1 << 1,
 		IO_READ_HUP = 1<<2, //read closed by remote peer
 		IO_ADD_PENDING = 1<<3, //USED BY SELECT ONLY,
-		IO_EPOLL_NOET = 1<<4 //USED BY EPOLL ONLY
+		IO_EPOLL_NOET = 1<<4, //USED BY EPOLL ONLY
+		IO_WRITE_BLOCKED = 1<<5 //set right before io_action::WRITE if the write has just got EWOULDBLOCK, set and cleared by T_EPOLL with NETP_EPOLL_COALESCE_CTL only
 	};
 
 	enum class io_action {
@@ -75,14 +83,19 @@ namespace netp {
 	{
 	protected:
 		io_poller_type m_type;
+		i64_t m_wait_exit_tp;
 	public:
-		poller_abstract(io_poller_type t):m_type(t) {}
+		poller_abstract(io_poller_type t):m_type(t), m_wait_exit_tp(0) {}
 		~poller_abstract() {}
 
+		//steady clock in nano of the last return of a blocking wait, the events are dispatched after it
+		i64_t wait_exit_tp() const { return m_wait_exit_tp; }
+
 		virtual void init() = 0;
 		virtual void deinit() = 0;
 
-		virtual void poll(i64_t wait_in_nano, std::atomic<bool>& waiting) = 0;
+		//return the count of the ready events
+		virtual u32_t poll(i64_t wait_in_nano, std::atomic<bool>& waiting) = 0;
 
 		virtual void interrupt_wait() = 0;
 		virtual int io_do(io_action, io_ctx*) = 0;
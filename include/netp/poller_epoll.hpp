@@ -4,6 +4,7 @@
 #include <sys/epoll.h>
 #include <syscall.h>
 #include <poll.h>
+#include <vector>
 
 #include <netp/core.hpp>
 #include <netp/poller_interruptable_by_fd.hpp>
@@ -19,21 +20,180 @@ namespace netp {
 		EPOLLIN,EPOLLOUT
 	};
 
+	//rounds of a batch used less than a quarter before it shrinks
+	#define NETP_EPOLL_BATCH_SHRINK_ROUNDS (256)
+
+#ifdef NETP_EPOLL_COALESCE_CTL
+	#define NETP_EPOLL_CTX_CLEAN (u32_t(~0))
+	//EPOLLOUT kept after the write end is dropped once it fires this many times unwanted
+	#define NETP_EPOLL_WRITE_UNWANTED_MAX (4)
+
+	struct epoll_ctx :
+		public io_ctx
+	{
+		u8_t registered; //io_flag::IO_READ|io_flag::IO_WRITE in the kernel
+		u8_t write_unwanted; //times the kept EPOLLOUT has fired since the write end
+		bool rearm; //watched again with the event in the kernel, mod it to get the edge of the current state
+		u32_t dirty_idx; //slot in m_dirty, NETP_EPOLL_CTX_CLEAN if none
+	};
+#endif
+
 	class poller_epoll final:
 		public poller_interruptable_by_fd
 	{
 		int m_epfd;
+		struct epoll_event* m_events;
+		int m_events_size;
+		int m_events_low_rounds;
+
+#ifdef NETP_EPOLL_COALESCE_CTL
+		std::vector<epoll_ctx*, netp::allocator<epoll_ctx*>> m_dirty;
+
+		inline void __dirty(epoll_ctx* ctx) {
+			if (ctx->dirty_idx == NETP_EPOLL_CTX_CLEAN) {
+				ctx->dirty_idx = u32_t(m_dirty.size());
+				m_dirty.push_back(ctx);
+			}
+		}
+
+		//bring the kernel to the flag of io_ctx by one epoll_ctl at most
+		int __ctl(epoll_ctx* ctx) {
+			u8_t want = (ctx->flag & (io_flag::IO_READ | io_flag::IO_WRITE));
+			//for et, EPOLLOUT is kept after the write end, a tcp socket wakes it up once at most after a blocked write, so the next block costs no epoll_ctl
+			if (want & io_flag::IO_WRITE) {
+				ctx->write_unwanted = 0;
+			} else if (want && (ctx->registered & io_flag::IO_WRITE) && ((ctx->flag & io_flag::IO_EPOLL_NOET) == 0) && (ctx->write_unwanted < NETP_EPOLL_WRITE_UNWANTED_MAX)) {
+				want |= io_flag::IO_WRITE;
+			}
+			if (want == ctx->registered && !ctx->rearm) {
+				return netp::OK;
+			}
+			struct epoll_event epEvent =
+			{
+				(ctx->flag&io_flag::IO_EPOLL_NOET) ? (EPOLLRDHUP|EPOLLHUP|EPOLLERR) : (EPOLLET|EPOLLRDHUP|EPOLLHUP|EPOLLERR),
+				{(void*)ctx}
+			};
+			int epoll_op;
+			if (want == 0) {
+				epoll_op = EPOLL_CTL_DEL;
+			} else {
+				epoll_op = ctx->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+				epEvent.events |= ((want & io_flag::IO_READ) ? u32_t(EPOLLIN) : 0) | ((want & io_flag::IO_WRITE) ? u32_t(EPOLLOUT) : 0);
+			}
+			NETP_TRACE_IOE("[EPOLL][##%u][ctl][#%u]op: %d, evts: %u", m_epfd, ctx->fd, epoll_op, epEvent.events);
+			const int rt = epoll_ctl(m_epfd, epoll_op, ctx->fd, &epEvent);
+			if (rt == 0) {
+				ctx->registered = want;
+				ctx->rearm = false;
+				if ((want & io_flag::IO_WRITE) == 0) {
+					ctx->write_unwanted = 0;
+				}
+			}
+			return rt;
+		}
+
+		void __flush_ctl() {
+			//@note: a notify of a failed one might dirty more ctx, they are applied in this round as well
+			for (size_t i = 0; i < m_dirty.size(); ++i) {
+				epoll_ctx* ctx = m_dirty[i];
+				if (ctx == nullptr) {
+					continue;
+				}
+				ctx->dirty_idx = NETP_EPOLL_CTX_CLEAN;
+				if (__ctl(ctx) != netp::OK) {
+					const int ec = netp_socket_get_last_errno();
+					NETP_WARN("[EPOLL][##%u][#%u]epoll_ctl failed: %d, flag: %u", m_epfd, ctx->fd, ec, ctx->flag);
+					NRP<io_monitor>& iom = ctx->iom;
+					if (ctx->flag & u8_t(io_flag::IO_READ)) {
+						iom->io_notify_read(ec, ctx);
+					}
+					if (ctx->flag & u8_t(io_flag::IO_WRITE)) {
+						iom->io_notify_write(ec, ctx);
+					}
+				}
+			}
+			m_dirty.clear();
+		}
+#endif
+
+		void __events_resize(int size) {
+			if (m_events != nullptr) {
+				netp::allocator<struct epoll_event>::free(m_events);
+			}
+			m_events = netp::allocator<struct epoll_event>::malloc(size_t(size));
+			m_events_size = size;
+			m_events_low_rounds = 0;
+		}
+
+		//a full batch doubles the next one, a quarter used for NETP_EPOLL_BATCH_SHRINK_ROUNDS halves it
+		void __events_adapt(int nEvents) {
+			if (nEvents == m_events_size) {
+				if (m_events_size < NETP_EPOLL_PER_HANDLE_SIZE_MAX) {
+					__events_resize(m_events_size << 1);
+				}
+			} else if (nEvents <= (m_events_size >> 2) && m_events_size > NETP_EPOLL_PER_HANDLE_SIZE) {
+				if (++m_events_low_rounds == NETP_EPOLL_BATCH_SHRINK_ROUNDS) {
+					__events_resize(m_events_size >> 1);
+				}
+			} else {
+				m_events_low_rounds = 0;
+			}
+		}
+
 	public:
 		poller_epoll():
 			poller_interruptable_by_fd(io_poller_type::T_EPOLL),
-			m_epfd(NETP_INVALID_SOCKET)
+			m_epfd(NETP_INVALID_SOCKET),
+			m_events(nullptr),
+			m_events_size(0),
+			m_events_low_rounds(0)
 		{
 		}
 
 		~poller_epoll() {
 			NETP_ASSERT( m_epfd == NETP_INVALID_SOCKET);
+			NETP_ASSERT( m_events == nullptr);
+		}
+
+#ifdef NETP_EPOLL_COALESCE_CTL
+		io_ctx* io_begin(SOCKET fd, NRP<io_monitor> const& iom) override {
+			epoll_ctx* ctx = netp::allocator<epoll_ctx>::make();
+			if (ctx == 0) {
+				return 0;
+			}
+			ctx->fd = fd;
+			ctx->flag = 0;
+			ctx->iom = iom;
+			ctx->registered = 0;
+			ctx->write_unwanted = 0;
+			ctx->rearm = false;
+			ctx->dirty_idx = NETP_EPOLL_CTX_CLEAN;
+			netp::list_append(&m_io_ctx_list, (io_ctx*)ctx);
+#ifdef NETP_DEBUG_IO_CTX_
+			++m_io_ctx_count_alloc;
+#endif
+			NETP_TRACE_IOE("[EPOLL][##%u][io_begin][#%d]", m_epfd, ctx->fd);
+			return ctx;
 		}
 
+		void io_end(io_ctx* ctx_) override {
+			NETP_TRACE_IOE("[EPOLL][##%u][io_end][#%d]", m_epfd, ctx_->fd);
+			NETP_ASSERT((ctx_->iom != nullptr) && ((ctx_->flag & (io_flag::IO_READ | io_flag::IO_WRITE)) == 0), "flag: %u", ctx_->flag);
+			epoll_ctx* ctx = (epoll_ctx*)ctx_;
+			//removed by unwatch already
+			NETP_ASSERT(ctx->registered == 0);
+			if (ctx->dirty_idx != NETP_EPOLL_CTX_CLEAN) {
+				m_dirty[ctx->dirty_idx] = nullptr;
+			}
+			netp::list_delete(ctx_);
+			ctx->iom = nullptr;
+			netp::allocator<epoll_ctx>::trash(ctx);
+#ifdef NETP_DEBUG_IO_CTX_
+			++m_io_ctx_count_free;
+#endif
+		}
+#endif
+
 		int watch(u8_t flag, io_ctx* ctx) override {
 
 #ifdef _NETP_DEBUG_EPOLL_EVENTS
@@ -43,6 +203,17 @@ namespace netp {
 			//ctx->flag |= io_flag::IO_EPOLL_NOET;
 #endif
 
+#ifdef NETP_EPOLL_COALESCE_CTL
+			//applied before the next epoll_wait, ctx->flag has the new one by then
+			//an unwatch of this round might have been canceled, or EPOLLOUT is kept, the edge of data pending or of a writable socket is gone, but a full send buffer wakes it up again
+			epoll_ctx* ectx = (epoll_ctx*)ctx;
+			if ((ectx->registered & flag) && !((flag == io_flag::IO_WRITE) && (ctx->flag & io_flag::IO_WRITE_BLOCKED))) {
+				ectx->rearm = true;
+			}
+			ctx->flag &= ~io_flag::IO_WRITE_BLOCKED;
+			__dirty(ectx);
+			return netp::OK;
+#else
 			struct epoll_event epEvent =
 			{
 				(ctx->flag&io_flag::IO_EPOLL_NOET) ? (EPOLLRDHUP|EPOLLHUP|EPOLLERR) : (EPOLLET|EPOLLRDHUP|EPOLLHUP|EPOLLERR),
@@ -64,12 +235,24 @@ namespace netp {
 #endif
 			NETP_TRACE_IOE("[EPOLL][##%u][watch][#%u]op: %c, evts: %u", m_epfd, ctx->fd, epoll_op == EPOLL_CTL_MOD ? 'm' : 'a', epEvent.events);
 			return epoll_ctl(m_epfd, epoll_op, ctx->fd, &epEvent);
+#endif
 		}
 
 		int unwatch( u8_t flag, io_ctx* ctx ) override {
 #ifdef _NETP_DEBUG_EPOLL_EVENTS
 			NETP_ASSERT((ctx->fd != NETP_INVALID_SOCKET) && (flag == io_flag::IO_READ || flag == io_flag::IO_WRITE));
 #endif
+
+#ifdef NETP_EPOLL_COALESCE_CTL
+			(void)flag;
+			ctx->flag &= ~io_flag::IO_WRITE_BLOCKED;
+			if ((ctx->flag & (io_flag::IO_READ | io_flag::IO_WRITE)) == 0) {
+				//epoll_ctl(del) must happen before close(fd), nothing to do if the add is still pending
+				return __ctl((epoll_ctx*)ctx);
+			}
+			__dirty((epoll_ctx*)ctx);
+			return netp::OK;
+#else
 			struct epoll_event epEvent =
 			{
 				(ctx->flag&io_flag::IO_EPOLL_NOET) ? (EPOLLRDHUP|EPOLLHUP|EPOLLERR) : (EPOLLET|EPOLLRDHUP|EPOLLHUP|EPOLLERR),
@@ -94,6 +277,7 @@ namespace netp {
 #endif
 			NETP_TRACE_IOE("[EPOLL][##%u][unwatch][#%u]op: %c, evts: %u", m_epfd, ctx->fd, epoll_op == EPOLL_CTL_MOD ? 'm': 'd', epEvent.events);
 			return epoll_ctl(m_epfd,epoll_op,ctx->fd,&epEvent) ;
+#endif
 		}
 
 	public:
@@ -104,11 +288,18 @@ namespace netp {
 				NETP_THROW("create epoll handle failed");
 			}
 			NETP_VERBOSE("[EPOLL][##%u]init epoll handle ok", m_epfd);
+			__events_resize(NETP_EPOLL_PER_HANDLE_SIZE);
 			poller_interruptable_by_fd::init();
 		}
 
 		void deinit() override {
 			poller_interruptable_by_fd::deinit();
+#ifdef NETP_EPOLL_COALESCE_CTL
+			m_dirty.clear();
+#endif
+			netp::allocator<struct epoll_event>::free(m_events);
+			m_events = nullptr;
+			m_events_size = 0;
 			NETP_ASSERT(m_epfd != NETP_INVALID_SOCKET);
 			NETP_VERBOSE("[EPOLL][##%u]EPOLL::deinit() begin", m_epfd);
 			int rt = netp::close(m_epfd);
@@ -119,16 +310,19 @@ namespace netp {
 			m_epfd = NETP_INVALID_SOCKET;
 		}
 
-		void poll(i64_t wait_in_nano, std::atomic<bool>& W) override {
+		u32_t poll(i64_t wait_in_nano, std::atomic<bool>& W) override {
 			NETP_ASSERT(m_epfd != NETP_INVALID_SOCKET);
 
-			struct epoll_event epEvents[NETP_EPOLL_PER_HANDLE_SIZE];
+#ifdef NETP_EPOLL_COALESCE_CTL
+			__flush_ctl();
+#endif
+			struct epoll_event* epEvents = m_events;
 			const int wait_in_mill = (wait_in_nano != ~0 ? (wait_in_nano / i64_t(1000000)) : ~0);
-			int nEvents = epoll_wait(m_epfd, epEvents, NETP_EPOLL_PER_HANDLE_SIZE, wait_in_mill);
+			int nEvents = epoll_wait(m_epfd, epEvents, m_events_size, wait_in_mill);
 			NETP_POLLER_WAIT_EXIT(wait_in_nano, W);
 			if (-1 == nEvents) {
 				NETP_VERBOSE("[EPOLL][##%u]epoll wait event failed!, errno: %d", m_epfd, netp_socket_get_last_errno());
-				return;
+				return 0;
 			}
 
 #ifdef _NETP_DEBUG_EPOLL_EVENTS
@@ -150,6 +344,14 @@ namespace netp {
 #endif
 				uint32_t events = ((epEvents[i].events) & 0xFFFFFFFF);
 				io_ctx* ctx = (static_cast<io_ctx*> (epEvents[i].data.ptr));
+#ifdef NETP_EPOLL_COALESCE_CTL
+				if ((events & EPOLLOUT) && !(ctx->flag & io_flag::IO_WRITE) && (static_cast<epoll_ctx*>(ctx)->registered & io_flag::IO_WRITE)) {
+					//the kept EPOLLOUT fires with no write pending, drop it if it keeps firing (udp wakes it up by every send)
+					if (++(static_cast<epoll_ctx*>(ctx)->write_unwanted) == NETP_EPOLL_WRITE_UNWANTED_MAX) {
+						__dirty(static_cast<epoll_ctx*>(ctx));
+					}
+				}
+#endif
 				int sockerr = netp::OK;
 				//refer to:https://elixir.bootlin.com/linux/v4.19/source/net/ipv4/tcp.c#L524
 				//EPOLLHUP is only sent when the shutdown has been both for read and write (I reckon that the peer shutdowning the write equals to my shutdowning the read). Or when the connection is closed, of course.
@@ -192,6 +394,8 @@ namespace netp {
 					iom->io_notify_write(sockerr, ctx);
 				}
 			}
+			__events_adapt(nEvents);
+			return u32_t(nEvents);
 		}
 	};
 }
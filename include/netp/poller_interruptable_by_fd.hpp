@@ -15,7 +15,7 @@ namespace netp {
 		public io_monitor
 	{
 
-		//@TODO: eventfd vs pipe's
+		//fdr == fdw for eventfd
 		SOCKET fdr;
 		SOCKET fdw;
 		io_ctx* ctx;
@@ -36,10 +36,24 @@ namespace netp {
 				NETP_ASSERT(is_sigset.load(std::memory_order_acquire));
 				u32_t nbytes = 0;
 #endif
-				byte_t tmp[4];
 				int ec = netp::OK;
 				do {
-#ifdef NETP_USE_PIPE_AS_INTRFD
+#if defined(NETP_USE_EVENTFD_AS_INTRFD)
+			__label_read_eventfd:
+					eventfd_t v = 0;
+					if (NETP_UNLIKELY(::eventfd_read(fdr, &v) != 0)) {
+						ec = netp_socket_get_last_errno();
+						if (ec == netp::E_EINTR) {
+							goto __label_read_eventfd;
+						}
+						_NETP_REFIX_EWOULDBLOCK(ec);
+					}
+#ifdef _NETP_DEBUG_INTERRUPT_
+					else { nbytes += u32_t(v); }
+#endif
+
+#elif defined(NETP_USE_PIPE_AS_INTRFD)
+					byte_t tmp[4];
 					//NOTE: error 88 if we do read|write on a pipe fd 
 			__label_read:
 					ssize_t c = ::read(fdr, tmp, 4);
@@ -57,6 +71,7 @@ namespace netp {
 #endif
 
 #else
+					byte_t tmp[4];
 					ec = netp::recv(fdr, tmp, 4, 0);
 	#ifdef _NETP_DEBUG_INTERRUPT_
 					if (ec >0) {
@@ -80,8 +95,15 @@ namespace netp {
 				return;
 			}
 			int ec;
+#if defined(NETP_USE_EVENTFD_AS_INTRFD)
+			while (NETP_UNLIKELY(::eventfd_write(fdw, 1) != 0)) {
+				ec = netp_socket_get_last_errno();
+				if (ec == netp::E_EINTR) { continue; }
+				NETP_WARN("[fdinterrupt_monitor][##%u]interrupt eventfd failed: %d", fdw, ec);
+				break;
+			}
+#elif defined(NETP_USE_PIPE_AS_INTRFD)
 			const char interrutp_i = 'i';
-#ifdef NETP_USE_PIPE_AS_INTRFD
 			do {
 				int c = ::write(fdw, (const void*)&interrutp_i, 1);
 				if (c == 1) {
@@ -92,6 +114,7 @@ namespace netp {
 				NETP_WARN("[fdinterrupt_monitor][##%u]interrupt pipe failed: %d", fdw, ec);
 			} while (fdw != NETP_INVALID_SOCKET);
 #else
+			const char interrutp_i = 'i';
 			ec = netp::send(fdw, (byte_t const* const)&interrutp_i, 1, 0);
 			if (NETP_UNLIKELY(ec<0)) {
 				NETP_WARN("[fdinterrupt_monitor][##%u]interrupt send failed: %d", fdw, ec);
@@ -100,6 +123,15 @@ namespace netp {
 		}
 		
 		void init() {
+#if defined(NETP_USE_EVENTFD_AS_INTRFD)
+			SOCKET fd;
+			while ((fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == NETP_INVALID_SOCKET) {
+				netp::this_thread::yield();
+			}
+			NETP_VERBOSE("[poller_interruptable_by_fd]init eventfd done, fd: %u", fd);
+			fdr = fd;
+			fdw = fd;
+#else
 			int rt;
 			SOCKET fds[2] = { NETP_INVALID_SOCKET, NETP_INVALID_SOCKET };
 #ifdef NETP_USE_PIPE_AS_INTRFD
@@ -122,13 +154,15 @@ namespace netp {
 
 			fdr = fds[0];
 			fdw = fds[1];
+#endif
 		}
 		
 		void close() {
 			netp::close(fdr);
-			fdr = NETP_INVALID_SOCKET;
-			
+#ifndef NETP_USE_EVENTFD_AS_INTRFD
 			netp::close(fdw);
+#endif
+			fdr = NETP_INVALID_SOCKET;
 			fdw = NETP_INVALID_SOCKET;
 		}
 	};
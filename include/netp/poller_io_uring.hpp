@@ -0,0 +1,779 @@
+#ifndef _NETP_IO_URING_POLLER_HPP_
+#define _NETP_IO_URING_POLLER_HPP_
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <signal.h>
+
+#include <netp/core.hpp>
+#include <netp/packet.hpp>
+#include <netp/poller_interruptable_by_fd.hpp>
+#include <netp/socket_api.hpp>
+
+#ifdef _NETP_DEBUG
+	#define _NETP_DEBUG_IO_URING_EVENTS
+#endif
+
+namespace netp {
+
+	//@note: a multishot poll for every watched fd, it posts one completion for every wakeup of the fd, like EPOLLET
+	//1, watch|unwatch only queue sqes, they are submitted by the io_uring_enter of the next poll() together with the wait, no syscall per epoll_ctl
+	//2, a change of the watched events updates the poll in place (IORING_POLL_UPDATE_EVENTS), unwatch all cancels it
+	//3, the ctx is the user_data of its poll, it is freed once the last completion of the poll is reaped
+	//4, a stream channel could do its io by completion instead (socket_channel_io_uring): a multishot recv picks the buffers from a ring provided by the poller, a sendmsg sends the tx entries left by a full snd buffer
+	//   the op is tagged in the low bits of the user_data, the ctx is freed once none of its poll|recv|send is inflight
+
+#ifdef IORING_RECV_MULTISHOT
+	#define NETP_IO_URING_COMPLETION_IO
+#endif
+
+	enum io_uring_ctx_state {
+		IOU_POLL_INFLIGHT = 1,
+		IOU_POLL_CANCELING = 1 << 1,
+		IOU_ENDED = 1 << 2,
+		IOU_RECV_INFLIGHT = 1 << 3,
+		IOU_RECV_CANCELING = 1 << 4,
+		IOU_SEND_INFLIGHT = 1 << 5,
+		IOU_SEND_CANCELING = 1 << 6,
+		IOU_POLL_UPDATING = 1 << 7
+	};
+
+	enum io_uring_user_data_tag {
+		IOU_UD_POLL = 0,
+		IOU_UD_RECV = 1,
+		IOU_UD_SEND = 2,
+		IOU_UD_POLL_UPDATE = 3,
+		IOU_UD_MASK = 3
+	};
+
+	//the completion of a recv|send of the ctx, called in the loop thread, never after io_end
+	class io_uring_monitor {
+	public:
+		//buf is a provided buffer of nbytes, it is given back to the ring right after the call
+		//more == false if the multishot recv is over, it has to be submitted again to keep reading
+		virtual void iou_recv_done(int nbytes, byte_t const* buf, bool more, io_ctx* ctx) = 0;
+		virtual void iou_send_done(int nbytes, io_ctx* ctx) = 0;
+	};
+
+	//the msghdr of the inflight sendmsg, the packets are held until its completion in case the channel drops its tx entries on close
+	struct io_uring_tx {
+		struct msghdr msg;
+		struct iovec iov[NETP_IO_URING_SEND_IOV_MAX];
+		NRP<packet> hold[NETP_IO_URING_SEND_IOV_MAX];
+		u32_t n;
+	};
+
+	struct io_uring_ctx :
+		public io_ctx
+	{
+		u32_t armed; //events of the poll in the kernel
+		u32_t arming; //events of the inflight update, they are armed once the kernel accepts it
+		u8_t state;
+		io_uring_monitor* ciom; //set by the channel which does its io by completion, kept alive by iom
+		io_uring_tx* tx;
+	};
+
+	class poller_io_uring final :
+		public poller_interruptable_by_fd
+	{
+		int m_ringfd;
+		struct io_uring_params m_params;
+
+		void* m_sq_ptr;
+		size_t m_sq_ptr_size;
+		void* m_cq_ptr;
+		size_t m_cq_ptr_size;
+		struct io_uring_sqe* m_sqes;
+
+		u32_t* m_sq_head;
+		u32_t* m_sq_tail;
+		u32_t* m_sq_flags;
+		u32_t* m_sq_array;
+		u32_t m_sq_mask;
+		u32_t m_sq_pending; //queued, not submitted yet
+
+		u32_t* m_cq_head;
+		u32_t* m_cq_tail;
+		u32_t m_cq_mask;
+		struct io_uring_cqe* m_cqes;
+
+		bool m_taskrun_flag; //IORING_SQ_TASKRUN tells whether a non-blocking poll needs a syscall to get its completions
+		long m_ended_inflight; //ended ctx waiting for the last completion of its poll|recv|send
+
+		//the tail of the ring overlays bufs[0].resv, the flex array of struct io_uring_buf_ring is not laid out the same by a c++ compiler
+		struct io_uring_buf* m_pbuf_ring; //nullptr if the kernel could not provide buffers, the channels read by readiness then
+		u16_t* m_pbuf_tail;
+		byte_t* m_pbuf;
+		size_t m_pbuf_mmap_size;
+
+		static inline u32_t __events(u8_t flag) {
+			return ((flag & io_flag::IO_READ) ? (POLLIN | POLLRDHUP) : 0) | ((flag & io_flag::IO_WRITE) ? POLLOUT : 0);
+		}
+
+		static inline u32_t __poll32_events(u32_t events) {
+#ifdef __NETP_IS_LITTLE_ENDIAN
+			return events;
+#else
+			return (events << 16) | (events >> 16);
+#endif
+		}
+
+		inline int __enter(u32_t to_submit, u32_t min_complete, u32_t flags, void* arg, size_t argsz) {
+			return int(::syscall(__NR_io_uring_enter, m_ringfd, to_submit, min_complete, flags, arg, argsz));
+		}
+
+		int __submit() {
+			while (m_sq_pending) {
+				const int n = __enter(m_sq_pending, 0, 0, 0, 0);
+				if (n < 0) {
+					const int ec = netp_socket_get_last_errno();
+					if (ec == netp::E_EINTR) { continue; }
+					return ec;
+				}
+				m_sq_pending -= u32_t(n);
+			}
+			return netp::OK;
+		}
+
+		struct io_uring_sqe* __sqe_get() {
+			const u32_t tail = *m_sq_tail;
+			if ((tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE)) == m_params.sq_entries) {
+				//full, flush the queued ones
+				if (__submit() != netp::OK) {
+					return nullptr;
+				}
+			}
+			const u32_t idx = tail & m_sq_mask;
+			struct io_uring_sqe* sqe = &m_sqes[idx];
+			std::memset(sqe, 0, sizeof(struct io_uring_sqe));
+			m_sq_array[idx] = idx;
+			return sqe;
+		}
+
+		inline void __sqe_commit() {
+			__atomic_store_n(m_sq_tail, (*m_sq_tail) + 1, __ATOMIC_RELEASE);
+			++m_sq_pending;
+		}
+
+		int __poll_add(io_uring_ctx* ctx, u32_t events) {
+			struct io_uring_sqe* sqe = __sqe_get();
+			if (sqe == nullptr) {
+				return netp_socket_get_last_errno();
+			}
+			sqe->opcode = IORING_OP_POLL_ADD;
+			sqe->fd = int(ctx->fd);
+			sqe->len = IORING_POLL_ADD_MULTI;
+			sqe->poll32_events = __poll32_events(events);
+			sqe->user_data = u64_t(ctx);
+			__sqe_commit();
+			ctx->armed = events;
+			ctx->state |= IOU_POLL_INFLIGHT;
+			return netp::OK;
+		}
+
+		//the completion of the cancel itself is ignored by user_data 0
+		//a poll remove fails with -EALREADY and leaves the poll armed if it is being woken up, the async cancel marks it canceled anyway
+		int __poll_cancel(io_uring_ctx* ctx) {
+			struct io_uring_sqe* sqe = __sqe_get();
+			if (sqe == nullptr) {
+				return netp_socket_get_last_errno();
+			}
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			sqe->fd = -1;
+			sqe->addr = u64_t(ctx);
+			sqe->user_data = 0;
+			__sqe_commit();
+			ctx->state |= IOU_POLL_CANCELING;
+			return netp::OK;
+		}
+
+		//update the events of the poll in place, one at a time, __complete_update checks the result
+		int __poll_update(io_uring_ctx* ctx, u32_t events) {
+			struct io_uring_sqe* sqe = __sqe_get();
+			if (sqe == nullptr) {
+				return netp_socket_get_last_errno();
+			}
+			sqe->opcode = IORING_OP_POLL_REMOVE;
+			sqe->fd = -1;
+			sqe->addr = u64_t(ctx);
+			sqe->len = IORING_POLL_UPDATE_EVENTS | IORING_POLL_ADD_MULTI;
+			sqe->poll32_events = __poll32_events(events);
+			sqe->user_data = u64_t(ctx) | IOU_UD_POLL_UPDATE;
+			__sqe_commit();
+			ctx->arming = events;
+			ctx->state |= IOU_POLL_UPDATING;
+			return netp::OK;
+		}
+
+		//bring the poll in the kernel to the events of ctx->flag
+		int __arm(io_uring_ctx* ctx, u32_t events) {
+			if ((ctx->state & IOU_POLL_INFLIGHT) == 0) {
+				return (events != 0) ? __poll_add(ctx, events) : netp::OK;
+			}
+			if (ctx->state & IOU_POLL_CANCELING) {
+				//re-armed by the last completion of the canceled poll
+				return netp::OK;
+			}
+			if (events == 0) {
+				return __poll_cancel(ctx);
+			}
+			if (ctx->state & IOU_POLL_UPDATING) {
+				//brought up to date by the completion of the inflight one
+				return netp::OK;
+			}
+			return (events != ctx->armed) ? __poll_update(ctx, events) : netp::OK;
+		}
+
+		inline void __ctx_free(io_uring_ctx* ctx) {
+			if (ctx->tx != nullptr) {
+				netp::allocator<io_uring_tx>::trash(ctx->tx);
+			}
+			netp::allocator<io_uring_ctx>::trash(ctx);
+		}
+
+		//free the ended ctx on the last completion of its ops
+		inline void __ended_release(io_uring_ctx* ctx) {
+			if ((ctx->state & (IOU_POLL_INFLIGHT | IOU_POLL_UPDATING | IOU_RECV_INFLIGHT | IOU_SEND_INFLIGHT)) == 0) {
+				--m_ended_inflight;
+				__ctx_free(ctx);
+			}
+		}
+
+#ifdef NETP_IO_URING_COMPLETION_IO
+		//the completion of the cancel itself is ignored by user_data 0
+		int __cancel(io_uring_ctx* ctx, u64_t tag, u8_t canceling) {
+			struct io_uring_sqe* sqe = __sqe_get();
+			if (sqe == nullptr) {
+				return netp_socket_get_last_errno();
+			}
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			sqe->fd = -1;
+			sqe->addr = u64_t(ctx) | tag;
+			sqe->user_data = 0;
+			__sqe_commit();
+			ctx->state |= canceling;
+			return netp::OK;
+		}
+
+		inline void __pbuf_put(u16_t bid, u16_t off) {
+			struct io_uring_buf* b = &m_pbuf_ring[(*m_pbuf_tail + off) & (NETP_IO_URING_PBUF_COUNT - 1)];
+			b->addr = u64_t(m_pbuf + (size_t(bid) * NETP_IO_URING_PBUF_SIZE));
+			b->len = NETP_IO_URING_PBUF_SIZE;
+			b->bid = bid;
+		}
+
+		inline void __pbuf_recycle(u16_t bid) {
+			__pbuf_put(bid, 0);
+			__atomic_store_n(m_pbuf_tail, u16_t(*m_pbuf_tail + 1), __ATOMIC_RELEASE);
+		}
+
+		void __pbuf_init() {
+			static_assert((NETP_IO_URING_PBUF_COUNT & (NETP_IO_URING_PBUF_COUNT - 1)) == 0 && NETP_IO_URING_PBUF_COUNT <= 32768, "NETP_IO_URING_PBUF_COUNT must be a power of 2 and not exceed 32768");
+			//the ring must be page aligned, the buffers follow it in the same mapping
+			const size_t page_size = size_t(::sysconf(_SC_PAGESIZE));
+			const size_t ring_size = ((sizeof(struct io_uring_buf) * NETP_IO_URING_PBUF_COUNT) + page_size - 1) / page_size * page_size;
+			m_pbuf_mmap_size = ring_size + (size_t(NETP_IO_URING_PBUF_COUNT) * NETP_IO_URING_PBUF_SIZE);
+			void* ptr = ::mmap(0, m_pbuf_mmap_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (ptr == MAP_FAILED) {
+				NETP_WARN("[IO_URING][##%u]mmap provided buffers failed: %d", m_ringfd, netp_socket_get_last_errno());
+				return;
+			}
+
+			struct io_uring_buf_reg reg;
+			std::memset(&reg, 0, sizeof(reg));
+			reg.ring_addr = u64_t(ptr);
+			reg.ring_entries = NETP_IO_URING_PBUF_COUNT;
+			reg.bgid = NETP_IO_URING_PBUF_GID;
+			if (::syscall(__NR_io_uring_register, m_ringfd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+				NETP_WARN("[IO_URING][##%u]register provided buffers failed: %d, read by readiness", m_ringfd, netp_socket_get_last_errno());
+				::munmap(ptr, m_pbuf_mmap_size);
+				return;
+			}
+
+			m_pbuf_ring = (struct io_uring_buf*)ptr;
+			m_pbuf_tail = &m_pbuf_ring[0].resv;
+			m_pbuf = (byte_t*)ptr + ring_size;
+			for (u16_t i = 0; i < u16_t(NETP_IO_URING_PBUF_COUNT); ++i) {
+				__pbuf_put(i, i);
+			}
+			__atomic_store_n(m_pbuf_tail, u16_t(*m_pbuf_tail + NETP_IO_URING_PBUF_COUNT), __ATOMIC_RELEASE);
+		}
+
+		void __pbuf_deinit() {
+			if (m_pbuf_ring == nullptr) {
+				return;
+			}
+			struct io_uring_buf_reg reg;
+			std::memset(&reg, 0, sizeof(reg));
+			reg.bgid = NETP_IO_URING_PBUF_GID;
+			::syscall(__NR_io_uring_register, m_ringfd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+			::munmap(m_pbuf_ring, m_pbuf_mmap_size);
+			m_pbuf_ring = nullptr;
+			m_pbuf_tail = nullptr;
+			m_pbuf = nullptr;
+		}
+
+		void __complete_recv(io_uring_ctx* ctx, struct io_uring_cqe const& cqe) {
+			const bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+			NETP_TRACE_IOE("[IO_URING][##%u][#%u]recv: %d, flags: %u", m_ringfd, ctx->fd, cqe.res, cqe.flags);
+			if (!more) {
+				ctx->state &= ~(IOU_RECV_INFLIGHT | IOU_RECV_CANCELING);
+			}
+			byte_t const* buf = nullptr;
+			const u16_t bid = u16_t(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+			if (cqe.flags & IORING_CQE_F_BUFFER) {
+				buf = m_pbuf + (size_t(bid) * NETP_IO_URING_PBUF_SIZE);
+			}
+			if ((ctx->state & IOU_ENDED) == 0) {
+				ctx->ciom->iou_recv_done(cqe.res, buf, more, ctx);
+			}
+			if (buf != nullptr) {
+				__pbuf_recycle(bid);
+			}
+			if (!more && (ctx->state & IOU_ENDED)) {
+				__ended_release(ctx);
+			}
+		}
+
+		void __complete_send(io_uring_ctx* ctx, struct io_uring_cqe const& cqe) {
+			NETP_TRACE_IOE("[IO_URING][##%u][#%u]send: %d", m_ringfd, ctx->fd, cqe.res);
+			ctx->state &= ~(IOU_SEND_INFLIGHT | IOU_SEND_CANCELING);
+			for (u32_t i = 0; i < ctx->tx->n; ++i) {
+				ctx->tx->hold[i] = nullptr;
+			}
+			ctx->tx->n = 0;
+			if ((ctx->state & IOU_ENDED) == 0) {
+				ctx->ciom->iou_send_done(cqe.res, ctx);
+				return;
+			}
+			__ended_release(ctx);
+		}
+#endif
+
+		void __dispatch(io_uring_ctx* ctx, u32_t events) {
+			int sockerr = netp::OK;
+			if (events & (POLLERR | POLLHUP)) {
+				socklen_t optlen = sizeof(int);
+				int readsockfderr = ::getsockopt(ctx->fd, SOL_SOCKET, SO_ERROR, (char*)&sockerr, &optlen);
+				(void)readsockfderr;
+				if (sockerr == -1) {
+					sockerr = (events & POLLHUP) ? netp::E_SOCKET_EPOLLHUP : netp::E_UNKNOWN;
+				} else {
+					sockerr = NETP_NEGATIVE(sockerr);
+				}
+			}
+
+			//refer to poller_epoll::poll
+			NRP<io_monitor>& iom = ctx->iom;
+			if ((ctx->flag & u8_t(io_flag::IO_READ)) && (events & (POLLIN | POLLRDHUP | POLLERR | POLLHUP))) {
+				if (events & POLLRDHUP) {
+					ctx->flag |= io_flag::IO_READ_HUP;
+				}
+				iom->io_notify_read(sockerr, ctx);
+			}
+			//@note io_notify_read might result in io_write be removed
+			if ((ctx->flag & u8_t(io_flag::IO_WRITE)) && (events & (POLLOUT | POLLERR | POLLHUP))) {
+				iom->io_notify_write(sockerr, ctx);
+			}
+		}
+
+		//-EALREADY if a wakeup owns the poll, -ENOENT if the poll is over, the old events stay armed for both
+		void __complete_update(io_uring_ctx* ctx, struct io_uring_cqe const& cqe) {
+			NETP_TRACE_IOE("[IO_URING][##%u][#%u]poll update: %d, events: %u", m_ringfd, ctx->fd, cqe.res, ctx->arming);
+			ctx->state &= ~IOU_POLL_UPDATING;
+			if (cqe.res == 0) {
+				ctx->armed = ctx->arming;
+			}
+			if (ctx->state & IOU_ENDED) {
+				__ended_release(ctx);
+				return;
+			}
+			if (cqe.res == 0 || cqe.res == -EALREADY || cqe.res == -ENOENT) {
+				//try again, or add a new one if the last completion of the poll has been reaped
+				__arm(ctx, __events(ctx->flag));
+				return;
+			}
+			NETP_WARN("[IO_URING][##%u][#%u]poll update failed: %d, cancel it", m_ringfd, ctx->fd, cqe.res);
+			if ((ctx->state & (IOU_POLL_INFLIGHT | IOU_POLL_CANCELING)) == IOU_POLL_INFLIGHT) {
+				//re-armed by the last completion of the canceled poll
+				__poll_cancel(ctx);
+			}
+		}
+
+		void __complete(struct io_uring_cqe const& cqe) {
+			if (cqe.user_data == 0) {
+				//-ENOENT if the op has completed before the cancel, -EALREADY if the canceled one is completing
+				NETP_TRACE_IOE("[IO_URING][##%u]cancel: %d", m_ringfd, cqe.res);
+				return;
+			}
+			io_uring_ctx* ctx = (io_uring_ctx*)(cqe.user_data & ~u64_t(IOU_UD_MASK));
+			switch (cqe.user_data & IOU_UD_MASK) {
+			case IOU_UD_POLL_UPDATE:
+			{
+				__complete_update(ctx, cqe);
+				return;
+			}
+#ifdef NETP_IO_URING_COMPLETION_IO
+			case IOU_UD_RECV:
+			{
+				__complete_recv(ctx, cqe);
+				return;
+			}
+			case IOU_UD_SEND:
+			{
+				__complete_send(ctx, cqe);
+				return;
+			}
+#endif
+			}
+			const bool last = (cqe.flags & IORING_CQE_F_MORE) == 0;
+
+#ifdef _NETP_DEBUG_IO_URING_EVENTS
+			NETP_ASSERT(ctx->state & IOU_POLL_INFLIGHT);
+#endif
+			//the poll stays inflight during the dispatch, io_end() of the ctx in a notify defers the free to the code below
+			if ((ctx->state & IOU_ENDED) == 0) {
+				if (cqe.res > 0) {
+					__dispatch(ctx, u32_t(cqe.res));
+				} else if (cqe.res < 0 && cqe.res != -ECANCELED) {
+					NETP_WARN("[IO_URING][##%u][#%u]poll failed: %d", m_ringfd, ctx->fd, cqe.res);
+					if (ctx->flag & u8_t(io_flag::IO_READ)) {
+						ctx->iom->io_notify_read(cqe.res, ctx);
+					}
+					if (ctx->flag & u8_t(io_flag::IO_WRITE)) {
+						ctx->iom->io_notify_write(cqe.res, ctx);
+					}
+				}
+			}
+
+			if (!last) {
+				return;
+			}
+			ctx->state &= ~(IOU_POLL_INFLIGHT | IOU_POLL_CANCELING);
+			ctx->armed = 0;
+			if (ctx->state & IOU_ENDED) {
+				__ended_release(ctx);
+				return;
+			}
+			//a multishot poll could end by itself, keep watching if it is not an error
+			if (cqe.res >= 0 || cqe.res == -ECANCELED) {
+				__arm(ctx, __events(ctx->flag));
+			}
+		}
+
+		u32_t __reap() {
+			u32_t head = *m_cq_head;
+			const u32_t tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+			const u32_t n = tail - head;
+			while (head != tail) {
+				//copy out, a notify might submit and the slot is given back below
+				const struct io_uring_cqe cqe = m_cqes[head & m_cq_mask];
+				__atomic_store_n(m_cq_head, ++head, __ATOMIC_RELEASE);
+				__complete(cqe);
+			}
+			return n;
+		}
+
+		int __setup(u32_t flags) {
+			std::memset(&m_params, 0, sizeof(m_params));
+			m_params.flags = flags;
+			m_ringfd = int(::syscall(__NR_io_uring_setup, NETP_IO_URING_ENTRIES, &m_params));
+			return (m_ringfd < 0) ? netp_socket_get_last_errno() : netp::OK;
+		}
+
+	public:
+		poller_io_uring() :
+			poller_interruptable_by_fd(io_poller_type::T_IO_URING),
+			m_ringfd(NETP_INVALID_SOCKET),
+			m_sq_ptr(MAP_FAILED),
+			m_sq_ptr_size(0),
+			m_cq_ptr(MAP_FAILED),
+			m_cq_ptr_size(0),
+			m_sqes((struct io_uring_sqe*)MAP_FAILED),
+			m_sq_pending(0),
+			m_taskrun_flag(false),
+			m_ended_inflight(0),
+			m_pbuf_ring(nullptr),
+			m_pbuf_tail(nullptr),
+			m_pbuf(nullptr),
+			m_pbuf_mmap_size(0)
+		{
+		}
+
+		~poller_io_uring() {
+			NETP_ASSERT(m_ringfd == NETP_INVALID_SOCKET);
+		}
+
+		io_ctx* io_begin(SOCKET fd, NRP<io_monitor> const& iom) override {
+			io_uring_ctx* ctx = netp::allocator<io_uring_ctx>::make();
+			if (ctx == 0) {
+				return 0;
+			}
+			ctx->fd = fd;
+			ctx->flag = 0;
+			ctx->iom = iom;
+			ctx->armed = 0;
+			ctx->arming = 0;
+			ctx->state = 0;
+			ctx->ciom = nullptr;
+			ctx->tx = nullptr;
+			netp::list_append(&m_io_ctx_list, (io_ctx*)ctx);
+#ifdef NETP_DEBUG_IO_CTX_
+			++m_io_ctx_count_alloc;
+#endif
+			NETP_TRACE_IOE("[IO_URING][##%u][io_begin][#%d]", m_ringfd, ctx->fd);
+			return ctx;
+		}
+
+		void io_end(io_ctx* ctx_) override {
+			NETP_TRACE_IOE("[IO_URING][##%u][io_end][#%d]", m_ringfd, ctx_->fd);
+			NETP_ASSERT((ctx_->iom != nullptr) && ((ctx_->flag & (io_flag::IO_READ | io_flag::IO_WRITE)) == 0), "flag: %u", ctx_->flag);
+			io_uring_ctx* ctx = (io_uring_ctx*)ctx_;
+			netp::list_delete(ctx_);
+			ctx->iom = nullptr;
+			ctx->state |= IOU_ENDED;
+#ifdef NETP_DEBUG_IO_CTX_
+			++m_io_ctx_count_free;
+#endif
+#ifdef NETP_IO_URING_COMPLETION_IO
+			//the channel has canceled its recv|send on end read|write, the cancel is issued here for the one not yet
+			if ((ctx->state & (IOU_RECV_INFLIGHT | IOU_RECV_CANCELING)) == IOU_RECV_INFLIGHT) {
+				__cancel(ctx, IOU_UD_RECV, IOU_RECV_CANCELING);
+			}
+			if ((ctx->state & (IOU_SEND_INFLIGHT | IOU_SEND_CANCELING)) == IOU_SEND_INFLIGHT) {
+				__cancel(ctx, IOU_UD_SEND, IOU_SEND_CANCELING);
+			}
+#endif
+			if (ctx->state & (IOU_POLL_INFLIGHT | IOU_POLL_UPDATING | IOU_RECV_INFLIGHT | IOU_SEND_INFLIGHT)) {
+				++m_ended_inflight;
+				return;
+			}
+			__ctx_free(ctx);
+		}
+
+#ifdef NETP_IO_URING_COMPLETION_IO
+		__NETP_FORCE_INLINE bool pbuf_ready() const { return m_pbuf_ring != nullptr; }
+		__NETP_FORCE_INLINE static u8_t state(io_ctx* ctx) { return ((io_uring_ctx*)ctx)->state; }
+
+		void completion_begin(io_ctx* ctx, io_uring_monitor* ciom) {
+			((io_uring_ctx*)ctx)->ciom = ciom;
+		}
+
+		//the msghdr of the next send of ctx, not to be touched while a send is inflight
+		io_uring_tx* tx(io_ctx* ctx_) {
+			io_uring_ctx* ctx = (io_uring_ctx*)ctx_;
+			if (ctx->tx == nullptr) {
+				ctx->tx = netp::allocator<io_uring_tx>::make();
+				NETP_ALLOC_CHECK(ctx->tx, sizeof(io_uring_tx));
+				std::memset(&ctx->tx->msg, 0, sizeof(ctx->tx->msg));
+				ctx->tx->msg.msg_iov = ctx->tx->iov;
+				ctx->tx->n = 0;
+			}
+			return ctx->tx;
+		}
+
+		//a multishot recv from the provided buffers, it keeps posting completions until it is canceled, it fails or the kernel ends it
+		int recv(io_ctx* ctx_) {
+			io_uring_ctx* ctx = (io_uring_ctx*)ctx_;
+			NETP_ASSERT(pbuf_ready() && (ctx->ciom != nullptr) && ((ctx->state & IOU_RECV_INFLIGHT) == 0));
+			struct io_uring_sqe* sqe = __sqe_get();
+			if (sqe == nullptr) {
+				return netp_socket_get_last_errno();
+			}
+			sqe->opcode = IORING_OP_RECV;
+			sqe->fd = int(ctx->fd);
+			sqe->ioprio = IORING_RECV_MULTISHOT;
+			sqe->flags = IOSQE_BUFFER_SELECT;
+			sqe->buf_group = NETP_IO_URING_PBUF_GID;
+			sqe->user_data = u64_t(ctx) | IOU_UD_RECV;
+			__sqe_commit();
+			ctx->state |= IOU_RECV_INFLIGHT;
+			return netp::OK;
+		}
+
+		//send tx(ctx)->iov[0, tx(ctx)->n) by one sendmsg
+		int send(io_ctx* ctx_) {
+			io_uring_ctx* ctx = (io_uring_ctx*)ctx_;
+			NETP_ASSERT((ctx->ciom != nullptr) && (ctx->tx != nullptr) && (ctx->tx->n > 0) && ((ctx->state & IOU_SEND_INFLIGHT) == 0));
+			struct io_uring_sqe* sqe = __sqe_get();
+			if (sqe == nullptr) {
+				return netp_socket_get_last_errno();
+			}
+			ctx->tx->msg.msg_iovlen = ctx->tx->n;
+			sqe->opcode = IORING_OP_SENDMSG;
+			sqe->fd = int(ctx->fd);
+			sqe->addr = u64_t(&ctx->tx->msg);
+			sqe->len = 1;
+			sqe->msg_flags = MSG_NOSIGNAL;
+			sqe->user_data = u64_t(ctx) | IOU_UD_SEND;
+			__sqe_commit();
+			ctx->state |= IOU_SEND_INFLIGHT;
+			return netp::OK;
+		}
+
+		//the last completion of the op comes with -ECANCELED if it is still inflight
+		int cancel_recv(io_ctx* ctx_) {
+			io_uring_ctx* ctx = (io_uring_ctx*)ctx_;
+			return ((ctx->state & (IOU_RECV_INFLIGHT | IOU_RECV_CANCELING)) == IOU_RECV_INFLIGHT) ? __cancel(ctx, IOU_UD_RECV, IOU_RECV_CANCELING) : netp::OK;
+		}
+
+		int cancel_send(io_ctx* ctx_) {
+			io_uring_ctx* ctx = (io_uring_ctx*)ctx_;
+			return ((ctx->state & (IOU_SEND_INFLIGHT | IOU_SEND_CANCELING)) == IOU_SEND_INFLIGHT) ? __cancel(ctx, IOU_UD_SEND, IOU_SEND_CANCELING) : netp::OK;
+		}
+#endif
+
+		int watch(u8_t flag, io_ctx* ctx) override {
+#ifdef _NETP_DEBUG_IO_URING_EVENTS
+			NETP_ASSERT((ctx->fd != NETP_INVALID_SOCKET) && (flag == io_flag::IO_READ || flag == io_flag::IO_WRITE));
+			NETP_ASSERT((flag & ctx->flag) == 0);
+#endif
+			NETP_TRACE_IOE("[IO_URING][##%u][watch][#%u]flag: %u", m_ringfd, ctx->fd, flag);
+			return __arm((io_uring_ctx*)ctx, __events(ctx->flag | flag));
+		}
+
+		//ctx->flag has been updated by the caller
+		int unwatch(u8_t flag, io_ctx* ctx) override {
+#ifdef _NETP_DEBUG_IO_URING_EVENTS
+			NETP_ASSERT((ctx->fd != NETP_INVALID_SOCKET) && (flag == io_flag::IO_READ || flag == io_flag::IO_WRITE));
+#endif
+			(void)flag;
+			NETP_TRACE_IOE("[IO_URING][##%u][unwatch][#%u]flag: %u", m_ringfd, ctx->fd, flag);
+			return __arm((io_uring_ctx*)ctx, __events(ctx->flag));
+		}
+
+		void init() override {
+			//completions are posted at the next syscall of the loop instead of interrupting it, the kernel flags the sq ring if there are some
+			int rt = __setup(IORING_SETUP_COOP_TASKRUN | IORING_SETUP_TASKRUN_FLAG);
+			m_taskrun_flag = (rt == netp::OK);
+			if (rt == netp::E_EINVAL) {
+				rt = __setup(0);
+			}
+			if (rt != netp::OK) {
+				NETP_THROW("create io_uring failed");
+			}
+			if ((m_params.features & IORING_FEAT_NODROP) == 0 || (m_params.features & IORING_FEAT_EXT_ARG) == 0) {
+				NETP_THROW("io_uring: IORING_FEAT_NODROP|IORING_FEAT_EXT_ARG required");
+			}
+
+			m_sq_ptr_size = m_params.sq_off.array + m_params.sq_entries * sizeof(u32_t);
+			m_cq_ptr_size = m_params.cq_off.cqes + m_params.cq_entries * sizeof(struct io_uring_cqe);
+			if (m_params.features & IORING_FEAT_SINGLE_MMAP) {
+				m_sq_ptr_size = m_cq_ptr_size = NETP_MAX(m_sq_ptr_size, m_cq_ptr_size);
+			}
+			m_sq_ptr = ::mmap(0, m_sq_ptr_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringfd, IORING_OFF_SQ_RING);
+			if (m_sq_ptr == MAP_FAILED) {
+				NETP_THROW("io_uring: mmap sq ring failed");
+			}
+			if (m_params.features & IORING_FEAT_SINGLE_MMAP) {
+				m_cq_ptr = m_sq_ptr;
+			} else {
+				m_cq_ptr = ::mmap(0, m_cq_ptr_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringfd, IORING_OFF_CQ_RING);
+				if (m_cq_ptr == MAP_FAILED) {
+					NETP_THROW("io_uring: mmap cq ring failed");
+				}
+			}
+			m_sqes = (struct io_uring_sqe*)::mmap(0, m_params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringfd, IORING_OFF_SQES);
+			if (m_sqes == MAP_FAILED) {
+				NETP_THROW("io_uring: mmap sqes failed");
+			}
+
+			byte_t* sq = (byte_t*)m_sq_ptr;
+			m_sq_head = (u32_t*)(sq + m_params.sq_off.head);
+			m_sq_tail = (u32_t*)(sq + m_params.sq_off.tail);
+			m_sq_flags = (u32_t*)(sq + m_params.sq_off.flags);
+			m_sq_array = (u32_t*)(sq + m_params.sq_off.array);
+			m_sq_mask = *(u32_t*)(sq + m_params.sq_off.ring_mask);
+			m_sq_pending = 0;
+
+			byte_t* cq = (byte_t*)m_cq_ptr;
+			m_cq_head = (u32_t*)(cq + m_params.cq_off.head);
+			m_cq_tail = (u32_t*)(cq + m_params.cq_off.tail);
+			m_cq_mask = *(u32_t*)(cq + m_params.cq_off.ring_mask);
+			m_cqes = (struct io_uring_cqe*)(cq + m_params.cq_off.cqes);
+
+			m_ended_inflight = 0;
+#ifdef NETP_IO_URING_COMPLETION_IO
+			__pbuf_init();
+#endif
+			NETP_VERBOSE("[IO_URING][##%u]init io_uring ok, sq: %u, cq: %u, features: %u, taskrun_flag: %d", m_ringfd, m_params.sq_entries, m_params.cq_entries, m_params.features, m_taskrun_flag);
+			poller_interruptable_by_fd::init();
+		}
+
+		void deinit() override {
+			poller_interruptable_by_fd::deinit();
+			NETP_ASSERT(m_ringfd != NETP_INVALID_SOCKET);
+			NETP_VERBOSE("[IO_URING][##%u]deinit begin, ended inflight: %ld", m_ringfd, m_ended_inflight);
+
+			//the ops of the ended ctx are canceled, wait for their last completion to free them
+			while (m_ended_inflight > 0) {
+				const int rt = __enter(m_sq_pending, 1, IORING_ENTER_GETEVENTS, 0, 0);
+				if (rt < 0) {
+					const int ec = netp_socket_get_last_errno();
+					if (ec == netp::E_EINTR) { continue; }
+					NETP_WARN("[IO_URING][##%u]deinit, io_uring_enter failed: %d", m_ringfd, ec);
+					break;
+				}
+				m_sq_pending -= u32_t(rt);
+				__reap();
+			}
+#ifdef NETP_IO_URING_COMPLETION_IO
+			__pbuf_deinit();
+#endif
+
+			::munmap(m_sqes, m_params.sq_entries * sizeof(struct io_uring_sqe));
+			if (m_cq_ptr != m_sq_ptr) {
+				::munmap(m_cq_ptr, m_cq_ptr_size);
+			}
+			::munmap(m_sq_ptr, m_sq_ptr_size);
+			m_sqes = (struct io_uring_sqe*)MAP_FAILED;
+			m_sq_ptr = MAP_FAILED;
+			m_cq_ptr = MAP_FAILED;
+
+			int rt = netp::close(m_ringfd);
+			if (-1 == rt) {
+				NETP_THROW("IO_URING::deinit io_uring handle failed");
+			}
+			NETP_VERBOSE("[IO_URING][##%u]deinit done", m_ringfd);
+			m_ringfd = NETP_INVALID_SOCKET;
+		}
+
+		//submit the queued sqes and wait for completions by one io_uring_enter
+		u32_t poll(i64_t wait_in_nano, std::atomic<bool>& W) override {
+			NETP_ASSERT(m_ringfd != NETP_INVALID_SOCKET);
+
+			if (wait_in_nano == 0) {
+				if (m_sq_pending || !m_taskrun_flag || (__atomic_load_n(m_sq_flags, __ATOMIC_RELAXED) & IORING_SQ_TASKRUN)) {
+					const int n = __enter(m_sq_pending, 0, IORING_ENTER_GETEVENTS, 0, 0);
+					if (n > 0) {
+						m_sq_pending -= u32_t(n);
+					}
+				}
+			} else {
+				struct __kernel_timespec ts;
+				struct io_uring_getevents_arg arg;
+				std::memset(&arg, 0, sizeof(arg));
+				arg.sigmask_sz = _NSIG / 8;
+				if (wait_in_nano != ~0) {
+					ts.tv_sec = wait_in_nano / i64_t(1000000000);
+					ts.tv_nsec = wait_in_nano % i64_t(1000000000);
+					arg.ts = u64_t(&ts);
+				}
+				const int n = __enter(m_sq_pending, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+				NETP_POLLER_WAIT_EXIT(wait_in_nano, W);
+				if (n > 0) {
+					m_sq_pending -= u32_t(n);
+				} else if (n < 0) {
+					const int ec = netp_socket_get_last_errno();
+					if (ec != netp::E_EINTR && ec != netp::E_ETIME) {
+						NETP_VERBOSE("[IO_URING][##%u]io_uring_enter failed!, errno: %d", m_ringfd, ec);
+					}
+				}
+			}
+			return __reap();
+		}
+	};
+}
+#endif
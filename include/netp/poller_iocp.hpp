@@ -226,7 +226,7 @@ namespace netp {
 #endif
 		}
 
-		void poll(i64_t wait_in_nano, std::atomic<bool>& W) override {
+		u32_t poll(i64_t wait_in_nano, std::atomic<bool>& W) override {
 			NETP_ASSERT(m_handle > 0);
 			const long long wait_in_milli = wait_in_nano != ~0 ? (wait_in_nano / 1000000L) : ~0;
 			//INFINITE == -1
@@ -242,7 +242,7 @@ namespace netp {
 				ec = netp_socket_get_last_errno();
 				if (ec == netp::E_WAIT_TIMEOUT) {
 					NETP_TRACE_IOE("[iocp]GetQueuedCompletionStatus return: %d", ec);
-					return;
+					return 0;
 				}
 				NETP_THROW("GetQueuedCompletionStatusEx failed");
 			}
@@ -250,7 +250,7 @@ namespace netp {
 				LPOVERLAPPED& ol = entrys[i].lpOverlapped;
 				if (ol == 0) {
 					NETP_TRACE_IOE("[iocp]GetQueuedCompletionStatusEx, no packet dequeue");
-					return;
+					return u32_t(i);
 				}
 				ol_ctx* olctx = (CONTAINING_RECORD(ol, ol_ctx, ol));
 				olctx->action_status &= ~AS_WAIT_IOCP;
@@ -272,6 +272,7 @@ namespace netp {
 					_handle_iocp_event(olctx, ec, dwTrans);
 				}
 			}
+			return u32_t(n);
 #else
 			int ec = 0;
 			DWORD dwTrans_;
@@ -284,7 +285,7 @@ namespace netp {
 				ec = netp_socket_get_last_errno();
 				if (ec == netp::E_WAIT_TIMEOUT) {
 					NETP_VERBOSE("[iocp]GetQueuedCompletionStatus return: %d", ec);
-					return;
+					return 0;
 				}
 
 				NETP_ASSERT(dwTrans_ == 0);
@@ -296,7 +297,7 @@ namespace netp {
 			//did not dequeue a completion packet from the completion port
 			if (ol == 0) {
 				NETP_VERBOSE("[iocp]GetQueuedCompletionStatus return: %d, no packet dequeue", ec);
-				return;
+				return 0;
 			}
 			ol_ctx* olctx=(CONTAINING_RECORD(ol, ol_ctx, ol));
 			olctx->action_status &= ~AS_WAIT_IOCP;
@@ -316,6 +317,7 @@ namespace netp {
 			} else {
 				_handle_iocp_event(olctx, ec, dwTrans_);
 			}
+			return 1;
 #endif
 		}
 
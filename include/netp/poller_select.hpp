@@ -64,7 +64,7 @@ namespace netp {
     #pragma warning(push)
     #pragma warning(disable:4389)
 #endif
-			void poll(i64_t wait_in_nano, std::atomic<bool>& W) override {
+			u32_t poll(i64_t wait_in_nano, std::atomic<bool>& W) override {
 				FD_ZERO(&m_fds[fds_r]);
 				FD_ZERO(&m_fds[fds_w]);
 				FD_ZERO(&m_fds[fds_e]);
@@ -100,8 +100,9 @@ namespace netp {
 				if (ec != 0) {
 					NETP_ERR("[event_loop][select]select error, errno: %d", netp_socket_get_last_errno());
 				}
-				return;
+				return 0;
 			}
+			const u32_t nevents = u32_t(nready);
 
 			io_ctx* ctx_n;
 			for (ctx = (m_io_ctx_list.next), ctx_n = ctx->next; ctx != &m_io_ctx_list && nready>0; ctx = ctx_n, ctx_n = ctx->next) {
@@ -138,6 +139,7 @@ namespace netp {
 				if (hit) { --nready; }
 			}
 			m_polling = false;
+			return nevents;
 		}
 
 #ifdef _NETP_MSVC
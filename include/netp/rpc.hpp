@@ -3,6 +3,7 @@
 
 #include <functional>
 #include <list>
+#include <unordered_map>
 
 #include <netp/core.hpp>
 #include <netp/smart_ptr.hpp>
@@ -16,6 +17,11 @@
 namespace netp {
 	#define __NETP_RPC_DEFAULT_TIMEOUT std::chrono::seconds(30)
 
+	//[type:u8][id:u32][code:i32]([data len:u32])
+	#define NETP_RPC_MESSAGE_HEADER_SIZE (13)
+	//[hlen:u32] + message header
+	#define NETP_RPC_FRAME_HEADER_SIZE (4+NETP_RPC_MESSAGE_HEADER_SIZE)
+
 	enum class rpc_message_type {
 		T_REQ,
 		T_RESP,
@@ -61,7 +67,9 @@ namespace netp {
 			data(data_)
 		{}
 
+		//@note: outp shares the buffer with data if data is held by this message only and none of its buffer is shared, the header is written into its headroom then, otherwise data is copied
 		void encode(NRP<netp::packet>& outp);
+		//@note: the data of in_rpcm is a slice of inpack (no copy)
 		static int from_packet(NRP<netp::packet> const& inpack, NRP<rpc_message>& in_rpcm);
 	};
 
@@ -80,7 +88,8 @@ namespace netp {
 	class rpc;
 	struct list_req_message final
 	{
-		list_req_message *prev, *next;
+		list_req_message *prev, *next; //to write|writing list
+		u32_t dl_idx; //index in the deadline heap, before it is written (push), or before it is responded (req)
 
 		rpc_req_message_state state;
 		NRP<netp::rpc_message> m;
@@ -110,8 +119,18 @@ namespace netp {
 	typedef netp::promise<std::tuple<int, NRP<rpc>>> rpc_dial_promise;
 	typedef netp::channel_listen_promise rpc_listen_promise;
 
-	#define NETP_RPC_INFLIGHT_MAX 128
-	#define NETP_RPC_INFLIGHT_SLOT(reqId) ((reqId)&127)
+	typedef std::function<void(NRP<netp::rpc> const& rpc_, bool blocked)> fn_rpc_write_block_notify_t;
+
+	//@note: max reqs written but not responded yet, the others wait in the to write list
+	#define NETP_RPC_INFLIGHT_MAX (16384)
+	//@note: max reqs|pushes in the to write list, the call|push beyond it fails with E_CHANNEL_WRITE_BLOCK
+	//write block is notified once it is reached, write unblock is notified once it drops to the half
+	#define NETP_RPC_PENDING_MAX (16384)
+
+	//@note: max bytes of one outbound batch (hlen frames of replies, reqs, pushes), one message at least
+	#define NETP_RPC_BATCH_BYTES_MAX (128*1024)
+	//@note: payload larger than this is written by its own packet instead of a copy into the batch buffer
+	#define NETP_RPC_BATCH_INLINE_MAX (2048)
 	
 	//struct list_message {
 	//	list_message *prev, *next;
@@ -124,6 +143,9 @@ namespace netp {
 		private rpc_event_broker_any
 	{
 		typedef std::deque<NRP<netp::rpc_message>, netp::allocator<NRP<netp::rpc_message>>> rpc_message_reply_queue_t;
+		typedef std::unordered_map<u32_t, list_req_message*, std::hash<u32_t>, std::equal_to<u32_t>, netp::allocator<std::pair<const u32_t, list_req_message*>>> rpc_call_map_t;
+		//min-heap by tp_timeout
+		typedef std::vector<list_req_message*, netp::allocator<list_req_message*>> rpc_deadline_heap_t;
 		//typedef std::deque<NRP<netp::rpc_req_message>, netp::allocator<NRP<netp::rpc_req_message>>> rpc_message_req_queue_t;
 
 	private:
@@ -138,16 +160,29 @@ namespace netp {
 		rpc_message_reply_queue_t m_reply_q;
 
 		u32_t m_list_to_write_count;
-		u32_t m_list_wait_for_response_count;
+		u32_t m_batch_bytes_max;
+		u32_t m_inflight_max;
+		u32_t m_pending_max;
+		bool m_flush_scheduled;
+		bool m_write_blocked;
+		fn_rpc_write_block_notify_t m_fn_write_block;
 
 		list_req_message m_list_to_write;
-		list_req_message m_list_wait_for_response[NETP_RPC_INFLIGHT_MAX];
+		list_req_message m_list_writing; //pushes of the batch in writing
+		rpc_call_map_t m_calls; //reqs written, wait for response, by id
+		rpc_deadline_heap_t m_deadlines;
+
+		void _deadline_up(u32_t idx);
+		void _deadline_down(u32_t idx);
+		void _deadline_add(list_req_message* lrm, timer_duration_t const& timeout);
+		void _deadline_remove(list_req_message* lrm);
+		void _write_block_check();
 
 		void _do_reply(NRP<netp::rpc_message> const& reply);
-		void _do_reply_done(int code);
-		void _do_write_req_done(list_req_message* lrm, int code);
+		void _do_write_batch_done(int code);
 
 		void _do_flush();
+		void _do_flush_later();
 
 		void _timer_timeout(NRP<netp::timer> const& t);
 		void _do_timer_timeout();
@@ -172,6 +207,19 @@ namespace netp {
 		NRP<netp::event_loop> const& event_loop() const { return m_loop; }
 		NRP<netp::channel> const& channel() const { return m_ctx->ch; }
 
+		//set these before connected, or on the loop thread
+		//max bytes of one outbound batch
+		inline void set_batch_bytes_max(u32_t nbytes) { m_batch_bytes_max = nbytes; }
+		//max reqs in flight (written, not responded), refer to NETP_RPC_INFLIGHT_MAX
+		inline void set_inflight_max(u32_t n) { m_inflight_max = NETP_MAX(n, 1u); }
+		//max reqs|pushes waiting to be written, refer to NETP_RPC_PENDING_MAX
+		inline void set_pending_max(u32_t n) { m_pending_max = NETP_MAX(n, 1u); }
+		//notified on the loop thread, blocked: true once the pending ones reach the max, false once they drop to the half
+		inline void on_write_block(fn_rpc_write_block_notify_t const& fn) { m_fn_write_block = fn; }
+		inline bool write_blocked() const { return m_write_blocked; }
+		inline u32_t inflight_count() const { return u32_t(m_calls.size()); }
+		inline u32_t pending_count() const { return m_list_to_write_count; }
+
 		template <class ctx_t>
 		inline NRP<ctx_t> get_ctx() { return netp::static_pointer_cast<ctx_t>(m_rpc_ctx);}
 		inline void set_ctx(NRP<ref_base> const& ctx) { m_rpc_ctx = ctx;}
@@ -1,13 +1,21 @@
 #ifndef _NETP_TASK_TASK_DISPATCHER_HPP_
 #define _NETP_TASK_TASK_DISPATCHER_HPP_
 
-#include <deque>
+#include <vector>
+#include <type_traits>
 
 #include <netp/core.hpp>
 #include <netp/smart_ptr.hpp>
 #include <netp/singleton.hpp>
 #include <netp/thread.hpp>
+#include <netp/mutex.hpp>
 #include <netp/condition.hpp>
+#include <netp/mpsc_queue.hpp>
+#include <netp/promise.hpp>
+#include <netp/event_loop.hpp>
+
+//@note: yields of an idle worker before it parks
+#define NETP_SCHEDULER_IDLE_SPIN (16)
 
 namespace netp {
 
@@ -17,172 +25,142 @@ namespace netp {
 
 	typedef std::function<void()> fn_task_t;
 
-	typedef std::deque<netp::non_atomic_shared_ptr<fn_task_t>, netp::allocator<netp::non_atomic_shared_ptr<fn_task_t>> > task_queue_t;
-	struct priority_task_queue {
-		task_queue_t tasks[P_MAX];
-		inline void push(fn_task_t const& t, u8_t const& p) {
-			tasks[p].push_back( netp::make_non_atomic_shared<fn_task_t>(t) );
-		}
-		inline void push(fn_task_t&& t, u8_t const& p) {
-			tasks[p].push_back(netp::make_non_atomic_shared<fn_task_t>(std::forward<fn_task_t>(t)));
-		}
-		inline bool front_and_pop(netp::non_atomic_shared_ptr<fn_task_t>& t) {
-			for (u8_t i = 0; i < P_MAX; ++i) {
-				if (tasks[i].size()) {
-					t = tasks[i].front();
-					tasks[i].pop_front();
-					return true;
-				}
-			}
-			return false;
-		}
-		inline bool empty() const {
-			return	tasks[P_NORMAL].empty() && tasks[P_HIGH].empty();
-		}
-	};
+	//fifo of task_node linked by mpsc_node::next, guarded by the lock of its worker
+	struct scheduler_task_list {
+		mpsc_node* head;
+		mpsc_node* tail;
 
-		enum task_runner_state {
-			TR_S_IDLE,
-			TR_S_WAITING,
-			TR_S_ASSIGNED,
-			TR_S_RUNNING,
-			TR_S_ENDING
-		};
-
-		class scheduler;
-		class runner final :
-			public thread_run_object_abstract
-		{
-			NETP_DECLARE_NONCOPYABLE(runner)
-
-			u8_t m_id;
-			std::atomic<u8_t> m_wait_flag;
-			std::atomic<u8_t> m_state;
-
-			scheduler* m_scheduler;
-		public:
-			runner(u8_t runner_id, scheduler* s);
-			~runner();
-
-			void stop();
-			void on_start();
-			void on_stop();
-			void run();
-
-			inline bool is_waiting() const { return m_state.load(std::memory_order_acquire) == TR_S_WAITING; }
-			inline bool is_running() const { return m_state.load(std::memory_order_acquire) == TR_S_RUNNING; }
-			inline bool is_idle() const { return m_state.load(std::memory_order_acquire) == TR_S_IDLE; }
-			inline bool is_ending() const { return m_state.load(std::memory_order_acquire) == TR_S_ENDING; }
-
-			inline bool test_waiting_step1() {
-				if (m_state.load(std::memory_order_acquire) == TR_S_WAITING) {
-					m_wait_flag.store(1, std::memory_order_release);
-					return true;
-				}
-				return false;
-			}
+		scheduler_task_list() :head(nullptr), tail(nullptr) {}
 
-			inline bool test_waiting_step2() {
-				return (m_wait_flag.load(std::memory_order_acquire) == 1) && (m_state.load(std::memory_order_acquire) == TR_S_WAITING);
+		__NETP_FORCE_INLINE void push(task_node* n) {
+			n->next.store(nullptr, std::memory_order_relaxed);
+			if (tail == nullptr) {
+				head = n;
+			} else {
+				tail->next.store(n, std::memory_order_relaxed);
 			}
-		};
-
-		typedef std::vector<NRP<runner>,netp::allocator<NRP<runner>> > TRV;
-
-		class runner_pool {
-		public:
-			runner_pool(u8_t const& max_runner = 4);
-			~runner_pool();
-
-			void init(scheduler* s);
-			void deinit();
-
-		public:
-
-			inline void set_max_task_runner(u8_t const& count);
-			inline u8_t const& get_max_task_runner() const { return m_max_concurrency; }
+			tail = n;
+		}
 
-			bool test_waiting_step1() {
-				for (u32_t i = 0; i < m_runners.size(); ++i) {
-					if (!m_runners[i]->test_waiting_step1()) {
-						return false;
-					}
+		__NETP_FORCE_INLINE task_node* pop() {
+			mpsc_node* n = head;
+			if (n != nullptr) {
+				head = n->next.load(std::memory_order_relaxed);
+				if (head == nullptr) {
+					tail = nullptr;
 				}
-				return true;
 			}
+			return static_cast<task_node*>(n);
+		}
+	};
 
-			bool test_waiting_step2() {
-				for (u32_t i = 0; i < m_runners.size(); ++i) {
-					if (!m_runners[i]->test_waiting_step2()) {
-						return false;
-					}
-				}
-				return true;
-			}
+	struct scheduler_worker;
 
-		private:
-			mutex m_mutex;
-			TRV m_runners;
-			bool m_is_running : 1;
-			u8_t m_max_concurrency;
-			u8_t m_last_runner_idx;
-		};
+	//the value type of the promise of scheduler::submit, int (netp::OK) for a void callable
+	template <class R>
+	struct scheduler_submit_result { typedef R type; };
+	template <>
+	struct scheduler_submit_result<void> { typedef int type; };
 
-	//@please note that, this class is deprecated
+	//work-stealing scheduler for cpu bound jobs (compression, crypto, json ...)
+	//1, each worker owns one fifo for each priority, a task goes to the calling worker if it is called from a worker, round robin otherwise
+	//2, a worker takes: its own high, others' high (steal), its own normal, others' normal (steal)
+	//3, the callable is stored in a task_node, one allocation for one task
+	//4, a worker parks after a few rounds of empty take, the producer wakes one up only if there is any parked
 	class scheduler:
 		public netp::singleton<scheduler>
 	{
-		friend class runner;
 		NETP_DECLARE_NONCOPYABLE(scheduler)
 
-	private:
-		spin_mutex m_mutex;
-		condition_any m_condition;
-		int m_state;
-		u8_t m_tasks_runner_wait_count;
-		u8_t m_max_concurrency;
-		priority_task_queue* m_tasks_assigning;
-		runner_pool* m_runner_pool;
-	public:
-		enum task_manager_state {
+		typedef std::vector<scheduler_worker*, netp::allocator<scheduler_worker*>> scheduler_workers_t;
+
+		enum scheduler_state {
 			S_IDLE,
 			S_RUN,
-			S_EXIT,
+			S_EXIT
 		};
 
+		template <class R>
+		struct __submit_invoker {
+			template <class promise_t, class fn_t>
+			static void invoke(NRP<promise_t> const& p, NRP<event_loop> const& L, fn_t& fn) {
+				R r = fn();
+				if (L == nullptr) {
+					p->set(r);
+					return;
+				}
+				L->schedule([p, r]() {
+					p->set(r);
+				});
+			}
+		};
+
+		std::atomic<u8_t> m_state;
+		u8_t m_max_concurrency;
+		scheduler_workers_t m_workers;
+		std::atomic<u32_t> m_rr;
+		std::atomic<u64_t> m_stolen;
+
+		//tasks pushed but not taken yet
+		std::atomic<i64_t> m_pending;
+		std::atomic<u32_t> m_parked;
+		netp::mutex m_park_mtx;
+		netp::condition_variable m_park_cond;
+
+		void _push(task_node* n, u8_t p);
+		task_node* _take(u32_t wi);
+		void __worker_run(u32_t wi);
+
+	public:
 		scheduler(u8_t const& max_runner_count = static_cast<u8_t>(std::thread::hardware_concurrency()));
 		~scheduler();
 
-		inline void schedule(fn_task_t const& t, u8_t const& p = P_NORMAL ) {
-			lock_guard<spin_mutex> _lg(m_mutex);
-			NETP_ASSERT( m_state == S_RUN );
-			m_tasks_assigning->push(t, p);
-			if (m_tasks_runner_wait_count > 0) m_condition.notify_one();
-		}
-
+		template <class fn_task_t>
 		inline void schedule(fn_task_t&& t, u8_t const& p = P_NORMAL) {
-			lock_guard<spin_mutex> _lg(m_mutex);
-			NETP_ASSERT(m_state == S_RUN);
-			m_tasks_assigning->push(std::move(t), p);
-			if (m_tasks_runner_wait_count > 0) m_condition.notify_one();
+			NETP_ASSERT(p < P_MAX);
+			_push(task_node::make(std::forward<fn_task_t>(t)), p);
 		}
 
-		void set_concurrency( u8_t const& max ) {
-			unique_lock<spin_mutex> _lg( m_mutex );
+		//the promise is set on the event_loop of the caller, or on the worker if the caller is not a loop thread
+		template <class fn_t, class R = typename std::result_of<typename std::decay<fn_t>::type()>::type>
+		NRP<netp::promise<typename scheduler_submit_result<R>::type>> submit(fn_t&& f, u8_t const& p = P_NORMAL) {
+			typedef netp::promise<typename scheduler_submit_result<R>::type> promise_t;
+			NRP<promise_t> sp = netp::make_ref<promise_t>();
+			schedule([sp, L = NRP<event_loop>(event_loop::this_loop()), fn = std::forward<fn_t>(f)]() mutable {
+				__submit_invoker<R>::invoke(sp, L, fn);
+			}, p);
+			return sp;
+		}
 
-			NETP_ASSERT( m_state != S_RUN );
+		//before start
+		void set_concurrency(u8_t const& max) {
+			NETP_ASSERT(m_state.load(std::memory_order_acquire) != S_RUN);
 			m_max_concurrency = max;
 		}
 
-		inline u8_t const& get_max_task_runner() const {return m_runner_pool->get_max_task_runner();}
+		inline u8_t const& get_max_task_runner() const { return m_max_concurrency; }
+
+		//tasks run by a worker that were taken from the others
+		u64_t stolen() const { return m_stolen.load(std::memory_order_relaxed); }
 
 		int start();
+		//run all the tasks already scheduled, then stop the workers
 		void stop();
+	};
 
-		void __on_start();
-		void __on_stop();
-
-		void __block_until_no_new_task();
+	template <>
+	struct scheduler::__submit_invoker<void> {
+		template <class promise_t, class fn_t>
+		static void invoke(NRP<promise_t> const& p, NRP<event_loop> const& L, fn_t& fn) {
+			fn();
+			if (L == nullptr) {
+				p->set(netp::OK);
+				return;
+			}
+			L->schedule([p]() {
+				p->set(netp::OK);
+			});
+		}
 	};
 }
 
@@ -7,6 +7,10 @@
 	#include <netp/socket_channel_iocp.hpp>
 #endif
 
+#ifdef NETP_HAS_POLLER_IO_URING
+	#include <netp/socket_channel_io_uring.hpp>
+#endif
+
 namespace netp {
 	struct socket_url_parse_info {
 		string_t proto;
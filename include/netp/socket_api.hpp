@@ -262,6 +262,49 @@ __label_send:
 		return r;
 	}
 
+#ifdef _NETP_WIN
+	typedef WSABUF iov_t;
+	#define NETP_IOV_MAX (64)
+	#define NETP_IOV_SET(_iov,_buf,_len) do { (_iov).buf = (char*)(_buf); (_iov).len = (ULONG)(_len); } while(0)
+#else
+	typedef struct iovec iov_t;
+	#ifdef IOV_MAX
+		#define NETP_IOV_MAX (IOV_MAX)
+	#else
+		#define NETP_IOV_MAX (1024)
+	#endif
+	#define NETP_IOV_SET(_iov,_buf,_len) do { (_iov).iov_base = (void*)(_buf); (_iov).iov_len = (size_t)(_len); } while(0)
+#endif
+
+	//gather write, one syscall for iovcnt buffers
+	//@return nbytes sent (might be less than the sum of iov), otherwise the error code
+	//caller decide to retry or not
+	inline int sendv(SOCKET fd, iov_t const* const iov, netp::u32_t iovcnt) {
+		NETP_ASSERT(iovcnt <= NETP_IOV_MAX);
+#ifdef _NETP_WIN
+		DWORD nbytes = 0;
+		const int r = ::WSASend(fd, (LPWSABUF)iov, (DWORD)iovcnt, &nbytes, 0, NULL, NULL);
+		if (NETP_UNLIKELY(r == NETP_SOCKET_ERROR)) {
+			int ec = netp_socket_get_last_errno();
+			_NETP_REFIX_EWOULDBLOCK(ec);
+			return ec;
+		}
+		return (int)nbytes;
+#else
+__label_sendv:
+		const ::ssize_t r = ::writev(fd, iov, (int)iovcnt);
+		if (NETP_UNLIKELY(r == -1)) {
+			int ec = netp_socket_get_last_errno();
+			if (NETP_UNLIKELY(ec == netp::E_EINTR)) {
+				goto __label_sendv;
+			}
+			_NETP_REFIX_EWOULDBLOCK(ec);
+			return ec;
+		}
+		return (int)r;
+#endif
+	}
+
 	//@note: 
 	//Datagram sockets in various domains(e.g., the UNIXand Internet
 	//	domains) permit zero - length datagrams.When such a datagram is
@@ -346,6 +389,40 @@ __label_recv:
 		return nbytes;
 	}
 
+#ifdef __NETP_ENABLE_MMSG
+	//batch version of recvfrom, one datagram per msgvec entry, msg_len of each entry is filled by kernel
+	//@return the number of datagrams received, otherwise the error code
+	inline int recvmmsg(SOCKET fd, struct mmsghdr* msgvec, netp::u32_t vlen, int flag = 0) {
+	_label_recvmmsg:
+		const int n = ::recvmmsg(fd, msgvec, vlen, flag, NULL);
+		if (NETP_UNLIKELY(n == -1)) {
+			int ec = netp_socket_get_last_errno();
+			if (ec == netp::E_EINTR) {
+				goto _label_recvmmsg;
+			}
+			_NETP_REFIX_EWOULDBLOCK(ec);
+			return ec;
+		}
+		return n;
+	}
+
+	//batch version of sendto
+	//@return the number of datagrams sent (might be less than vlen), otherwise the error code of the first entry
+	inline int sendmmsg(SOCKET fd, struct mmsghdr* msgvec, netp::u32_t vlen, int flag = 0) {
+	_label_sendmmsg:
+		const int n = ::sendmmsg(fd, msgvec, vlen, flag);
+		if (NETP_UNLIKELY(n == -1)) {
+			int ec = netp_socket_get_last_errno();
+			if (ec == netp::E_EINTR) {
+				goto _label_sendmmsg;
+			}
+			_NETP_REFIX_EWOULDBLOCK(ec);
+			return ec;
+		}
+		return n;
+	}
+#endif
+
 	inline int socketpair(int domain, int type, int protocol, SOCKET sv[2]) {
 		if (domain != int(NETP_AF_INET)) {
 			return NETP_SOCKET_ERROR;
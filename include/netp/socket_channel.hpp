@@ -15,6 +15,15 @@
 //@NOTE: turn on this option would result in about 20% performance boost for EPOLL
 #define NETP_ENABLE_FAST_WRITE
 
+//@NOTE: gather pending outbound entries into one sendv (writev|WSASend) for stream socket
+//up to NETP_IOV_MAX entries per syscall
+#define NETP_ENABLE_VECTORED_WRITE
+
+//@NOTE: batch udp read_from|write_to by recvmmsg|sendmmsg, NETP_UDP_MMSG_BATCH datagrams per syscall
+#ifdef __NETP_ENABLE_MMSG
+	#define NETP_ENABLE_UDP_MMSG
+#endif
+
 //in milliseconds, small clock would result in a more accurate control
 #define NETP_DEFAULT_LISTEN_BACKLOG 256
 
@@ -33,6 +42,14 @@ namespace netp {
 
 	const static int default_socket_option = (int(socket_option::OPTION_NON_BLOCKING) | int(socket_option::OPTION_KEEP_ALIVE));
 
+	enum listen_flag {
+		F_LISTEN_NONE = 0,
+		//one SO_REUSEPORT listener per loop of the group, accepted channel is born on the loop that accept it
+		F_LISTEN_REUSEPORT_SHARDING = 1,
+		//steer incoming connection to the listener whose loop is pinned to the cpu that handles the rx (SO_INCOMING_CPU), need f_th_thread_affinity
+		F_LISTEN_INCOMING_CPU = 1<<1
+	};
+
 	struct keep_alive_vals {
 		netp::u8_t	 probes;
 		netp::u8_t	 idle; //in seconds
@@ -90,6 +107,7 @@ namespace netp {
 		u32_t tx_limit; //in Byte (1kb == 1024Byte), 0 means no limit
 		u32_t wsabuf_size;
 		u32_t mark;
+		u8_t listen_flag;
 
 		fn_socket_channel_maker_t ch_maker;
 		socket_cfg(NRP<event_loop> const& L = nullptr) :
@@ -106,6 +124,7 @@ namespace netp {
 			tx_limit(0),
 			wsabuf_size(64*1024),
 			mark(0),
+			listen_flag(F_LISTEN_NONE),
 			ch_maker(nullptr)
 		{}
 
@@ -124,14 +143,18 @@ namespace netp {
 			_cfg->tx_limit = tx_limit;
 			_cfg->wsabuf_size = wsabuf_size;
 			_cfg->mark = mark;
+			_cfg->listen_flag = listen_flag;
 			_cfg->ch_maker = ch_maker;
 
 			return _cfg;
 		}
 	};
 
+	//a chain is pushed as one entry per slice, only the last one has the write_promise
+	//write_promise is nullptr for a post_write, eom tells the last slice of a message from the leading ones
 	struct socket_outbound_entry final {
 		u32_t written;
+		bool eom;
 		NRP<netp::packet> data;
 		NRP<promise<int>> write_promise;
 	};
@@ -149,12 +172,13 @@ namespace netp {
 	{
 		friend void do_dial(NRP<channel_dial_promise> const& ch_dialf, NRP<address> const& addr, fn_channel_initializer_t const& initializer, NRP<socket_cfg> const& cfg);
 		friend void do_listen_on(NRP<channel_listen_promise> const& listenp, NRP<address> const& laddr, fn_channel_initializer_t const& initializer, NRP<socket_cfg> const& cfg, int backlog);
-		typedef std::deque<socket_outbound_entry, netp::allocator<socket_outbound_entry>> socket_outbound_entry_t;
-		typedef std::deque<socket_outbound_entry_to, netp::allocator<socket_outbound_entry_to>> socket_outbound_entry_to_t;
 
 		template <class _Ref_ty, typename... _Args>
 		friend ref_ptr<_Ref_ty> make_ref(_Args&&... args);
 	protected:
+		typedef std::deque<socket_outbound_entry, netp::allocator<socket_outbound_entry>> socket_outbound_entry_t;
+		typedef std::deque<socket_outbound_entry_to, netp::allocator<socket_outbound_entry_to>> socket_outbound_entry_to_t;
+
 		SOCKET m_fd;
 		u16_t m_family;
 		u16_t m_type;
@@ -471,6 +495,20 @@ protected:
 			return netp::OK;
 		}
 
+		//busy read the device queue for up to us on a blocking read|poll of this socket, refer to https://www.kernel.org/doc/html/latest/networking/napi.html#busy-polling
+		int _cfg_busy_poll(u32_t us) {
+#ifdef SO_BUSY_POLL
+			NETP_RETURN_V_IF_MATCH(netp::E_INVALID_OPERATION, m_fd == NETP_INVALID_SOCKET);
+			int optval = int(us);
+			int rt = socket_setsockopt_impl(SOL_SOCKET, SO_BUSY_POLL, &optval, sizeof(optval));
+			NETP_RETURN_V_IF_MATCH(netp_socket_get_last_errno(), rt == NETP_SOCKET_ERROR);
+			return netp::OK;
+#else
+			(void)us;
+			return netp::E_INVALID_OPERATION;
+#endif
+		}
+
 		int _cfg_option(u16_t opt, keep_alive_vals const& kvals) {
 
 			//force nonblocking
@@ -481,8 +519,8 @@ protected:
 			NETP_RETURN_V_IF_NOT_MATCH(rt, rt == netp::OK);
 
 #if defined(_NETP_GNU_LINUX) || defined(_NETP_ANDROID) || defined(_NETP_APPLE)
-			rt = _cfg_reuseport((m_option & u8_t(socket_option::OPTION_REUSEPORT)) != 0);
-			NETP_RETURN_V_IF_MATCH(NETP_SOCKET_ERROR, rt == NETP_SOCKET_ERROR);
+			rt = _cfg_reuseport((opt & u16_t(socket_option::OPTION_REUSEPORT)) != 0);
+			NETP_RETURN_V_IF_NOT_MATCH(rt, rt == netp::OK);
 #endif
 
 			if (is_udp()) {
@@ -500,6 +538,15 @@ protected:
 				rt = _cfg_keepalive((opt & u16_t(socket_option::OPTION_KEEP_ALIVE)) != 0, kvals);
 				NETP_RETURN_V_IF_NOT_MATCH(rt, rt == netp::OK);
 			}
+
+			//best effort, the loop busy polls anyway
+			const u32_t busy_poll_us = L->channel_busy_poll_us();
+			if (busy_poll_us != 0) {
+				rt = _cfg_busy_poll(busy_poll_us);
+				if (rt != netp::OK) {
+					NETP_VERBOSE("[socket][%s]_cfg_busy_poll(%u) failed: %d", ch_info().c_str(), busy_poll_us, rt);
+				}
+			}
 			return netp::OK;
 		}
 
@@ -598,9 +645,17 @@ protected:
 		virtual int socket_send_impl(const byte_t* data, u32_t len, int flag = 0) {
 			return netp::send(m_fd, data, len, flag);
 		}
+		virtual int socket_sendv_impl(iov_t const* iov, u32_t iovcnt) {
+			return netp::sendv(m_fd, iov, iovcnt);
+		}
 		virtual int socket_sendto_impl(const byte_t* data, u32_t len, NRP<address> const& to, int flag = 0) {
 			return netp::sendto(m_fd, data, len, to, flag);
 		}
+#ifdef NETP_ENABLE_UDP_MMSG
+		virtual int socket_sendmmsg_impl(struct mmsghdr* msgvec, u32_t vlen, int flag = 0) {
+			return netp::sendmmsg(m_fd, msgvec, vlen, flag);
+		}
+#endif
 
 		virtual int socket_recv_impl(byte_t* const buf, u32_t size, int flag = 0) {
 			return netp::recv(m_fd, buf, size, flag);
@@ -608,6 +663,11 @@ protected:
 		virtual int socket_recvfrom_impl(byte_t* const buf, u32_t size, NRP<address>& from, int flag = 0) {
 			return netp::recvfrom(m_fd, buf, size, from, flag);
 		}
+#ifdef NETP_ENABLE_UDP_MMSG
+		virtual int socket_recvmmsg_impl(struct mmsghdr* msgvec, u32_t vlen, int flag = 0) {
+			return netp::recvmmsg(m_fd, msgvec, vlen, flag);
+		}
+#endif
 
 	public:
 		__NETP_FORCE_INLINE u16_t sock_family() const { return ((m_family)); };
@@ -795,16 +855,27 @@ protected:
 			NETP_ASSERT( ch_is_connected() ? m_tx_entry_to_q.empty() : m_tx_entry_q.empty(), "flag: %u", m_chflag );
 #endif
 
+			u32_t post_cancelled = 0;
 			while (m_tx_entry_q.size()) {
 				NETP_ASSERT((ch_errno() != 0) && (m_chflag & (int(channel_flag::F_WRITE_ERROR) | int(channel_flag::F_READ_ERROR) | int(channel_flag::F_FIRE_ACT_EXCEPTION))));
 				socket_outbound_entry& entry = m_tx_entry_q.front();
 				NETP_WARN("[socket][%s]cancel outbound, nbytes:%u, errno: %d", ch_info().c_str(), entry.data->len(), ch_errno());
 				//hold a copy before we do pop it from queue
 				NRP<promise<int>> wp = entry.write_promise;
+				const bool eom = entry.eom;
 				m_tx_bytes -= (entry.data->len()-entry.written);
 				m_tx_entry_q.pop_front();
-				NETP_ASSERT(wp->is_idle());
-				wp->set(ch_errno());
+				//no promise for the leading slices of a chain
+				if (wp != nullptr) {
+					NETP_ASSERT(wp->is_idle());
+					wp->set(ch_errno());
+				} else if (eom) {
+					++post_cancelled;
+				}
+			}
+			//one error event for all the post_write cancelled
+			if (post_cancelled > 0) {
+				ch_fire_error(ch_errno());
 			}
 
 			while (m_tx_entry_to_q.size()) {
@@ -905,6 +976,10 @@ protected:
 		}
 
 		void __do_io_read_from(int status, io_ctx* ctx);
+#ifdef NETP_ENABLE_UDP_MMSG
+		//recvmmsg into loop slots, fire the whole batch to pipeline per syscall
+		void __do_io_read_from_mmsg(int status);
+#endif
 		void __do_io_read(int status, io_ctx* ctx);
 
 		inline void __do_io_write_done(const int status) {
@@ -923,6 +998,9 @@ protected:
 					NETP_TRACE_SOCKET("[socket][%s]IO_WRITE, end F_WRITE_SHUTDOWN_PENDING, ch_close_write, errno: %d, flag: %d", ch_info().c_str(), ch_errno(), m_chflag);
 				} else {
 					ch_io_end_write();
+					if (m_fn_drained != nullptr) {
+						m_chflag |= int(channel_flag::F_DRAINED_PENDING);
+					}
 				}
 
 				NETP_ASSERT( (m_chflag & (int(channel_flag::F_WATCH_WRITE))) == 0);
@@ -936,6 +1014,12 @@ protected:
 
 #ifdef NETP_ENABLE_FAST_WRITE
 				NETP_ASSERT(m_chflag & (int(channel_flag::F_WRITE_BARRIER)) );
+#ifdef NETP_EPOLL_COALESCE_CTL
+				if (((m_chflag & int(channel_flag::F_WATCH_WRITE)) == 0) && (L->poller_type() == io_poller_type::T_EPOLL)) {
+					//the full send buffer wakes the write up, no need to rearm an et poller, poller_epoll clears it on watch/unwatch
+					m_io_ctx->flag |= io_flag::IO_WRITE_BLOCKED;
+				}
+#endif
 				ch_io_write();
 #else
 				NETP_ASSERT(m_chflag & (int(channel_flag::F_WRITE_BARRIER) | int(channel_flag::F_WATCH_WRITE)) == (int(channel_flag::F_WRITE_BARRIER) | int(channel_flag::F_WATCH_WRITE))  );
@@ -963,14 +1047,37 @@ protected:
 		void __do_io_write(int status, io_ctx* ctx);
 		void __do_io_write_to(int status, io_ctx* ctx);
 
+		//called right after the write barrier is left, the callee might write again
+		inline void __ch_drained_check() {
+			if (m_chflag & int(channel_flag::F_DRAINED_PENDING)) {
+				m_chflag &= ~int(channel_flag::F_DRAINED_PENDING);
+				if ((m_fn_drained != nullptr) && m_tx_entry_q.empty() && m_tx_entry_to_q.empty()) {
+					m_fn_drained(NRP<channel>(this));
+				}
+			}
+		}
+
 		//@note, we need simulate a async write, so for write operation, we'll flush outbound buffer in the next loop
 		//flush until error
 		//<0, is_error == (errno != E_CHANNEL_WRITING)
 		//==0, flush done
 		//this api would be called right after a check of writeable of the current socket
-		int ___do_io_write();
+		//a completion based variant submits the write instead and returns E_EWOULDBLOCK till it completes
+		virtual int ___do_io_write();
 		int ___do_io_write_to();
 
+#ifdef NETP_ENABLE_VECTORED_WRITE
+		//gather write for stream socket, resolve write_promise entry by entry as bytes drained
+		int ___do_io_writev();
+#endif
+#ifdef NETP_ENABLE_UDP_MMSG
+		//sendmmsg for udp, one datagram per entry
+		int ___do_io_write_to_mmsg();
+#endif
+		void ___tx_budget_consume(u32_t nbytes);
+		//nbytes of the front entries are written, resolve write_promise entry by entry
+		void ___tx_entry_consume(u32_t nbytes);
+
 		//for connected socket type
 		void _ch_do_close_listener();
 		void _ch_do_close_read_write();
@@ -981,6 +1088,7 @@ protected:
 
 		void ch_write_impl(NRP<promise<int>> const& intp, NRP<packet> const& outlet) override;
 		void ch_write_to_impl(NRP<promise<int>> const& intp, NRP<packet> const& outlet, NRP<netp::address> const& to) override;
+		void ch_write_chain_impl(NRP<promise<int>> const& intp, NRP<packet_chain> const& chain) override;
 
 		void ch_close_read_impl(NRP<promise<int>> const& closep) override;
 		void ch_close_write_impl(NRP<promise<int>> const& chp) override;
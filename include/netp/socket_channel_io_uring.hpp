@@ -0,0 +1,69 @@
+#ifndef _NETP_SOCKET_CH_IO_URING_HPP_
+#define _NETP_SOCKET_CH_IO_URING_HPP_
+
+#include <netp/socket_channel.hpp>
+
+#ifdef NETP_HAS_POLLER_IO_URING
+#include <netp/poller_io_uring.hpp>
+
+#ifdef NETP_IO_URING_COMPLETION_IO
+namespace netp {
+
+	//the stream channel of a io_uring loop, it reads by a multishot recv from the buffers provided by the poller, the tx entries a full snd buffer could not take are written by sendmsg
+	//listen, accept and connect stay on the readiness path of socket_channel, so does the read if the kernel could not provide buffers
+	class socket_channel_io_uring final :
+		public socket_channel,
+		public io_uring_monitor
+	{
+		template <class _Ref_ty, typename... _Args>
+		friend ref_ptr<_Ref_ty> make_ref(_Args&&... args);
+
+		enum iou_ch_flag {
+			IOU_CH_READ = 1, //F_WATCH_READ is served by the recv
+			IOU_CH_WRITE = 1 << 1, //F_WATCH_WRITE is served by the sendmsg
+			IOU_CH_READ_BY_READINESS = 1 << 2 //the kernel rejected the multishot recv
+		};
+
+		poller_io_uring* m_iou;
+		u8_t m_iou_flag;
+		int m_rx_status; //the eof|error received while the read is paused
+		packet_deque_t m_rx_pending; //received while the read is paused, fired before anything else on resume
+
+		socket_channel_io_uring(NRP<socket_cfg> const& cfg) :
+			socket_channel(cfg),
+			m_iou(nullptr),
+			m_iou_flag(0),
+			m_rx_status(netp::OK)
+		{
+			NETP_ASSERT(cfg->L != nullptr && cfg->L->poller_type() == io_poller_type::T_IO_URING);
+		}
+
+		~socket_channel_io_uring()
+		{
+		}
+
+		void __io_begin_done(io_ctx* ctx) override {
+			socket_channel::__io_begin_done(ctx);
+			m_iou = static_cast<poller_io_uring*>(L->poller().get());
+			m_iou->completion_begin(ctx, this);
+		}
+
+		int ___do_io_write() override;
+
+		void __iou_recv();
+		void __iou_rx_flush();
+
+		void iou_recv_done(int nbytes, byte_t const* buf, bool more, io_ctx* ctx) override;
+		void iou_send_done(int nbytes, io_ctx* ctx) override;
+
+	public:
+		void ch_io_read(fn_io_event_t const& fn_read = nullptr) override;
+		void ch_io_end_read() override;
+		void ch_io_write(fn_io_event_t const& fn_write = nullptr) override;
+		void ch_io_end_write() override;
+	};
+}
+
+#endif //NETP_IO_URING_COMPLETION_IO
+#endif //NETP_HAS_POLLER_IO_URING
+#endif
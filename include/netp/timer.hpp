@@ -8,6 +8,11 @@
 #include <netp/core.hpp>
 #include <netp/smart_ptr.hpp>
 #include <netp/heap.hpp>
+#include <netp/list.hpp>
+
+#ifdef _NETP_MSVC
+	#include <intrin.h>
+#endif
 
 #ifdef NETP_ENABLE_TRACE_TIMER
 	#define NETP_TRACE_TIMER NETP_INFO
@@ -47,8 +52,24 @@ namespace netp {
 	const timer_duration_t _TIMER_DURATION_INFINITE = timer_duration_t(TIMER_TIME_INFINITE);
 	const timer_timepoint_t _TIMER_TP_INFINITE = timer_timepoint_t() + _TIMER_DURATION_INFINITE;
 
+	enum timer_broker_type {
+		T_TIMER_HEAP, //binary heap, O(log n) launch, ns precision
+		T_TIMER_WHEEL //hierarchical timing wheel, O(1) launch|cancel, tick precision
+	};
+
+	enum timer_broker_flag {
+		F_TIMER_IN_BROKER = 1<<0
+	};
+
+	//slot list hook for timer_broker_wheel
+	struct timer_wheel_node {
+		timer_wheel_node* prev;
+		timer_wheel_node* next;
+	};
+
 	class timer final:
-		public netp::ref_base
+		public netp::ref_base,
+		public timer_wheel_node
 	{
 		typedef std::function<void(NRP<timer> const&)> _fn_timer_t;
 		_fn_timer_t callee;
@@ -56,6 +77,12 @@ namespace netp {
 		timer_timepoint_t expiration;
 		timer_timepoint_t invocation;
 		u32_t invoke_cnt;
+		u8_t tb_flag;
+		//bumped by every launch|cancel of timer_broker_heap, a heap entry of an older gen is stale
+		u32_t tb_gen;
+		i64_t tw_tick;
+		//the wheel holds the timer by this ref while it is linked in a slot
+		NRP<timer> tw_hold;
 
 		friend bool operator < (NRP<timer> const& l, NRP<timer> const& r);
 		friend bool operator > (NRP<timer> const& l, NRP<timer> const& r);
@@ -63,6 +90,8 @@ namespace netp {
 		friend struct timer_less;
 		friend struct timer_greater;
 		friend class timer_broker;
+		friend class timer_broker_heap;
+		friend class timer_broker_wheel;
 		friend class timer_broker_ts;
 	public:
 		template <class dur, class _Fx, class... _Args>
@@ -71,8 +100,13 @@ namespace netp {
 			delay(delay_),
 			expiration(timer_timepoint_t()),
 			invocation(timer_timepoint_t()),
-			invoke_cnt(0)
+			invoke_cnt(0),
+			tb_flag(0),
+			tb_gen(0),
+			tw_tick(0)
 		{
+			prev = nullptr;
+			next = nullptr;
 		}
 
 		template <class dur, class _callable
@@ -82,8 +116,13 @@ namespace netp {
 			delay(std::forward<dur>(delay_)),
 			expiration(timer_timepoint_t()),
 			invocation(timer_timepoint_t()),
-			invoke_cnt(0)
+			invoke_cnt(0),
+			tb_flag(0),
+			tb_gen(0),
+			tw_tick(0)
 		{
+			prev = nullptr;
+			next = nullptr;
 			static_assert(std::is_class<std::remove_reference<_callable>>::value, "_callable must be lambda or std::function type");
 		}
 		//return expire - now
@@ -141,37 +180,177 @@ namespace netp {
 		}
 	};
 
+	//the expiration is kept by the entry, the caller might update the one of the timer before it launches it again
+	struct timer_heap_entry {
+		timer_timepoint_t expiration;
+		u32_t gen;
+		NRP<timer> tm;
+	};
+
+	struct timer_heap_entry_less
+	{
+		inline bool operator()(timer_heap_entry const& l, timer_heap_entry const& r)
+		{
+			return l.expiration < r.expiration;
+		}
+	};
+
 	#define NETP_TM_INIT_CAPACITY (1000)
-	typedef std::deque<NRP<timer>, netp::allocator<NRP<timer>>> _timer_queue;
-	typedef netp::binary_heap< NRP<timer>, netp::timer_less, NETP_TM_INIT_CAPACITY > _timer_heap_t;
+	typedef std::deque<timer_heap_entry, netp::allocator<timer_heap_entry>> _timer_queue;
+	typedef netp::binary_heap< timer_heap_entry, netp::timer_heap_entry_less, NETP_TM_INIT_CAPACITY > _timer_heap_t;
 	
-	class timer_broker final:
+	class timer_broker:
 		public netp::ref_base
+	{
+	protected:
+		//timers invoked since the broker is made
+		u64_t m_fired;
+		virtual void _do_launch(NRP<timer>&& tm) = 0;
+
+	public:
+		timer_broker() : m_fired(0) {}
+		virtual ~timer_broker() {}
+
+		u64_t fired() const { return m_fired; }
+
+		//set a delay<0, the timer would be fired immedately in the next expire frame
+		template <class timer_t>
+		inline void launch(timer_t&& tm) {
+			NETP_ASSERT(tm != nullptr && (tm->delay != timer_duration_t(~0)) && (tm->expiration != timer_timepoint_t() ), "tm->delay: %lld", tm->delay.count());
+			_do_launch(NRP<timer>(std::forward<timer_t>(tm)));
+		}
+
+		//the callee would not be invoked after cancel, a cancelled timer could be launched again
+		virtual void cancel(NRP<timer> const& tm) = 0;
+
+		virtual void expire_all() = 0;
+		virtual void expire(timer_duration_t& ndelay) = 0;
+		virtual netp::size_t size() const = 0;
+	};
+
+	class timer_broker_heap final:
+		public timer_broker
 	{
 		_timer_heap_t m_heap;
 		_timer_queue m_tq;
+		//entries of m_heap and m_tq left by relaunch|cancel
+		netp::size_t m_stale;
+
+		//drop the stale entries once they outnumber the live ones, the heap is bounded by twice the live timers
+		void __compact();
+		__NETP_FORCE_INLINE void __stale_inc() {
+			if ((++m_stale<<1) > (m_tq.size() + m_heap.size())) {
+				__compact();
+			}
+		}
+
+	protected:
+		//launch a timer that is still in heap makes its entry stale, a new entry is pushed
+		void _do_launch(NRP<timer>&& tm) override {
+			const bool relaunch = (tm->tb_flag&F_TIMER_IN_BROKER) != 0;
+			tm->tb_flag = F_TIMER_IN_BROKER;
+			const u32_t gen = ++tm->tb_gen;
+			const timer_timepoint_t expiration = tm->expiration;
+			m_tq.push_back(timer_heap_entry{ expiration, gen, std::move(tm) });
+			if (relaunch) {
+				__stale_inc();
+			}
+		}
 
 	public:
-		timer_broker()
+		timer_broker_heap():
+			m_stale(0)
 		{
 		}
 
-		virtual ~timer_broker()
+		virtual ~timer_broker_heap()
 		{
-			NETP_ASSERT(m_tq.size() + m_heap.size() == 0);
+			NETP_ASSERT(size() == 0);
 			//NETP_INFO("[timer_broker]cancel timer: %d", m_tq.size() + m_heap.size() );
 		}
 
-		//set a delay<0, the timer would be fired immedately in the next expire frame
-		template <class timer_t>
-		inline void launch(timer_t&& tm) {
-			NETP_ASSERT(tm != nullptr && (tm->delay != timer_duration_t(~0)) && (tm->expiration != timer_timepoint_t() ), "tm->delay: %lld", tm->delay.count());
-			m_tq.emplace_back(std::forward<timer_t>(tm));
+		//@note: leave a stale entry in heap, it would be popped on its expiration or dropped by __compact
+		void cancel(NRP<timer> const& tm) override {
+			if (tm->tb_flag&F_TIMER_IN_BROKER) {
+				tm->tb_flag = 0;
+				++tm->tb_gen;
+				__stale_inc();
+			}
+		}
+
+		void expire_all() override;
+		void expire(timer_duration_t& ndelay) override;
+		//live timers only
+		netp::size_t size() const override { return m_tq.size() + m_heap.size() - m_stale; }
+	};
+
+	//tick: 1ms, level 0: 256 slots (256ms), level 1..3: 64 slots each (16.3s, 17.4min, 18.6h)
+	//the timer beyond the top level is parked in the farthest top level slot, and cascaded again when that slot comes
+	#define NETP_TIMER_WHEEL_TICK_NS (1000000LL)
+	#define NETP_TIMER_WHEEL_LEVEL (4)
+	#define NETP_TIMER_WHEEL_L0_BITS (8)
+	#define NETP_TIMER_WHEEL_LN_BITS (6)
+	#define NETP_TIMER_WHEEL_L0_SIZE (1<<NETP_TIMER_WHEEL_L0_BITS)
+	#define NETP_TIMER_WHEEL_BITMAP_WORDS (NETP_TIMER_WHEEL_L0_SIZE>>6)
+
+	/*
+	 * @note
+	 * 1, launch: link the timer into the slot of its expire tick, O(1)
+	 * 2, cancel: unlink the timer from its slot, O(1), no tombstone left
+	 * 3, expire: jump to the next non-empty tick by the slot bitmap, cascade the upper level slot on level boundary, run level 0 slot
+	 * 4, the expire tick is rounded up, a timer fires at [expiration, expiration+1tick)
+	 */
+	class timer_broker_wheel final:
+		public timer_broker
+	{
+		timer_wheel_node m_slots[NETP_TIMER_WHEEL_LEVEL][NETP_TIMER_WHEEL_L0_SIZE];
+		u64_t m_bitmap[NETP_TIMER_WHEEL_LEVEL][NETP_TIMER_WHEEL_BITMAP_WORDS];
+		//launched with expire tick <= m_cur, run on next expire
+		timer_wheel_node m_due;
+		timer_timepoint_t m_base;
+		//all ticks <= m_cur have been processed
+		i64_t m_cur;
+		netp::size_t m_size;
+
+		__NETP_FORCE_INLINE static u32_t __lv_shift(u32_t lv) {
+			return lv == 0 ? 0 : (NETP_TIMER_WHEEL_L0_BITS + (lv - 1) * NETP_TIMER_WHEEL_LN_BITS);
+		}
+		__NETP_FORCE_INLINE static u32_t __lv_mask(u32_t lv) {
+			return lv == 0 ? (NETP_TIMER_WHEEL_L0_SIZE - 1) : ((1 << NETP_TIMER_WHEEL_LN_BITS) - 1);
 		}
+		__NETP_FORCE_INLINE static u32_t __ctz64(u64_t v) {
+#ifdef _NETP_MSVC
+			unsigned long i;
+			_BitScanForward64(&i, v);
+			return u32_t(i);
+#else
+			return u32_t(__builtin_ctzll(v));
+#endif
+		}
+
+		__NETP_FORCE_INLINE i64_t __tick_of(timer_timepoint_t const& tp) const {
+			const i64_t ns = (tp - m_base).count();
+			return ns <= 0 ? 0 : ((ns + NETP_TIMER_WHEEL_TICK_NS - 1) / NETP_TIMER_WHEEL_TICK_NS);
+		}
+
+		void __link(timer* tm);
+		void __unlink(timer* tm);
+		void __cascade(u32_t lv, u32_t idx);
+		void __run_slot(timer_wheel_node* slot);
+		u32_t __next_slot_distance(u32_t lv, u32_t idx) const;
+		i64_t __next_tick() const;
+
+	protected:
+		void _do_launch(NRP<timer>&& tm) override;
+
+	public:
+		timer_broker_wheel();
+		virtual ~timer_broker_wheel();
 
-		void expire_all();
-		void expire(timer_duration_t& ndelay);
-		const netp::size_t size() { return m_tq.size() + m_heap.size(); }
+		void cancel(NRP<timer> const& tm) override;
+		void expire_all() override;
+		void expire(timer_duration_t& ndelay) override;
+		netp::size_t size() const override { return m_size; }
 	};
 
 	/*
@@ -88,7 +88,18 @@ namespace netp {
 					const netp::u32_t to_write = (inlen > m_size ? m_size : inlen);
 
 					if (m_pkt_tmp == nullptr) {
-						if ( (inlen<=m_size) && (inlen+in->left_right_capacity()) >= m_size) {
+						if (inlen == m_size) {
+							//the last frame of this packet, take it
+							m_pkt_tmp = std::move(in);
+							m_in_q.pop_front();
+							goto __label_skip_nbytes;
+						} else if (inlen > m_size) {
+							//slice of the incoming buffer, no copy, keep the len bytes as the headroom for a echo
+							m_pkt_tmp = in->slice(0, m_size, sizeof(hlen_util_size_t));
+							in->skip(m_size);
+							goto __label_skip_nbytes;
+						}
+						if ( (inlen+in->left_right_capacity()) >= m_size) {
 							//short path to save a memcpy
 							m_pkt_tmp = std::move(in);
 							m_in_q.pop_front();
@@ -129,6 +140,32 @@ __label_skip_nbytes:
 #endif
 			pkt->write_left<hlen_util_size_t>(hlen_util_size_t(pkt->len()));
 		}
+
+		//the len in a packet of its own, to be the head of a packet_chain
+		inline NRP<netp::packet> encode_header(u32_t len) {
+#ifdef _NETP_DEBUG
+			NETP_ASSERT(len <= hlen_util_size_t(-1));
+#endif
+			NRP<netp::packet> hp = netp::make_ref<netp::packet>(u32_t(sizeof(hlen_util_size_t)), 0);
+			hp->write<hlen_util_size_t>(hlen_util_size_t(len));
+			return hp;
+		}
+
+		//prepend the len into the headroom of pkt if possible, pkt is not modified
+		//@note: the returned packet might share the buffer with pkt
+		inline NRP<netp::packet> encode_to(NRP<netp::packet> const& pkt) {
+#ifdef _NETP_DEBUG
+			NETP_ASSERT(pkt->len() <= hlen_util_size_t(-1));
+#endif
+			byte_t hbuf[sizeof(hlen_util_size_t)];
+			netp::bytes_helper::write<hlen_util_size_t, netp::byte_t*>(hbuf, hlen_util_size_t(pkt->len()));
+			NRP<netp::packet> outp = pkt->slice_prepend(hbuf, sizeof(hlen_util_size_t));
+			if (outp == nullptr) {
+				outp = netp::make_ref<netp::packet>(pkt->head(), pkt->len());
+				encode(outp);
+			}
+			return outp;
+		}
 	};
 }
 
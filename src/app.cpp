@@ -71,6 +71,22 @@ namespace netp {
 		}
 	}
 
+	void app::cfg_poller(std::string const& name) {
+		m_poller_type = NETP_DEFAULT_POLLER_TYPE;
+#ifdef NETP_HAS_POLLER_EPOLL
+		if (name == "epoll") {
+			return;
+		}
+#endif
+#ifdef NETP_HAS_POLLER_IO_URING
+		if (name == "io_uring") {
+			m_poller_type = io_poller_type::T_IO_URING;
+			return;
+		}
+#endif
+		NETP_WARN("[app]unsupported poller: %s, use the default", name.c_str());
+	}
+
 	void app::cfg_channel_read_buf(u32_t buf_in_kbytes) {
 		if (buf_in_kbytes == 0) {
 			buf_in_kbytes = 128;
@@ -82,6 +98,13 @@ namespace netp {
 		m_channel_read_buf_size = buf_in_kbytes * (1024);
 	}
 
+	void app::cfg_busy_poll(u32_t us) {
+		if (us > 1000000) {
+			us = 1000000;
+		}
+		m_busy_poll_us = us;
+	}
+
 	void app::cfg_channel_tx_limit_clock(u32_t clock) {
 		if (clock < 1) {
 			clock = 1;
@@ -179,6 +202,15 @@ namespace netp {
 		if (cfg_json.find("netp_log") != cfg_json.end() && cfg_json["netp_log"].is_string()) {
 			cfg_log_filepathname(cfg_json["netp_log"].get<std::string>());
 		}
+		if (cfg_json.find("netp_log_async") != cfg_json.end() && cfg_json["netp_log_async"].is_boolean()) {
+			cfg_log_async(cfg_json["netp_log_async"].get<bool>());
+		}
+		if (cfg_json.find("netp_log_rotate_size") != cfg_json.end() && cfg_json["netp_log_rotate_size"].is_number()) {
+			cfg_log_rotate(cfg_json["netp_log_rotate_size"].get<u64_t>(), m_log_rotate_interval);
+		}
+		if (cfg_json.find("netp_log_rotate_interval") != cfg_json.end() && cfg_json["netp_log_rotate_interval"].is_number()) {
+			cfg_log_rotate(m_log_rotate_size, cfg_json["netp_log_rotate_interval"].get<u32_t>());
+		}
 
 		if (cfg_json.find("netp_def_loop_count_by_factor") != cfg_json.end() && cfg_json["netp_def_loop_count_by_factor"].is_number_float() && cfg_json["def_loop_count_factor"].get<float>() > 0 ) {
 			cfg_loop_count(u32_t(cfg_json["netp_def_loop_count_by_factor"].get<float>()*std::thread::hardware_concurrency()));
@@ -187,12 +219,22 @@ namespace netp {
 			cfg_loop_count(cfg_json["netp_def_loop_count"]);
 		}
 
+		if (cfg_json.find("netp_poller") != cfg_json.end() && cfg_json["netp_poller"].is_string()) {
+			cfg_poller(cfg_json["netp_poller"].get<std::string>());
+		}
+
 		if (cfg_json.find("netp_channel_read_buf") != cfg_json.end() && cfg_json["netp_channel_read_buf"].is_number()) {
 			cfg_channel_read_buf(cfg_json["netp_channel_read_buf"].get<int>());
 		}
+		if (cfg_json.find("netp_channel_read_right_size") != cfg_json.end() && cfg_json["netp_channel_read_right_size"].is_boolean()) {
+			cfg_channel_read_right_size(cfg_json["netp_channel_read_right_size"].get<bool>());
+		}
 		if (cfg_json.find("netp_channel_tx_limit_clock") != cfg_json.end() && cfg_json["netp_channel_tx_limit_clock"].is_number()) {
 			cfg_channel_tx_limit_clock(cfg_json["netp_channel_tx_limit_clock"].get<int>());
 		}
+		if (cfg_json.find("netp_busy_poll_us") != cfg_json.end() && cfg_json["netp_busy_poll_us"].is_number()) {
+			cfg_busy_poll(cfg_json["netp_busy_poll_us"].get<u32_t>());
+		}
 
 		return netp::OK;
 	}
@@ -208,6 +250,8 @@ namespace netp {
 			{"netp-def-loop-count", optional_argument, 0, 5 },
 			{"netp-channel-read-buf", optional_argument, 0, 6 },
 			{"netp-channel-bdlimit-clock", optional_argument, 0, 7 },
+			{"netp-poller", optional_argument, 0, 8 },
+			{"netp-busy-poll-us", optional_argument, 0, 9 },
 			{0,0,0,0}
 		};
 
@@ -296,6 +340,16 @@ namespace netp {
 				cfg_channel_tx_limit_clock(std::atoi(optarg));
 			}
 			break;
+			case 8:
+			{
+				cfg_poller(std::string(optarg));
+			}
+			break;
+			case 9:
+			{
+				cfg_busy_poll(u32_t(std::atoi(optarg)));
+			}
+			break;
 			}
 		}
 
@@ -334,12 +388,18 @@ _label_exit:
 
 	app::app() :
 		m_loop_count(u32_t(std::thread::hardware_concurrency())),
+		m_poller_type(NETP_DEFAULT_POLLER_TYPE),
 		m_channel_read_buf_size(128*1024),
+		m_channel_read_right_size(true),
 		m_channel_tx_limit_clock(30),/*resolution on windows is 15ms*/
+		m_busy_poll_us(0),
 		m_is_cfg_json_loaded(false),
 		m_should_exit(false), 
 		m_app_state(app_state::s_idle),
-		m_logfilepathname()
+		m_logfilepathname(),
+		m_log_async(false),
+		m_log_rotate_size(0),
+		m_log_rotate_interval(0)
 	{
 	}
 
@@ -381,7 +441,11 @@ _label_exit:
 
 		_init();
 
-		NRP<logger::file_logger> filelogger = netp::make_ref<netp::logger::file_logger>(netp::string_t(m_logfilepathname.c_str()));
+		netp::logger::file_logger_cfg flcfg;
+		flcfg.async = m_log_async;
+		flcfg.rotate_size = m_log_rotate_size;
+		flcfg.rotate_interval = m_log_rotate_interval;
+		NRP<logger::file_logger> filelogger = netp::make_ref<netp::logger::file_logger>(netp::string_t(m_logfilepathname.c_str()), flcfg);
 		filelogger->set_mask_by_level(NETP_FILE_LOGGER_LEVEL);
 		netp::logger_broker::instance()->add(filelogger);
 
@@ -613,7 +677,8 @@ _label_exit:
 #endif
 
 		NETP_ASSERT(m_def_loop_group == nullptr);
-		netp::event_loop_cfg cfg(NETP_DEFAULT_POLLER_TYPE, u8_t(f_enable_dns_resolver), m_channel_read_buf_size);
+		netp::event_loop_cfg cfg(m_poller_type, u8_t(f_enable_dns_resolver|(m_channel_read_right_size ? f_channel_read_right_size : 0)), m_channel_read_buf_size);
+		cfg.busy_poll_us = m_busy_poll_us;
 		dns_hosts(cfg.dns_hosts);
 		m_def_loop_group = netp::make_ref<netp::event_loop_group>(cfg, default_event_loop_maker);
 		NETP_TRACE_APP("net init end");
@@ -91,6 +91,14 @@ namespace netp {
 		(void)to;
 	}
 
+	void channel_handler_abstract::write_chain(NRP<promise<int>> const& intp, NRP<channel_handler_context> const& ctx, NRP<packet_chain> const& chain) {
+		_NETP_HANDLER_CONTEXT_ASSERT(CH_H_FLAG & CH_OUTBOUND_WRITE_CHAIN);
+		NETP_THROW("CH_OUTBOUND_WRITE_CHAIN MUST IMPL ITS OWN write_chain");
+		(void)intp;
+		(void)ctx;
+		(void)chain;
+	}
+
 	void channel_handler_head::write(NRP<promise<int>> const& intp, NRP<channel_handler_context> const& ctx, NRP<packet> const& outlet ) {
 		ctx->ch->ch_write_impl(intp,outlet);
 	}
@@ -111,6 +119,10 @@ namespace netp {
 		ctx->ch->ch_write_to_impl(intp, outlet, to);
 	}
 
+	void channel_handler_head::write_chain(NRP<promise<int>> const& intp, NRP<channel_handler_context> const& ctx, NRP<packet_chain> const& chain) {
+		ctx->ch->ch_write_chain_impl(intp, chain);
+	}
+
 	void channel_handler_tail::connected(NRP<channel_handler_context> const& ctx) {
 		NETP_TRACE_CHANNEL("[#%s][tail]channel connected, no action", ctx->ch->ch_info().c_str() );
 		(void)ctx;
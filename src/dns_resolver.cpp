@@ -1,4 +1,6 @@
 
+#include <algorithm>
+
 #include <netp/core.hpp>
 #include <netp/app.hpp>
 
@@ -12,6 +14,7 @@
 #endif 
 
 #include "../3rd/c-ares/c-ares-1.19.0/include/ares.h"
+#include "../3rd/c-ares/c-ares-1.19.0/include/ares_nameser.h"
 
 #include <netp/dns_resolver.hpp>
 #include <netp/socket_api.hpp>
@@ -103,7 +106,13 @@ namespace netp {
 		L(L_),
 		m_ares_channel(0),
 		m_ares_active_query(0),
-		m_flag(0)
+		m_flag(0),
+		m_stat_hit(0),
+		m_stat_negative_hit(0),
+		m_stat_static_hit(0),
+		m_stat_miss(0),
+		m_stat_coalesced(0),
+		m_stat_size(0)
 	{
 		NETP_ASSERT(L_ != nullptr );
 	}
@@ -124,16 +133,24 @@ namespace netp {
 
 	void dns_resolver::_do_add_name_server() {
 		NETP_ASSERT(L->in_event_loop());
-		std::for_each(m_ns.begin(), m_ns.end(), [&](netp::string_t const& serv) {
-			(void) serv;
-			NETP_VERBOSE("[dns_resolver]add dns serv: %s", serv.c_str());
-		});
+		if (m_ns.size() == 0 || (m_flag & (dns_resolver_flag::f_drf_launching | dns_resolver_flag::f_drf_running)) == 0) {
+			return;
+		}
+		netp::string_t csv;
+		netp::join(m_ns, netp::string_t(","), csv);
+		const int rt = ares_set_servers_ports_csv(*((ares_channel*)(m_ares_channel)), csv.c_str());
+		if (rt != ARES_SUCCESS) {
+			NETP_WARN("[dns_resolver]set dns serv failed: %d, serv: %s", rt, csv.c_str());
+			return;
+		}
+		NETP_VERBOSE("[dns_resolver]add dns serv: %s", csv.c_str());
 	}
 
 	NRP<netp::promise<int>> dns_resolver::add_name_server(std::vector<netp::string_t, netp::allocator<netp::string_t>> const& ns) {
 		NRP<netp::promise<int>> p = netp::make_ref<netp::promise<int>>();
 		L->execute([dnsr=NRP<dns_resolver>(this), ns, p]() {
 			dnsr->m_ns.insert(dnsr->m_ns.begin(), ns.begin(), ns.end());
+			dnsr->_do_add_name_server();
 			p->set(netp::OK);
 		});
 		return p;
@@ -206,6 +223,7 @@ namespace netp {
 		}
 
 		ares_set_socket_functions(*((ares_channel*)(m_ares_channel)), &__ares_func, this );
+		_do_add_name_server();
 
 		//@note
 		//it's safe to set this pointer, cuz ares ares_destroy always happens before loop exit
@@ -465,52 +483,59 @@ namespace netp {
 #endif
 	}
 
-	void dns_resolver::__ares_gethostbyname_cb(void* arg, int status, int timeouts, struct hostent* hostent)
+	void dns_resolver::__ares_search_cb(void* arg, int status, int timeouts, unsigned char* abuf, int alen)
 	{
 		(void)timeouts;
 		async_dns_query* adq = (async_dns_query*)arg;
-#ifdef _NETP_DEBUG
-		NETP_ASSERT(adq->dnsr->L->in_event_loop());
-#endif
-		adq->dnsr->__ares_done();
+		NRP<dns_resolver> dnsr = adq->dnsr;
+		NETP_ASSERT(dnsr->L->in_event_loop());
+		dnsr->__ares_done();
+
+		dns_ipv4s_t ipv4s;
+		u32_t ttl = NETP_DNS_CACHE_TTL_MAX;
 		if (status == ARES_SUCCESS) {
-			std::vector<netp::ipv4_t, netp::allocator<netp::ipv4_t>> ipv4s;
-			char** lpSrc;
-			for (lpSrc = hostent->h_addr_list; *lpSrc; lpSrc++) {
-				switch (hostent->h_addrtype) {
-				case AF_INET:
-				{
-					char addr_buf[32] = {0};
-					ares_inet_ntop(hostent->h_addrtype, *lpSrc, addr_buf, sizeof(addr_buf));
-					ipv4s.emplace_back( dotiptoip(addr_buf));
-					//u_long nip = u32_t(*lpSrc);
-					//ipv4s.push_back( ntohl(nip) );
-				}
-				break;
-				case AF_INET6:
-				{
-					NETP_TODO("AF_INET6");
-				}
-				break;
+			struct ares_addrttl addrttls[32];
+			int naddrttls = sizeof(addrttls) / sizeof(addrttls[0]);
+			status = ares_parse_a_reply(abuf, alen, NULL, addrttls, &naddrttls);
+			if (status == ARES_SUCCESS) {
+				for (int i = 0; i < naddrttls; ++i) {
+					ipv4s.push_back(netp::nipv4toipv4({ addrttls[i].ipaddr.s_addr }));
+					ttl = NETP_MIN(ttl, u32_t(NETP_MAX(addrttls[i].ttl, 0)));
 				}
 			}
+		}
 
+		switch (status) {
+		case ARES_SUCCESS:
+		{
 			if (ipv4s.size()) {
-				adq->dnsquery_p->set(std::make_tuple(netp::OK, ipv4s));
+				dnsr->_cache_insert(adq->host, netp::OK, ipv4s, NETP_MAX(ttl, u32_t(NETP_DNS_CACHE_TTL_MIN)));
+				dnsr->_query_done(adq->host, netp::OK, ipv4s);
 			} else {
-				adq->dnsquery_p->set(std::make_tuple(netp::E_DNS_DOMAIN_NO_DATA, ipv4s));
+				dnsr->_cache_insert(adq->host, netp::E_DNS_DOMAIN_NO_DATA, ipv4s, NETP_DNS_CACHE_NEGATIVE_TTL);
+				dnsr->_query_done(adq->host, netp::E_DNS_DOMAIN_NO_DATA, ipv4s);
 			}
-		} else {
-#ifdef _NETP_DEBUG
-			NETP_WARN("[dns_resolver]resolve status: %d, host: %s", status, adq->host.c_str() );
-#else
-			NETP_WARN("[dns_resolver]resolve status: %d", status);
-#endif
-			adq->dnsquery_p->set(std::make_tuple( NETP_NEGATIVE(NETP_ABS(netp::E_DNS_CARES_ERRNO_BEGIN)+NETP_ABS(status)), std::vector<netp::ipv4_t, netp::allocator<netp::ipv4_t>>()));
 		}
+		break;
+		case ARES_ENOTFOUND:
+		case ARES_ENODATA:
+		{
+			//NXDOMAIN|NODATA, cache it for a bounded time
+			const int code = NETP_NEGATIVE(NETP_ABS(netp::E_DNS_CARES_ERRNO_BEGIN) + NETP_ABS(status));
+			dnsr->_cache_insert(adq->host, code, ipv4s, NETP_DNS_CACHE_NEGATIVE_TTL);
+			dnsr->_query_done(adq->host, code, ipv4s);
+		}
+		break;
+		default:
+		{
+			NETP_WARN("[dns_resolver]resolve status: %d, host: %s", status, adq->host.c_str());
+			dnsr->_query_done(adq->host, NETP_NEGATIVE(NETP_ABS(netp::E_DNS_CARES_ERRNO_BEGIN) + NETP_ABS(status)), ipv4s);
+		}
+		}
+
 		if (status == ARES_ECONNREFUSED) {
-			NETP_WARN("[dns_resolver][%p]resolve status: %d", adq->dnsr.get(), ARES_ECONNREFUSED);
-			adq->dnsr->L->schedule([dnsr=adq->dnsr]() {
+			NETP_WARN("[dns_resolver][%p]resolve status: %d", dnsr.get(), ARES_ECONNREFUSED);
+			dnsr->L->schedule([dnsr]() {
 				dnsr->restart();
 			});
 		}
@@ -518,22 +543,117 @@ namespace netp {
 		netp::allocator<async_dns_query>::trash(adq);
 	}
 
+	bool dns_resolver::_cache_lookup(string_t const& name, NRP<dns_query_promise> const& p) {
+		dns_static_map_t::const_iterator sit = m_static.find(name);
+		if (sit != m_static.end()) {
+			m_stat_static_hit.fetch_add(1, std::memory_order_relaxed);
+			p->set(std::make_tuple(netp::OK, sit->second));
+			return true;
+		}
+
+		dns_cache_map_t::iterator it = m_cache.find(name);
+		if (it == m_cache.end()) {
+			return false;
+		}
+		if (it->second.expire <= netp::now<std::chrono::milliseconds, netp::steady_clock_t>().time_since_epoch().count()) {
+			m_cache.erase(it);
+			m_stat_size.store(u32_t(m_cache.size()), std::memory_order_relaxed);
+			return false;
+		}
+
+		m_stat_hit.fetch_add(1, std::memory_order_relaxed);
+		if (it->second.code != netp::OK) {
+			m_stat_negative_hit.fetch_add(1, std::memory_order_relaxed);
+		}
+		p->set(std::make_tuple(it->second.code, it->second.ipv4s));
+		return true;
+	}
+
+	void dns_resolver::_cache_insert(string_t const& name, int code, dns_ipv4s_t const& ipv4s, u32_t ttl) {
+		const i64_t now = netp::now<std::chrono::milliseconds, netp::steady_clock_t>().time_since_epoch().count();
+		if (m_cache.size() >= NETP_DNS_CACHE_MAX && m_cache.find(name) == m_cache.end()) {
+			dns_cache_map_t::iterator it = m_cache.begin();
+			while (it != m_cache.end()) {
+				if (it->second.expire <= now) {
+					it = m_cache.erase(it);
+				} else {
+					++it;
+				}
+			}
+			if (m_cache.size() >= NETP_DNS_CACHE_MAX) {
+				//all alive, make room by a random one
+				m_cache.erase(m_cache.begin());
+			}
+		}
+
+		dns_cache_entry& e = m_cache[name];
+		e.code = code;
+		e.ipv4s = ipv4s;
+		e.expire = now + i64_t(NETP_MIN(ttl, u32_t(NETP_DNS_CACHE_TTL_MAX))) * 1000;
+		m_stat_size.store(u32_t(m_cache.size()), std::memory_order_relaxed);
+	}
+
+	void dns_resolver::_query_done(string_t const& name, int code, dns_ipv4s_t const& ipv4s) {
+		dns_inflight_map_t::iterator it = m_inflight.find(name);
+		if (it == m_inflight.end()) {
+			return;
+		}
+		//a promise callback might resolve the same name again
+		dns_query_promises_t ps;
+		std::swap(ps, it->second);
+		m_inflight.erase(it);
+		for (std::size_t i = 0; i < ps.size(); ++i) {
+			ps[i]->set(std::make_tuple(code, ipv4s));
+		}
+	}
+
 	void dns_resolver::_do_resolve(string_t const& domain, NRP<dns_query_promise> const& p) {
 		NETP_ASSERT(L->in_event_loop());
 		if ( (m_flag& dns_resolver_flag::f_drf_running) == 0) {
-			p->set(std::make_tuple(netp::E_DNS_INVALID_STATE,std::vector<ipv4_t,netp::allocator<ipv4_t>>()));
+			p->set(std::make_tuple(netp::E_DNS_INVALID_STATE, dns_ipv4s_t()));
+			return;
+		}
+
+		string_t name(domain);
+		std::transform(name.begin(), name.end(), name.begin(), [](char c) { return char(::tolower((unsigned char)c)); });
+		if (netp::is_dotipv4_decimal_notation(name.c_str())) {
+			p->set(std::make_tuple(netp::OK, dns_ipv4s_t(1, netp::dotiptoip(name.c_str()))));
+			return;
+		}
+
+		if (_cache_lookup(name, p)) {
+			return;
+		}
+
+		dns_inflight_map_t::iterator it = m_inflight.find(name);
+		if (it != m_inflight.end()) {
+			m_stat_coalesced.fetch_add(1, std::memory_order_relaxed);
+			it->second.push_back(p);
+			return;
+		}
+		m_stat_miss.fetch_add(1, std::memory_order_relaxed);
+		m_inflight[name].push_back(p);
+
+		//hosts file first, as ares_gethostbyname does
+		struct hostent* he = NULL;
+		if (ares_gethostbyname_file(*((ares_channel*)m_ares_channel), name.c_str(), AF_INET, &he) == ARES_SUCCESS) {
+			dns_ipv4s_t ipv4s;
+			for (char** addr = he->h_addr_list; *addr; ++addr) {
+				ipv4s.push_back(netp::nipv4toipv4({ ((struct in_addr*)(*addr))->s_addr }));
+			}
+			ares_free_hostent(he);
+			const int code = ipv4s.size() ? netp::OK : netp::E_DNS_DOMAIN_NO_DATA;
+			_cache_insert(name, code, ipv4s, NETP_DNS_CACHE_HOSTS_FILE_TTL);
+			_query_done(name, code, ipv4s);
 			return;
 		}
 
 		async_dns_query* adq = netp::allocator<async_dns_query>::make();
 		adq->dnsr = NRP<dns_resolver>(this);
-		adq->dnsquery_p = p;
-		#ifdef _NETP_DEBUG
-		adq->host = netp::string_t(domain.c_str(), domain.length());
-		#endif
+		adq->host = name;
 
 		++m_ares_active_query;
-		ares_gethostbyname(*((ares_channel*)m_ares_channel), domain.c_str(), AF_INET, __ares_gethostbyname_cb, adq);
+		ares_search(*((ares_channel*)m_ares_channel), name.c_str(), C_IN, T_A, __ares_search_cb, adq);
 		__ares_check_timeout();
 	}
 
@@ -544,4 +664,45 @@ namespace netp {
 		});
 		return dnsp;
 	}
+
+	NRP<netp::promise<int>> dns_resolver::add_static_host(netp::string_t const& line) {
+		NRP<netp::promise<int>> p = netp::make_ref<netp::promise<int>>();
+		L->execute([dnsr = NRP<dns_resolver>(this), line, p]() {
+			netp::string_t l(line.substr(0, line.find('#')));
+			std::replace_if(l.begin(), l.end(), [](char c) { return c == '\t' || c == '\r' || c == '\n'; }, ' ');
+			std::vector<netp::string_t, netp::allocator<netp::string_t>> tokens;
+			netp::split<netp::string_t>(l, netp::string_t(" "), tokens);
+			if (tokens.size() < 2 || !netp::is_dotipv4_decimal_notation(tokens[0].c_str())) {
+				NETP_WARN("[dns_resolver]invalid static host: %s", line.c_str());
+				p->set(netp::E_OP_INVALID_ARG);
+				return;
+			}
+			const ipv4_t ip = netp::dotiptoip(tokens[0].c_str());
+			for (std::size_t i = 1; i < tokens.size(); ++i) {
+				std::transform(tokens[i].begin(), tokens[i].end(), tokens[i].begin(), [](char c) { return char(::tolower((unsigned char)c)); });
+				dns_ipv4s_t& ipv4s = dnsr->m_static[tokens[i]];
+				if (std::find(ipv4s.begin(), ipv4s.end(), ip) == ipv4s.end()) {
+					ipv4s.push_back(ip);
+				}
+			}
+			p->set(netp::OK);
+		});
+		return p;
+	}
+
+	void dns_resolver::cache_stat(dns_cache_stat& st) const {
+		st.hit = m_stat_hit.load(std::memory_order_relaxed);
+		st.negative_hit = m_stat_negative_hit.load(std::memory_order_relaxed);
+		st.static_hit = m_stat_static_hit.load(std::memory_order_relaxed);
+		st.miss = m_stat_miss.load(std::memory_order_relaxed);
+		st.coalesced = m_stat_coalesced.load(std::memory_order_relaxed);
+		st.size = m_stat_size.load(std::memory_order_relaxed);
+	}
+
+	void dns_resolver::cache_flush() {
+		L->execute([dnsr = NRP<dns_resolver>(this)]() {
+			dnsr->m_cache.clear();
+			dnsr->m_stat_size.store(0, std::memory_order_relaxed);
+		});
+	}
 }
\ No newline at end of file
@@ -8,6 +8,9 @@
 #if defined(NETP_HAS_POLLER_EPOLL)
 #include <netp/poller_epoll.hpp>
 #define NETP_DEFAULT_POLLER_TYPE netp::io_poller_type::T_EPOLL
+#if defined(NETP_HAS_POLLER_IO_URING)
+#include <netp/poller_io_uring.hpp>
+#endif
 #elif defined(NETP_HAS_POLLER_SELECT)
 #include <netp/poller_select.hpp>
 #define NETP_DEFAULT_POLLER_TYPE netp::io_poller_type::T_SELECT
@@ -24,6 +27,12 @@
 
 namespace netp {
 
+	static __NETP_TLS event_loop* __tls_this_loop = nullptr;
+
+	event_loop* event_loop::this_loop() {
+		return __tls_this_loop;
+	}
+
 	NRP<event_loop> default_event_loop_maker(NRP<event_loop_group> const& g, event_loop_cfg const& cfg) {
 		NRP<poller_abstract> poller;
 		switch (cfg.type) {
@@ -34,6 +43,14 @@ namespace netp {
 			NETP_ALLOC_CHECK(poller, sizeof(poller_epoll));
 		}
 		break;
+#if defined(NETP_HAS_POLLER_IO_URING)
+		case T_IO_URING:
+		{
+			poller = netp::make_ref<poller_io_uring>();
+			NETP_ALLOC_CHECK(poller, sizeof(poller_io_uring));
+		}
+		break;
+#endif
 #elif defined(NETP_HAS_POLLER_IOCP)
 		case T_IOCP:
 		{
@@ -74,25 +91,43 @@ namespace netp {
 
 	void event_loop::init() {
 		NETP_ASSERT(m_cfg.channel_read_buf_size > 0);
-		m_channel_rcv_buf = netp::make_ref<netp::packet>(m_cfg.channel_read_buf_size);
+		m_channel_rcv_pool = netp::make_ref<netp::packet_pool>(m_cfg.channel_read_buf_size);
+		m_channel_rcv_buf = m_channel_rcv_pool->get(m_cfg.channel_read_buf_size);
+		m_channel_rcv_right_size_max = (m_cfg.flag&f_channel_read_right_size) ? NETP_MIN(m_channel_rcv_pool->small_size(), (m_cfg.channel_read_buf_size>>2)) : 0;
 		m_tid = std::this_thread::get_id();
-		m_tb = netp::make_ref<timer_broker>();
-
-		m_tq = &m_tqs[0];
-		m_tq_standby = &m_tqs[1];
+		__tls_this_loop = this;
+		switch (m_cfg.timer_broker_type) {
+		case T_TIMER_WHEEL:
+		{
+			m_tb = netp::make_ref<timer_broker_wheel>();
+		}
+		break;
+		default:
+		{
+			m_tb = netp::make_ref<timer_broker_heap>();
+		}
+		}
 
 		m_poller->init();
 
 		if (m_cfg.flag & f_enable_dns_resolver) {
-			if (m_cfg.type == NETP_DEFAULT_POLLER_TYPE) {
+			if (NETP_IS_SOCKET_POLLER_TYPE(m_cfg.type)) {
 				m_dns_resolver = netp::make_ref<dns_resolver>(NRP<event_loop>(this));
 				inc_internal_ref_count();
 			} else {
 				m_dns_resolver = netp::make_ref<dns_resolver>(netp::app::instance()->def_loop_group()->next());
 			}
 			m_dns_resolver->init();
-			if (m_dns_hosts.size()) {
-				m_dns_resolver->add_name_server(m_dns_hosts);
+			std::vector<netp::string_t, netp::allocator<netp::string_t>> ns;
+			for (std::size_t i = 0; i < m_dns_hosts.size(); ++i) {
+				if (m_dns_hosts[i].find_first_of(" \t") == netp::string_t::npos) {
+					ns.push_back(m_dns_hosts[i]);
+				} else {
+					m_dns_resolver->add_static_host(m_dns_hosts[i]);
+				}
+			}
+			if (ns.size()) {
+				m_dns_resolver->add_name_server(ns);
 			}
 			NRP<netp::promise<int>> dnsp = m_dns_resolver->start();
 			if (dnsp->get() != netp::OK) {
@@ -111,7 +146,7 @@ namespace netp {
 
 		if (m_cfg.flag & f_enable_dns_resolver) {
 			NETP_ASSERT(m_dns_resolver != nullptr);
-			if (m_cfg.type == NETP_DEFAULT_POLLER_TYPE) {
+			if (NETP_IS_SOCKET_POLLER_TYPE(m_cfg.type)) {
 				m_dns_resolver->deinit();
 				m_dns_resolver = nullptr;
 			} else {
@@ -126,15 +161,19 @@ namespace netp {
 			}
 		}
 
-		{
-			lock_guard<spin_mutex> lg(m_tq_mutex);
-			NETP_ASSERT(m_tq_standby->empty());
-		}
-
-		NETP_ASSERT(m_tq->empty());
+		NETP_ASSERT(m_tq_count.load(std::memory_order_acquire) == 0);
+		NETP_ASSERT(m_tq.pop() == nullptr);
 		NETP_ASSERT(m_tb->size() == 0);
 		m_tb = nullptr;
 
+#ifdef __NETP_ENABLE_MMSG
+		//release the slot by the loop thread
+		for (u32_t i = 0; i < NETP_UDP_MMSG_BATCH; ++i) {
+			m_channel_rcv_mmsg_buf[i] = nullptr;
+			m_channel_rcv_mmsg_addr[i] = nullptr;
+		}
+#endif
+
 		m_poller->deinit();
 		NETP_VERBOSE("[event_loop][%p][%u]deinit done", this, m_cfg.type );
 	}
@@ -156,51 +195,72 @@ namespace netp {
 		//NETP_ASSERT(!"CHECK EXCEPTION STACK");
 		init();
 		//record a snapshot, used by update state
-		m_io_ctx_count_before_running = m_io_ctx_count;
+		m_io_ctx_count_before_running = m_io_ctx_count.load(std::memory_order_relaxed);
 		u8_t _SL = u8_t(loop_state::S_LAUNCHING);
 		const bool rt = m_state.compare_exchange_strong(_SL, u8_t(loop_state::S_RUNNING), std::memory_order_acq_rel, std::memory_order_acquire);
 		NETP_ASSERT(rt == true);
-#ifdef NETP_DEBUG_LOOP_TIME
-		m_loop_last_tp = netp::now<std::chrono::nanoseconds, netp::steady_clock_t>().time_since_epoch().count();
-#endif
+		i64_t round_begin = netp::now<std::chrono::nanoseconds, netp::steady_clock_t>().time_since_epoch().count();
+		m_load_window_begin = round_begin;
 		try {
 			//this load also act as a memory synchronization fence to sure all release operation happen before this line
 			//if we make_ref a atomic_ref object, then we call L->schedule([o=atomic_ref_instance](){});, the assign of a atomic_ref_instance would trigger memory_order_acq_rel, this operation guard all object member initialization and member valud update before the assign
 			//all member value of that object must be synchronized after this line, cuz we have netp::atomic_incre inside ref object
 			while (NETP_UNLIKELY(u8_t(loop_state::S_EXIT) != m_state.load(std::memory_order_acquire))) {
-				
-				//again the spin_mutex acts as a memory synchronization fence
-				m_tq_mutex.lock();
-				if (!m_tq_standby->empty()) {
-					std::swap(m_tq_standby, m_tq);
-				}
-				m_tq_mutex.unlock();
+				m_stat_round_tp.store(round_begin, std::memory_order_relaxed);
 
-				const std::size_t ss = m_tq->size();
+				//run the tasks scheduled before this line only, the ones scheduled by these tasks would be run in the next round
+				const u32_t ss = m_tq_count.load(std::memory_order_relaxed);
+				u32_t i = 0;
 				if (ss > 0) {
-					std::size_t i = 0;
+					__stat_max(m_stat_tq_max, ss);
 					while (i < ss) {
-						(*m_tq)[i]();
-						(*m_tq)[i] = nullptr;//release memory immedidately
+						mpsc_node* node = m_tq.pop();
+						if (node == nullptr) {
+							//producer in progress, check it in the next round
+							break;
+						}
+						static_cast<task_node*>(node)->run();
 						++i;
 					}
-#ifdef _NETP_DEBUG
-					NETP_ASSERT(ss == m_tq->size());
-#endif	
-					if (m_tq->capacity()>512) {
-						io_task_q_t().swap(*m_tq);
-					} else {
-						m_tq->clear();
-					}
+					m_tq_count.fetch_sub(i, std::memory_order_relaxed);
+					__stat_add(m_stat_tasks, u64_t(i));
 				}
 				//@_calc_wait_dur_in_nano must happen before poll..
+				const i64_t wait_in_nano = _calc_wait_dur_in_nano();
+				const u64_t timers = m_tb->fired();
+				const bool timer_fired = (timers != m_stat_timers.load(std::memory_order_relaxed));
+				if (timer_fired) {
+					m_stat_timers.store(timers, std::memory_order_relaxed);
+				}
 
-#ifdef NETP_DEBUG_LOOP_TIME
-				long long _now = netp::now<std::chrono::nanoseconds, netp::steady_clock_t>().time_since_epoch().count();
-				NETP_INFO("[event_loop]loop dt: %llu ns, last_wait: %llu", _now - m_loop_last_tp, m_last_wait);
-				m_loop_last_tp = _now;
-#endif
-				m_poller->poll(_calc_wait_dur_in_nano(), m_waiting);
+				//a clock read is ~40ns, skip the ones that could be told: the round that has nothing run goes to poll_ns as a whole, the wait that returns nothing ends the round
+				const i64_t poll_begin = ((i != 0) || timer_fired) ? netp::now<std::chrono::nanoseconds, netp::steady_clock_t>().time_since_epoch().count() : round_begin;
+				const u32_t nevents = m_poller->poll(wait_in_nano, m_waiting);
+				//the events are dispatched in poll after the wait returns
+				const i64_t wait_end = (wait_in_nano != 0) ? NETP_MAX(poll_begin, m_poller->wait_exit_tp()) : poll_begin;
+				const i64_t poll_end = ((nevents == 0) && (wait_in_nano != 0)) ? wait_end : netp::now<std::chrono::nanoseconds, netp::steady_clock_t>().time_since_epoch().count();
+
+				const i64_t task_ns = poll_begin - round_begin;
+				i64_t poll_ns = wait_end - poll_begin;
+				i64_t io_ns = poll_end - wait_end;
+				if (nevents == 0) {
+					poll_ns += io_ns;
+					io_ns = 0;
+				} else {
+					__stat_add(m_stat_io_events, u64_t(nevents));
+					__stat_add(m_stat_io_wakeups, u64_t(1));
+					__stat_max(m_stat_io_events_max, nevents);
+				}
+				__stat_add(m_stat_rounds, u64_t(1));
+				__stat_add(m_stat_poll_ns, u64_t(poll_ns));
+				__stat_add(m_stat_task_ns, u64_t(task_ns));
+				__stat_add(m_stat_io_ns, u64_t(io_ns));
+
+				__load_round_end(poll_end, task_ns + io_ns);
+				if (m_cfg.busy_poll_us != 0) {
+					__busy_poll_update(i + nevents, poll_end);
+				}
+				round_begin = poll_end;
 			}
 		}
 		catch (...) {
@@ -215,16 +275,19 @@ namespace netp {
 			// scenario 1:
 			// 1) do schedule, 2) set L -> null
 
-			std::size_t i = 0;
-			std::size_t vecs = m_tq_standby->size();
-			while (i < vecs) {
-				(*m_tq_standby)[i++]();
+			u32_t i = 0;
+			const u32_t ss = m_tq_count.load(std::memory_order_acquire);
+			mpsc_node* node;
+			while ( (node = m_tq.pop()) != nullptr) {
+				//drop the ones scheduled by the last round
+				(i++ < ss) ? static_cast<task_node*>(node)->run() : static_cast<task_node*>(node)->drop();
 			}
-			m_tq_standby->clear();
+			m_tq_count.fetch_sub(i, std::memory_order_relaxed);
 			m_tb->expire_all();
 		}
 
 		deinit();
+		__tls_this_loop = nullptr;
 		NETP_VERBOSE("[event_loop][%p][%u]exiting run", this, m_cfg.type );
 	}
 
@@ -241,7 +304,7 @@ namespace netp {
 		}
 
 		io_do(io_action::NOTIFY_TERMINATING, 0);
-		if (m_io_ctx_count == m_io_ctx_count_before_running) {
+		if (m_io_ctx_count.load(std::memory_order_relaxed) == m_io_ctx_count_before_running) {
 			__do_enter_terminated();
 		}
 	}
@@ -249,7 +312,7 @@ namespace netp {
 	void event_loop::__do_enter_terminated() {
 		//no competitor here, store directly
 		NETP_ASSERT(in_event_loop());
-		NETP_ASSERT(m_io_ctx_count == m_io_ctx_count_before_running);
+		NETP_ASSERT(m_io_ctx_count.load(std::memory_order_relaxed) == m_io_ctx_count_before_running);
 		u8_t terminating = u8_t(loop_state::S_TERMINATING);
 		if (m_state.compare_exchange_strong(terminating, u8_t(loop_state::S_TERMINATED), std::memory_order_acq_rel, std::memory_order_acquire)) {
 			NETP_VERBOSE("[event_loop][%p][%u]__do_enter_terminated done", this, m_cfg.type);
@@ -307,10 +370,34 @@ namespace netp {
 		m_waiting(false),
 		m_state(u8_t(loop_state::S_IDLE)),
 		m_poller(poller),
+		m_channel_rcv_right_size_max(0),
 		m_group(g),
 		m_io_ctx_count(0),
 		m_io_ctx_count_before_running(0), 
 		m_internal_ref_count(0),
+		m_busy_last_active(0),
+		m_busy_budget(i64_t(cfg.busy_poll_us) * 1000LL),
+		m_busy_spinning(false),
+		m_spin_rounds(0),
+		m_sleep_rounds(0),
+		m_load_window_begin(0),
+		m_load_busy_ns(0),
+		m_load_busy(0),
+		m_load_stamp(0),
+		m_stat_rounds(0),
+		m_stat_poll_ns(0),
+		m_stat_task_ns(0),
+		m_stat_io_ns(0),
+		m_stat_tasks(0),
+		m_stat_timers(0),
+		m_stat_io_events(0),
+		m_stat_io_wakeups(0),
+		m_stat_round_tp(0),
+		m_stat_tq_max(0),
+		m_stat_io_events_max(0),
+		m_tq_count(0),
+		m_stat_interrupts(0),
+		m_stat_coalesced(0),
 		m_cfg(cfg),
 		m_dns_hosts(cfg.dns_hosts.begin(), cfg.dns_hosts.end())
 	{
@@ -328,13 +415,41 @@ namespace netp {
 		return m_group;
 	}
 
+	void event_loop::stat(event_loop_stat& st) const {
+		st.rounds = m_stat_rounds.load(std::memory_order_relaxed);
+		st.poll_ns = m_stat_poll_ns.load(std::memory_order_relaxed);
+		st.task_ns = m_stat_task_ns.load(std::memory_order_relaxed);
+		st.io_ns = m_stat_io_ns.load(std::memory_order_relaxed);
+		st.tasks = m_stat_tasks.load(std::memory_order_relaxed);
+		st.timers = m_stat_timers.load(std::memory_order_relaxed);
+		st.io_events = m_stat_io_events.load(std::memory_order_relaxed);
+		st.io_wakeups = m_stat_io_wakeups.load(std::memory_order_relaxed);
+		st.interrupts = m_stat_interrupts.load(std::memory_order_relaxed);
+		st.coalesced = m_stat_coalesced.load(std::memory_order_relaxed);
+		st.spin_rounds = m_spin_rounds.load(std::memory_order_relaxed);
+		st.sleep_rounds = m_sleep_rounds.load(std::memory_order_relaxed);
+		st.round_tp = m_stat_round_tp.load(std::memory_order_relaxed);
+		st.tq_max = m_stat_tq_max.load(std::memory_order_relaxed);
+		st.io_events_max = m_stat_io_events_max.load(std::memory_order_relaxed);
+		st.tq = m_tq_count.load(std::memory_order_relaxed);
+		st.io_ctx = u32_t(m_io_ctx_count.load(std::memory_order_relaxed) - m_io_ctx_count_before_running);
+		const i64_t now = netp::now<std::chrono::nanoseconds, netp::steady_clock_t>().time_since_epoch().count();
+		st.busy = ((now - m_load_stamp.load(std::memory_order_relaxed)) < (NETP_LOOP_LOAD_WINDOW << 1)) ? m_load_busy.load(std::memory_order_relaxed) : 0;
+		st.load = load(now);
+		st.waiting = m_waiting.load(std::memory_order_relaxed);
+	}
+
 	event_loop_group::event_loop_group( event_loop_cfg const& cfg, fn_event_loop_maker_t const& L_maker):
 		m_curr_loop_idx(0),
+		m_snapshot(netp::allocator<event_loop_snapshot>::make()),
+		m_snapshot_epoch(0),
 		m_bye_state(bye_event_loop_state::S_IDLE),
 		m_bye_ref_count(0),
 		m_cfg(cfg),
 		m_fn_loop_maker(L_maker)
 	{
+		m_snapshot_readers[0].store(0, std::memory_order_relaxed);
+		m_snapshot_readers[1].store(0, std::memory_order_relaxed);
 	}
 
 	event_loop_group::~event_loop_group()
@@ -346,10 +461,55 @@ namespace netp {
 			m_bye_ref_count = 0;
 		}
 		NETP_ASSERT(m_bye_event_loop == nullptr);
+		netp::allocator<event_loop_snapshot>::trash(m_snapshot.load(std::memory_order_relaxed));
+	}
+
+	void event_loop_group::__snapshot_update() {
+		event_loop_snapshot* s = netp::allocator<event_loop_snapshot>::make();
+		for (std::size_t i = 0; i < m_loop.size(); ++i) {
+			s->L.push_back(m_loop[i].get());
+		}
+		event_loop_snapshot* replaced = m_snapshot.exchange(s, std::memory_order_seq_cst);
+		__snapshot_synchronize();
+		netp::allocator<event_loop_snapshot>::trash(replaced);
+	}
+
+	//a reader of the replaced snapshot entered either before the flip of its epoch, then we wait for it, or after, then it loads the new one
+	//a late reader of the previous epoch is counted in the other counter, so both are drained
+	void event_loop_group::__snapshot_synchronize() {
+		for (int i = 0; i < 2; ++i) {
+			const u32_t e = m_snapshot_epoch.fetch_add(1, std::memory_order_seq_cst) & 1;
+			int k = 0;
+			while (m_snapshot_readers[e].load(std::memory_order_seq_cst) != 0) {
+				netp::this_thread::no_interrupt_yield(++k);
+			}
+		}
+	}
+
+	void event_loop_group::__bye_launch() {
+		bye_event_loop_state idle = bye_event_loop_state::S_IDLE;
+		if (m_bye_state.compare_exchange_strong(idle, bye_event_loop_state::S_PREPARING, std::memory_order_acq_rel, std::memory_order_acquire)) {
+			NETP_ASSERT(m_bye_event_loop == nullptr, "m_bye_event_loop check failed");
+			NETP_VERBOSE("[event_loop][%u]launch bye begin", m_cfg.type);
+			event_loop_cfg __cfg = m_cfg;
+			__cfg.flag &= ~(f_th_thread_affinity | f_th_priority_above_normal | f_th_priority_time_critical);
+			m_bye_event_loop = m_fn_loop_maker(NRP<event_loop_group>(this), __cfg);
+			int rt = m_bye_event_loop->__launch();
+			NETP_ASSERT(rt == netp::OK);
+			m_bye_ref_count = m_bye_event_loop.ref_count();
+
+			bye_event_loop_state preparing = bye_event_loop_state::S_PREPARING;
+			bool set_to_running = m_bye_state.compare_exchange_strong(preparing, bye_event_loop_state::S_RUNNING, std::memory_order_acq_rel, std::memory_order_acquire);
+			NETP_ASSERT(set_to_running == true);
+			NETP_ASSERT(m_bye_state.load(std::memory_order_relaxed) == bye_event_loop_state::S_RUNNING);
+			NETP_VERBOSE("[event_loop][%u]launch bye end", m_cfg.type);
+		}
 	}
 
 	void event_loop_group::notify_terminating() {
-		shared_lock_guard<shared_mutex> slg(m_loop_mtx);
+		lock_guard<shared_mutex> lg(m_loop_mtx);
+		//next() falls back to the bye loop once it sees a terminating loop
+		__bye_launch();
 		for(::size_t i=0;i<m_loop.size();++i) {
 			m_loop[i]->__notify_terminating();
 		}
@@ -384,36 +544,25 @@ namespace netp {
 				return;//exit
 			}
 
-			bye_event_loop_state idle = bye_event_loop_state::S_IDLE;
-			if (m_bye_state.compare_exchange_strong(idle, bye_event_loop_state::S_PREPARING, std::memory_order_acq_rel, std::memory_order_acquire)) {
-				NETP_ASSERT(m_bye_event_loop == nullptr, "m_bye_event_loop check failed");
-				NETP_VERBOSE("[event_loop][%u]launch bye begin", m_cfg.type);
-				event_loop_cfg __cfg = m_cfg;
-				__cfg.flag &= ~(f_th_thread_affinity | f_th_priority_above_normal | f_th_priority_time_critical);
-				m_bye_event_loop = m_fn_loop_maker(NRP<event_loop_group>(this), __cfg);
-				int rt = m_bye_event_loop->__launch();
-				NETP_ASSERT(rt == netp::OK);
-				m_bye_ref_count = m_bye_event_loop.ref_count();
-
-				bye_event_loop_state preparing = bye_event_loop_state::S_PREPARING;
-				bool set_to_running = m_bye_state.compare_exchange_strong(preparing, bye_event_loop_state::S_RUNNING, std::memory_order_acq_rel, std::memory_order_acquire);
-				NETP_ASSERT(set_to_running == true);
-				NETP_ASSERT(m_bye_state.load(std::memory_order_relaxed) == bye_event_loop_state::S_RUNNING);
-				NETP_VERBOSE("[event_loop][%u]launch bye end", m_cfg.type);
-			}
+			__bye_launch();
 
-			event_loop_vector_t::iterator&& it = m_loop.begin();
-			while (it != m_loop.end()) {
+			for (std::size_t i = 0; i < m_loop.size(); ++i) {
 				//ref_count == internal_ref_count means no other ref for this LOOP, it is safe to deattach it from our pool
-				if ((*it).ref_count() == (*it)->internal_ref_count()) {
-					NETP_VERBOSE("[event_loop][%u]_wait_loop, dattached one event loop", m_cfg.type);
-
-					to_deattach.push_back(*it);
-					m_loop.erase(it);
-					break;
-				} else {
-					++it;
+				if (m_loop[i].ref_count() != m_loop[i]->internal_ref_count()) {
+					continue;
+				}
+				NRP<event_loop> L = m_loop[i];
+				m_loop.erase(m_loop.begin() + i);
+				__snapshot_update();
+				//a next() that had picked L before the update has taken its ref by now
+				if (L.ref_count() != L->internal_ref_count()) {
+					m_loop.insert(m_loop.begin() + i, std::move(L));
+					__snapshot_update();
+					continue;
 				}
+				NETP_VERBOSE("[event_loop][%u]_wait_loop, dattached one event loop", m_cfg.type);
+				to_deattach.push_back(std::move(L));
+				break;
 			}
 		}
 		while (to_deattach.size()) {
@@ -443,7 +592,12 @@ namespace netp {
 				}
 
 				m_bye_event_loop->__terminate();
-				m_bye_event_loop = nullptr;
+				{
+					//__next_bye() copies m_bye_event_loop in the read section
+					lock_guard<shared_mutex> lg(m_loop_mtx);
+					__snapshot_synchronize();
+					m_bye_event_loop = nullptr;
+				}
 				NETP_VERBOSE("[event_loop][%u]wait bye end", m_cfg.type );
 			}
 		}
@@ -464,6 +618,7 @@ namespace netp {
 				o->store_internal_ref_count(o.ref_count());
 				m_loop.emplace_back(std::move(o));
 			}
+			__snapshot_update();
 		}
 
 		void event_loop_group::stop() {
@@ -476,52 +631,142 @@ namespace netp {
 			return netp::size_t(m_loop.size());
 		}
 
-		//if there is a event_loop_group instance, we must always guarantee to return non-null loop instance
-		NRP<event_loop> event_loop_group::next(std::set<NRP<event_loop>> const& exclude_this_list_if_have_more) {
+		event_loop_vector_t event_loop_group::loops() {
+			shared_lock_guard<shared_mutex> lg(m_loop_mtx);
+			return m_loop;
+		}
+
+		void event_loop_group::stat(event_loop_group_stat& st) {
+			st.total = event_loop_stat();
+			st.total.waiting = true;
 			{
 				shared_lock_guard<shared_mutex> lg(m_loop_mtx);
-				if (m_loop.size() > 0) {
-					const std::size_t psize = m_loop.size();
-					if (psize <= exclude_this_list_if_have_more.size()) {
-						//skip one time
-						//u32_t idx = netp::atomic_incre(&m_curr_poller_idx[t]) % psize;
-						//if (exclude_this_list_if_have_more.find(pollers[idx]) == exclude_this_list_if_have_more.end()) {
-						//	return pollers[idx];
-						//}
-						return m_loop[m_curr_loop_idx.fetch_add(1, std::memory_order_relaxed) % psize];
-					}
-					else {
-						u32_t idx = m_curr_loop_idx.fetch_add(1, std::memory_order_relaxed) % psize;
-						while (exclude_this_list_if_have_more.find(m_loop[idx]) != exclude_this_list_if_have_more.end()) {
-							idx = m_curr_loop_idx.fetch_add(1, std::memory_order_relaxed) % psize;
-						}
-						return m_loop[idx];
+				st.L.resize(m_loop.size());
+				for (std::size_t i = 0; i < m_loop.size(); ++i) {
+					m_loop[i]->stat(st.L[i]);
+				}
+			}
+			st.now = netp::now<std::chrono::nanoseconds, netp::steady_clock_t>().time_since_epoch().count();
+
+			event_loop_stat& T = st.total;
+			for (std::size_t i = 0; i < st.L.size(); ++i) {
+				event_loop_stat const& l = st.L[i];
+				T.rounds += l.rounds;
+				T.poll_ns += l.poll_ns;
+				T.task_ns += l.task_ns;
+				T.io_ns += l.io_ns;
+				T.tasks += l.tasks;
+				T.timers += l.timers;
+				T.io_events += l.io_events;
+				T.io_wakeups += l.io_wakeups;
+				T.interrupts += l.interrupts;
+				T.coalesced += l.coalesced;
+				T.spin_rounds += l.spin_rounds;
+				T.sleep_rounds += l.sleep_rounds;
+				T.tq_max = NETP_MAX(T.tq_max, l.tq_max);
+				T.io_events_max = NETP_MAX(T.io_events_max, l.io_events_max);
+				T.tq += l.tq;
+				T.io_ctx += l.io_ctx;
+				T.busy += l.busy;
+				T.load += l.load;
+				if (!l.waiting) {
+					T.round_tp = (T.round_tp == 0) ? l.round_tp : NETP_MIN(T.round_tp, l.round_tp);
+					T.waiting = false;
+				}
+			}
+		}
+
+		//xorshift32 per caller thread, it is never 0 once seeded
+		static __NETP_TLS u32_t __tls_next_seed = 0;
+
+		//the least loaded one of a small group, or the less loaded one of two random loops (power of two choices, refer to https://www.eecs.harvard.edu/~michaelm/postscripts/mythesis.pdf)
+		//ties are broken by the random start
+		event_loop* event_loop_group::__next_by_load(event_loop_snapshot const* s) {
+			u32_t x = __tls_next_seed;
+			if (x == 0) {
+				x = u32_t(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+			}
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			__tls_next_seed = x;
+
+			const u32_t n = u32_t(s->L.size());
+			const u32_t a = x % n;
+			const i64_t now = netp::now<std::chrono::nanoseconds, netp::steady_clock_t>().time_since_epoch().count();
+			if (n <= NETP_LOOP_NEXT_BY_LOAD_SCAN_MAX) {
+				u32_t m = a;
+				u32_t mload = s->L[a]->load(now);
+				for (u32_t i = 1; i < n; ++i) {
+					const u32_t j = (a + i) % n;
+					const u32_t jload = s->L[j]->load(now);
+					if (jload < mload) {
+						m = j;
+						mload = jload;
 					}
 				}
+				return s->L[m];
 			}
-			//as the load might happens on other thread, we need a memory barrier
-			NRP<event_loop> __tmp = m_bye_event_loop;//may a copy first
+			const u32_t b = (a + 1 + ((x >> 16) % (n - 1))) % n;
+			return (s->L[b]->load(now) < s->L[a]->load(now)) ? s->L[b] : s->L[a];
+		}
+
+		//with the snapshot read entered, null if the bye loop is not launched yet
+		NRP<event_loop> event_loop_group::__next_bye() {
 			if (m_bye_state.load(std::memory_order_acquire) != bye_event_loop_state::S_IDLE) {
-				NETP_ASSERT(__tmp != nullptr);
+				NRP<event_loop> __tmp = m_bye_event_loop;
+				NETP_ASSERT(__tmp != nullptr, "m_bye_event_loop check");
 				NETP_VERBOSE("[event_loop][%u]return bye type", m_cfg.type);
 				return __tmp;
 			}
-			NETP_THROW("event_loop_group deinit logic issue");
+			return nullptr;
+		}
+
+		//if there is a event_loop_group instance, we must always guarantee to return non-null loop instance
+		NRP<event_loop> event_loop_group::next(std::set<NRP<event_loop>> const& exclude_this_list_if_have_more) {
+			NRP<event_loop> L;
+			const u32_t e = __snapshot_read_enter();
+			event_loop_snapshot const* s = m_snapshot.load(std::memory_order_seq_cst);
+			const std::size_t psize = s->L.size();
+			if (psize > 0) {
+				u32_t idx = m_curr_loop_idx.fetch_add(1, std::memory_order_relaxed) % psize;
+				if (psize > exclude_this_list_if_have_more.size()) {
+					while (exclude_this_list_if_have_more.find(s->L[idx]) != exclude_this_list_if_have_more.end()) {
+						idx = m_curr_loop_idx.fetch_add(1, std::memory_order_relaxed) % psize;
+					}
+				}
+				if (!__is_terminating(s->L[idx])) {
+					L = s->L[idx];
+				}
+			}
+			if (L == nullptr) {
+				L = __next_bye();
+			}
+			__snapshot_read_leave(e);
+			if (L == nullptr) {
+				NETP_THROW("event_loop_group deinit logic issue");
+			}
+			return L;
 		}
 
 		NRP<event_loop> event_loop_group::next() {
-			{
-				shared_lock_guard<shared_mutex> lg(m_loop_mtx);
-				if (m_loop.size() != 0) {
-					return m_loop[m_curr_loop_idx.fetch_add(1, std::memory_order_relaxed) % m_loop.size()];
+			NRP<event_loop> L;
+			const u32_t e = __snapshot_read_enter();
+			event_loop_snapshot const* s = m_snapshot.load(std::memory_order_seq_cst);
+			const std::size_t psize = s->L.size();
+			if (psize != 0) {
+				event_loop* l = ((psize > 1) && (m_cfg.flag & f_group_next_by_load)) ? __next_by_load(s) : s->L[m_curr_loop_idx.fetch_add(1, std::memory_order_relaxed) % psize];
+				if (!__is_terminating(l)) {
+					L = l;
 				}
 			}
-			NRP<event_loop> __tmp = m_bye_event_loop;//may a copy first
-			if(m_bye_state.load(std::memory_order_acquire) != bye_event_loop_state::S_IDLE) {
-				NETP_ASSERT(__tmp != nullptr, "m_bye_event_loop check");
-				NETP_VERBOSE("[event_loop][%u]return bye type", m_cfg.type);
-				return __tmp;
+			if (L == nullptr) {
+				L = __next_bye();
+			}
+			__snapshot_read_leave(e);
+			if (L == nullptr) {
+				NETP_THROW("event_loop_group deinit logic issue");
 			}
-			NETP_THROW("event_loop_group deinit logic issue");
+			return L;
 		}
 }
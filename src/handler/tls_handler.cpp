@@ -114,7 +114,9 @@ namespace netp { namespace handler {
 		while (m_tls_outlets_user_data.size()) {
 			tls_ch_outlet& outlet = m_tls_outlets_user_data.front();
 			NETP_WARN("[tls_handler]cancel write, nbytes: %u", outlet.data->len());
-			outlet.write_p->set(netp::E_CHANNEL_CLOSED);
+			if (outlet.write_p != nullptr) {
+				outlet.write_p->set(netp::E_CHANNEL_CLOSED);
+			}
 			m_tls_outlets_user_data.pop();
 		}
 
@@ -172,7 +174,12 @@ namespace netp { namespace handler {
 		//we should not get here if f_tls_ch_activated not set
 		NETP_ASSERT((m_flag & (f_tls_ch_activated | f_ch_connected)) == (f_tls_ch_activated | f_ch_connected));
 		if (m_flag & (f_tls_handler_close_called | f_tls_handler_close_write_called | f_ch_closed | f_ch_write_closed)) {
-			chp->set(netp::E_CHANNEL_WRITE_CLOSED);
+			//post_write
+			if (chp == nullptr) {
+				ctx->fire_error(netp::E_CHANNEL_WRITE_CLOSED);
+			} else {
+				chp->set(netp::E_CHANNEL_WRITE_CLOSED);
+			}
 			return;
 		}
 
@@ -319,14 +326,19 @@ namespace netp { namespace handler {
 
 		NETP_ASSERT(m_tls_outlets_user_data.size());
 		tls_ch_outlet& outlet = m_tls_outlets_user_data.front();
-		NETP_ASSERT(outlet.write_p != nullptr);
 
 		//if (--(outlet.record_count) > 0) {
 		//	return;
 		//}
 
-		outlet.write_p->set(code);
+		//nullptr for post_write
+		NRP<netp::promise<int>> write_p = std::move(outlet.write_p);
 		m_tls_outlets_user_data.pop();
+		if (write_p != nullptr) {
+			write_p->set(code);
+		} else if ((code != netp::OK) && (m_ctx != nullptr)) {
+			m_ctx->fire_error(code);
+		}
 		m_flag &= ~(f_tls_ch_writing);
 		//NETP_VERBOSE("[tls]write userdata bytes: %d, code: %d", outlet.data->len(), code);
 
@@ -1,4 +1,5 @@
 #include <netp/handler/websocket.hpp>
+#include <netp/handler/websocket_mask.hpp>
 
 #include <netp/app.hpp>
 #include <netp/channel_handler_context.hpp>
@@ -14,6 +15,7 @@
 #define _H_SEC_WEBSOCKET_VERSION "Sec-WebSocket-Version"
 #define _H_SEC_WEBSOCKET_KEY "Sec-WebSocket-Key"
 #define _H_SEC_WEBSOCKET_ACCEPT "Sec-WebSocket-Accept"
+#define _H_SEC_WEBSOCKET_EXTENSIONS "Sec-WebSocket-Extensions"
 #define _H_WEBSOCKET_SERVER "WebSocket-Server"
 
 #define _WEBSOCKET_UUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
@@ -29,12 +31,6 @@ namespace netp { namespace handler {
 	}
 
 	void websocket::connected(NRP<channel_handler_context> const& ctx) {
-		m_tmp_frame = netp::atomic_shared::make<ws_frame>();
-		m_tmp_frame->appdata = netp::make_ref<packet>();
-		m_tmp_frame->extdata = netp::make_ref<packet>();
-
-		m_tmp_message = netp::make_ref<packet>();
-
 		if (m_type == websocket_type::T_SERVER) {
 			m_state = state::S_WAIT_CLIENT_HANDSHAKE_REQ;
 		} else {
@@ -49,6 +45,17 @@ namespace netp { namespace handler {
 			m_http_parser->cb_reset();
 			m_http_parser = nullptr;
 		}
+		m_decoder.reset();
+		m_tmp_message = nullptr;
+
+		while (!m_deflate_q.empty()) {
+			//post_write queues a null promise, nobody to notify after close
+			if (m_deflate_q.front().chp != nullptr) {
+				m_deflate_q.front().chp->set(netp::E_CHANNEL_CLOSED);
+			}
+			m_deflate_q.pop_front();
+		}
+		m_deflate = nullptr;
 		(void)ctx;
 	}
 
@@ -59,6 +66,11 @@ namespace netp { namespace handler {
 			return;
 		}
 
+		if (m_state == state::S_MESSAGE_BEGIN) {
+			_frame_read(ctx, income);
+			return;
+		}
+
 		m_in_q_nbytes += income->len();
 		m_in_q.push(income);
 		bool bExit = false;
@@ -176,6 +188,7 @@ __label_S_UPGRADE_REQ_MESSAGE_DONE:
 				reply->H->add_header_line(_H_SEC_WEBSOCKET_ACCEPT, string_t(xx, nbytes));
 				reply->H->add_header_line(_H_SEC_WEBSOCKET_VERSION, "13");
 				reply->H->add_header_line(_H_WEBSOCKET_SERVER, __NETP_VERSION_STRING);
+				_deflate_negotiate(reply);
 
 				NRP<packet> outp;
 				reply->encode(outp);
@@ -183,380 +196,274 @@ __label_S_UPGRADE_REQ_MESSAGE_DONE:
 				ctx->write(outp);
 				m_state = state::S_MESSAGE_BEGIN;
 				ctx->fire_connected();
-				if (in->len() == 0) {
+
+				//the bytes right after the upgrade request are frames
+				while (!m_in_q.empty() && m_state == state::S_MESSAGE_BEGIN) {
+					NRP<netp::packet> _in = m_in_q.front();
 					m_in_q.pop();
-					goto _label_CHECK_IN_Q;
+					if (_in->len() != 0) {
+						_frame_read(ctx, _in);
+					}
 				}
-				goto __label_S_MESSAGE_BEGIN;
+				m_in_q_nbytes = 0;
+				return;
 			}
 			break;
-			case state::S_MESSAGE_BEGIN:
-__label_S_MESSAGE_BEGIN:
+			default:
 			{
-				NETP_ASSERT(m_tmp_message != nullptr);
-				m_state = state::S_FRAME_BEGIN;
-				m_fragmented_begin = false;
-				goto __label_S_FRAME_BEGIN;
+				bExit = true;
 			}
-			break;
-			case state::S_FRAME_BEGIN:
-__label_S_FRAME_BEGIN:
-			{
-				static_assert(sizeof(ws_frame::H) == 2, "check ws_frame header size");
-				m_state = state::S_FRAME_READ_H_B1;
-				goto __label_S_FRAME_READ_H_B1;
 			}
-			break;
-			case state::S_FRAME_READ_H_B1:
-__label_S_FRAME_READ_H_B1:
-			{
-				if (m_in_q_nbytes == 0) {
-					bExit = true;
-				} else {
-					m_tmp_frame->H.B1.B = in->read<u8_t>();
-					m_in_q_nbytes -= sizeof(u8_t);
-					m_state = state::S_FRAME_READ_H_B2;
-					if (in->len() == 0) {
-						m_in_q.pop();
-						goto _label_CHECK_IN_Q;
-					}
-					goto __label_FRAME_READ_H_B2;
-				}
-			}
-			break;
-			case state::S_FRAME_READ_H_B2:
-__label_FRAME_READ_H_B2:
-			{
-				if (m_in_q_nbytes == 0) {
-					bExit = true;
-				} else {
-					m_tmp_frame->H.B2.B = in->read<u8_t>();
-					m_in_q_nbytes -= sizeof(u8_t);
-					//@Note: refer to RFC6455
-					//frame with a control opcode would not be fragmented
-					if (m_fragmented_begin == false) {
-						NETP_ASSERT(m_tmp_frame->H.B1.Bit.opcode != 0x0);
-						m_message_opcode = m_tmp_frame->H.B1.Bit.opcode;
-						if (m_tmp_frame->H.B1.Bit.fin == 0) {
-							m_fragmented_begin = true;
-						}
-					}
+		}
+	}
 
-					m_state = state::S_FRAME_READ_PAYLOAD_LEN;
-					if ( (in->len() == 0) && (m_tmp_frame->H.B2.Bit.len == 126 || m_tmp_frame->H.B2.Bit.len == 127) ) {
-						//every time if in->len() reach 0, we have to revisit the queue to get the front one
-						m_in_q.pop();
-						goto _label_CHECK_IN_Q;
-					}
-					goto __label_S_FRAME_READ_PAYLOAD_LEN;
-				}
+	void websocket::_frame_error(NRP<channel_handler_context> const& ctx, int rt) {
+		NETP_WARN("[websocket][#%u]invalid frame: %d, close", ctx->ch->ch_id(), rt);
+		m_close_code = (rt == netp::E_WEBSOCKET_FRAME_TOO_BIG) ? websocket_close_code::C_RECEIVED_MESSAGE_DATA_TOO_BIG : websocket_close_code::C_PROTOCOL_ERROR;
+		close(make_ref<promise<int>>(), ctx);
+		m_state = state::S_CLOSED;
+	}
+
+	void websocket::_frame_read(NRP<channel_handler_context> const& ctx, NRP<packet> const& income) {
+		m_decoder.feed(income);
+
+		ws_frame f;
+		NRP<packet> payload;
+		while (m_state == state::S_MESSAGE_BEGIN) {
+			const int rt = m_decoder.next(f, payload);
+			if (rt == netp::E_WEBSOCKET_FRAME_INCOMPLETE) {
+				return;
+			} else if (rt != netp::OK) {
+				_frame_error(ctx, rt);
+				return;
 			}
-			break;
-			case state::S_FRAME_READ_PAYLOAD_LEN:
-__label_S_FRAME_READ_PAYLOAD_LEN:
-			{
-				//NETP_INFO("<<< %u", income->len());
-				if (m_tmp_frame->H.B2.Bit.len == 126) {
-					if (m_in_q_nbytes >= sizeof(u16_t)) {
-						if (in->len() < sizeof(u16_t)) {
-							NRP<netp::packet> _in = m_in_q.front();
-							m_in_q.pop();
-	#ifdef _NETP_DEBUG
-							NETP_ASSERT(m_in_q.size());
-	#endif
-							m_in_q.front()->write_left(_in->head(), _in->len());
-							goto _label_CHECK_IN_Q;
-						}
-
-						m_tmp_frame->payload_len = in->read<u16_t>();
-						m_in_q_nbytes -= sizeof(u16_t);
-						m_state = state::S_FRAME_READ_MASKING_KEY;
-						if (in->len() == 0) {
-							m_in_q.pop();
-							goto _label_CHECK_IN_Q;
-						}
-						goto __label_S_FRAME_READ_MASKING_KEY;
-					}
-				}
-				else if (m_tmp_frame->H.B2.Bit.len == 127) {
-					if (m_in_q_nbytes >= sizeof(u64_t)) {
-						if (in->len() < sizeof(u64_t)) {
-							NRP<netp::packet> _in = m_in_q.front();
-							m_in_q.pop();
-#ifdef _NETP_DEBUG
-							NETP_ASSERT(m_in_q.size());
-#endif
-							m_in_q.front()->write_left(_in->head(), _in->len());
-							goto _label_CHECK_IN_Q;
-						}
-
-						m_tmp_frame->payload_len = in->read<u64_t>();
-						m_in_q_nbytes -= sizeof(u64_t);
-						m_state = state::S_FRAME_READ_MASKING_KEY;
-						if (in->len() == 0) {
-							m_in_q.pop();
-							goto _label_CHECK_IN_Q;
-						}
-						goto __label_S_FRAME_READ_MASKING_KEY;
-					}
-				}
-				else {
-					m_tmp_frame->payload_len = m_tmp_frame->H.B2.Bit.len;
-					m_state = state::S_FRAME_READ_MASKING_KEY;
-					if (in->len() == 0) {
-						m_in_q.pop();
-						goto _label_CHECK_IN_Q;
-					}
-					goto __label_S_FRAME_READ_MASKING_KEY;
-				}
-				bExit = true;
+
+			//@refer to https://tools.ietf.org/html/rfc6455#page-27
+			//for message from server, mask would be 0
+			if (m_type == websocket_type::T_SERVER && f.H.B2.Bit.mask == 0) {
+				_frame_error(ctx, netp::E_WEBSOCKET_FRAME_PROTOCOL_ERROR);
+				return;
 			}
-			break;
-			case state::S_FRAME_READ_MASKING_KEY:
-__label_S_FRAME_READ_MASKING_KEY:
-			{
-				//@refer to https://tools.ietf.org/html/rfc6455#page-27
-				//for message from server, mask would be 0
-
-				if (m_type == websocket_type::T_SERVER) {
-					if (m_tmp_frame->H.B2.Bit.mask == 0) {
-						//invalid request
-						close(make_ref<promise<int>>(), ctx);
-						m_state = state::S_CLOSED;
-						return;
-					}
 
-					if (m_in_q_nbytes >= sizeof(u32_t)) {
-						if (in->len() < sizeof(u32_t)) {
-							NRP<netp::packet> _in = m_in_q.front();
-							m_in_q.pop();
-#ifdef _NETP_DEBUG
-							NETP_ASSERT(m_in_q.size());
-#endif
-							m_in_q.front()->write_left(_in->head(), _in->len());
-							goto _label_CHECK_IN_Q;
-						}
-
-						const u32_t key = in->read<u32_t>();
-						m_in_q_nbytes -= sizeof(u32_t);
-						m_tmp_frame->masking_key_arr[0] = (key >> 24) & 0xff;
-						m_tmp_frame->masking_key_arr[1] = (key >> 16) & 0xff;
-						m_tmp_frame->masking_key_arr[2] = (key >> 8) & 0xff;
-						m_tmp_frame->masking_key_arr[3] = (key) & 0xff;
-
-						if (m_tmp_frame->payload_len == 0) {
-							m_state = state::S_FRAME_END;
-							goto __label_S_FRAME_END;
-						} else {
-							m_state = state::S_FRAME_READ_PAYLOAD;
-							if (in->len() == 0) {
-								m_in_q.pop();
-								goto _label_CHECK_IN_Q;
-							}
-							goto __label_S_FRAME_READ_PAYLOAD;
-						}
-					}
-					bExit = true;
+			switch (f.H.B1.Bit.opcode) {
+			case OP_TEXT:
+			case OP_BINARY:
+			{
+				if (m_fragmented_begin) {
+					_frame_error(ctx, netp::E_WEBSOCKET_FRAME_PROTOCOL_ERROR);
+					return;
 				}
-				else {
-					m_state = state::S_FRAME_READ_PAYLOAD;
-					goto __label_S_FRAME_READ_PAYLOAD;
+				m_message_opcode = f.H.B1.Bit.opcode;
+				m_message_compressed = (f.H.B1.Bit.rsv1 == 0x1);
+				if (f.H.B1.Bit.fin == 0x1) {
+					//unfragmented, the payload goes up as it is
+					_message_read(ctx, payload);
+				} else {
+					m_fragmented_begin = true;
+					m_tmp_message = netp::make_ref<packet>(payload->len());
+					m_tmp_message->write(payload->head(), payload->len());
 				}
 			}
 			break;
-			case state::S_FRAME_READ_PAYLOAD:
-__label_S_FRAME_READ_PAYLOAD:
+			case OP_CONTINUE:
 			{
-				const u32_t remaining_nbytes = (m_tmp_frame->payload_len - m_tmp_frame->appdata->len());
-				if (m_in_q_nbytes < remaining_nbytes) {
-					bExit = true;
+				if (!m_fragmented_begin) {
+					_frame_error(ctx, netp::E_WEBSOCKET_FRAME_PROTOCOL_ERROR);
 					return;
 				}
-
-				if (m_tmp_frame->H.B2.Bit.mask == 0x1) {
-					u32_t i = 0;
-					while (i < remaining_nbytes) {
-						const u8_t _byte = (*((netp::u8_t*)in->head() + (i)) ^ m_tmp_frame->masking_key_arr[i % 4]);
-						++i;
-						m_tmp_frame->appdata->write<u8_t>(_byte);
-					}
+				if ((u64_t(m_tmp_message->len()) + payload->len()) > NETP_WEBSOCKET_MESSAGE_MAX) {
+					_frame_error(ctx, netp::E_WEBSOCKET_FRAME_TOO_BIG);
+					return;
 				}
-				else {
-					m_tmp_frame->appdata->write(in->head(), remaining_nbytes);
+				m_tmp_message->write(payload->head(), payload->len());
+				if (f.H.B1.Bit.fin == 0x1) {
+					NETP_ASSERT(m_message_opcode == OP_BINARY || m_message_opcode == OP_TEXT);
+					m_fragmented_begin = false;
+					NRP<netp::packet> _m_tmp_message;
+					_m_tmp_message.swap(m_tmp_message);
+					_message_read(ctx, _m_tmp_message);
 				}
-
-				m_in_q_nbytes -= remaining_nbytes;
-				in->skip(remaining_nbytes);
-				m_state = state::S_FRAME_END;
-				goto __label_S_FRAME_END;
 			}
 			break;
-			case state::S_FRAME_END:
-__label_S_FRAME_END:
+			case OP_CLOSE:
 			{
-				//NO EXT SUPPORT NOW
-				NETP_ASSERT(m_tmp_frame->H.B1.Bit.rsv1 == 0);
-				NETP_ASSERT(m_tmp_frame->H.B1.Bit.rsv2 == 0);
-				NETP_ASSERT(m_tmp_frame->H.B1.Bit.rsv3 == 0);
-
-				switch (m_tmp_frame->H.B1.Bit.opcode) {
-				case OP_CLOSE:
-				{
-					//reply a CLOSE, then do ctx->close();
-					NETP_VERBOSE("<<< op_close");
-					m_state = state::S_FRAME_CLOSE_RECEIVED;
-					close(make_ref<promise<int>>(), ctx);
-					goto __label_S_FRAME_CLOSE_RECEIVED;
-				}
-				break;
-				case OP_PING:
-				{
-					//reply a PONG
-					NSP<ws_frame> _PONG = netp::atomic_shared::make<ws_frame>();
-					_PONG->H.B1.Bit.fin = 0x1;
-					_PONG->H.B1.Bit.rsv1 = 0x0;
-					_PONG->H.B1.Bit.rsv2 = 0x0;
-					_PONG->H.B1.Bit.rsv3 = 0x0;
-					_PONG->H.B1.Bit.opcode = OP_PONG;
-
-					_PONG->H.B2.Bit.mask = 0x0;
-					_PONG->H.B2.Bit.len = m_tmp_frame->appdata->len();
-					_PONG->appdata = m_tmp_frame->appdata;
-
-					NRP<packet> outp_PONG = netp::make_ref<packet>();
-					outp_PONG->write<u8_t>(_PONG->H.B1.B);
-					outp_PONG->write<u8_t>(_PONG->H.B2.B);
-
-					outp_PONG->write(m_tmp_frame->appdata->head(), m_tmp_frame->appdata->len());
-					m_tmp_frame->appdata->reset();
-
-					ctx->write(outp_PONG);
-					m_state = state::S_FRAME_BEGIN;
-					if (in->len() == 0) {
-						m_in_q.pop();
-						goto _label_CHECK_IN_Q;
-					}
-					goto __label_S_FRAME_BEGIN;
-				}
-				break;
-				case OP_PONG:
-				{
-					//ignore right now
-					m_state = state::S_FRAME_BEGIN;
-					if (in->len() == 0) {
-						m_in_q.pop();
-						goto _label_CHECK_IN_Q;
-					}
-					goto __label_S_FRAME_BEGIN;
-				}
-				break;
-				case OP_TEXT:
-				case OP_BINARY:
-				case OP_CONTINUE:
-				{
-					NETP_ASSERT(m_tmp_frame->payload_len == m_tmp_frame->appdata->len());
-					NETP_ASSERT(m_tmp_message->len() == 0);
-					m_tmp_message.swap(m_tmp_frame->appdata);
-
-					if (m_tmp_frame->H.B1.Bit.fin == 0x1) {
-						m_state = state::S_MESSAGE_END;
-						goto __label_S_MESSAGE_END;
-					} else {
-						m_state = state::S_FRAME_BEGIN;
-						if (in->len() == 0) {
-							m_in_q.pop();
-							goto _label_CHECK_IN_Q;
-						}
-						goto __label_S_FRAME_BEGIN;
-					}
-				}
-				break;
-				case OP_X3:
-				case OP_X4:
-				case OP_X5:
-				case OP_X6:
-				case OP_X7:
-				case OP_B:
-				case OP_C:
-				case OP_D:
-				case OP_E:
-				case OP_F:
-				{
-					//reply a CLOSE, then do ctx->close();
-					NETP_WARN("<<< op_not_supported");
-					close(make_ref<promise<int>>(), ctx);
-				}
-				break;
-				default:
-				{
-					//reply a CLOSE, then do ctx->close();
-					NETP_WARN("<<< op_unknown");
-					close(make_ref<promise<int>>(), ctx);
-				}
-				}
+				//reply a CLOSE, then do ctx->close();
+				NETP_VERBOSE("<<< op_close");
+				m_state = state::S_FRAME_CLOSE_RECEIVED;
+				close(make_ref<promise<int>>(), ctx);
 			}
 			break;
-			case state::S_MESSAGE_END:
-__label_S_MESSAGE_END:
+			case OP_PING:
 			{
-				NETP_ASSERT(m_message_opcode == OP_BINARY || m_message_opcode == OP_TEXT);
-				NRP<netp::packet> _m_tmp_message = netp::make_ref<netp::packet>();
-				_m_tmp_message.swap(m_tmp_message);
-				ctx->fire_read(_m_tmp_message);
-				m_state = state::S_MESSAGE_BEGIN;
-				if (in->len() == 0) {
-					m_in_q.pop();
-					goto _label_CHECK_IN_Q;
-				}
-				goto __label_S_MESSAGE_BEGIN;
+				//reply a PONG with the payload of the PING, the header is written into its headroom
+				ws_frame _PONG;
+				_PONG.H.B1.B = 0;
+				_PONG.H.B1.Bit.fin = 0x1;
+				_PONG.H.B1.Bit.opcode = OP_PONG;
+				_PONG.H.B2.B = 0;
+				_PONG.H.B2.Bit.len = u8_t(payload->len());
+
+				payload->write_left<u8_t>(_PONG.H.B2.B);
+				payload->write_left<u8_t>(_PONG.H.B1.B);
+				ctx->write(payload);
 			}
 			break;
-			case state::S_FRAME_CLOSE_RECEIVED:
-__label_S_FRAME_CLOSE_RECEIVED:
+			case OP_PONG:
 			{
-				bExit = true;
-				/*exit point*/
+				//ignore right now
 			}
 			break;
+			default:
+			{
+				//reply a CLOSE, then do ctx->close();
+				NETP_WARN("<<< op_not_supported: %u", f.H.B1.Bit.opcode);
+				close(make_ref<promise<int>>(), ctx);
+				m_state = state::S_CLOSED;
+			}
 			}
 		}
 	}
 
+	void websocket::_message_read(NRP<channel_handler_context> const& ctx, NRP<packet> const& message) {
+		if (!m_message_compressed) {
+			ctx->fire_read(message);
+			return;
+		}
+		NETP_ASSERT(m_deflate != nullptr);
+		NRP<packet> inflated;
+		const int rt = m_deflate->decompress(message->head(), message->len(), inflated, NETP_WEBSOCKET_MESSAGE_MAX);
+		if (rt != netp::OK) {
+			_frame_error(ctx, rt);
+			return;
+		}
+		ctx->fire_read(inflated);
+	}
 
-	void websocket::write(NRP<promise<int>> const& chp,NRP<channel_handler_context> const& ctx, NRP<packet> const& outlet) {
+	void websocket::_deflate_negotiate(NRP<netp::http::message> const& reply) {
+		if (m_deflate_cfg.codec_maker == nullptr || !m_upgrade_req->H->have(_H_SEC_WEBSOCKET_EXTENSIONS)) {
+			return;
+		}
+		websocket_deflate_params params;
+		string_t ext;
+		const int rt = websocket_deflate_negotiate(m_deflate_cfg, m_upgrade_req->H->get(_H_SEC_WEBSOCKET_EXTENSIONS), params, ext);
+		if (rt != netp::OK) {
+			NETP_VERBOSE("[websocket]extension declined: %s", m_upgrade_req->H->get(_H_SEC_WEBSOCKET_EXTENSIONS).c_str());
+			return;
+		}
 
-		NSP<ws_frame> _frame = netp::atomic_shared::make<ws_frame>();
-		_frame->H.B1.Bit.fin = 0x1;
-		_frame->H.B1.Bit.rsv1 = 0x0;
-		_frame->H.B1.Bit.rsv2 = 0x0;
-		_frame->H.B1.Bit.rsv3 = 0x0;
-		_frame->H.B1.Bit.opcode = m_message_opcode;
+		NETP_ASSERT(m_type == websocket_type::T_SERVER);
+		const websocket_deflate_codec_cfg ccfg = { params.server_max_window_bits, params.server_no_context_takeover, params.client_max_window_bits, params.client_no_context_takeover, params.mem_level };
+		m_deflate = m_deflate_cfg.codec_maker(ccfg);
+		if (m_deflate == nullptr) {
+			return;
+		}
+		m_decoder.allow_rsv1(true);
+		reply->H->add_header_line(_H_SEC_WEBSOCKET_EXTENSIONS, ext);
+	}
 
+	void websocket::write(NRP<promise<int>> const& chp,NRP<channel_handler_context> const& ctx, NRP<packet> const& outlet) {
 		NETP_ASSERT(ctx->L->in_event_loop());
 
+		if (m_deflate == nullptr || (m_deflate_q.empty() && outlet->len() < m_deflate_cfg.threshold)) {
+			_frame_write(chp, ctx, outlet, m_message_opcode, false);
+			return;
+		}
+
+		//keep the order of messages if any of them is being compressed off the loop
+		m_deflate_q.push_back({ chp, outlet, m_message_opcode });
+		_deflate_write(ctx);
+	}
+
+	void websocket::_deflate_write(NRP<channel_handler_context> const& ctx) {
+		while (!m_deflate_offloading && !m_deflate_q.empty()) {
+			deflate_outbound_entry& e = m_deflate_q.front();
+			if (e.outlet->len() < m_deflate_cfg.threshold) {
+				_frame_write(e.chp, ctx, e.outlet, e.opcode, false);
+				m_deflate_q.pop_front();
+				continue;
+			}
+
+			if (m_deflate_cfg.offload != nullptr && e.outlet->len() >= m_deflate_cfg.offload_threshold) {
+				//the codec is used by one message at a time, the result is posted back to the loop
+				m_deflate_offloading = true;
+				m_deflate_cfg.offload([ws = NRP<websocket>(this), ctx, codec = m_deflate, in = e.outlet]() {
+					NRP<packet> out;
+					const int rt = codec->compress(in->head(), in->len(), out);
+					ctx->L->execute([ws, ctx, rt, out]() {
+						ws->_deflate_offload_done(ctx, rt, out);
+					});
+				});
+				return;
+			}
+
+			NRP<packet> out;
+			const int rt = m_deflate->compress(e.outlet->head(), e.outlet->len(), out);
+			if (rt != netp::OK) {
+				_deflate_write_failed(e.chp, ctx, rt);
+			} else {
+				_frame_write(e.chp, ctx, out, e.opcode, true);
+			}
+			m_deflate_q.pop_front();
+		}
+	}
+
+	void websocket::_deflate_offload_done(NRP<channel_handler_context> const& ctx, int rt, NRP<packet> const& out) {
+		m_deflate_offloading = false;
+		if (m_deflate_q.empty()) {
+			//closed
+			return;
+		}
+		deflate_outbound_entry e = m_deflate_q.front();
+		m_deflate_q.pop_front();
+		if (rt != netp::OK) {
+			_deflate_write_failed(e.chp, ctx, rt);
+		} else {
+			_frame_write(e.chp, ctx, out, e.opcode, true);
+		}
+		_deflate_write(ctx);
+	}
+
+	void websocket::_deflate_write_failed(NRP<promise<int>> const& chp, NRP<channel_handler_context> const& ctx, int rt) {
+		//post_write
+		if (chp == nullptr) {
+			ctx->fire_error(rt);
+		} else {
+			chp->set(rt);
+		}
+	}
+
+	void websocket::_frame_write(NRP<promise<int>> const& chp, NRP<channel_handler_context> const& ctx, NRP<packet> const& outlet, u8_t opcode, bool compressed) {
+
+		ws_frame _frame;
+		_frame.H.B1.B = 0;
+		_frame.H.B1.Bit.fin = 0x1;
+		_frame.H.B1.Bit.rsv1 = compressed ? 0x1 : 0x0;
+		_frame.H.B1.Bit.opcode = opcode;
+		_frame.H.B2.B = 0;
+
 		if (m_type == websocket_type::T_SERVER) {
-			_frame->H.B2.Bit.mask = 0x0;
+			_frame.H.B2.Bit.mask = 0x0;
 		} else {
 			NETP_TODO("client not supported right now");
 		}
 
 		if (outlet->len() > 0xFFFF) {
-			_frame->H.B2.Bit.len = 0x7F;
-			outlet->write_left<u64_t>(outlet->len());
-			outlet->write_left<u8_t>( _frame->H.B2.B );
-			outlet->write_left<u8_t>(_frame->H.B1.B);
+			_frame.H.B2.Bit.len = 0x7F;
+			outlet->write_left<u64_t, netp::bytes_helper::big_endian>(outlet->len());
+			outlet->write_left<u8_t>(_frame.H.B2.B);
+			outlet->write_left<u8_t>(_frame.H.B1.B);
 		}
 		else if (outlet->len() > 0x7D) {
 			NETP_ASSERT(outlet->len() <= 0xFFFF);
-			_frame->H.B2.Bit.len = 0x7E;
-			outlet->write_left<u16_t>(outlet->len()&0xFFFF);
-			outlet->write_left<u8_t>(_frame->H.B2.B);
-			outlet->write_left<u8_t>(_frame->H.B1.B);
+			_frame.H.B2.Bit.len = 0x7E;
+			outlet->write_left<u16_t, netp::bytes_helper::big_endian>(outlet->len()&0xFFFF);
+			outlet->write_left<u8_t>(_frame.H.B2.B);
+			outlet->write_left<u8_t>(_frame.H.B1.B);
 		}
 		else {
-			_frame->H.B2.Bit.len = outlet->len();
-			outlet->write_left<u8_t>(_frame->H.B2.B);
-			outlet->write_left<u8_t>(_frame->H.B1.B);
+			_frame.H.B2.Bit.len = outlet->len();
+			outlet->write_left<u8_t>(_frame.H.B2.B);
+			outlet->write_left<u8_t>(_frame.H.B1.B);
 		}
 
 		ctx->write(chp,outlet);
@@ -570,19 +477,15 @@ __label_S_FRAME_CLOSE_RECEIVED:
 			return;
 		}
 
-		NSP<ws_frame> _CLOSE = netp::atomic_shared::make<ws_frame>();
-		_CLOSE->H.B1.Bit.fin = 0x1;
-		_CLOSE->H.B1.Bit.rsv1 = 0x0;
-		_CLOSE->H.B1.Bit.rsv2 = 0x0;
-		_CLOSE->H.B1.Bit.rsv3 = 0x0;
-		_CLOSE->H.B1.Bit.opcode = OP_CLOSE;
-
-		_CLOSE->H.B2.Bit.mask = 0x0;
-		_CLOSE->H.B2.Bit.len = 0x0;
+		ws_frame _CLOSE;
+		_CLOSE.H.B1.B = 0;
+		_CLOSE.H.B1.Bit.fin = 0x1;
+		_CLOSE.H.B1.Bit.opcode = OP_CLOSE;
+		_CLOSE.H.B2.B = 0;
 
 		NRP<packet> outp_CLOSE = netp::make_ref<packet>();
-		outp_CLOSE->write<u8_t>( _CLOSE->H.B1.B );
-		outp_CLOSE->write<u8_t>( _CLOSE->H.B2.B );
+		outp_CLOSE->write<u8_t>( _CLOSE.H.B1.B );
+		outp_CLOSE->write<u8_t>( _CLOSE.H.B2.B );
 
 		chp->if_done([ctx](int const&) {
 			ctx->close();
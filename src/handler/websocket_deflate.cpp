@@ -0,0 +1,294 @@
+#include <netp/handler/websocket_deflate.hpp>
+
+#ifdef NETP_WITH_ZLIB
+	#include <zlib.h>
+#endif
+
+namespace netp { namespace handler {
+
+	//zlib could not make a raw deflate stream of 8 bits window
+	static const u8_t WEBSOCKET_DEFLATE_WINDOW_BITS_MIN = 9;
+	static const u8_t WEBSOCKET_DEFLATE_WINDOW_BITS_MAX = 15;
+
+	u32_t websocket_deflate_memory(websocket_deflate_codec_cfg const& cfg) {
+		//deflate: (1 << (windowBits+2)) + (1 << (memLevel+9)), inflate: (1 << windowBits) + about 7KB
+		const u32_t deflate_mem = (1u << (cfg.deflate_window_bits + 2)) + (1u << (cfg.mem_level + 9)) + 6 * 1024;
+		const u32_t inflate_mem = (1u << cfg.inflate_window_bits) + 7 * 1024;
+		return deflate_mem + inflate_mem;
+	}
+
+	static string_t __ext_trim(string_t const& s) {
+		string_t::size_type b = 0;
+		string_t::size_type e = s.length();
+		while (b < e && (s[b] == ' ' || s[b] == '\t')) { ++b; }
+		while (e > b && (s[e - 1] == ' ' || s[e - 1] == '\t')) { --e; }
+		return s.substr(b, e - b);
+	}
+
+	struct websocket_deflate_offer {
+		bool server_no_context_takeover;
+		bool client_no_context_takeover;
+		u8_t server_max_window_bits; //0 for absent
+		bool client_max_window_bits_present;
+		u8_t client_max_window_bits; //0 for absent or no value
+
+		websocket_deflate_offer() :
+			server_no_context_takeover(false),
+			client_no_context_takeover(false),
+			server_max_window_bits(0),
+			client_max_window_bits_present(false),
+			client_max_window_bits(0)
+		{}
+	};
+
+	static int __window_bits_parse(string_t const& v, u8_t& bits) {
+		if (v.length() == 0 || v.length() > 2 || v[0] < '1' || v[0] > '9' || (v.length() == 2 && (v[1] < '0' || v[1] > '9'))) {
+			return netp::E_WEBSOCKET_EXTENSION_DECLINED;
+		}
+		const u32_t n = netp::to_u32(v.c_str());
+		if (n < 8 || n > WEBSOCKET_DEFLATE_WINDOW_BITS_MAX) {
+			return netp::E_WEBSOCKET_EXTENSION_DECLINED;
+		}
+		bits = u8_t(n);
+		return netp::OK;
+	}
+
+	//refer to https://tools.ietf.org/html/rfc7692#section-7.1, an unknown or duplicated param declines the offer
+	static int __offer_parse(std::vector<string_t, netp::allocator<string_t>> const& params, websocket_deflate_offer& o) {
+		bool server_max_window_bits_present = false;
+		for (::size_t i = 1; i < params.size(); ++i) {
+			string_t k = __ext_trim(params[i]);
+			string_t v;
+			bool has_v = false;
+			const string_t::size_type eq = k.find('=');
+			if (eq != string_t::npos) {
+				v = __ext_trim(k.substr(eq + 1));
+				k = __ext_trim(k.substr(0, eq));
+				if (v.length() >= 2 && v[0] == '"' && v[v.length() - 1] == '"') {
+					v = v.substr(1, v.length() - 2);
+				}
+				has_v = true;
+			}
+
+			if (k == "server_no_context_takeover") {
+				if (has_v || o.server_no_context_takeover) { return netp::E_WEBSOCKET_EXTENSION_DECLINED; }
+				o.server_no_context_takeover = true;
+			} else if (k == "client_no_context_takeover") {
+				if (has_v || o.client_no_context_takeover) { return netp::E_WEBSOCKET_EXTENSION_DECLINED; }
+				o.client_no_context_takeover = true;
+			} else if (k == "server_max_window_bits") {
+				if (!has_v || server_max_window_bits_present || __window_bits_parse(v, o.server_max_window_bits) != netp::OK) { return netp::E_WEBSOCKET_EXTENSION_DECLINED; }
+				server_max_window_bits_present = true;
+			} else if (k == "client_max_window_bits") {
+				if (o.client_max_window_bits_present) { return netp::E_WEBSOCKET_EXTENSION_DECLINED; }
+				if (has_v && __window_bits_parse(v, o.client_max_window_bits) != netp::OK) { return netp::E_WEBSOCKET_EXTENSION_DECLINED; }
+				o.client_max_window_bits_present = true;
+			} else {
+				return netp::E_WEBSOCKET_EXTENSION_DECLINED;
+			}
+		}
+		return netp::OK;
+	}
+
+	static int __offer_accept(websocket_deflate_cfg const& cfg, websocket_deflate_offer const& o, websocket_deflate_params& params, string_t& response) {
+		u8_t sw = NETP_MIN(NETP_MAX(cfg.server_max_window_bits, WEBSOCKET_DEFLATE_WINDOW_BITS_MIN), WEBSOCKET_DEFLATE_WINDOW_BITS_MAX);
+		if (o.server_max_window_bits != 0) {
+			if (o.server_max_window_bits < WEBSOCKET_DEFLATE_WINDOW_BITS_MIN) {
+				return netp::E_WEBSOCKET_EXTENSION_DECLINED;
+			}
+			sw = NETP_MIN(sw, o.server_max_window_bits);
+		}
+
+		//the client uses 15 bits unless it takes client_max_window_bits
+		u8_t cw = WEBSOCKET_DEFLATE_WINDOW_BITS_MAX;
+		if (o.client_max_window_bits_present) {
+			cw = NETP_MIN(NETP_MAX(cfg.client_max_window_bits, WEBSOCKET_DEFLATE_WINDOW_BITS_MIN), WEBSOCKET_DEFLATE_WINDOW_BITS_MAX);
+			if (o.client_max_window_bits != 0) {
+				//the response must not exceed the offer, refer to https://tools.ietf.org/html/rfc7692#section-7.1.2.2
+				if (o.client_max_window_bits < WEBSOCKET_DEFLATE_WINDOW_BITS_MIN) {
+					return netp::E_WEBSOCKET_EXTENSION_DECLINED;
+				}
+				cw = NETP_MIN(cw, o.client_max_window_bits);
+			}
+		}
+
+		websocket_deflate_codec_cfg ccfg = { sw, false, cw, false, NETP_MIN(NETP_MAX(cfg.mem_level, u8_t(1)), u8_t(9)) };
+		//lower the bigger one of the deflate window and the deflate hash first, a smaller deflate window is always safe for the peer
+		while (websocket_deflate_memory(ccfg) > cfg.memory_max) {
+			if (ccfg.mem_level > 1 && (ccfg.mem_level + 9) >= (ccfg.deflate_window_bits + 2)) {
+				--ccfg.mem_level;
+			} else if (ccfg.deflate_window_bits > WEBSOCKET_DEFLATE_WINDOW_BITS_MIN) {
+				--ccfg.deflate_window_bits;
+			} else if (o.client_max_window_bits_present && ccfg.inflate_window_bits > WEBSOCKET_DEFLATE_WINDOW_BITS_MIN) {
+				--ccfg.inflate_window_bits;
+			} else if (ccfg.mem_level > 1) {
+				--ccfg.mem_level;
+			} else {
+				return netp::E_WEBSOCKET_EXTENSION_DECLINED;
+			}
+		}
+
+		params.server_no_context_takeover = o.server_no_context_takeover || cfg.server_no_context_takeover;
+		params.client_no_context_takeover = o.client_no_context_takeover || cfg.client_no_context_takeover;
+		params.server_max_window_bits = ccfg.deflate_window_bits;
+		params.client_max_window_bits = ccfg.inflate_window_bits;
+		params.mem_level = ccfg.mem_level;
+
+		response = "permessage-deflate";
+		if (params.server_no_context_takeover) {
+			response += "; server_no_context_takeover";
+		}
+		if (params.client_no_context_takeover) {
+			response += "; client_no_context_takeover";
+		}
+		if (o.server_max_window_bits != 0) {
+			response += "; server_max_window_bits=" + netp::to_string(u32_t(params.server_max_window_bits));
+		}
+		if (o.client_max_window_bits_present) {
+			response += "; client_max_window_bits=" + netp::to_string(u32_t(params.client_max_window_bits));
+		}
+		return netp::OK;
+	}
+
+	int websocket_deflate_negotiate(websocket_deflate_cfg const& cfg, string_t const& offers, websocket_deflate_params& params, string_t& response) {
+		if (cfg.codec_maker == nullptr) {
+			return netp::E_WEBSOCKET_EXTENSION_DECLINED;
+		}
+
+		std::vector<string_t, netp::allocator<string_t>> exts;
+		netp::split(offers, string_t(","), exts);
+		for (::size_t i = 0; i < exts.size(); ++i) {
+			std::vector<string_t, netp::allocator<string_t>> ext_params;
+			netp::split(exts[i], string_t(";"), ext_params);
+			if (ext_params.size() == 0 || __ext_trim(ext_params[0]) != "permessage-deflate") {
+				continue;
+			}
+			websocket_deflate_offer o;
+			if (__offer_parse(ext_params, o) != netp::OK) {
+				continue;
+			}
+			if (__offer_accept(cfg, o, params, response) == netp::OK) {
+				return netp::OK;
+			}
+		}
+		return netp::E_WEBSOCKET_EXTENSION_DECLINED;
+	}
+
+#ifdef NETP_WITH_ZLIB
+	class websocket_deflate_zlib final :
+		public websocket_deflate_codec
+	{
+		websocket_deflate_codec_cfg m_cfg;
+		z_stream m_d;
+		z_stream m_i;
+		//the streams are made on the first message of each direction
+		bool m_d_inited;
+		bool m_i_inited;
+
+	public:
+		websocket_deflate_zlib(websocket_deflate_codec_cfg const& cfg) :
+			m_cfg(cfg),
+			m_d_inited(false),
+			m_i_inited(false)
+		{
+			std::memset(&m_d, 0, sizeof(m_d));
+			std::memset(&m_i, 0, sizeof(m_i));
+		}
+
+		~websocket_deflate_zlib() {
+			if (m_d_inited) {
+				::deflateEnd(&m_d);
+			}
+			if (m_i_inited) {
+				::inflateEnd(&m_i);
+			}
+		}
+
+		int compress(byte_t const* in, u32_t len, NRP<packet>& out) override {
+			if (!m_d_inited) {
+				if (::deflateInit2(&m_d, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -int(m_cfg.deflate_window_bits), m_cfg.mem_level, Z_DEFAULT_STRATEGY) != Z_OK) {
+					return netp::E_WEBSOCKET_DEFLATE_FAILED;
+				}
+				m_d_inited = true;
+			}
+
+			out = netp::make_ref<packet>(u32_t(::deflateBound(&m_d, len)) + 16);
+			m_d.next_in = (Bytef*)in;
+			m_d.avail_in = len;
+			do {
+				out->reserve(NETP_MAX(out->len(), u32_t(64)));
+				const u32_t cap = out->left_right_capacity();
+				m_d.next_out = (Bytef*)out->tail();
+				m_d.avail_out = cap;
+				const int rt = ::deflate(&m_d, Z_SYNC_FLUSH);
+				if (rt != Z_OK && rt != Z_BUF_ERROR) {
+					return netp::E_WEBSOCKET_DEFLATE_FAILED;
+				}
+				out->incre_write_idx(cap - m_d.avail_out);
+			} while (m_d.avail_out == 0);
+
+			//a sync flush ends with an empty stored block
+			NETP_ASSERT(out->len() >= 4 && out->tail()[-1] == 0xff && out->tail()[-2] == 0xff && out->tail()[-3] == 0 && out->tail()[-4] == 0);
+			out->decre_write_idx(4);
+			if (m_cfg.deflate_no_context_takeover) {
+				::deflateReset(&m_d);
+			}
+			return netp::OK;
+		}
+
+		int decompress(byte_t const* in, u32_t len, NRP<packet>& out, u32_t max) override {
+			if (!m_i_inited) {
+				if (::inflateInit2(&m_i, -int(m_cfg.inflate_window_bits)) != Z_OK) {
+					return netp::E_WEBSOCKET_DEFLATE_FAILED;
+				}
+				m_i_inited = true;
+			}
+
+			static const byte_t __sync_tail[4] = { 0x00, 0x00, 0xff, 0xff };
+			byte_t const* const src[2] = { in, __sync_tail };
+			const u32_t src_len[2] = { len, 4 };
+
+			out = netp::make_ref<packet>(u32_t(NETP_MIN(u64_t(len) * 4 + 64, u64_t(max) + 64)));
+			int rt = Z_OK;
+			for (u32_t i = 0; i < 2 && rt != Z_STREAM_END; ++i) {
+				m_i.next_in = (Bytef*)src[i];
+				m_i.avail_in = src_len[i];
+				do {
+					out->reserve(NETP_MAX(out->len(), u32_t(64)));
+					const u32_t cap = out->left_right_capacity();
+					m_i.next_out = (Bytef*)out->tail();
+					m_i.avail_out = cap;
+					rt = ::inflate(&m_i, Z_SYNC_FLUSH);
+					out->incre_write_idx(cap - m_i.avail_out);
+					if (out->len() > max) {
+						::inflateReset(&m_i);
+						return netp::E_WEBSOCKET_FRAME_TOO_BIG;
+					}
+					if (rt == Z_STREAM_END) {
+						//the peer ended the stream by a final block, the rest is ignored
+						::inflateReset(&m_i);
+						break;
+					}
+					if (rt == Z_BUF_ERROR && m_i.avail_in == 0) {
+						//no more output pending
+						break;
+					}
+					if (rt != Z_OK) {
+						::inflateReset(&m_i);
+						return netp::E_WEBSOCKET_DEFLATE_FAILED;
+					}
+				} while (m_i.avail_in != 0 || m_i.avail_out == 0);
+			}
+
+			if (m_cfg.inflate_no_context_takeover && rt != Z_STREAM_END) {
+				::inflateReset(&m_i);
+			}
+			return netp::OK;
+		}
+	};
+
+	NRP<websocket_deflate_codec> websocket_deflate_zlib_maker(websocket_deflate_codec_cfg const& cfg) {
+		return netp::make_ref<websocket_deflate_zlib>(cfg);
+	}
+#endif
+}}
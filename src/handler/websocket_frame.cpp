@@ -0,0 +1,119 @@
+#include <netp/handler/websocket_frame.hpp>
+#include <netp/handler/websocket_mask.hpp>
+
+namespace netp { namespace handler {
+
+	//2 + 8 (payload len) + 4 (masking key)
+	static const u32_t WEBSOCKET_FRAME_HEADER_MAX = 14;
+
+	void websocket_frame_decoder::_buffer_reserve(u64_t need) {
+		const u32_t len = m_in->len();
+		NETP_ASSERT(need >= len);
+		if (m_in_buffered && (m_in->left_right_capacity() >= (need - len))) {
+			return;
+		}
+		NRP<packet> buf = netp::make_ref<packet>(u32_t(need));
+		buf->write(m_in->head(), len);
+		m_in = buf;
+		m_in_buffered = true;
+	}
+
+	void websocket_frame_decoder::feed(NRP<packet> const& income) {
+		if (m_in_buffered) {
+			NETP_ASSERT(m_income == nullptr);
+			m_income = income;
+			return;
+		}
+		NETP_ASSERT(m_in == nullptr || m_in->len() == 0);
+		m_in = income;
+	}
+
+	int websocket_frame_decoder::_check(ws_frame const& f) const {
+		//rsv1 only for the first frame of a data message once permessage-deflate is negotiated, a control frame must not be fragmented, refer to https://tools.ietf.org/html/rfc6455#section-5.5
+		if (f.H.B1.Bit.rsv2 || f.H.B1.Bit.rsv3) {
+			return netp::E_WEBSOCKET_FRAME_PROTOCOL_ERROR;
+		}
+		if (f.H.B1.Bit.rsv1 && (!m_rsv1_allowed || f.H.B1.Bit.opcode == OP_CONTINUE || (f.H.B1.Bit.opcode & 0x8))) {
+			return netp::E_WEBSOCKET_FRAME_PROTOCOL_ERROR;
+		}
+		if ((f.H.B1.Bit.opcode & 0x8) && (f.H.B1.Bit.fin == 0 || f.payload_len > 125)) {
+			return netp::E_WEBSOCKET_FRAME_PROTOCOL_ERROR;
+		}
+		if (f.payload_len > NETP_WEBSOCKET_MESSAGE_MAX) {
+			return netp::E_WEBSOCKET_FRAME_TOO_BIG;
+		}
+		return netp::OK;
+	}
+
+	int websocket_frame_decoder::next(ws_frame& f, NRP<packet>& payload) {
+		//complete the split frame by the bytes it needs, the rest of the income is decoded in place
+		while (m_in_buffered) {
+			const u32_t len = m_in->len();
+			if (len == 0) {
+				m_in = std::move(m_income);
+				m_income = nullptr;
+				m_in_buffered = false;
+				break;
+			}
+			const u32_t hlen = websocket_frame_header_decode(m_in->head(), len, f);
+			u64_t need = WEBSOCKET_FRAME_HEADER_MAX;
+			if (hlen != 0) {
+				const int rt = _check(f);
+				if (rt != netp::OK) {
+					return rt;
+				}
+				need = hlen + f.payload_len;
+			}
+			if (len >= need) {
+				break;
+			}
+			if (m_income == nullptr || m_income->len() == 0) {
+				m_income = nullptr;
+				return netp::E_WEBSOCKET_FRAME_INCOMPLETE;
+			}
+			_buffer_reserve(need);
+			const u32_t n = u32_t(NETP_MIN(need - len, u64_t(m_income->len())));
+			m_in->write(m_income->head(), n);
+			m_income->skip(n);
+		}
+
+		if (m_in == nullptr || m_in->len() == 0) {
+			m_in = nullptr;
+			return netp::E_WEBSOCKET_FRAME_INCOMPLETE;
+		}
+
+		const u32_t len = m_in->len();
+		const u32_t hlen = websocket_frame_header_decode(m_in->head(), len, f);
+		if (hlen == 0) {
+			_buffer_reserve(WEBSOCKET_FRAME_HEADER_MAX);
+			return netp::E_WEBSOCKET_FRAME_INCOMPLETE;
+		}
+		const int rt = _check(f);
+		if (rt != netp::OK) {
+			return rt;
+		}
+
+		const u32_t plen = u32_t(f.payload_len);
+		if ((len - hlen) < plen) {
+			_buffer_reserve(u64_t(hlen) + plen);
+			return netp::E_WEBSOCKET_FRAME_INCOMPLETE;
+		}
+
+		if (f.H.B2.Bit.mask == 0x1) {
+			websocket_mask(m_in->head() + hlen, plen, f.masking_key_arr);
+		}
+		m_in->skip(hlen);
+
+		if (m_in->len() == plen) {
+			payload = std::move(m_in);
+			m_in = std::move(m_income);
+			m_income = nullptr;
+			m_in_buffered = false;
+		} else {
+			//the consumed header is the headroom of the slice, it is enough for the header of a reply frame
+			payload = m_in->slice(0, plen, hlen);
+			m_in->skip(plen);
+		}
+		return netp::OK;
+	}
+}}
@@ -0,0 +1,125 @@
+#include <netp/handler/websocket_mask.hpp>
+#include <netp/CPUID.hpp>
+
+#if defined(_NETP_ARCH_X64) || defined(_NETP_ARCH_X86)
+	#define NETP_WEBSOCKET_MASK_X86
+	#include <immintrin.h>
+	#ifdef _NETP_GCC
+		#define __NETP_TARGET_SSE2 __attribute__((target("sse2")))
+		#define __NETP_TARGET_AVX2 __attribute__((target("avx2")))
+	#else
+		#define __NETP_TARGET_SSE2
+		#define __NETP_TARGET_AVX2
+	#endif
+#endif
+
+namespace netp { namespace handler {
+
+	typedef void(*fn_websocket_mask_t)(byte_t* data, u32_t len, u32_t key32);
+
+	//key32: the key rotated to the phase of data[0], in memory order
+	__NETP_FORCE_INLINE static u32_t __websocket_key32(u8_t const key[4], u64_t offset) {
+		u8_t k[4];
+		for (u32_t i = 0; i < 4; ++i) {
+			k[i] = key[(offset + i) & 3];
+		}
+		u32_t key32;
+		std::memcpy(&key32, k, 4);
+		return key32;
+	}
+
+	//words of 8 bytes, then the tail, the phase of the key is kept by steps of multiple of 4
+	static void __websocket_mask_word(byte_t* data, u32_t len, u32_t key32) {
+		const u64_t key64 = (u64_t(key32) << 32) | key32;
+		u32_t i = 0;
+		for (; i + 8 <= len; i += 8) {
+			u64_t w;
+			std::memcpy(&w, data + i, 8);
+			w ^= key64;
+			std::memcpy(data + i, &w, 8);
+		}
+		const u8_t* k = (const u8_t*)&key32;
+		for (; i < len; ++i) {
+			data[i] ^= k[i & 3];
+		}
+	}
+
+#ifdef NETP_WEBSOCKET_MASK_X86
+	__NETP_TARGET_SSE2
+	static void __websocket_mask_sse2(byte_t* data, u32_t len, u32_t key32) {
+		const __m128i k = _mm_set1_epi32(int(key32));
+		u32_t i = 0;
+		for (; i + 64 <= len; i += 64) {
+			__m128i* p = (__m128i*)(data + i);
+			_mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), k));
+			_mm_storeu_si128(p + 1, _mm_xor_si128(_mm_loadu_si128(p + 1), k));
+			_mm_storeu_si128(p + 2, _mm_xor_si128(_mm_loadu_si128(p + 2), k));
+			_mm_storeu_si128(p + 3, _mm_xor_si128(_mm_loadu_si128(p + 3), k));
+		}
+		for (; i + 16 <= len; i += 16) {
+			__m128i* p = (__m128i*)(data + i);
+			_mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), k));
+		}
+		__websocket_mask_word(data + i, len - i, key32);
+	}
+
+	__NETP_TARGET_AVX2
+	static void __websocket_mask_avx2(byte_t* data, u32_t len, u32_t key32) {
+		const __m256i k = _mm256_set1_epi32(int(key32));
+		u32_t i = 0;
+		for (; i + 128 <= len; i += 128) {
+			__m256i* p = (__m256i*)(data + i);
+			_mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), k));
+			_mm256_storeu_si256(p + 1, _mm256_xor_si256(_mm256_loadu_si256(p + 1), k));
+			_mm256_storeu_si256(p + 2, _mm256_xor_si256(_mm256_loadu_si256(p + 2), k));
+			_mm256_storeu_si256(p + 3, _mm256_xor_si256(_mm256_loadu_si256(p + 3), k));
+		}
+		for (; i + 32 <= len; i += 32) {
+			__m256i* p = (__m256i*)(data + i);
+			_mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), k));
+		}
+		//avoid the avx-sse transition penalty on the tail
+		_mm256_zeroupper();
+		__websocket_mask_word(data + i, len - i, key32);
+	}
+
+	//the cpu bits are not enough, the os must save the ymm state on context switch: XCR0 bit 1 (xmm) and bit 2 (ymm)
+	static bool __websocket_mask_os_ymm() {
+		if (!netp::CPUID::OSXSAVE() || !netp::CPUID::AVX()) {
+			return false;
+		}
+#ifdef _NETP_GCC
+		u32_t eax, edx;
+		__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		const u64_t xcr0 = (u64_t(edx) << 32) | eax;
+#else
+		const u64_t xcr0 = u64_t(_xgetbv(0));
+#endif
+		return (xcr0 & 0x6) == 0x6;
+	}
+#endif
+
+	static fn_websocket_mask_t __websocket_mask_select() {
+#ifdef NETP_WEBSOCKET_MASK_X86
+		if (netp::CPUID::AVX2() && __websocket_mask_os_ymm()) {
+			return __websocket_mask_avx2;
+		}
+		if (netp::CPUID::SSE2()) {
+			return __websocket_mask_sse2;
+		}
+#endif
+		return __websocket_mask_word;
+	}
+
+	void websocket_mask(byte_t* data, u32_t len, u8_t const key[4], u64_t offset) {
+		//resolved on the first call, the init order of netp::CPUID (another static) is unspecified
+		static const fn_websocket_mask_t __fn_mask = __websocket_mask_select();
+		__fn_mask(data, len, __websocket_key32(key, offset));
+	}
+
+	void websocket_mask_scalar(byte_t* data, u32_t len, u8_t const key[4], u64_t offset) {
+		for (u32_t i = 0; i < len; ++i) {
+			data[i] ^= key[(offset + i) & 3];
+		}
+	}
+}}
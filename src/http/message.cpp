@@ -18,8 +18,13 @@ namespace netp { namespace http {
 	};
 
 	void message::encode(NRP<packet>& outp) const {
+		NETP_ASSERT(H != nullptr);
+		//start line, the lines of H, content-length, and the body in one buffer
+		const u32_t reserve_n = 64 + u32_t(urlfields.path.length() + urlfields.query.length() + status.length()) + H->encode_len() + ((body != nullptr) ? body->len() : 0);
 		if (outp == nullptr) {
-			outp = netp::make_ref<packet>();
+			outp = netp::make_ref<packet>(reserve_n);
+		} else {
+			outp->reserve(reserve_n);
 		}
 
 		NETP_ASSERT(ver.major != 0);
@@ -47,8 +52,6 @@ namespace netp { namespace http {
 			outp->write((netp::byte_t*)tmp, n);
 		}
 
-		NETP_ASSERT(H != nullptr);
-
 		H->encode(outp);
 		const bool has_body = (body != nullptr && (body->len() > 0));
 
@@ -49,6 +49,7 @@ namespace netp { namespace http {
 		NETP_ASSERT(p != nullptr);
 		p->message_tmp = netp::make_ref<netp::http::message>();
 		p->message_tmp->H = netp::make_ref<netp::http::header>();
+		p->last_h = last_header_element::NONE;
 		return 0;
 	}
 
@@ -146,18 +147,12 @@ namespace netp { namespace http {
 	inline static int _on_header_field(llhttp_t* p_, char const* data, ::size_t len) {
 		parser* p = (parser*)p_->data;
 		NETP_ASSERT(p != nullptr);
+		//a field split across reads comes by pieces, the arena keeps them contiguous
+		//llhttp resumes the span of a field that ends a read, the piece could be empty
 		if (len == 0) {
-			return netp::E_HTTP_EMPTY_FILED_NAME;
+			return p->message_tmp->H->line_open ? 0 : netp::E_HTTP_EMPTY_FILED_NAME;
 		}
-
-		if (p->last_h == last_header_element::VALUE) {
-			NETP_ASSERT(p->field_tmp.length());
-			p->message_tmp->H->add_header_line(p->field_tmp, p->field_value_tmp);
-			p->field_tmp.clear();
-			p->field_value_tmp.clear();
-		}
-
-		p->field_tmp += string_t(data, len);
+		p->message_tmp->H->_field_append(data, u32_t(len));
 		p->last_h = last_header_element::FIELD;
 		return 0;
 	}
@@ -165,24 +160,27 @@ namespace netp { namespace http {
 	inline static int _on_header_value(llhttp_t* p_, char const* data, ::size_t len) {
 		parser* p = (parser*)p_->data;
 		NETP_ASSERT(p != nullptr);
-		NETP_ASSERT(p->field_tmp.length());
-		p->field_value_tmp += string_t(data,len);
+		NETP_ASSERT(p->last_h != last_header_element::NONE);
+		p->message_tmp->H->_value_append(data, u32_t(len));
 		p->last_h = last_header_element::VALUE;
 		return 0;
 	}
 
-	inline static int _on_headers_complete(llhttp_t* p_) {
+	//called for an empty value as well
+	inline static int _on_header_value_complete(llhttp_t* p_) {
 		parser* p = (parser*)p_->data;
 		NETP_ASSERT(p != nullptr);
+		NETP_ASSERT(p->last_h != last_header_element::NONE);
+		p->message_tmp->H->_line_done();
+		p->last_h = last_header_element::NONE;
+		return 0;
+	}
 
-		if (p->last_h == last_header_element::VALUE) {
-			NETP_ASSERT(p->field_tmp.length());
-			p->message_tmp->H->add_header_line(p->field_tmp, p->field_value_tmp);
-			p->field_tmp.clear();
-			p->field_value_tmp.clear();
-			p->last_h = last_header_element::NONE;
-		}
+	inline static int _on_headers_complete(llhttp_t* p_) {
+		parser* p = (parser*)p_->data;
+		NETP_ASSERT(p != nullptr);
 
+		NETP_ASSERT(p->last_h == last_header_element::NONE);
 		p->message_tmp->type = (p_->type == HTTP_REQUEST) ? T_REQ : (p_->type == HTTP_RESPONSE) ? T_RESP: NETP_THROW("invalid message type") ;
 		p->message_tmp->ver.major = p_->http_major;
 		p->message_tmp->ver.minor = p_->http_minor;
@@ -243,6 +241,7 @@ namespace netp { namespace http {
 		_settings.on_status = _on_status;
 		_settings.on_header_field = _on_header_field;
 		_settings.on_header_value = _on_header_value;
+		_settings.on_header_value_complete = _on_header_value_complete;
 		_settings.on_headers_complete = _on_headers_complete;
 		_settings.on_body = _on_body;
 		_settings.on_message_complete = _on_message_complete;
@@ -1,35 +1,402 @@
 #include <stdio.h>
 #include <fcntl.h>
+#include <ctime>
+
+#ifndef _NETP_WIN
+	#include <sys/uio.h>
+#endif
+
 #include <netp/string.hpp>
+#include <netp/thread.hpp>
 #include <netp/logger/file_logger.hpp>
 
 namespace netp { namespace logger {
 
-	file_logger::file_logger(string_t const& log_file ) :
+#ifdef _NETP_WIN
+	struct iovec {
+		void* iov_base;
+		size_t iov_len;
+	};
+#endif
+
+	//@note: the ring is shared by the logger and the producer thread, the last one of them frees it
+	//the memory comes from libc instead of netp::allocator, the thread might release it in its tls destruction
+	struct file_logger::record_ring {
+		byte_t* buf;
+		u64_t size;
+		u64_t mask;
+		std::atomic<u32_t> refs;
+		std::atomic<bool> closed; //the logger has gone
+		byte_t __pad0[64];
+		std::atomic<u64_t> head; //producer
+		byte_t __pad1[64];
+		std::atomic<u64_t> tail; //writer
+	};
+
+	static_assert(NETP_FILE_LOGGER_RING_SIZE_MIN > NETP_LOGGER_RECORD_MAX, "one record and its line break must fit in a ring");
+
+	static file_logger::record_ring* __record_ring_create(u32_t size) {
+		u64_t rsize = NETP_FILE_LOGGER_RING_SIZE_MIN;
+		while (rsize < size) { rsize <<= 1; }
+		file_logger::record_ring* r = (file_logger::record_ring*) std::malloc(sizeof(file_logger::record_ring));
+		NETP_ALLOC_CHECK(r, sizeof(file_logger::record_ring));
+		r->buf = (byte_t*) std::malloc(rsize);
+		NETP_ALLOC_CHECK(r->buf, rsize);
+		r->size = rsize;
+		r->mask = rsize - 1;
+		::new ((void*)&r->refs) std::atomic<u32_t>(2); //logger + producer thread
+		::new ((void*)&r->closed) std::atomic<bool>(false);
+		::new ((void*)&r->head) std::atomic<u64_t>(0);
+		::new ((void*)&r->tail) std::atomic<u64_t>(0);
+		return r;
+	}
+
+	static void __record_ring_release(file_logger::record_ring* r) {
+		if (r->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			std::free(r->buf);
+			std::free(r);
+		}
+	}
+
+	struct __record_ring_slot {
+		u64_t owner;
+		file_logger::record_ring* ring;
+	};
+
+	//rings of this thread, the thread drops its refs on exit
+	struct __record_ring_slots {
+		__record_ring_slot slots[NETP_FILE_LOGGER_TLS_SLOT_MAX];
+		~__record_ring_slots() {
+			for (u32_t i = 0; i < NETP_FILE_LOGGER_TLS_SLOT_MAX; ++i) {
+				if (slots[i].ring != nullptr) {
+					__record_ring_release(slots[i].ring);
+					slots[i].ring = nullptr;
+				}
+			}
+		}
+	};
+	static __NETP_TLS __record_ring_slots __tls_record_rings;
+
+	static std::atomic<u64_t> __file_logger_id(1);
+
+	//partial write is continued, the bytes left would be lost on error, there is no one to report to
+	static u64_t __file_writev(FILE* fp, struct iovec* iov, u32_t n) {
+		u64_t total = 0;
+#ifdef _NETP_WIN
+		for (u32_t i = 0; i < n; ++i) {
+			total += fwrite(iov[i].iov_base, 1, iov[i].iov_len, fp);
+		}
+		fflush(fp);
+#else
+		const int fd = fileno(fp);
+		while (n > 0) {
+			const ssize_t nbytes = ::writev(fd, iov, int(n));
+			if (nbytes < 0) {
+				if (errno == EINTR) { continue; }
+				break;
+			}
+			total += u64_t(nbytes);
+			size_t left = size_t(nbytes);
+			while (n > 0 && left >= iov->iov_len) {
+				left -= iov->iov_len;
+				++iov;
+				--n;
+			}
+			if (n > 0) {
+				iov->iov_base = (byte_t*)iov->iov_base + left;
+				iov->iov_len -= left;
+			}
+		}
+#endif
+		return total;
+	}
+
+	file_logger::file_logger(string_t const& log_file, file_logger_cfg const& cfg) :
 		logger_abstract(),
-		m_fp(nullptr)
+		m_file(log_file),
+		m_cfg(cfg),
+		m_fp(nullptr),
+		m_file_size(0),
+		m_file_open_time(0),
+		m_id(__file_logger_id.fetch_add(1, std::memory_order_relaxed)),
+		m_writer_notified(false),
+		m_writer_exit(false),
+		m_dropped(0),
+		m_dropped_reported(0),
+		m_rotated(0)
 	{
-		m_fp = fopen(log_file.c_str() , "a+b" );
-		if( m_fp == nullptr ) {
+		const int rt = _open();
+		if( rt != netp::OK ) {
 			char err_msg[1024] = {0};
-			snprintf(err_msg, 1024,"fopen(%s)=%d", log_file.c_str(), netp_last_errno() );
+			snprintf(err_msg, 1024,"fopen(%s)=%d", log_file.c_str(), rt );
 			NETP_THROW(err_msg);
 		}
+
+		if (m_cfg.async) {
+			m_writer = netp::make_ref<netp::thread>();
+			int srt = m_writer->start(&file_logger::_writer_run, this);
+			if (srt != netp::OK) {
+				m_writer = nullptr;
+				m_cfg.async = false;
+			}
+		}
 	}
 
 	file_logger::~file_logger() {
+		if (m_writer != nullptr) {
+			m_writer_exit.store(true, std::memory_order_release);
+			_writer_notify();
+			m_writer->join();
+			m_writer = nullptr;
+		}
+
+		for (record_ring* r : m_rings) {
+			r->closed.store(true, std::memory_order_release);
+			__record_ring_release(r);
+		}
+		m_rings.clear();
+
 		if(m_fp) {
 			fclose(m_fp);
 		}
 	}
 
+	int file_logger::_open() {
+		m_fp = fopen(m_file.c_str(), "a+b");
+		if (m_fp == nullptr) {
+			return netp_last_errno();
+		}
+		fseek(m_fp, 0, SEEK_END);
+		const long pos = ftell(m_fp);
+		m_file_size = pos > 0 ? u64_t(pos) : 0;
+		m_file_open_time = i64_t(std::time(nullptr));
+		return netp::OK;
+	}
+
+	//m_file_mtx must be held
+	void file_logger::_rotate_check(u64_t incoming) {
+		const bool by_size = (m_cfg.rotate_size != 0) && (m_file_size != 0) && ((m_file_size + incoming) > m_cfg.rotate_size);
+		const i64_t now = i64_t(std::time(nullptr));
+		const bool by_time = (m_cfg.rotate_interval != 0) && ((now - m_file_open_time) >= i64_t(m_cfg.rotate_interval));
+		if (!by_size && !by_time) {
+			return;
+		}
+		if (m_fp != nullptr) {
+			if (m_file_size == 0) {
+				//nothing to keep
+				m_file_open_time = now;
+				return;
+			}
+			fclose(m_fp);
+			m_fp = nullptr;
+		}
+
+		time_t long_time = (time_t)now;
+		struct tm timeinfo;
+#ifdef _NETP_WIN
+		localtime_s(&timeinfo, &long_time);
+#else
+		localtime_r(&long_time, &timeinfo);
+#endif
+		char suffix[32] = { 0 };
+		strftime(suffix, sizeof(suffix), ".%Y%m%d_%H%M%S", &timeinfo);
+
+		string_t to = m_file + suffix;
+		for (u32_t i = 1; ; ++i) {
+			FILE* exists = fopen(to.c_str(), "rb");
+			if (exists == nullptr) { break; }
+			fclose(exists);
+			char seq[16] = { 0 };
+			snprintf(seq, sizeof(seq), ".%u", i);
+			to = m_file + suffix + seq;
+		}
+		::rename(m_file.c_str(), to.c_str());
+		m_rotated.fetch_add(1, std::memory_order_relaxed);
+		//m_fp stays nullptr on failure, records would be lost until next check
+		_open();
+	}
+
+	file_logger::record_ring* file_logger::_ring_of_this_thread() {
+		__record_ring_slot* free_slot = nullptr;
+		for (u32_t i = 0; i < NETP_FILE_LOGGER_TLS_SLOT_MAX; ++i) {
+			__record_ring_slot& s = __tls_record_rings.slots[i];
+			if (s.ring == nullptr) {
+				if (free_slot == nullptr) { free_slot = &s; }
+				continue;
+			}
+			if (s.owner == m_id) {
+				return s.ring;
+			}
+			if (s.ring->closed.load(std::memory_order_acquire)) {
+				__record_ring_release(s.ring);
+				s.ring = nullptr;
+				if (free_slot == nullptr) { free_slot = &s; }
+			}
+		}
+		if (free_slot == nullptr) {
+			return nullptr;
+		}
+
+		record_ring* r = __record_ring_create(m_cfg.ring_size);
+		{
+			lock_guard<spin_mutex> lg(m_rings_mtx);
+			m_rings.push_back(r);
+		}
+		free_slot->owner = m_id;
+		free_slot->ring = r;
+		return r;
+	}
+
+	//the writer might be in between its check of m_writer_notified and the wait, the mutex makes sure the notify is not lost
+	void file_logger::_writer_notify() {
+		lock_guard<netp::mutex> lg(m_writer_mtx);
+		m_writer_cond.notify_one();
+	}
+
 	void file_logger::write( log_mask mask, char const* log, netp::u32_t len ) {
 		NETP_ASSERT(test_mask(mask));
-		::size_t nbytes = fprintf(m_fp, "%s\n", log);
-		//::size_t nbytes = fwrite( log,sizeof(char), len, m_fp );
-		//fwrite("\n", sizeof(char), netp::strlen("\n"), m_fp);
-		fflush(m_fp);
-		(void)nbytes;
-		(void)len;
+		record_ring* r = m_cfg.async ? _ring_of_this_thread() : nullptr;
+		if (r == nullptr || (u64_t(len) + 1) > r->size) {
+			struct iovec iov[2];
+			iov[0].iov_base = (void*)log;
+			iov[0].iov_len = len;
+			iov[1].iov_base = (void*)"\n";
+			iov[1].iov_len = 1;
+
+			lock_guard<netp::mutex> lg(m_file_mtx);
+			_rotate_check(len + 1);
+			if (m_fp != nullptr) {
+				m_file_size += __file_writev(m_fp, iov, 2);
+			}
+			return;
+		}
+
+		//one record, one line, copied as a whole
+		const u64_t n = u64_t(len) + 1;
+		const u64_t head = r->head.load(std::memory_order_relaxed);
+		const u64_t tail = r->tail.load(std::memory_order_acquire);
+		if ((r->size - (head - tail)) < n) {
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			if (!m_writer_notified.exchange(true, std::memory_order_acq_rel)) {
+				_writer_notify();
+			}
+			return;
+		}
+
+		const u64_t start = head & r->mask;
+		const u64_t first = NETP_MIN(u64_t(len), r->size - start);
+		std::memcpy(r->buf + start, log, size_t(first));
+		std::memcpy(r->buf, log + first, size_t(len - first));
+		r->buf[(head + len) & r->mask] = '\n';
+		r->head.store(head + n, std::memory_order_release);
+
+		//wake the writer up early if the ring is half full, or for a error
+		if ((((head + n - tail) << 1) >= r->size || mask == LOG_MASK_ERR) &&
+			!m_writer_notified.exchange(true, std::memory_order_acq_rel))
+		{
+			_writer_notify();
+		}
+	}
+
+	void file_logger::_writer_run() {
+		while (!m_writer_exit.load(std::memory_order_acquire)) {
+			_writer_drain();
+			netp::unique_lock<netp::mutex> ulk(m_writer_mtx);
+			if (!m_writer_notified.exchange(false, std::memory_order_acq_rel) && !m_writer_exit.load(std::memory_order_acquire)) {
+				m_writer_cond.no_interrupt_wait_for(ulk, std::chrono::milliseconds(m_cfg.flush_interval));
+			}
+		}
+		//the last round, the producers should have stopped
+		while (_writer_drain()) {}
+	}
+
+	//return true if any bytes have been written
+	bool file_logger::_writer_drain() {
+		record_rings_t rings;
+		{
+			lock_guard<spin_mutex> lg(m_rings_mtx);
+			//reclaim the ring of a exited thread once it has been drained
+			record_rings_t::iterator it = m_rings.begin();
+			while (it != m_rings.end()) {
+				record_ring* r = *it;
+				if (r->refs.load(std::memory_order_acquire) == 1 &&
+					r->head.load(std::memory_order_acquire) == r->tail.load(std::memory_order_relaxed))
+				{
+					it = m_rings.erase(it);
+					__record_ring_release(r);
+				} else {
+					rings.push_back(r);
+					++it;
+				}
+			}
+		}
+
+		struct iovec iov[NETP_FILE_LOGGER_IOV_MAX];
+		struct pending_t {
+			record_ring* r;
+			u64_t head;
+		} pending[NETP_FILE_LOGGER_IOV_MAX];
+
+		u32_t niov = 0;
+		u32_t npending = 0;
+		u64_t nbytes = 0;
+		bool written = false;
+
+		char dropped_info[128];
+		const u64_t dropped = m_dropped.load(std::memory_order_relaxed);
+		if (dropped != m_dropped_reported) {
+			const int dlen = snprintf(dropped_info, sizeof(dropped_info), "%s [W][file_logger]%llu records dropped, ring full\n", netp::curr_local_datatime_str().c_str(), (unsigned long long)(dropped - m_dropped_reported));
+			m_dropped_reported = dropped;
+			if (dlen > 0) {
+				iov[niov].iov_base = dropped_info;
+				iov[niov].iov_len = NETP_MIN(size_t(dlen), sizeof(dropped_info) - 1);
+				nbytes += iov[niov].iov_len;
+				++niov;
+			}
+		}
+
+		auto flush = [&]() {
+			if (niov == 0) { return; }
+			{
+				lock_guard<netp::mutex> lg(m_file_mtx);
+				_rotate_check(nbytes);
+				if (m_fp != nullptr) {
+					m_file_size += __file_writev(m_fp, iov, niov);
+				}
+			}
+			for (u32_t i = 0; i < npending; ++i) {
+				pending[i].r->tail.store(pending[i].head, std::memory_order_release);
+			}
+			written = true;
+			niov = 0;
+			npending = 0;
+			nbytes = 0;
+		};
+
+		for (record_ring* r : rings) {
+			const u64_t head = r->head.load(std::memory_order_acquire);
+			const u64_t tail = r->tail.load(std::memory_order_relaxed);
+			if (head == tail) { continue; }
+			if ((niov + 2) > NETP_FILE_LOGGER_IOV_MAX) {
+				flush();
+			}
+			const u64_t start = tail & r->mask;
+			const u64_t len = head - tail;
+			const u64_t first = NETP_MIN(len, r->size - start);
+			iov[niov].iov_base = r->buf + start;
+			iov[niov].iov_len = size_t(first);
+			++niov;
+			if (len > first) {
+				iov[niov].iov_base = r->buf;
+				iov[niov].iov_len = size_t(len - first);
+				++niov;
+			}
+			nbytes += len;
+			pending[npending].r = r;
+			pending[npending].head = head;
+			++npending;
+		}
+		flush();
+		return written;
 	}
 }}
\ No newline at end of file
@@ -56,10 +56,41 @@ namespace netp {
 		}
 	}
 
-#define LOG_BUFFER_SIZE_MAX		(8192)
+#define LOG_BUFFER_SIZE_MAX		(NETP_LOGGER_RECORD_MAX)
 #define TRACE_INFO_SIZE 1024
 
+	//localtime_r|strftime once per second per thread
+	struct __log_datetime_cache {
+		i64_t sec;
+		char str[32]; //1970-01-01 00:00:00.000
+	};
+	static __NETP_TLS __log_datetime_cache __tls_log_datetime = { -1, {0} };
+
+	static char const* __log_datetime_str() {
+		struct timeval tv;
+		netp::time_of_day(tv, nullptr);
+		__log_datetime_cache& c = __tls_log_datetime;
+		if (c.sec != i64_t(tv.tv_sec)) {
+			std::string&& dt = netp::to_local_datatime_str(tv);
+			NETP_ASSERT(dt.length() == 23);
+			std::memcpy(c.str, dt.c_str(), 24);
+			c.sec = i64_t(tv.tv_sec);
+		} else {
+			int rt = snprintf(c.str + 20, 4, "%03d", (int)(tv.tv_usec / 1000));
+			(void)rt;
+			NETP_ASSERT(rt == 3);
+		}
+		return c.str;
+	}
+
 	void logger_broker::write(logger::log_mask mask, char const* const file, int line, char const* const func, ...) {
+		NETP_ASSERT(m_isInited);
+		const ::size_t lc = m_loggers.size();
+		::size_t i = 0;
+		while (i < lc && !m_loggers[i]->test_mask(mask)) { ++i; }
+		if (i == lc) {
+			return;
+		}
 
 #if defined(_NETP_DEBUG)
 		char __traceInfo[TRACE_INFO_SIZE] = { 0 };
@@ -71,63 +102,59 @@ namespace netp {
 
 		(void)file;
 		(void)line;
-		NETP_ASSERT(m_isInited);
-		const netp::u64_t tid = netp::this_thread::get_id();
-		const ::size_t lc = m_loggers.size();
-		for(::size_t i=0;i<lc;++i) {
-			if (!m_loggers[i]->test_mask(mask)) { continue; }
-			NETP_ASSERT(m_loggers[i] != nullptr);
+		(void)func;
 
-			char log_buffer[LOG_BUFFER_SIZE_MAX] = { 0 };
-			netp::curr_local_datatime_str();
-			int idx_tid = 0;
-			int snwrite = snprintf(log_buffer + idx_tid, LOG_BUFFER_SIZE_MAX - idx_tid, "%s [%c][%llu]", netp::curr_local_datatime_str().c_str(), logger::__log_mask_char[mask], tid);
-			if (snwrite == -1) {
-				NETP_THROW("snprintf failed for loggerManager::write");
-			}
-			NETP_ASSERT(snwrite < (LOG_BUFFER_SIZE_MAX - idx_tid));
-			idx_tid += snwrite;
+		//format once for all the loggers
+		const netp::u64_t tid = netp::this_thread::get_id();
+		char log_buffer[LOG_BUFFER_SIZE_MAX];
+		int idx_tid = 0;
+		int snwrite = snprintf(log_buffer + idx_tid, LOG_BUFFER_SIZE_MAX - idx_tid, "%s [%c][%llu]", __log_datetime_str(), logger::__log_mask_char[mask], tid);
+		if (snwrite == -1) {
+			NETP_THROW("snprintf failed for loggerManager::write");
+		}
+		NETP_ASSERT(snwrite < (LOG_BUFFER_SIZE_MAX - idx_tid));
+		idx_tid += snwrite;
 
-			int idx_fmt = idx_tid;
+		int idx_fmt = idx_tid;
 
-			va_list valist;
-			va_start(valist, func);
-			char* fmt;
-			fmt = va_arg(valist, char*);
-			int fmtsize = vsnprintf(log_buffer + idx_fmt, LOG_BUFFER_SIZE_MAX - idx_fmt, fmt, valist);
-			va_end(valist);
+		va_list valist;
+		va_start(valist, func);
+		char* fmt;
+		fmt = va_arg(valist, char*);
+		int fmtsize = vsnprintf(log_buffer + idx_fmt, LOG_BUFFER_SIZE_MAX - idx_fmt, fmt, valist);
+		va_end(valist);
 
-			NETP_ASSERT(fmtsize != -1);
-			//@refer to: https://linux.die.net/man/3/vsnprintf
-			if (fmtsize >= (LOG_BUFFER_SIZE_MAX-idx_fmt)) {
-				//truncated
-				fmtsize = (LOG_BUFFER_SIZE_MAX - idx_fmt) - 1;
-			} 
+		NETP_ASSERT(fmtsize != -1);
+		//@refer to: https://linux.die.net/man/3/vsnprintf
+		if (fmtsize >= (LOG_BUFFER_SIZE_MAX-idx_fmt)) {
+			//truncated
+			fmtsize = (LOG_BUFFER_SIZE_MAX - idx_fmt) - 1;
+		} 
 
-			idx_fmt += fmtsize;
-			NETP_ASSERT(idx_fmt < LOG_BUFFER_SIZE_MAX);
+		idx_fmt += fmtsize;
+		NETP_ASSERT(idx_fmt < LOG_BUFFER_SIZE_MAX);
 
 #if defined(_NETP_DEBUG)
-			netp::size_t trace_len = netp::strlen(__traceInfo)+5; //...+\n+info+'\0' 
-			NETP_ASSERT(LOG_BUFFER_SIZE_MAX > trace_len);
-			if ( (netp::size_t)(LOG_BUFFER_SIZE_MAX) < (trace_len +idx_fmt)) {
-				int tsnsize = snprintf((log_buffer + (LOG_BUFFER_SIZE_MAX- trace_len)+3 ), (trace_len), "\n%s", __traceInfo);
-				(void)&tsnsize;
-
-				log_buffer[LOG_BUFFER_SIZE_MAX - trace_len + 0] = '.';
-				log_buffer[LOG_BUFFER_SIZE_MAX - trace_len + 1] = '.';
-				log_buffer[LOG_BUFFER_SIZE_MAX - trace_len + 2] = '.';
-				idx_fmt = (LOG_BUFFER_SIZE_MAX);
-			} else {
-				int tsnsize = snprintf((log_buffer + idx_fmt), LOG_BUFFER_SIZE_MAX - idx_fmt, "\n%s", __traceInfo);
-				idx_fmt += tsnsize;
-			}
+		netp::size_t trace_len = netp::strlen(__traceInfo)+5; //...+\n+info+'\0' 
+		NETP_ASSERT(LOG_BUFFER_SIZE_MAX > trace_len);
+		if ( (netp::size_t)(LOG_BUFFER_SIZE_MAX) < (trace_len +idx_fmt)) {
+			int tsnsize = snprintf((log_buffer + (LOG_BUFFER_SIZE_MAX- trace_len)+3 ), (trace_len), "\n%s", __traceInfo);
+			(void)&tsnsize;
+
+			log_buffer[LOG_BUFFER_SIZE_MAX - trace_len + 0] = '.';
+			log_buffer[LOG_BUFFER_SIZE_MAX - trace_len + 1] = '.';
+			log_buffer[LOG_BUFFER_SIZE_MAX - trace_len + 2] = '.';
+			idx_fmt = (LOG_BUFFER_SIZE_MAX);
+		} else {
+			int tsnsize = snprintf((log_buffer + idx_fmt), LOG_BUFFER_SIZE_MAX - idx_fmt, "\n%s", __traceInfo);
+			idx_fmt += tsnsize;
+		}
 #endif
 
+		for(;i<lc;++i) {
+			if (!m_loggers[i]->test_mask(mask)) { continue; }
+			NETP_ASSERT(m_loggers[i] != nullptr);
 			m_loggers[i]->write( mask, log_buffer, idx_fmt);
-
-			(void)file;
-			(void)func;
 		}
 	}
 }
@@ -7,24 +7,48 @@ namespace netp {
 
 	std::atomic<netp::u32_t> rpc_message::__rpc_message_id__{1};
 
+	//[type][id][code]([data len]), return the header size
+	static inline u32_t __rpc_message_header(byte_t* hdr, rpc_message const* m) {
+		byte_t* p = hdr;
+		p += netp::bytes_helper::write<netp::u8_t, byte_t*>(p, (u8_t)m->type & 0xFF);
+		p += netp::bytes_helper::write<netp::u32_t, byte_t*>(p, m->id);
+		p += netp::bytes_helper::write<netp::i32_t, byte_t*>(p, m->code);
+		if (m->data != nullptr) {
+			p += netp::bytes_helper::write<netp::u32_t, byte_t*>(p, m->data->len());
+		}
+		return u32_t(p - hdr);
+	}
+
+	//the headroom of data is written only if no one else could see it: data is held by the message only, and its buffer is not shared by any slice
+	//a payload sent twice, or by two loops, is never written
+	static inline NRP<netp::packet> __rpc_prepend_in_place(NRP<netp::packet> const& data, byte_t const* hdr, u32_t hlen) {
+		if ((data.ref_count() != 1) || data->is_buffer_shared()) {
+			return nullptr;
+		}
+		return data->slice_prepend(hdr, hlen);
+	}
+
+	//the header goes into the headroom of data if it is owned by this message, otherwise the payload is copied
 	void rpc_message::encode(NRP<netp::packet>& outp) {
-		u32_t outp_len = sizeof(u32_t) * 3 + 1;
+		byte_t hdr[NETP_RPC_MESSAGE_HEADER_SIZE];
+		const u32_t hlen = __rpc_message_header(hdr, this);
 		if (data != nullptr) {
-			outp_len += data->len();
+			outp = __rpc_prepend_in_place(data, hdr, hlen);
+			if (outp != nullptr) {
+				return;
+			}
 		}
 
-		NRP<netp::packet> _outp = netp::make_ref<netp::packet>(outp_len);
-		_outp->write<netp::u8_t>((u8_t)type & 0xFF);
-		_outp->write<netp::u32_t>(id);
-		_outp->write<netp::i32_t>(code);
+		NRP<netp::packet> _outp = netp::make_ref<netp::packet>(hlen + ((data == nullptr) ? 0 : data->len()));
+		_outp->write(hdr, hlen);
 		if (data != nullptr) {
-			_outp->write<u32_t>(data->len()&0xFFFFFFFF);
 			_outp->write(data->head(), data->len());
 		}
 		outp = _outp;
 	}
 
-	 int rpc_message::from_packet(NRP<netp::packet> const& inpack, NRP<rpc_message>& in_rpcm) {
+	//the payload is a slice of inpack, the consumed header bytes become its headroom
+	int rpc_message::from_packet(NRP<netp::packet> const& inpack, NRP<rpc_message>& in_rpcm) {
 		NETP_ASSERT(inpack != nullptr);
 		if (inpack->len() < (sizeof(u8_t) + sizeof(u32_t) + sizeof(i32_t))) {
 			return netp::E_RPC_MESSAGE_DECODE_FAILED;
@@ -43,7 +67,7 @@ namespace netp {
 			}
 		}
 
-		in_rpcm = netp::make_ref<rpc_message>((rpc_message_type)t, id, code, netp::make_ref<netp::packet>(inpack->head(), plen));
+		in_rpcm = netp::make_ref<rpc_message>((rpc_message_type)t, id, code, inpack->slice(0, plen, NETP_RPC_FRAME_HEADER_SIZE));
 		inpack->skip(plen);
 		return netp::OK;
 	}
@@ -58,107 +82,190 @@ namespace netp {
 		}
 
 		m_reply_q.push_back(reply);
-		_do_flush();
+		_do_flush_later();
 	}
 
-	//for a one by one write call, we would not get E_CHANNEL_WRITE_BLOCK
-	void rpc::_do_reply_done(int rt) {
+	//the whole batch is done by the last write of it, one promise for one batch
+	void rpc::_do_write_batch_done(int rt) {
 		NETP_ASSERT(m_loop->in_event_loop());
 
 		if (m_wstate == rpc_write_state::S_WRITE_CLOSED) { return; }
+		NETP_ASSERT(m_wstate == rpc_write_state::S_WRITING);
+
+		list_req_message *cur, *nxt;
+		NETP_LIST_SAFE_FOR(cur, nxt, &m_list_writing) {
+			NETP_ASSERT(cur->m->type == rpc_message_type::T_DATA);
+			NETP_ASSERT(cur->state == rpc_req_message_state::S_WRITING);
+			cur->state = rpc_req_message_state::S_WRITE_DONE;
+			netp::list_delete(cur);
+			cur->pushp->set(rt);
+			netp::allocator<list_req_message>::trash(cur);
+		}
 
-		NETP_ASSERT(m_reply_q.size());
-		NRP<rpc_message>& _reply = m_reply_q.front();
 		if (rt == netp::OK) {
-			TRACE_RPC("[rpc]reply ok, write rt: %d, id: %d, call rt: %d, reply data len: %u", rt, _reply->id, _reply->code, _reply->data == nullptr ? 0 : _reply->data->len());
 			m_wstate = rpc_write_state::S_WRITE_IDLE;
-			m_reply_q.pop_front();
-			if (m_reply_q.empty()) {
-				rpc_message_reply_queue_t().swap(m_reply_q);
-			}
 			_do_flush();
 		} else {
-			NETP_ASSERT(rt != netp::E_CHANNEL_WRITE_BLOCK);
 			NETP_ASSERT(m_ctx != nullptr);
-			NETP_ERR("[rpc]reply failed, write rt: %d, id: %d, call rt: %d, reply data len: %u",rt, _reply->id, _reply->code, _reply->data == nullptr ? 0 : _reply->data->len() );
+			NETP_ERR("[rpc]write batch failed, write rt: %d", rt);
 			m_ctx->close();
 		}
 	}
 
-	void rpc::_do_write_req_done(list_req_message* lrm, int rt) {
-		NETP_ASSERT(m_loop->in_event_loop());
+	//hlen frame: [len][type][id][code]([data len][data])
+	//refer to handler::hlen, rpc frames the outbound messages itself to write them by one write_chain
+	static inline u32_t __rpc_frame_size(rpc_message const* m) {
+		return u32_t(sizeof(u32_t) + sizeof(u8_t) + sizeof(u32_t) + sizeof(i32_t)) + ((m->data == nullptr) ? 0 : u32_t(sizeof(u32_t) + m->data->len()));
+	}
 
-		if(m_wstate == rpc_write_state::S_WRITE_CLOSED) {return;}
-		NETP_ASSERT(lrm->state == rpc_req_message_state::S_WRITING);
+	static inline u32_t __rpc_frame_inline_size(rpc_message const* m) {
+		return ((m->data == nullptr) || (m->data->len() <= NETP_RPC_BATCH_INLINE_MAX)) ? __rpc_frame_size(m) : (__rpc_frame_size(m) - m->data->len());
+	}
 
-		TRACE_RPC("[rpc]write ok, write rt: %d, type: %d, id: %d, data len: %u", rt, _req->m->type, _req->m->id, _req->m->data == nullptr ? 0 : _req->m->data->len());
-		if (lrm->m->type == rpc_message_type::T_REQ) {
-			lrm->state = rpc_req_message_state::S_WAIT_RESPOND;
-		} else {
-			lrm->state = rpc_req_message_state::S_WRITE_DONE;
-			NETP_ASSERT(lrm->m->type == rpc_message_type::T_DATA);
-			lrm->pushp->set(rt);
-			netp::allocator<list_req_message>::trash(lrm);
+	//the frame is written into buf, except for a large payload, which is appended to the chain as it is
+	//the frame header of a large payload goes into its headroom if it is owned by the message, otherwise into buf, right in front of it in the chain
+	static void __rpc_frame_append(NRP<packet_chain> const& batch, NRP<netp::packet> const& buf, u32_t& mark, rpc_message const* m) {
+		byte_t hdr[NETP_RPC_FRAME_HEADER_SIZE];
+		const u32_t hsize = u32_t(sizeof(u32_t)) + __rpc_message_header(hdr + sizeof(u32_t), m);
+		netp::bytes_helper::write<netp::u32_t, byte_t*>(hdr, __rpc_frame_size(m) - u32_t(sizeof(u32_t)));
+
+		if ((m->data == nullptr) || (m->data->len() <= NETP_RPC_BATCH_INLINE_MAX)) {
+			buf->write(hdr, hsize);
+			if (m->data != nullptr) {
+				buf->write(m->data->head(), m->data->len());
+			}
+			return;
 		}
 
-		if (rt == netp::OK) {
-			m_wstate = rpc_write_state::S_WRITE_IDLE;
-			_do_flush();
-		} else {
-			NETP_ASSERT(m_ctx != nullptr);
-			NETP_ASSERT(rt != netp::E_CHANNEL_WRITE_BLOCK);
-			NETP_ERR("[rpc]write req failed, write rt: %d, id: %d, data len: %u", rt, lrm->m->id, lrm->m->data == nullptr ? 0 : lrm->m->data->len());
-			m_ctx->close();
+		NRP<netp::packet> framed = __rpc_prepend_in_place(m->data, hdr, hsize);
+		if (framed == nullptr) {
+			buf->write(hdr, hsize);
+			framed = m->data;
 		}
-
+		if (buf->len() > mark) {
+			batch->push_back(buf->slice(mark, buf->len() - mark));
+			mark = buf->len();
+		}
+		batch->push_back(framed);
 	}
 
+	//encode all the queued replies, then the queued reqs|pushes, into one batch (at most m_batch_bytes_max bytes) by one write
+	//1, small frames are copied into one buffer, large payloads are referenced
+	//2, the next batch starts once the current one is done, the messages queued in between are coalesced into it
 	void rpc::_do_flush() {
 		NETP_ASSERT(m_loop->in_event_loop());
 		NETP_ASSERT((m_wstate != rpc_write_state::S_WRITE_CLOSED) ) ;
 		if (m_wstate != rpc_write_state::S_WRITE_IDLE ) {
 			return;
 		}
-
+		if (m_reply_q.empty() && NETP_LIST_IS_EMPTY(&m_list_to_write)) {
+			return;
+		}
 		NETP_ASSERT(m_ctx != nullptr);
-		while (!m_reply_q.empty()) {
-			m_wstate = rpc_write_state::S_WRITING;
-			NRP<rpc_message>& reply_r = m_reply_q.front();
-			NRP<netp::packet> outp;
-			reply_r->encode(outp);
-
-			NRP<netp::promise<int>> wp = netp::make_ref<netp::promise<int>>();
-			wp->if_done([R = NRP<netp::rpc>(this)](int const& rt) {
-				R->_do_reply_done(rt);
-			});
-
-			m_ctx->write(wp, outp);
+
+		//size the batch first
+		u32_t nbytes = 0;
+		u32_t nbytes_inline = 0;
+		::size_t nreply = 0;
+		const ::size_t reply_q_size = m_reply_q.size();
+		for (; nreply < reply_q_size; ++nreply) {
+			rpc_message const* m = m_reply_q[nreply].get();
+			const u32_t fsize = __rpc_frame_size(m);
+			if ((nbytes > 0) && ((nbytes + fsize) > m_batch_bytes_max)) {
+				break;
+			}
+			nbytes += fsize;
+			nbytes_inline += __rpc_frame_inline_size(m);
+		}
+
+		//a req waits in the list if the in flight ones reach the max, the ones after it wait as well to keep the order
+		list_req_message* lrm_end = m_list_to_write.next;
+		if (nreply == reply_q_size) {
+			u32_t inflight = u32_t(m_calls.size());
+			for (; lrm_end != &m_list_to_write; lrm_end = lrm_end->next) {
+				if (lrm_end->m->type == rpc_message_type::T_REQ) {
+					if (inflight >= m_inflight_max) {
+						break;
+					}
+					++inflight;
+				}
+				const u32_t fsize = __rpc_frame_size(lrm_end->m.get());
+				if ((nbytes > 0) && ((nbytes + fsize) > m_batch_bytes_max)) {
+					break;
+				}
+				nbytes += fsize;
+				nbytes_inline += __rpc_frame_inline_size(lrm_end->m.get());
+			}
+		}
+
+		if (nbytes == 0) {
 			return;
 		}
 
-		while (!NETP_LIST_IS_EMPTY(&m_list_to_write)) {
+		NRP<packet_chain> batch = netp::make_ref<packet_chain>();
+		NRP<netp::packet> buf = netp::make_ref<netp::packet>(nbytes_inline, 0);
+		u32_t mark = 0;
+
+		for (::size_t i = 0; i < nreply; ++i) {
+			TRACE_RPC("[rpc]reply out, id: %d, call rt: %d, reply data len: %u", m_reply_q.front()->id, m_reply_q.front()->code, m_reply_q.front()->data == nullptr ? 0 : m_reply_q.front()->data->len());
+			__rpc_frame_append(batch, buf, mark, m_reply_q.front().get());
+			m_reply_q.pop_front();
+		}
+		if (m_reply_q.empty()) {
+			rpc_message_reply_queue_t().swap(m_reply_q);
+		}
+
+		while (m_list_to_write.next != lrm_end) {
 			//the first one
 			list_req_message* lrm = m_list_to_write.next;
 			NETP_ASSERT(lrm->state == rpc_req_message_state::S_WAIT_WRITE);
 			netp::list_delete(lrm);
 			--m_list_to_write_count;
 
-			lrm->state = rpc_req_message_state::S_WRITING;
+			__rpc_frame_append(batch, buf, mark, lrm->m.get());
 			if (lrm->m->type == rpc_message_type::T_REQ) {
-				netp::list_append(&m_list_wait_for_response[NETP_RPC_INFLIGHT_SLOT(lrm->m->id)], lrm);
-				++m_list_wait_for_response_count;
+				//the resp could not arrive before the req has been written
+				//the deadline of the call is kept
+				lrm->state = rpc_req_message_state::S_WAIT_RESPOND;
+				const bool inserted = m_calls.emplace(lrm->m->id, lrm).second;
+				NETP_ASSERT(inserted, "[rpc]duplicate call id: %u", lrm->m->id);
+				(void)inserted;
+			} else {
+				NETP_ASSERT(lrm->m->type == rpc_message_type::T_DATA);
+				lrm->state = rpc_req_message_state::S_WRITING;
+				_deadline_remove(lrm);
+				netp::list_append(&m_list_writing, lrm);
 			}
+		}
+		_write_block_check();
+
+		if (mark == 0 && batch->empty()) {
+			batch->push_back(buf);
+		} else if (buf->len() > mark) {
+			batch->push_back(buf->slice(mark, buf->len() - mark));
+		}
+		NETP_ASSERT(batch->len() == nbytes);
 
-			NRP<netp::packet> outp;
-			lrm->m->encode(outp);
-			NRP<netp::promise<int>> wp = netp::make_ref<netp::promise<int>>();
-			wp->if_done([R = NRP<netp::rpc>(this),lrm](int const& rt) {
-				R->_do_write_req_done(lrm, rt);
-			});
-			m_wstate = rpc_write_state::S_WRITING;
-			m_ctx->write(wp, outp);
+		NRP<netp::promise<int>> wp = netp::make_ref<netp::promise<int>>();
+		wp->if_done([R = NRP<netp::rpc>(this)](int const& rt) {
+			R->_do_write_batch_done(rt);
+		});
+		m_wstate = rpc_write_state::S_WRITING;
+		m_ctx->write_chain(wp, batch);
+	}
+
+	//the replies|reqs of the current round of the loop (tasks, reads) are coalesced into one batch by the flush of the next round
+	void rpc::_do_flush_later() {
+		if (m_flush_scheduled || (m_wstate != rpc_write_state::S_WRITE_IDLE)) {
 			return;
 		}
+		m_flush_scheduled = true;
+		m_loop->schedule([R = NRP<netp::rpc>(this)]() {
+			R->m_flush_scheduled = false;
+			if (R->m_wstate == rpc_write_state::S_WRITE_IDLE) {
+				R->_do_flush();
+			}
+		});
 	}
 
 	void rpc::_timer_timeout(NRP<netp::timer> const& t) {
@@ -169,44 +276,126 @@ namespace netp {
 		}
 	}
 
+	void rpc::_deadline_up(u32_t idx) {
+		list_req_message* lrm = m_deadlines[idx];
+		while (idx > 0) {
+			const u32_t p = ((idx - 1) >> 1);
+			if (!(lrm->tp_timeout < m_deadlines[p]->tp_timeout)) {
+				break;
+			}
+			m_deadlines[idx] = m_deadlines[p];
+			m_deadlines[idx]->dl_idx = idx;
+			idx = p;
+		}
+		m_deadlines[idx] = lrm;
+		lrm->dl_idx = idx;
+	}
+
+	void rpc::_deadline_down(u32_t idx) {
+		list_req_message* lrm = m_deadlines[idx];
+		const u32_t n = u32_t(m_deadlines.size());
+		while (true) {
+			u32_t c = ((idx << 1) + 1);
+			if (c >= n) {
+				break;
+			}
+			if (((c + 1) < n) && (m_deadlines[c + 1]->tp_timeout < m_deadlines[c]->tp_timeout)) {
+				++c;
+			}
+			if (!(m_deadlines[c]->tp_timeout < lrm->tp_timeout)) {
+				break;
+			}
+			m_deadlines[idx] = m_deadlines[c];
+			m_deadlines[idx]->dl_idx = idx;
+			idx = c;
+		}
+		m_deadlines[idx] = lrm;
+		lrm->dl_idx = idx;
+	}
+
+	void rpc::_deadline_add(list_req_message* lrm, timer_duration_t const& timeout) {
+		lrm->tp_timeout = (timer_clock_t::now() + timeout);
+		m_deadlines.push_back(lrm);
+		_deadline_up(u32_t(m_deadlines.size() - 1));
+	}
+
+	//the last one takes the slot, then moves up or down from there
+	void rpc::_deadline_remove(list_req_message* lrm) {
+		const u32_t idx = lrm->dl_idx;
+		NETP_ASSERT(idx < m_deadlines.size() && m_deadlines[idx] == lrm);
+		list_req_message* last = m_deadlines.back();
+		m_deadlines.pop_back();
+		if (last == lrm) {
+			return;
+		}
+		m_deadlines[idx] = last;
+		last->dl_idx = idx;
+		if ((idx > 0) && (last->tp_timeout < m_deadlines[(idx - 1) >> 1]->tp_timeout)) {
+			_deadline_up(idx);
+		} else {
+			_deadline_down(idx);
+		}
+	}
+
+	void rpc::_write_block_check() {
+		bool blocked = m_write_blocked;
+		if (!m_write_blocked && (m_list_to_write_count >= m_pending_max)) {
+			blocked = true;
+		} else if (m_write_blocked && (m_list_to_write_count <= (m_pending_max >> 1))) {
+			blocked = false;
+		}
+		if (blocked == m_write_blocked) {
+			return;
+		}
+		m_write_blocked = blocked;
+		if (m_fn_write_block != nullptr) {
+			m_fn_write_block(NRP<netp::rpc>(this), blocked);
+		}
+	}
+
+	//the heap top is the earliest one, stop at the first one not expired
 	void rpc::_do_timer_timeout() {
 		NETP_ASSERT(m_loop->in_event_loop());
 
 		const timer_timepoint_t now = timer_clock_t::now();
-		list_req_message *cur, *nxt;
-		for (size_t i = 0; i < sizeof(m_list_wait_for_response) / sizeof(m_list_wait_for_response[i]); ++i) {
-			NETP_LIST_SAFE_FOR(cur, nxt, &m_list_wait_for_response[i]) {
-				if (now > cur->tp_timeout) {
-					NETP_ASSERT(cur->m != nullptr);
-					NETP_ASSERT(cur->m->type == rpc_message_type::T_REQ);
-					NETP_ASSERT(cur->state == rpc_req_message_state::S_WAIT_RESPOND);
-
-					cur->state = rpc_req_message_state::S_TIMEOUT;
-					cur->callp->set(std::make_tuple(netp::E_RPC_CALL_TIMEOUT, nullptr));
-					NETP_WARN("[rpc]req timeout, id: %d, api code: %d, data len: %u", cur->m->id, cur->m->code, cur->m->data == nullptr ? 0 : cur->m->data->len());
-
-					netp::list_delete(cur);
-					--m_list_wait_for_response_count;
-					netp::allocator<list_req_message>::trash(cur);
-				}
+		bool call_expired = false;
+		while (!m_deadlines.empty()) {
+			list_req_message* cur = m_deadlines.front();
+			if (now <= cur->tp_timeout) {
+				break;
 			}
-		}
-
-		NETP_LIST_SAFE_FOR(cur, nxt, &m_list_to_write) {
-			if (now > cur->tp_timeout) {
-				NETP_ASSERT( cur->state == rpc_req_message_state::S_WAIT_WRITE);
+			_deadline_remove(cur);
+			NETP_ASSERT(cur->m != nullptr);
+			if (cur->state == rpc_req_message_state::S_WAIT_RESPOND) {
+				NETP_ASSERT(cur->m->type == rpc_message_type::T_REQ);
+				m_calls.erase(cur->m->id);
+				call_expired = true;
+				cur->state = rpc_req_message_state::S_TIMEOUT;
+				cur->callp->set(std::make_tuple(netp::E_RPC_CALL_TIMEOUT, nullptr));
+				NETP_WARN("[rpc]req timeout, id: %d, api code: %d, data len: %u", cur->m->id, cur->m->code, cur->m->data == nullptr ? 0 : cur->m->data->len());
+			} else {
+				NETP_ASSERT(cur->state == rpc_req_message_state::S_WAIT_WRITE);
+				netp::list_delete(cur);
+				--m_list_to_write_count;
 				cur->state = rpc_req_message_state::S_TIMEOUT;
 				if (cur->m->type == rpc_message_type::T_REQ) {
-					cur->callp->set(std::make_tuple(netp::E_RPC_WRITE_TIMEOUT,nullptr));
+					cur->callp->set(std::make_tuple(netp::E_RPC_WRITE_TIMEOUT, nullptr));
 				} else {
 					NETP_ASSERT(cur->m->type == rpc_message_type::T_DATA);
 					cur->pushp->set(netp::E_RPC_WRITE_TIMEOUT);
 				}
-				NETP_WARN("[rpc]write timeout, id: %d, data len: %u", cur->m->id, cur->m->data == nullptr ? 0 : cur->m->data->len() );
-				netp::list_delete(cur);
-				--m_list_to_write_count;
-				netp::allocator<list_req_message>::trash(cur);
+				NETP_WARN("[rpc]write timeout, id: %d, data len: %u", cur->m->id, cur->m->data == nullptr ? 0 : cur->m->data->len());
 			}
+			netp::allocator<list_req_message>::trash(cur);
+		}
+
+		if (m_wstate == rpc_write_state::S_WRITE_CLOSED) {
+			return;
+		}
+		_write_block_check();
+		if (call_expired && !NETP_LIST_IS_EMPTY(&m_list_to_write)) {
+			//room for the reqs waiting for in flight slot
+			_do_flush_later();
 		}
 	}
 
@@ -225,7 +414,7 @@ namespace netp {
 			return;
 		}
 
-		if ((m_list_to_write_count + m_list_wait_for_response_count) >= NETP_RPC_INFLIGHT_MAX) {
+		if (m_list_to_write_count >= m_pending_max) {
 			callp->set(std::make_tuple(netp::E_CHANNEL_WRITE_BLOCK, nullptr));
 			return;
 		}
@@ -235,12 +424,13 @@ namespace netp {
 		lrm->state = netp::rpc_req_message_state::S_WAIT_WRITE;
 		lrm->m = m;
 		lrm->callp = callp;
-		lrm->tp_timeout = (timer_clock_t::now() + timeout);
+		_deadline_add(lrm, timeout);
 
 		netp::list_append(&m_list_to_write, lrm);
 		++m_list_to_write_count;
+		_write_block_check();
 		
-		_do_flush();
+		_do_flush_later();
 	}
 
 	void rpc::_do_push(NRP<netp::rpc_push_promise> const& pushp, NRP<netp::packet> const& data,  timer_duration_t const& timeout) {
@@ -251,7 +441,7 @@ namespace netp {
 			return;
 		}
 
-		if ((m_list_to_write_count + m_list_wait_for_response_count) >= NETP_RPC_INFLIGHT_MAX) {
+		if (m_list_to_write_count >= m_pending_max) {
 			pushp->set(netp::E_CHANNEL_WRITE_BLOCK);
 			return;
 		}
@@ -262,11 +452,12 @@ namespace netp {
 		lrm->state = netp::rpc_req_message_state::S_WAIT_WRITE;
 		lrm->m = m;
 		lrm->pushp = pushp;
-		lrm->tp_timeout = (timer_clock_t::now() + timeout);
+		_deadline_add(lrm, timeout);
 		netp::list_append(&m_list_to_write, lrm);
 		++m_list_to_write_count;
+		_write_block_check();
 		
-		_do_flush();
+		_do_flush_later();
 	}
 
 	void rpc::connected(NRP<netp::channel_handler_context> const& ctx) {
@@ -298,6 +489,12 @@ namespace netp {
 		}
 
 		list_req_message *cur, *nxt;
+		NETP_LIST_SAFE_FOR(cur, nxt, &m_list_writing) {
+			cur->pushp->set(netp::E_RPC_CALL_CANCEL);
+			netp::list_delete(cur);
+			netp::allocator<list_req_message>::trash(cur);
+		}
+
 		NETP_LIST_SAFE_FOR(cur, nxt, &m_list_to_write) {
 			if (cur->m->type == rpc_message_type::T_REQ) {
 				cur->callp->set(std::make_tuple(netp::E_RPC_CALL_CANCEL, nullptr));
@@ -310,14 +507,15 @@ namespace netp {
 			netp::allocator<list_req_message>::trash(cur);
 		}
 
-		for (size_t i = 0; i < sizeof(m_list_wait_for_response) / sizeof(m_list_wait_for_response[0]); ++i) {
-			NETP_LIST_SAFE_FOR(cur, nxt, &m_list_wait_for_response[i]) {
-				cur->callp->set(std::make_tuple(netp::E_RPC_CALL_TIMEOUT, nullptr));
-				--m_list_wait_for_response_count;
-				netp::list_delete(cur);
-				netp::allocator<list_req_message>::trash(cur);
-			}
+		for (rpc_call_map_t::iterator it = m_calls.begin(); it != m_calls.end(); ++it) {
+			it->second->callp->set(std::make_tuple(netp::E_RPC_CALL_TIMEOUT, nullptr));
+			netp::allocator<list_req_message>::trash(it->second);
 		}
+		m_calls.clear();
+
+		//all the lrms have been trashed
+		rpc_deadline_heap_t().swap(m_deadlines);
+		m_write_blocked = false;
 
 		m_fn_on_push = nullptr;
 		m_ctx = nullptr;
@@ -388,19 +586,15 @@ namespace netp {
 		break;
 		case rpc_message_type::T_RESP:
 		{
-			list_req_message* lrm_slot = &m_list_wait_for_response[NETP_RPC_INFLIGHT_SLOT(in->id)];
-			list_req_message* lrm_waiting_reply = 0;
-			NETP_LIST_FOR(lrm_waiting_reply, lrm_slot) {
-				if (lrm_waiting_reply->m->id == in->id) {
-					break;
-				}
-			}
-			if (lrm_waiting_reply == 0 ) {
+			rpc_call_map_t::iterator it = m_calls.find(in->id);
+			if (it == m_calls.end()) {
+				//timeout already, or a bad one
 				NETP_INFO("[rpc]unknown resp in, id: %u, api code: %d, data len: %u", in->id, in->code, in->data == nullptr ? 0 : in->data->len());
 				return;
 			}
-			netp::list_delete(lrm_waiting_reply);
-			--m_list_wait_for_response_count;
+			list_req_message* lrm_waiting_reply = it->second;
+			m_calls.erase(it);
+			_deadline_remove(lrm_waiting_reply);
 
 			NETP_ASSERT(lrm_waiting_reply->state == rpc_req_message_state::S_WAIT_RESPOND);
 			TRACE_RPC("[rpc]reply in, id: %u, call rt: %d, data len: %u", in->id, in->code, in->data == nullptr ? 0 : in->data->len());
@@ -416,6 +610,11 @@ namespace netp {
 			}
 
 			netp::allocator<list_req_message>::trash(lrm_waiting_reply);
+
+			//one in flight slot released
+			if (!NETP_LIST_IS_EMPTY(&m_list_to_write) && (m_wstate != rpc_write_state::S_WRITE_CLOSED)) {
+				_do_flush_later();
+			}
 		}
 		break;
 		case rpc_message_type::T_DATA:
@@ -451,17 +650,20 @@ namespace netp {
 		m_wstate(rpc_write_state::S_WRITE_CLOSED),
 		m_fn_on_push(nullptr),
 		m_list_to_write_count(0),
-		m_list_wait_for_response_count(0)
+		m_batch_bytes_max(NETP_RPC_BATCH_BYTES_MAX),
+		m_inflight_max(NETP_RPC_INFLIGHT_MAX),
+		m_pending_max(NETP_RPC_PENDING_MAX),
+		m_flush_scheduled(false),
+		m_write_blocked(false),
+		m_fn_write_block(nullptr)
 	{
 		netp::list_init(&m_list_to_write);
-		for (size_t i = 0; i < sizeof(m_list_wait_for_response) / sizeof(m_list_wait_for_response[0]); ++i) {
-			netp::list_init(&m_list_wait_for_response[i]);
-		}
+		netp::list_init(&m_list_writing);
 	}
 
 	rpc::~rpc()
 	{
-		NETP_ASSERT(m_list_to_write_count == 0 && m_list_wait_for_response_count == 0);
+		NETP_ASSERT(m_list_to_write_count == 0 && m_calls.size() == 0 && m_deadlines.size() == 0);
 	}
 
 	void rpc::on_push(fn_on_push_t const& fn) {
@@ -488,7 +690,8 @@ namespace netp {
 				fn_ch_initializer(ch);
 			}
 
-			NRP<netp::channel_handler_abstract> h_hlen = netp::make_ref<netp::handler::hlen>();
+			//decode only, rpc frames the outbound messages itself
+			NRP<netp::channel_handler_abstract> h_hlen = netp::make_ref<netp::handler::hlen>(false);
 			ch->pipeline()->add_last(h_hlen);
 
 			NRP<netp::rpc> rpc = netp::make_ref<netp::rpc>(ch->L);
@@ -1,4 +1,3 @@
-
 #include <netp/core.hpp>
 #include <netp/smart_ptr.hpp>
 #include <netp/logger_broker.hpp>
@@ -7,256 +6,190 @@
 
 namespace netp {
 
-	runner::runner(u8_t id, scheduler* s) :
-		m_id(id),
-		m_wait_flag(0),
-		m_state(task_runner_state::TR_S_IDLE),
-		m_scheduler(s)
-	{
-		NETP_TRACE_TASK("[TRunner][-%u-]construct new runner", m_id);
-	}
+	struct scheduler_worker {
+		spin_mutex mtx;
+		scheduler_task_list tasks[P_MAX];
+		//peek without lock, a stealer skip the empty one
+		std::atomic<u32_t> count[P_MAX];
+		NRP<netp::thread> th;
 
-	runner::~runner() {
-		stop();
-		NETP_TRACE_TASK("[TRunner][-%u-]destructTaskRunner", m_id);
-	}
+		scheduler_worker() {
+			for (u8_t p = 0; p < P_MAX; ++p) {
+				count[p].store(0, std::memory_order_relaxed);
+			}
+		}
 
-	void runner::on_start() {
-		m_state.store(task_runner_state::TR_S_IDLE, std::memory_order_release);
+		__NETP_FORCE_INLINE task_node* pop(u8_t p) {
+			if (count[p].load(std::memory_order_acquire) == 0) {
+				return nullptr;
+			}
+			lock_guard<spin_mutex> lg(mtx);
+			task_node* n = tasks[p].pop();
+			if (n != nullptr) {
+				count[p].fetch_sub(1, std::memory_order_relaxed);
+			}
+			return n;
+		}
+	};
+
+	//the scheduler && the index of the worker that runs on this thread
+	static __NETP_TLS scheduler* __tls_scheduler = nullptr;
+	static __NETP_TLS u32_t __tls_scheduler_wi = 0;
+
+	scheduler::scheduler(u8_t const& max_runner):
+		m_state(S_IDLE),
+		m_max_concurrency(NETP_MAX(max_runner, u8_t(1))),
+		m_rr(0),
+		m_stolen(0),
+		m_pending(0),
+		m_parked(0)
+	{
 	}
 
-	void runner::on_stop() {
-		NETP_TRACE_TASK("[TRunner][-%u-]runner exit...", m_id);
+	scheduler::~scheduler() {
+		stop();
+		NETP_TRACE_TASK("[scheduler]~scheduler()");
 	}
 
-	void runner::stop() {
+	void scheduler::_push(task_node* n, u8_t p) {
+		NETP_ASSERT(m_state.load(std::memory_order_acquire) != S_IDLE, "scheduler not started");
+		const u32_t wi = (__tls_scheduler == this) ? __tls_scheduler_wi : (m_rr.fetch_add(1, std::memory_order_relaxed) % u32_t(m_workers.size()));
+		scheduler_worker* w = m_workers[wi];
 		{
-			while (m_state.load(std::memory_order_acquire) != TR_S_WAITING) {
-				netp::this_thread::no_interrupt_yield(1);
-			}
-
-			m_state = TR_S_ENDING;
-			NETP_TRACE_TASK("[TRunner][-%u-]runner enter into state [%d]", m_id, m_state);
+			lock_guard<spin_mutex> lg(w->mtx);
+			w->tasks[p].push(n);
+			w->count[p].fetch_add(1, std::memory_order_release);
 		}
 
-		{
-			lock_guard<spin_mutex> lg_schd(m_scheduler->m_mutex);
-			m_scheduler->m_condition.no_interrupt_notify_all();
+		//pair with the re-check of m_pending in __worker_run, either we see the parked one, or it sees this task
+		m_pending.fetch_add(1, std::memory_order_seq_cst);
+		if (m_parked.load(std::memory_order_seq_cst) > 0) {
+			lock_guard<mutex> lg(m_park_mtx);
+			m_park_cond.no_interrupt_notify_one();
 		}
-		thread_run_object_abstract::stop();
 	}
 
-	void runner::run() {
-
-		NETP_ASSERT(m_scheduler != nullptr);
-		while (1)
-		{
-			netp::non_atomic_shared_ptr<fn_task_t> task = nullptr;
-			{
-				unique_lock<spin_mutex> _ulk(m_scheduler->m_mutex);
-			check_begin:
-				{
-					if (m_state.load(std::memory_order_acquire) == TR_S_ENDING) {
-						break;
-					}
-				}
-
-				bool has_any = m_scheduler->m_tasks_assigning->front_and_pop(task);
-				if (!has_any) {
-					m_state.store(TR_S_WAITING, std::memory_order_release);
-					++(m_scheduler->m_tasks_runner_wait_count);
-					m_scheduler->m_condition.no_interrupt_wait(_ulk);
-					--(m_scheduler->m_tasks_runner_wait_count);
-					goto check_begin;
-				}
+	task_node* scheduler::_take(u32_t wi) {
+		const u32_t wc = u32_t(m_workers.size());
+		for (u8_t p = 0; p < P_MAX; ++p) {
+			task_node* n = m_workers[wi]->pop(p);
+			if (n != nullptr) {
+				m_pending.fetch_sub(1, std::memory_order_relaxed);
+				return n;
 			}
-			m_state.store(TR_S_RUNNING, std::memory_order_release);
-			m_wait_flag.store(0, std::memory_order_release);
-
-			NETP_ASSERT(task != nullptr);
-			try {
-				(*task)();
-			} catch (netp::exception& e) {
-				NETP_ERR("[TRunner][-%d-]runner netp::exception: [%d]%s\n%s(%d) %s\n%s",
-					m_id, e.code(), e.what(), e.file(), e.line(), e.function(), e.callstack());
-				throw;
-			} catch (std::exception& e) {
-				NETP_ERR("[TRunner][-%d-]runner exception: %s", m_id, e.what());
-				throw;
-			} catch (...) {
-				NETP_ERR("[TRunner][-%d-]runner, unknown exception", m_id);
-				throw;
+			for (u32_t k = 1; k < wc; ++k) {
+				n = m_workers[(wi + k) % wc]->pop(p);
+				if (n != nullptr) {
+					m_pending.fetch_sub(1, std::memory_order_relaxed);
+					m_stolen.fetch_add(1, std::memory_order_relaxed);
+					return n;
+				}
 			}
 		}
+		return nullptr;
 	}
 
-	runner_pool::runner_pool(u8_t const& max_runner) :
-		m_mutex(),
-		m_runners(),
-		m_is_running(false),
-		m_max_concurrency(max_runner),
-		m_last_runner_idx(0)
-	{
-	}
-
-	runner_pool::~runner_pool() {}
+	void scheduler::__worker_run(u32_t wi) {
+		__tls_scheduler = this;
+		__tls_scheduler_wi = wi;
 
-	void runner_pool::init(scheduler* s) {
-		netp::lock_guard<mutex> _lg(m_mutex);
-		m_is_running = true;
-		m_last_runner_idx = 0;
+		u32_t idle = 0;
+		while (1) {
+			task_node* n = _take(wi);
+			if (n != nullptr) {
+				idle = 0;
+				try {
+					n->run();
+				} catch (netp::exception& e) {
+					NETP_ERR("[scheduler][-%u-]worker netp::exception: [%d]%s\n%s(%d) %s\n%s",
+						wi, e.code(), e.what(), e.file(), e.line(), e.function(), e.callstack());
+					throw;
+				} catch (std::exception& e) {
+					NETP_ERR("[scheduler][-%u-]worker exception: %s", wi, e.what());
+					throw;
+				} catch (...) {
+					NETP_ERR("[scheduler][-%u-]worker, unknown exception", wi);
+					throw;
+				}
+				continue;
+			}
 
-		u8_t i = 0;
-		while (m_runners.size() < m_max_concurrency) {
-			NRP<runner> tr = netp::make_ref<runner>(i, s);
-			NETP_ALLOC_CHECK(tr, sizeof(runner));
-			int rt = tr->start();
-			if (rt != netp::OK) {
-				tr->stop();
-				NETP_THROW("create thread failed");
+			//a running task might schedule new one to its own worker, exit only if there is no task left at all
+			if (m_state.load(std::memory_order_acquire) == S_EXIT && m_pending.load(std::memory_order_acquire) <= 0) {
+				break;
 			}
-			++i;
-			m_runners.push_back(tr);
-		}
-	}
 
-	void runner_pool::deinit() {
-		netp::lock_guard<mutex> _lg(m_mutex);
-		if (m_is_running == false) { return; }
+			if (++idle < NETP_SCHEDULER_IDLE_SPIN) {
+				std::this_thread::yield();
+				continue;
+			}
+			idle = 0;
 
-		m_is_running = false;
-		while (!m_runners.empty()) {
-			m_runners.pop_back();
+			unique_lock<mutex> ulk(m_park_mtx);
+			m_parked.fetch_add(1, std::memory_order_seq_cst);
+			while (m_pending.load(std::memory_order_seq_cst) <= 0 && m_state.load(std::memory_order_acquire) != S_EXIT) {
+				m_park_cond.no_interrupt_wait(ulk);
+			}
+			m_parked.fetch_sub(1, std::memory_order_relaxed);
 		}
+
+		__tls_scheduler = nullptr;
+		NETP_TRACE_TASK("[scheduler][-%u-]worker exit", wi);
 	}
 
-	void runner_pool::set_max_task_runner(u8_t const& count) {
-		unique_lock<mutex> _lg(m_mutex);
-		m_max_concurrency = count;
-		//dynamic clear ,,if ...
-		while (m_runners.size() > m_max_concurrency) {
-			m_runners.pop_back();
+	int scheduler::start() {
+		u8_t _SI = S_IDLE;
+		if (!m_state.compare_exchange_strong(_SI, u8_t(S_RUN), std::memory_order_acq_rel, std::memory_order_acquire)) {
+			return netp::E_OP_ALREADY;
 		}
-	}
-	scheduler::scheduler( u8_t const& max_runner):
-		m_mutex(),
-		m_condition(),
-		m_state( S_IDLE ),
-		m_max_concurrency(max_runner),
-		m_runner_pool(nullptr)
-	{
-	}
 
-	scheduler::~scheduler() {
-		stop();
-		NETP_TRACE_TASK("[scheduler]~scheduler()");
-	}
+		m_pending.store(0, std::memory_order_relaxed);
+		m_parked.store(0, std::memory_order_relaxed);
+		for (u8_t i = 0; i < m_max_concurrency; ++i) {
+			scheduler_worker* w = netp::allocator<scheduler_worker>::make();
+			NETP_ALLOC_CHECK(w, sizeof(scheduler_worker));
+			m_workers.push_back(w);
+		}
 
-	int scheduler::start() {
-		{
-			unique_lock<spin_mutex> _ul(m_mutex);
-			if (m_state == S_EXIT) {
-				m_state = S_IDLE;
+		//all the workers must be there before anyone of them steals
+		for (u8_t i = 0; i < m_max_concurrency; ++i) {
+			NRP<netp::thread> th = netp::make_ref<netp::thread>();
+			NETP_ALLOC_CHECK(th, sizeof(netp::thread));
+			int rt = th->start(&scheduler::__worker_run, this, u32_t(i));
+			if (rt != netp::OK) {
+				NETP_THROW("create thread failed");
 			}
+			m_workers[i]->th = th;
 		}
-		__on_start();
 		return netp::OK;
 	}
 
 	void scheduler::stop() {
-		{
-			NETP_TRACE_TASK("scheduler::stop begin");
-			{
-				lock_guard<spin_mutex> _ul(m_mutex);
-				if (m_state == S_EXIT || m_state == S_IDLE) { return; }
-			}
-			NETP_TRACE_TASK("scheduler::stop __block_until_no_new_task()");
-
-			//experiment
-			__block_until_no_new_task();
-			NETP_TRACE_TASK("scheduler::stop __block_until_no_new_task() exit");
-
-			lock_guard<spin_mutex> _ul( m_mutex );
-			if( m_state == S_EXIT || m_state == S_IDLE ) { return; }
-
-			m_state = S_EXIT;
-			m_condition.notify_one();
+		u8_t _SR = S_RUN;
+		if (!m_state.compare_exchange_strong(_SR, u8_t(S_EXIT), std::memory_order_acq_rel, std::memory_order_acquire)) {
+			return;
 		}
-		NETP_TRACE_TASK("scheduler::stop __block_until_no_new_task() on_stop");
-		__on_stop();
-		NETP_TRACE_TASK("scheduler::stop __block_until_no_new_task() on_stop exit");
-	}
-
-	void scheduler::__on_start() {
-		unique_lock<spin_mutex> _ul( m_mutex );
-
-		m_state = S_RUN;
-		m_tasks_assigning = netp::allocator<priority_task_queue>::make();
-		m_tasks_runner_wait_count = 0;
-
-		m_runner_pool = netp::allocator<runner_pool>::make( m_max_concurrency ) ;
-		NETP_ALLOC_CHECK( m_runner_pool, sizeof(runner_pool) ) ;
-		m_runner_pool->init(this);
-	}
-
-	void scheduler::__on_stop() {
-		NETP_ASSERT( m_state == S_EXIT );
-		NETP_ASSERT( m_tasks_assigning->empty() );
-
-		m_runner_pool->deinit();
-
-		netp::allocator<priority_task_queue>::trash( m_tasks_assigning );
-		netp::allocator<runner_pool>::trash(m_runner_pool);
-		m_tasks_assigning = 0;
-		 m_runner_pool =0;
-	}
-
-	void scheduler::__block_until_no_new_task() {
-
-		u8_t self_flag = 0;
-		u8_t runner_flag = 0;
-		while (1) {
-		begin:
-
-			if (self_flag == 0) {
-				while (!m_tasks_assigning->empty()) {
-					netp::this_thread::no_interrupt_yield(50);
-					runner_flag = 0;
-				}
-				self_flag = 1;
-			}
-			else if (self_flag == 1) {
-				while (!m_tasks_assigning->empty()) {
-					self_flag = 0;
-					runner_flag = 0;
-					netp::this_thread::no_interrupt_yield(50);
-					goto begin;
-				}
-				self_flag = 2;
-			}
 
-			if (runner_flag == 0) {
-				while (!m_runner_pool->test_waiting_step1()) {
-					netp::this_thread::no_interrupt_yield(50);
-					self_flag = 0;
-					runner_flag = 0;
-					goto begin;
-				}
-				runner_flag = 1;
-			}
-			else if (runner_flag == 1) {
-				while (!m_runner_pool->test_waiting_step2()	) {
-					netp::this_thread::no_interrupt_yield(50);
-					self_flag = 0;
-					runner_flag = 0;
-					goto begin;
-				}
-				runner_flag = 2;
+		NETP_TRACE_TASK("scheduler::stop begin");
+		{
+			lock_guard<mutex> lg(m_park_mtx);
+			m_park_cond.no_interrupt_notify_all();
+		}
+		for (u32_t i = 0; i < m_workers.size(); ++i) {
+			if (m_workers[i]->th != nullptr) {
+				m_workers[i]->th->join();
 			}
+		}
 
-			if (self_flag == 2 && runner_flag == 2) {
-				break;
+		for (u32_t i = 0; i < m_workers.size(); ++i) {
+			scheduler_worker* w = m_workers[i];
+			for (u8_t p = 0; p < P_MAX; ++p) {
+				NETP_ASSERT(w->tasks[p].head == nullptr);
 			}
+			netp::allocator<scheduler_worker>::trash(w);
 		}
+		m_workers.clear();
+		m_state.store(S_IDLE, std::memory_order_release);
+		NETP_TRACE_TASK("scheduler::stop end");
 	}
 }//end of ns
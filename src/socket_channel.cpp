@@ -299,6 +299,7 @@ int socket_base::get_left_snd_queue() const {
 			m_chflag |= int(channel_flag::F_WRITE_BARRIER);
 			ch_is_connected() ? __do_io_write(netp::OK, m_io_ctx) : __do_io_write_to(netp::OK, m_io_ctx);
 			m_chflag &= ~int(channel_flag::F_WRITE_BARRIER);
+			__ch_drained_check();
 #else
 			ch_io_write();
 #endif
@@ -334,6 +335,29 @@ int socket_base::get_left_snd_queue() const {
 			return;
 		}
 
+		//the ephemeral port taken by the kernel
+		if (addr->port() == 0) {
+			rt = load_sockname();
+			if (rt != netp::OK) {
+				NETP_WARN("[socket][#%d]load_sockname(%s): %d", m_fd, addr->to_string().c_str(), rt);
+				m_chflag |= int(channel_flag::F_READ_ERROR);//for assert check
+				ch_errno() = rt;
+				ch_close_impl(nullptr);
+				intp->set(rt);
+				return;
+			}
+		}
+
+#ifdef __NETP_ENABLE_SO_INCOMING_CPU
+		if ((listener_cfg->listen_flag&u8_t(F_LISTEN_INCOMING_CPU)) && L->has_thread_affinity()) {
+			//hint only, keep listening if it fails
+			rt = cfg_incoming_cpu(L->thread_affinity());
+			if (rt != netp::OK) {
+				NETP_WARN("[socket][#%d]cfg_incoming_cpu(%u): %d, addr: %s", m_fd, L->thread_affinity(), rt, addr->to_string().c_str());
+			}
+		}
+#endif
+
 		rt = socket_channel::listen(backlog);
 		if (rt != netp::OK) {
 			NETP_WARN("[socket][#%d]listen(%u): %d, addr: %s", m_fd, backlog, rt, addr->to_string().c_str());
@@ -540,7 +564,8 @@ int socket_base::get_left_snd_queue() const {
 				}
 			}
 			
-			NRP<event_loop> LL = L->group()->next();
+			//for reuseport sharding, the accepted channel stay on this loop, no cross-thread schedule
+			NRP<event_loop> LL = (listener_cfg->listen_flag&u8_t(F_LISTEN_REUSEPORT_SHARDING)) ? L : L->group()->next();
 			LL->execute([LL,fn_initializer,nfd, laddr, raddr, listener_cfg]() {
 				NRP<socket_cfg> cfg_ = netp::make_ref<socket_cfg>();
 				cfg_->fd = nfd;
@@ -591,6 +616,12 @@ int socket_base::get_left_snd_queue() const {
 
 	void socket_channel::__do_io_read_from(int status, io_ctx* ) {
 		NETP_ASSERT(m_protocol == u8_t(NETP_PROTOCOL_UDP));
+#ifdef NETP_ENABLE_UDP_MMSG
+		if (m_family != u16_t(NETP_AF_USER)) {
+			__do_io_read_from_mmsg(status);
+			return;
+		}
+#endif
 		while (status == netp::OK) {
 			NETP_ASSERT((m_chflag & (int(channel_flag::F_READ_SHUTDOWNING))) == 0);
 			/*@NOTE: ch_fire_read might result in F_WATCH_READ BE RESET*/
@@ -604,20 +635,57 @@ int socket_base::get_left_snd_queue() const {
 				status = nbytes;
 				break;
 			}
-			loop_buf->incre_write_idx(nbytes);
-			NRP<netp::packet> __tmp =netp::make_ref<netp::packet>(L->channel_rcv_buf_size());
-			__tmp.swap(loop_buf);
-			channel::ch_fire_readfrom(std::move(__tmp), __address_nonnullptr_);
+			channel::ch_fire_readfrom(L->channel_rcv_buf_take(u32_t(nbytes)), __address_nonnullptr_);
 		}
 		___do_io_read_done(status);
 	}
 
+#ifdef NETP_ENABLE_UDP_MMSG
+	void socket_channel::__do_io_read_from_mmsg(int status) {
+		struct mmsghdr msgvec[NETP_UDP_MMSG_BATCH];
+		struct iovec iov[NETP_UDP_MMSG_BATCH];
+		while (status == netp::OK) {
+			NETP_ASSERT((m_chflag & (int(channel_flag::F_READ_SHUTDOWNING))) == 0);
+			if (NETP_UNLIKELY(int(channel_flag::F_WATCH_READ) != (m_chflag & (int(channel_flag::F_WATCH_READ) | int(channel_flag::F_READ_SHUTDOWN) | int(channel_flag::F_CLOSE_PENDING)))))
+			{ return; }
+
+			L->channel_rcv_mmsg_prepare(msgvec, iov);
+			const int n = socket_recvmmsg_impl(msgvec, NETP_UDP_MMSG_BATCH);
+			if (NETP_UNLIKELY(n < 0)) {
+				status = n;
+				break;
+			}
+
+			//move out of the loop slot before firing, the pipeline might trigger another read of this loop
+			//a small datagram is copied out, the slot is kept for the next batch
+			const u32_t right_size_max = L->channel_rcv_right_size_max();
+			for (int i = 0; i < n; ++i) {
+				NRP<netp::packet> __tmp;
+				NRP<netp::address> __from;
+				if (msgvec[i].msg_len <= right_size_max) {
+					__tmp = L->channel_rcv_pool()->get(msgvec[i].msg_len);
+					__tmp->write(L->channel_rcv_mmsg_buf(u32_t(i))->head(), msgvec[i].msg_len);
+				} else {
+					__tmp.swap(L->channel_rcv_mmsg_buf(u32_t(i)));
+					__tmp->incre_write_idx(msgvec[i].msg_len);
+				}
+				__from.swap(L->channel_rcv_mmsg_addr(u32_t(i)));
+				/*@NOTE: ch_fire_readfrom might result in F_WATCH_READ BE RESET, the left of this batch has been taken from the kernel, deliver it unless we're closing*/
+				if (NETP_UNLIKELY(0 != (m_chflag & (int(channel_flag::F_READ_SHUTDOWN) | int(channel_flag::F_READ_ERROR) | int(channel_flag::F_CLOSE_PENDING) | int(channel_flag::F_CLOSING)))))
+				{ continue; }
+				channel::ch_fire_readfrom(std::move(__tmp), __from);
+			}
+		}
+		___do_io_read_done(status);
+	}
+#endif
+
 	void socket_channel::__do_io_read(int status, io_ctx* ioctx) {
 		//NETP_INFO("READ IN");
 #ifdef _NETP_DEBUG
 		NETP_ASSERT(!ch_is_listener());
 		NETP_ASSERT(L->in_event_loop());
-		NETP_ASSERT(L->channel_rcv_buf()->len() == 0 && L->channel_rcv_buf()->left_right_capacity() == L->channel_rcv_buf_size());
+		NETP_ASSERT(L->channel_rcv_buf()->len() == 0 && L->channel_rcv_buf()->left_right_capacity() >= L->channel_rcv_buf_size());
 #endif
 
 		//in case socket object be destructed during ch_read
@@ -650,10 +718,7 @@ int socket_base::get_left_snd_queue() const {
 			}
 
 			//@note: udp socket might receive a 0 len pkt
-			loop_buf->incre_write_idx(nbytes);
-			NRP<netp::packet> __tmp = netp::make_ref<netp::packet>(size);
-			__tmp.swap(loop_buf);
-			channel::ch_fire_read(std::move(__tmp));
+			channel::ch_fire_read(L->channel_rcv_buf_take(u32_t(nbytes)));
 		}
 
 		//for epoll et, (nbytes<size && rdhub is set)
@@ -672,7 +737,7 @@ int socket_base::get_left_snd_queue() const {
 		NETP_ASSERT( (m_chflag&(int(channel_flag::F_WRITE_SHUTDOWNING)|int(channel_flag::F_TX_LIMIT)|int(channel_flag::F_CLOSING) | int(channel_flag::F_WRITE_ERROR) |int(channel_flag::F_WRITE_SHUTDOWN) )) == 0 );
 		//NETP_TRACE_SOCKET("[socket][%s]__do_io_write, write begin: %d, flag: %u", ch_info().c_str(), status , m_chflag );
 		if (status == netp::OK) {
-			status = socket_channel::___do_io_write();
+			status = ___do_io_write();
 		}
 		__do_io_write_done(status);
 	}
@@ -708,6 +773,13 @@ int socket_base::get_left_snd_queue() const {
 #ifdef _NETP_DEBUG
 			NETP_ASSERT( is_udp() ? true: (m_tx_bytes) > 0 );
 #endif
+
+#ifdef NETP_ENABLE_VECTORED_WRITE
+			//@note: udp pkt boundary must be kept, user defined socket may not impl sendv
+			if ( (m_tx_entry_q.size()>1) && is_stream() && (m_family != u16_t(NETP_AF_USER)) ) {
+				return ___do_io_writev();
+			}
+#endif
 			socket_outbound_entry& entry = m_tx_entry_q.front();
 			const u32_t dlen = (entry.data->len());
 			u32_t wlen = (dlen-entry.written);
@@ -734,19 +806,16 @@ int socket_base::get_left_snd_queue() const {
 
 			m_tx_bytes -= nbytes;
 			if (m_tx_limit != 0 ) {
-				m_tx_budget -= nbytes;
-				u32_t __tx_limit_clock_ms = netp::app::instance()->channel_tx_limit_clock();
-				if (!(m_chflag & int(channel_flag::F_TX_LIMIT_TIMER)) && ( (m_tx_budget < ((m_tx_limit/(1000/__tx_limit_clock_ms))) ) ) ) {
-					m_chflag |= int(channel_flag::F_TX_LIMIT_TIMER);
-					m_tx_limit_last_tp = netp::now<netp::microseconds_duration_t, netp::steady_clock_t>().time_since_epoch().count();
-					L->launch(netp::make_ref<netp::timer>(std::chrono::milliseconds(__tx_limit_clock_ms), &socket_channel::_tmcb_tx_limit, NRP<socket_channel>(this), std::placeholders::_1));
-				}
+				___tx_budget_consume(u32_t(nbytes));
 			}
 
 			entry.written += nbytes;
 			if ((entry.written == dlen)) {
-				entry.write_promise->set(netp::OK);
+				NRP<promise<int>> wp = std::move(entry.write_promise);
 				m_tx_entry_q.pop_front();
+				if (wp != nullptr) {
+					wp->set(netp::OK);
+				}
 			} else {
 				NETP_ASSERT(!is_udp(), "proto: %u", sock_protocol() );
 			}
@@ -754,12 +823,102 @@ int socket_base::get_left_snd_queue() const {
 		return netp::OK;
 	}
 
+	void socket_channel::___tx_budget_consume(u32_t nbytes) {
+		NETP_ASSERT(m_tx_limit != 0 && m_tx_budget >= nbytes);
+		m_tx_budget -= nbytes;
+		u32_t __tx_limit_clock_ms = netp::app::instance()->channel_tx_limit_clock();
+		if (!(m_chflag & int(channel_flag::F_TX_LIMIT_TIMER)) && ( (m_tx_budget < ((m_tx_limit/(1000/__tx_limit_clock_ms))) ) ) ) {
+			m_chflag |= int(channel_flag::F_TX_LIMIT_TIMER);
+			m_tx_limit_last_tp = netp::now<netp::microseconds_duration_t, netp::steady_clock_t>().time_since_epoch().count();
+			L->launch(netp::make_ref<netp::timer>(std::chrono::milliseconds(__tx_limit_clock_ms), &socket_channel::_tmcb_tx_limit, NRP<socket_channel>(this), std::placeholders::_1));
+		}
+	}
+
+	void socket_channel::___tx_entry_consume(u32_t nbytes) {
+		m_tx_bytes -= nbytes;
+		if (m_tx_limit != 0) {
+			___tx_budget_consume(nbytes);
+		}
+
+		//resolve entry by entry, write_promise->set might push new entry to the back of the q
+		while (nbytes > 0) {
+			socket_outbound_entry& entry = m_tx_entry_q.front();
+			const u32_t elen = (entry.data->len() - entry.written);
+			if (nbytes < elen) {
+				entry.written += nbytes;
+				break;
+			}
+			nbytes -= elen;
+			NRP<promise<int>> wp = std::move(entry.write_promise);
+			m_tx_entry_q.pop_front();
+			if (wp != nullptr) {
+				wp->set(netp::OK);
+			}
+		}
+	}
+
+#ifdef NETP_ENABLE_VECTORED_WRITE
+	//gather as many entries as we can (NETP_IOV_MAX at most, tx_budget if tx_limit is set) into one sendv
+	//a short write means the kernel snd buffer is full for stream socket, return E_EWOULDBLOCK directly to save a syscall
+	int socket_channel::___do_io_writev() {
+		NETP_ASSERT(is_stream());
+		iov_t iov[NETP_IOV_MAX];
+
+		while (m_tx_entry_q.size()) {
+			u32_t iovcnt = 0;
+			u32_t wtotal = 0;
+			socket_outbound_entry_t::iterator it = m_tx_entry_q.begin();
+			while ( (it != m_tx_entry_q.end()) && (iovcnt < u32_t(NETP_IOV_MAX)) ) {
+				u32_t wlen = (it->data->len() - it->written);
+				if ( (m_tx_limit != 0) && ((m_tx_budget-wtotal) < wlen) ) {
+					//split the last one by the left budget
+					wlen = (m_tx_budget - wtotal);
+					if (wlen > 0) {
+						NETP_IOV_SET(iov[iovcnt], (it->data->head() + it->written), wlen);
+						++iovcnt;
+						wtotal += wlen;
+					}
+					break;
+				}
+				NETP_IOV_SET(iov[iovcnt], (it->data->head() + it->written), wlen);
+				++iovcnt;
+				wtotal += wlen;
+				++it;
+			}
+
+			if (iovcnt == 0) {
+#ifdef _NETP_DEBUG
+				NETP_ASSERT( (m_tx_budget == 0) && (m_chflag&int(channel_flag::F_TX_LIMIT_TIMER)) );
+#endif
+				return netp::E_CHANNEL_TXLIMIT;
+			}
+
+			const int nbytes = socket_sendv_impl(iov, iovcnt);
+			if (NETP_UNLIKELY(nbytes < 0)) {
+				return nbytes;
+			}
+
+			___tx_entry_consume(u32_t(nbytes));
+			if (u32_t(nbytes) < wtotal) {
+				return netp::E_EWOULDBLOCK;
+			}
+		}
+		return netp::OK;
+	}
+#endif
+
 	int socket_channel::___do_io_write_to() {
 #ifdef _NETP_DEBUG
 		NETP_ASSERT( !ch_is_connected() && m_tx_entry_to_q.size() && m_tx_entry_q.empty(), "%s, flag: %u", ch_info().c_str(), m_chflag);
 #endif
 		NETP_ASSERT(m_chflag & (int(channel_flag::F_WRITE_BARRIER)|int(channel_flag::F_WATCH_WRITE)));
 
+#ifdef NETP_ENABLE_UDP_MMSG
+		if ( (m_tx_entry_to_q.size()>1) && (m_family != u16_t(NETP_AF_USER)) ) {
+			return ___do_io_write_to_mmsg();
+		}
+#endif
+
 		//there might be a chance to be blocked a while in this loop, if set trigger another write
 		int status = netp::OK;
 		while ( m_tx_entry_to_q.size() ) {
@@ -777,6 +936,59 @@ int socket_base::get_left_snd_queue() const {
 		return netp::OK;
 	}
 
+#ifdef NETP_ENABLE_UDP_MMSG
+	int socket_channel::___do_io_write_to_mmsg() {
+		struct mmsghdr msgvec[NETP_UDP_MMSG_BATCH];
+		struct iovec iov[NETP_UDP_MMSG_BATCH];
+		struct sockaddr_in to[NETP_UDP_MMSG_BATCH];
+
+		while (m_tx_entry_to_q.size()) {
+			u32_t vlen = 0;
+			socket_outbound_entry_to_t::iterator it = m_tx_entry_to_q.begin();
+			while ((it != m_tx_entry_to_q.end()) && (vlen < NETP_UDP_MMSG_BATCH)) {
+				//@note: udp allow zero-len pkt
+				iov[vlen].iov_base = it->data->head();
+				iov[vlen].iov_len = it->data->len();
+				struct msghdr& hdr = msgvec[vlen].msg_hdr;
+				if (it->to != nullptr) {
+					::memset(&to[vlen], 0, sizeof(struct sockaddr_in));
+					to[vlen].sin_family = u16_t(it->to->family());
+					to[vlen].sin_port = it->to->nport();
+					to[vlen].sin_addr.s_addr = it->to->nipv4().u32;
+					hdr.msg_name = &to[vlen];
+					hdr.msg_namelen = sizeof(struct sockaddr_in);
+				} else {
+					hdr.msg_name = NULL;
+					hdr.msg_namelen = 0;
+				}
+				hdr.msg_iov = &iov[vlen];
+				hdr.msg_iovlen = 1;
+				hdr.msg_control = NULL;
+				hdr.msg_controllen = 0;
+				hdr.msg_flags = 0;
+				msgvec[vlen].msg_len = 0;
+				++vlen;
+				++it;
+			}
+
+			const int n = socket_sendmmsg_impl(msgvec, vlen);
+			if (n < 0) {
+				return n;
+			}
+
+			for (int i = 0; i < n; ++i) {
+				socket_outbound_entry_to& entry = m_tx_entry_to_q.front();
+				NETP_ASSERT((entry.data->len() <= m_tx_bytes));
+				m_tx_bytes -= u32_t(entry.data->len());
+				NRP<promise<int>> wp = std::move(entry.write_promise);
+				m_tx_entry_to_q.pop_front();
+				wp->set(netp::OK);
+			}
+		}
+		return netp::OK;
+	}
+#endif
+
 	void socket_channel::_ch_do_close_listener() {
 		NETP_ASSERT(L->in_event_loop());
 		NETP_ASSERT(m_chflag & int(channel_flag::F_LISTENING));
@@ -899,16 +1111,24 @@ __act_label_close_read_write:
 		if (closep) { closep->set(prt); }
 	}
 
+//the write without promise (post_write) gets its error by the error event of the pipeline
+#define __CH_WRITE_REJECT__(chp, code) \
+		if (chp != nullptr) { \
+			chp->set(code); \
+		} else { \
+			ch_fire_error(code); \
+		} \
+
 #define __CH_WRITEABLE_CHECK__( outlet, chp) \
 		if (m_chflag&(int(channel_flag::F_READ_ERROR)|int(channel_flag::F_WRITE_ERROR)|int(channel_flag::F_WRITE_SHUTDOWN)|int(channel_flag::F_WRITE_SHUTDOWN_PENDING)|int(channel_flag::F_WRITE_SHUTDOWNING)|int(channel_flag::F_CLOSE_PENDING)|int(channel_flag::F_CLOSING) ) ) { \
-			chp->set(netp::E_CHANNEL_WRITE_ABORT); \
+			__CH_WRITE_REJECT__(chp, netp::E_CHANNEL_WRITE_ABORT); \
 			return ; \
 		} \
 		const u32_t outlet_len = (u32_t)outlet->len(); \
 		/*set the threshold arbitrarily high, the writer have to check the return value if */ \
 		if ( (m_tx_bytes>0) && ( (m_tx_bytes + outlet_len) > m_snd_buf_size) ) { \
 			NETP_ASSERT(m_chflag&(int(channel_flag::F_WRITE_BARRIER)|int(channel_flag::F_WATCH_WRITE))); \
-			chp->set(netp::E_CHANNEL_WRITE_BLOCK); \
+			__CH_WRITE_REJECT__(chp, netp::E_CHANNEL_WRITE_BLOCK); \
 			return; \
 		} \
 
@@ -916,7 +1136,7 @@ __act_label_close_read_write:
 	{
 #ifdef _NETP_DEBUG
 		NETP_ASSERT(L->in_event_loop());
-		NETP_ASSERT((intp != nullptr) && ( is_udp() ? true: (outlet->len() > 0)) );
+		NETP_ASSERT( is_udp() ? true: (outlet->len() > 0) );
 		NETP_ASSERT(m_snd_buf_size>0);
 #endif
 
@@ -924,11 +1144,13 @@ __act_label_close_read_write:
 
 #ifdef _NETP_DEBUG
 			NETP_ASSERT(ch_is_connected(),"socket[%s]flag: %u", ch_info().c_str(), m_chflag );
-			NETP_ASSERT((m_chflag & (int(channel_flag::F_WATCH_WRITE) | int(channel_flag::F_TX_LIMIT))) ? m_tx_entry_q.size() : true, "[#%s]flag: %d, errno: %d", ch_info().c_str(), m_chflag, m_cherrno);
+			//a write_promise resolved in the write barrier writes again right after its entry is popped, the q might be empty
+			NETP_ASSERT(((m_chflag & (int(channel_flag::F_WATCH_WRITE) | int(channel_flag::F_TX_LIMIT))) && !(m_chflag & int(channel_flag::F_WRITE_BARRIER))) ? m_tx_entry_q.size() : true, "[#%s]flag: %d, errno: %d", ch_info().c_str(), m_chflag, m_cherrno);
 #endif
 
 		m_tx_entry_q.push_back({
 			0,
+			true,
 			outlet,
 			intp
 		});
@@ -943,6 +1165,57 @@ __act_label_close_read_write:
 		m_chflag |= int(channel_flag::F_WRITE_BARRIER);
 		__do_io_write(netp::OK, m_io_ctx);
 		m_chflag &= ~int(channel_flag::F_WRITE_BARRIER);
+		__ch_drained_check();
+#else
+		ch_io_write();
+#endif
+	}
+
+	//one entry for one slice, ___do_io_writev gathers them into one sendv, no copy
+	//datagram boundary must be kept, coalesce for non-stream socket
+	void socket_channel::ch_write_chain_impl(NRP<promise<int>> const& intp, NRP<packet_chain> const& chain) {
+		if ((chain->count() < 2) || !is_stream()) {
+			ch_write_impl(intp, chain->to_packet());
+			return;
+		}
+
+#ifdef _NETP_DEBUG
+		NETP_ASSERT(L->in_event_loop());
+		NETP_ASSERT(m_snd_buf_size>0);
+#endif
+
+		__CH_WRITEABLE_CHECK__(chain, intp);
+
+#ifdef _NETP_DEBUG
+		NETP_ASSERT(ch_is_connected(), "socket[%s]flag: %u", ch_info().c_str(), m_chflag);
+#endif
+
+		const packet_chain::const_iterator last = chain->end() - 1;
+		for (packet_chain::const_iterator it = chain->begin(); it != last; ++it) {
+			m_tx_entry_q.push_back({
+				0,
+				false,
+				*it,
+				nullptr
+			});
+		}
+		m_tx_entry_q.push_back({
+			0,
+			true,
+			*last,
+			intp
+		});
+		m_tx_bytes += outlet_len;
+
+		if (m_chflag&(int(channel_flag::F_WRITE_BARRIER)|int(channel_flag::F_WATCH_WRITE)|int(channel_flag::F_TX_LIMIT))) {
+			return;
+		}
+
+#ifdef NETP_ENABLE_FAST_WRITE
+		m_chflag |= int(channel_flag::F_WRITE_BARRIER);
+		__do_io_write(netp::OK, m_io_ctx);
+		m_chflag &= ~int(channel_flag::F_WRITE_BARRIER);
+		__ch_drained_check();
 #else
 		ch_io_write();
 #endif
@@ -977,6 +1250,7 @@ __act_label_close_read_write:
 		m_chflag |= int(channel_flag::F_WRITE_BARRIER);
 		__do_io_write_to(netp::OK,m_io_ctx);
 		m_chflag &= ~int(channel_flag::F_WRITE_BARRIER);
+		__ch_drained_check();
 #else
 		ch_io_write();
 #endif
@@ -1024,6 +1298,7 @@ __act_label_close_read_write:
 			m_chflag |= int(channel_flag::F_WRITE_BARRIER);
 			ch_is_connected() ? __do_io_write(status, ctx) : __do_io_write_to(status, ctx);
 			m_chflag &= ~int(channel_flag::F_WRITE_BARRIER);
+			__ch_drained_check();
 			return;
 		}
 		NETP_ASSERT(m_fn_write != nullptr);
@@ -1224,7 +1499,7 @@ __act_label_close_read_write:
 		//please do ch_io_begin by manual
 
 		NRP<netp::promise<std::tuple<int, NRP<socket_channel>>>> socket_channel::dup(NRP<event_loop> const& LL) {
-			NETP_ASSERT( (L->poller_type() == LL->poller_type()) && (LL->poller_type() == NETP_DEFAULT_POLLER_TYPE) );
+			NETP_ASSERT( (L->poller_type() == LL->poller_type()) && NETP_IS_SOCKET_POLLER_TYPE(LL->poller_type()) );
 
 			NRP<netp::promise<std::tuple<int, NRP<socket_channel>>>> p =
 				netp::make_ref<netp::promise<std::tuple<int, NRP<socket_channel>>>>();
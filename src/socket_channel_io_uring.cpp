@@ -0,0 +1,285 @@
+#include <netp/core.hpp>
+#include <netp/app.hpp>
+#include <netp/socket_channel_io_uring.hpp>
+
+#ifdef NETP_IO_URING_COMPLETION_IO
+
+namespace netp {
+
+	//write inline as long as the kernel takes it, a write chained by a write_promise goes out in the same tick
+	//what is left by a full snd buffer is gathered (NETP_IO_URING_SEND_IOV_MAX at most, tx_budget if tx_limit is set) into one sendmsg, resolved by iou_send_done
+	int socket_channel_io_uring::___do_io_write() {
+#ifdef _NETP_DEBUG
+		NETP_ASSERT(ch_is_connected() && is_stream(), "%s, flag: %u", ch_info().c_str(), m_chflag);
+#endif
+		NETP_ASSERT(m_chflag & (int(channel_flag::F_WRITE_BARRIER) | int(channel_flag::F_WATCH_WRITE)));
+		NETP_ASSERT((m_chflag & int(channel_flag::F_TX_LIMIT)) == 0);
+
+		if (m_tx_entry_q.empty()) {
+			return netp::OK;
+		}
+		NETP_ASSERT((poller_io_uring::state(m_io_ctx) & IOU_SEND_INFLIGHT) == 0);
+
+		const int wrt = socket_channel::___do_io_write();
+		if ((wrt != netp::E_EWOULDBLOCK) || m_tx_entry_q.empty()) {
+			return wrt;
+		}
+
+		io_uring_tx* tx = m_iou->tx(m_io_ctx);
+		u32_t wtotal = 0;
+		socket_outbound_entry_t::iterator it = m_tx_entry_q.begin();
+		while ((it != m_tx_entry_q.end()) && (tx->n < u32_t(NETP_IO_URING_SEND_IOV_MAX))) {
+			const u32_t elen = (it->data->len() - it->written);
+			const u32_t wlen = ((m_tx_limit != 0) && ((m_tx_budget - wtotal) < elen)) ? (m_tx_budget - wtotal) : elen;
+			if (wlen == 0) {
+				break;
+			}
+			NETP_IOV_SET(tx->iov[tx->n], (it->data->head() + it->written), wlen);
+			tx->hold[tx->n] = it->data;
+			++tx->n;
+			wtotal += wlen;
+			if (wlen < elen) {
+				//split the last one by the left budget
+				break;
+			}
+			++it;
+		}
+
+		if (tx->n == 0) {
+#ifdef _NETP_DEBUG
+			NETP_ASSERT((m_tx_budget == 0) && (m_chflag & int(channel_flag::F_TX_LIMIT_TIMER)));
+#endif
+			return netp::E_CHANNEL_TXLIMIT;
+		}
+
+		const int rt = m_iou->send(m_io_ctx);
+		if (rt != netp::OK) {
+			for (u32_t i = 0; i < tx->n; ++i) {
+				tx->hold[i] = nullptr;
+			}
+			tx->n = 0;
+			return rt;
+		}
+		//ch_io_write watches the write till iou_send_done
+		return netp::E_EWOULDBLOCK;
+	}
+
+	void socket_channel_io_uring::iou_send_done(int nbytes, io_ctx* ctx) {
+		//the entries have been dropped by the close write which cancels the send
+		if ((m_iou_flag & IOU_CH_WRITE) == 0) {
+			return;
+		}
+		NETP_ASSERT(m_chflag & int(channel_flag::F_WATCH_WRITE));
+
+		//go on like a fast write, the write of a write_promise is queued behind the barrier, the next send watches the write again
+		m_iou_flag &= ~IOU_CH_WRITE;
+		m_chflag &= ~(int(channel_flag::F_USE_DEFAULT_WRITE) | int(channel_flag::F_WATCH_WRITE));
+		m_chflag |= int(channel_flag::F_WRITE_BARRIER);
+		if (nbytes >= 0) {
+			___tx_entry_consume(u32_t(nbytes));
+		}
+		//a write_promise might close the write right away
+		if ((m_chflag & (int(channel_flag::F_WRITE_SHUTDOWNING) | int(channel_flag::F_WRITE_SHUTDOWN) | int(channel_flag::F_WRITE_ERROR) | int(channel_flag::F_CLOSING))) == 0) {
+			__do_io_write((nbytes >= 0) ? netp::OK : nbytes, ctx);
+		}
+		m_chflag &= ~int(channel_flag::F_WRITE_BARRIER);
+		__ch_drained_check();
+	}
+
+	void socket_channel_io_uring::__iou_recv() {
+		//a canceling one is armed again by its last completion
+		if (poller_io_uring::state(m_io_ctx) & IOU_RECV_INFLIGHT) {
+			return;
+		}
+		const int rt = m_iou->recv(m_io_ctx);
+		if (NETP_UNLIKELY(rt != netp::OK)) {
+			NETP_ERR("[socket][%s]io_uring recv, rt: %d", ch_info().c_str(), rt);
+			___do_io_read_done(rt);
+		}
+	}
+
+	//fire the ones received while the read is paused, then go on with the recv
+	void socket_channel_io_uring::__iou_rx_flush() {
+		while ((m_iou_flag & IOU_CH_READ) && m_rx_pending.size()) {
+			NRP<packet> pkt = std::move(m_rx_pending.front());
+			m_rx_pending.pop_front();
+			channel::ch_fire_read(std::move(pkt));
+		}
+		if ((m_iou_flag & IOU_CH_READ) == 0) {
+			return;
+		}
+		if (m_rx_status != netp::OK) {
+			const int status = m_rx_status;
+			m_rx_status = netp::OK;
+			___do_io_read_done(status);
+			return;
+		}
+		__iou_recv();
+	}
+
+	void socket_channel_io_uring::iou_recv_done(int nbytes, byte_t const* buf, bool more, io_ctx*) {
+		//ignore the left read buffer, cuz we're closing it
+		if (m_chflag & (int(channel_flag::F_READ_SHUTDOWNING) | int(channel_flag::F_READ_SHUTDOWN) | int(channel_flag::F_READ_ERROR) | int(channel_flag::F_CLOSE_PENDING) | int(channel_flag::F_CLOSING))) {
+			return;
+		}
+
+		int status = netp::OK;
+		if (nbytes > 0) {
+			NRP<netp::packet> pkt = L->channel_rcv_pool()->get(u32_t(nbytes));
+			pkt->write(buf, u32_t(nbytes));
+			if ((m_iou_flag & IOU_CH_READ) && m_rx_pending.empty()) {
+				channel::ch_fire_read(std::move(pkt));
+			} else {
+				m_rx_pending.push_back(std::move(pkt));
+			}
+		} else if (nbytes == 0) {
+			status = netp::E_SOCKET_GRACE_CLOSE;
+		} else if (nbytes == netp::E_EINVAL && ((m_iou_flag & IOU_CH_READ_BY_READINESS) == 0)) {
+			//multishot recv is not supported by the kernel, fall back to the readiness read
+			NETP_WARN("[socket][%s]io_uring multishot recv not supported, read by readiness", ch_info().c_str());
+			m_iou_flag |= IOU_CH_READ_BY_READINESS;
+			if (m_iou_flag & IOU_CH_READ) {
+				m_iou_flag &= ~IOU_CH_READ;
+				m_chflag &= ~(int(channel_flag::F_USE_DEFAULT_READ) | int(channel_flag::F_WATCH_READ));
+				socket_channel::ch_io_read();
+			}
+			return;
+		} else if (nbytes != netp::E_ECANCELED && nbytes != netp::E_ENOBUFS) {
+			//out of the provided buffers, or canceled by a pause of the read, arm it again if it is watched
+			status = nbytes;
+		}
+
+		if (status != netp::OK) {
+			if ((m_iou_flag & IOU_CH_READ) && m_rx_pending.empty()) {
+				___do_io_read_done(status);
+			} else {
+				m_rx_status = status;
+			}
+			return;
+		}
+
+		if (!more && (m_iou_flag & IOU_CH_READ)) {
+			__iou_recv();
+		}
+	}
+
+	void socket_channel_io_uring::ch_io_read(fn_io_event_t const& fn_read) {
+		if (!L->in_event_loop()) {
+			L->schedule([s = NRP<socket_channel_io_uring>(this), fn_read]()->void {
+				s->ch_io_read(fn_read);
+			});
+			return;
+		}
+
+		//accept and the channels without provided buffers read by readiness
+		if ((fn_read != nullptr) || !ch_is_connected() || !m_iou->pbuf_ready() || (m_iou_flag & IOU_CH_READ_BY_READINESS)) {
+			socket_channel::ch_io_read(fn_read);
+			return;
+		}
+
+		NETP_ASSERT((m_chflag & int(channel_flag::F_READ_SHUTDOWNING)) == 0);
+		if (m_chflag & int(channel_flag::F_WATCH_READ)) {
+			NETP_TRACE_SOCKET("[socket][%s]io_action::READ, ignore, flag: %d", ch_info().c_str(), m_chflag);
+			return;
+		}
+		if (m_chflag & int(channel_flag::F_READ_SHUTDOWN)) {
+			return;
+		}
+
+		m_chflag |= (int(channel_flag::F_USE_DEFAULT_READ) | int(channel_flag::F_WATCH_READ));
+		m_iou_flag |= IOU_CH_READ;
+		NETP_TRACE_IOE("[socket][%s]io_uring recv", ch_info().c_str());
+
+		if (m_rx_pending.size() || (m_rx_status != netp::OK)) {
+			//it's safe to call ch_io_read in a read callback, fire the pending ones in the next tick
+			L->schedule([s = NRP<socket_channel_io_uring>(this)]()->void {
+				s->__iou_rx_flush();
+			});
+			return;
+		}
+		__iou_recv();
+	}
+
+	void socket_channel_io_uring::ch_io_end_read() {
+		if (!L->in_event_loop()) {
+			L->schedule([_so = NRP<socket_channel_io_uring>(this)]()->void {
+				_so->ch_io_end_read();
+			});
+			return;
+		}
+
+		if ((m_iou_flag & IOU_CH_READ) == 0) {
+			socket_channel::ch_io_end_read();
+			return;
+		}
+
+		m_iou_flag &= ~IOU_CH_READ;
+		m_chflag &= ~(int(channel_flag::F_USE_DEFAULT_READ) | int(channel_flag::F_WATCH_READ));
+		//the bytes received before the cancel goes into m_rx_pending
+		const int rt = m_iou->cancel_recv(m_io_ctx);
+		NETP_TRACE_IOE("[socket][%s]io_uring cancel recv, rt: %d", ch_info().c_str(), rt);
+		if (rt != netp::OK) {
+			NETP_WARN("[socket][%s]io_uring cancel recv, rt: %d, close socket_channel", ch_info().c_str(), rt);
+			ch_errno() = rt;
+			ch_close_impl(nullptr);
+		}
+	}
+
+	void socket_channel_io_uring::ch_io_write(fn_io_event_t const& fn_write) {
+		if (!L->in_event_loop()) {
+			L->schedule([_so = NRP<socket_channel_io_uring>(this), fn_write]()->void {
+				_so->ch_io_write(fn_write);
+			});
+			return;
+		}
+
+		//connect watches the writable by readiness
+		if ((fn_write != nullptr) || !ch_is_connected()) {
+			socket_channel::ch_io_write(fn_write);
+			return;
+		}
+
+		if (m_chflag & (int(channel_flag::F_WATCH_WRITE) | int(channel_flag::F_WRITE_SHUTDOWN))) {
+			return;
+		}
+
+		m_chflag |= (int(channel_flag::F_USE_DEFAULT_WRITE) | int(channel_flag::F_WATCH_WRITE));
+		m_iou_flag |= IOU_CH_WRITE;
+		NETP_TRACE_IOE("[socket][%s]io_uring send", ch_info().c_str());
+
+		//not from a write in progress, there is no writable event to wait for, write it out right now
+		if (((m_chflag & int(channel_flag::F_WRITE_BARRIER)) == 0) && ((poller_io_uring::state(m_io_ctx) & IOU_SEND_INFLIGHT) == 0)) {
+			m_chflag |= int(channel_flag::F_WRITE_BARRIER);
+			__do_io_write(netp::OK, m_io_ctx);
+			m_chflag &= ~int(channel_flag::F_WRITE_BARRIER);
+			__ch_drained_check();
+		}
+	}
+
+	void socket_channel_io_uring::ch_io_end_write() {
+		if (!L->in_event_loop()) {
+			L->schedule([_so = NRP<socket_channel_io_uring>(this)]()->void {
+				_so->ch_io_end_write();
+			});
+			return;
+		}
+
+		if ((m_iou_flag & IOU_CH_WRITE) == 0) {
+			socket_channel::ch_io_end_write();
+			return;
+		}
+
+		m_iou_flag &= ~IOU_CH_WRITE;
+		m_chflag &= ~(int(channel_flag::F_USE_DEFAULT_WRITE) | int(channel_flag::F_WATCH_WRITE));
+		//only the close write ends a inflight send, its packets are held by the poller till it completes
+		const int rt = m_iou->cancel_send(m_io_ctx);
+		NETP_TRACE_IOE("[socket][%s]io_uring end send, rt: %d", ch_info().c_str(), rt);
+		if (rt != netp::OK) {
+			NETP_WARN("[socket][%s]io_uring cancel send, rt: %d, close socket_channel", ch_info().c_str(), rt);
+			ch_errno() = rt;
+			ch_close_impl(nullptr);
+		}
+	}
+}
+
+#endif
@@ -244,7 +244,9 @@ namespace netp {
 		m_tx_bytes -= status;
 		entry.data->skip(status);
 		if (entry.data->len() == 0) {
-			entry.write_promise->set(netp::OK);
+			if (entry.write_promise != nullptr) {
+				entry.write_promise->set(netp::OK);
+			}
 			m_tx_entry_q.pop_front();
 		}
 		status = netp::OK;
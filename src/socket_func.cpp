@@ -62,6 +62,12 @@ namespace netp {
 	NRP<socket_channel> default_socket_channel_maker(NRP<netp::socket_cfg> const& cfg) {
 #ifdef NETP_HAS_POLLER_IOCP
 		return netp::make_ref<socket_channel_iocp>(cfg);
+#endif
+#ifdef NETP_IO_URING_COMPLETION_IO
+		//the loops of io_uring do the stream io by completion
+		if ((cfg->L->poller_type() == io_poller_type::T_IO_URING) && (cfg->type == NETP_SOCK_STREAM) && (cfg->family != NETP_AF_USER)) {
+			return netp::make_ref<socket_channel_io_uring>(cfg);
+		}
 #endif
 		return netp::make_ref<socket_channel>(cfg);
 	}
@@ -71,13 +77,13 @@ namespace netp {
 
 		NRP<socket_channel> __socketch;
 		if (cfg->family == NETP_AF_USER) {
-			NETP_ASSERT(cfg->L->poller_type() != NETP_DEFAULT_POLLER_TYPE);
+			NETP_ASSERT(!NETP_IS_SOCKET_POLLER_TYPE(cfg->L->poller_type()));
 			if (cfg->ch_maker == nullptr) {
 				return std::make_tuple(netp::E_CHANNEL_MISSING_MAKER, nullptr);
 			}
 			__socketch = cfg->ch_maker(cfg);
 		} else {
-			NETP_ASSERT(cfg->L->poller_type() == NETP_DEFAULT_POLLER_TYPE);
+			NETP_ASSERT(NETP_IS_SOCKET_POLLER_TYPE(cfg->L->poller_type()));
 			NETP_ASSERT(cfg->ch_maker == nullptr);
 			__socketch = default_socket_channel_maker(cfg);
 		}
@@ -261,6 +267,100 @@ namespace netp {
 		so->do_listen_on(listen_f, laddr, initializer, cfg, backlog);
 	}
 
+#if defined(_NETP_GNU_LINUX) || defined(_NETP_ANDROID)
+	struct reuseport_sharding_ctx :
+		public ref_base
+	{
+		spin_mutex mtx;
+		u32_t left;
+		int rt;
+		std::vector<NRP<channel>, netp::allocator<NRP<channel>>> listeners;
+	};
+
+	static void __reuseport_shard_done(NRP<channel_listen_promise> const& listenp, NRP<reuseport_sharding_ctx> const& ctx, std::size_t i, std::tuple<int, NRP<channel>> const& tupc) {
+		bool done;
+		{
+			lock_guard<spin_mutex> lg(ctx->mtx);
+			if (std::get<0>(tupc) != netp::OK) {
+				ctx->rt = std::get<0>(tupc);
+			} else {
+				ctx->listeners[i] = std::get<1>(tupc);
+			}
+			done = (--ctx->left == 0);
+		}
+		if (!done) { return; }
+
+		if (ctx->rt != netp::OK) {
+			for (NRP<channel> const& ch : ctx->listeners) {
+				if (ch != nullptr) { ch->ch_close(); }
+			}
+			listenp->set(std::make_tuple(ctx->rt, nullptr));
+			return;
+		}
+
+		NRP<channel> const& first = ctx->listeners[0];
+		first->ch_close_promise()->if_done([ctx](int const&) {
+			for (std::size_t j = 1; j < ctx->listeners.size(); ++j) {
+				ctx->listeners[j]->ch_close();
+			}
+		});
+		listenp->set(std::make_tuple(netp::OK, first));
+	}
+
+	static NRP<channel_listen_promise> __reuseport_shard_listen(NRP<event_loop> const& L, NRP<address> const& laddr, fn_channel_initializer_t const& initializer, NRP<socket_cfg> const& cfg, int backlog) {
+		NRP<socket_cfg> _lcfg = cfg->clone();
+		_lcfg->L = L;
+		_lcfg->option |= u16_t(socket_option::OPTION_REUSEPORT);
+
+		NRP<channel_listen_promise> shardp = netp::make_ref<channel_listen_promise>();
+		L->execute([shardp, laddr, initializer, _lcfg, backlog]() {
+			do_listen_on(shardp, laddr, initializer, _lcfg, backlog);
+		});
+		return shardp;
+	}
+
+	//one listener for each loop of cfg->L's group, the kernel distribute incoming connections among them
+	//the listener of the first loop is returned, all the others would be closed once it is closed
+	//for port 0, the first listener takes an ephemeral port, the others listen on the same one
+	void do_listen_on_reuseport_sharding(NRP<channel_listen_promise> const& listenp, NRP<address> const& laddr, fn_channel_initializer_t const& initializer, NRP<socket_cfg> const& cfg, int backlog) {
+		event_loop_vector_t loops = cfg->L->group()->loops();
+		NETP_ASSERT(loops.size() > 0);
+
+		NRP<reuseport_sharding_ctx> ctx = netp::make_ref<reuseport_sharding_ctx>();
+		ctx->left = u32_t(loops.size());
+		ctx->rt = netp::OK;
+		ctx->listeners.resize(loops.size());
+
+		if (laddr->port() != 0) {
+			for (std::size_t i = 0; i < loops.size(); ++i) {
+				__reuseport_shard_listen(loops[i], laddr, initializer, cfg, backlog)->if_done([listenp, ctx, i](std::tuple<int, NRP<channel>> const& tupc) {
+					__reuseport_shard_done(listenp, ctx, i, tupc);
+				});
+			}
+			return;
+		}
+
+		__reuseport_shard_listen(loops[0], laddr, initializer, cfg, backlog)->if_done([listenp, ctx, loops, laddr, initializer, cfg, backlog](std::tuple<int, NRP<channel>> const& tupc) {
+			if (std::get<0>(tupc) != netp::OK) {
+				{
+					lock_guard<spin_mutex> lg(ctx->mtx);
+					ctx->left = 1;
+				}
+				__reuseport_shard_done(listenp, ctx, 0, tupc);
+				return;
+			}
+			NRP<address> shard_addr = laddr->clone();
+			shard_addr->setport(netp::static_pointer_cast<socket_channel>(std::get<1>(tupc))->local_addr()->port());
+			__reuseport_shard_done(listenp, ctx, 0, tupc);
+			for (std::size_t i = 1; i < loops.size(); ++i) {
+				__reuseport_shard_listen(loops[i], shard_addr, initializer, cfg, backlog)->if_done([listenp, ctx, i](std::tuple<int, NRP<channel>> const& tupc) {
+					__reuseport_shard_done(listenp, ctx, i, tupc);
+				});
+			}
+		});
+	}
+#endif
+
 	NRP<channel_listen_promise> listen_on(const char* listenurl, size_t len, fn_channel_initializer_t const& initializer, NRP<socket_cfg> const& cfg, int backlog ) {
 		NRP<channel_listen_promise> listenp = netp::make_ref<channel_listen_promise>();
 
@@ -287,6 +387,17 @@ namespace netp {
 			cfg->L = app::instance()->def_loop_group()->next();
 		}
 
+		if (cfg->listen_flag&u8_t(F_LISTEN_REUSEPORT_SHARDING)) {
+#if defined(_NETP_GNU_LINUX) || defined(_NETP_ANDROID)
+			if ((cfg->family != NETP_AF_USER) && (cfg->proto == NETP_PROTOCOL_TCP)) {
+				do_listen_on_reuseport_sharding(listenp, laddr, initializer, cfg, backlog);
+				return listenp;
+			}
+#endif
+			NETP_WARN("[socket]reuseport sharding not supported, fallback to single listener, listen addr: %s", laddr->to_string().c_str());
+			cfg->listen_flag &= ~u8_t(F_LISTEN_REUSEPORT_SHARDING);
+		}
+
 		if (!cfg->L->in_event_loop()) {
 			cfg->L->schedule([listenp, laddr, initializer, cfg, backlog]() {
 				do_listen_on(listenp, laddr, initializer, cfg, backlog);
@@ -1,19 +1,36 @@
+#include <algorithm>
+
 #include <netp/timer.hpp>
 
 namespace netp {
-	void timer_broker::expire_all() {
+	void timer_broker_heap::__compact() {
+		const auto is_stale = [](timer_heap_entry const& e) { return e.gen != e.tm->tb_gen; };
+		NETP_TRACE_TIMER("[timer_broker]compact, entries: %u, stale: %u", u32_t(m_tq.size() + m_heap.size()), u32_t(m_stale));
+		m_heap.remove_if(is_stale);
+		m_tq.erase(std::remove_if(m_tq.begin(), m_tq.end(), is_stale), m_tq.end());
+		m_stale = 0;
+	}
+
+	void timer_broker_heap::expire_all() {
 		while (!m_tq.empty()) {
 			m_heap.push(std::move(m_tq.front()));
 			m_tq.pop_front();
 		}
 		while (!m_heap.empty()) {
-			NRP<timer>& tm = m_heap.front();
-			tm->invoke(true);
+			NRP<timer> tm = std::move(m_heap.front().tm);
+			const u32_t gen = m_heap.front().gen;
 			m_heap.pop();
+			if (gen == tm->tb_gen) {
+				tm->tb_flag = 0;
+				++m_fired;
+				tm->invoke(true);
+			} else {
+				--m_stale;
+			}
 		}
 	}
 
-	void timer_broker::expire(timer_duration_t& ndelay) {
+	void timer_broker_heap::expire(timer_duration_t& ndelay) {
 #ifdef _NETP_DEBUG
 		const bool swap_to_release = true;
 #else
@@ -27,11 +44,23 @@ namespace netp {
 		if (swap_to_release) { _timer_queue().swap(m_tq); }
 
 		while (!m_heap.empty()) {
-			ndelay = m_heap.front()->invoke();
-			if (ndelay.count() > 0) {
-				goto _recalc_nexpire;
+			timer_heap_entry& front = m_heap.front();
+			const bool stale = (front.gen != front.tm->tb_gen);
+			if (!stale) {
+				ndelay = front.expiration - timer_clock_t::now();
+				if (ndelay.count() > 0) {
+					goto _recalc_nexpire;
+				}
+			}
+			//pop before invoke, the callee might launch this timer again
+			NRP<timer> tm = std::move(front.tm);
+			m_heap.pop();
+			if (!stale) {
+				tm->tb_flag = 0;
+				++m_fired;
+				tm->invoke(true);
 			} else {
-				m_heap.pop();
+				--m_stale;
 			}
 		}
 		//NETP_ASSERT(m_heap.size() == 0);
@@ -45,6 +74,209 @@ namespace netp {
 		}
 	}
 
+	timer_broker_wheel::timer_broker_wheel() :
+		m_base(timer_clock_t::now()),
+		m_cur(0),
+		m_size(0)
+	{
+		for (u32_t lv = 0; lv < NETP_TIMER_WHEEL_LEVEL; ++lv) {
+			for (u32_t i = 0; i < NETP_TIMER_WHEEL_L0_SIZE; ++i) {
+				netp::list_init(&m_slots[lv][i]);
+			}
+			for (u32_t w = 0; w < NETP_TIMER_WHEEL_BITMAP_WORDS; ++w) {
+				m_bitmap[lv][w] = 0;
+			}
+		}
+		netp::list_init(&m_due);
+	}
+
+	timer_broker_wheel::~timer_broker_wheel() {
+		NETP_ASSERT(m_size == 0);
+	}
+
+	void timer_broker_wheel::__link(timer* tm) {
+		const i64_t delta = tm->tw_tick - m_cur;
+		if (delta <= 0) {
+			netp::list_append(&m_due, static_cast<timer_wheel_node*>(tm));
+			return;
+		}
+
+		u32_t lv = 0;
+		while ((lv < (NETP_TIMER_WHEEL_LEVEL - 1)) && (delta >= (i64_t(1) << __lv_shift(lv + 1)))) {
+			++lv;
+		}
+		//beyond the top level, park it in the farthest slot
+		const i64_t tick = (lv == (NETP_TIMER_WHEEL_LEVEL - 1) && (delta >= (i64_t(1) << (__lv_shift(lv) + NETP_TIMER_WHEEL_LN_BITS)))) ?
+			(m_cur + (i64_t(__lv_mask(lv)) << __lv_shift(lv))) : tm->tw_tick;
+
+		const u32_t idx = u32_t(tick >> __lv_shift(lv)) & __lv_mask(lv);
+		netp::list_append(&m_slots[lv][idx], static_cast<timer_wheel_node*>(tm));
+		m_bitmap[lv][idx >> 6] |= (u64_t(1) << (idx & 63));
+	}
+
+	void timer_broker_wheel::__unlink(timer* tm) {
+		timer_wheel_node* next = tm->next;
+		netp::list_delete(static_cast<timer_wheel_node*>(tm));
+		//the slot head is the only node left, clear the bit
+		if (next->next == next) {
+			for (u32_t lv = 0; lv < NETP_TIMER_WHEEL_LEVEL; ++lv) {
+				if (next >= &m_slots[lv][0] && next < &m_slots[lv][NETP_TIMER_WHEEL_L0_SIZE]) {
+					const u32_t idx = u32_t(next - &m_slots[lv][0]);
+					m_bitmap[lv][idx >> 6] &= ~(u64_t(1) << (idx & 63));
+					break;
+				}
+			}
+		}
+	}
+
+	void timer_broker_wheel::__cascade(u32_t lv, u32_t idx) {
+		timer_wheel_node* slot = &m_slots[lv][idx];
+		if (NETP_LIST_IS_EMPTY(slot)) {
+			return;
+		}
+		timer_wheel_node head;
+		netp::list_init(&head);
+		//move all to head
+		head.next = slot->next;
+		head.prev = slot->prev;
+		head.next->prev = &head;
+		head.prev->next = &head;
+		netp::list_init(slot);
+		m_bitmap[lv][idx >> 6] &= ~(u64_t(1) << (idx & 63));
+
+		timer_wheel_node* now_slot = &m_slots[0][u32_t(m_cur) & __lv_mask(0)];
+		while (!NETP_LIST_IS_EMPTY(&head)) {
+			timer* tm = static_cast<timer*>(head.next);
+			netp::list_delete(head.next);
+			if (tm->tw_tick <= m_cur) {
+				//run in this tick
+				netp::list_append(now_slot, static_cast<timer_wheel_node*>(tm));
+				m_bitmap[0][(u32_t(m_cur) & __lv_mask(0)) >> 6] |= (u64_t(1) << (m_cur & 63));
+			} else {
+				__link(tm);
+			}
+		}
+	}
+
+	void timer_broker_wheel::__run_slot(timer_wheel_node* slot) {
+		//pop one by one, the callee might launch|cancel any timer
+		while (!NETP_LIST_IS_EMPTY(slot)) {
+			timer* tm_ = static_cast<timer*>(slot->next);
+			__unlink(tm_);
+			NRP<timer> tm = std::move(tm_->tw_hold);
+			tm->tb_flag = 0;
+			--m_size;
+			++m_fired;
+			tm->invoke(true);
+		}
+	}
+
+	u32_t timer_broker_wheel::__next_slot_distance(u32_t lv, u32_t idx) const {
+		const u32_t mask = __lv_mask(lv);
+		const u32_t words = (mask >> 6) + 1;
+		const u32_t start = (idx + 1) & mask;
+		u32_t w = start >> 6;
+		u64_t bits = m_bitmap[lv][w] & (~u64_t(0) << (start & 63));
+		for (u32_t i = 0; i <= words; ++i) {
+			if (bits != 0) {
+				const u32_t slot = (w << 6) + __ctz64(bits);
+				return ((slot - idx - 1) & mask) + 1;
+			}
+			w = (w + 1) % words;
+			bits = m_bitmap[lv][w];
+		}
+		return 0;
+	}
+
+	//the first tick that we have something to do: run a level 0 slot, or cascade a upper level slot
+	i64_t timer_broker_wheel::__next_tick() const {
+		i64_t next = TIMER_TIME_INFINITE;
+		for (u32_t lv = 0; lv < NETP_TIMER_WHEEL_LEVEL; ++lv) {
+			const u32_t shift = __lv_shift(lv);
+			const u32_t d = __next_slot_distance(lv, u32_t(m_cur >> shift) & __lv_mask(lv));
+			if (d == 0) {
+				continue;
+			}
+			const i64_t tick = ((m_cur >> shift) + d) << shift;
+			if (next == TIMER_TIME_INFINITE || tick < next) {
+				next = tick;
+			}
+		}
+		return next;
+	}
+
+	void timer_broker_wheel::_do_launch(NRP<timer>&& tm) {
+		timer* tm_ = tm.get();
+		if (tm_->tb_flag&F_TIMER_IN_BROKER) {
+			//reset, relink by the new expiration
+			__unlink(tm_);
+		} else {
+			tm_->tw_hold = std::move(tm);
+			tm_->tb_flag = F_TIMER_IN_BROKER;
+			++m_size;
+		}
+		tm_->tw_tick = __tick_of(tm_->expiration);
+		__link(tm_);
+	}
+
+	void timer_broker_wheel::cancel(NRP<timer> const& tm) {
+		if ((tm->tb_flag&F_TIMER_IN_BROKER) == 0) {
+			return;
+		}
+		__unlink(tm.get());
+		tm->tb_flag = 0;
+		--m_size;
+		//tm is still held by the caller
+		tm->tw_hold = nullptr;
+	}
+
+	void timer_broker_wheel::expire_all() {
+		__run_slot(&m_due);
+		for (u32_t lv = 0; lv < NETP_TIMER_WHEEL_LEVEL; ++lv) {
+			for (u32_t i = 0; i < NETP_TIMER_WHEEL_L0_SIZE; ++i) {
+				__run_slot(&m_slots[lv][i]);
+			}
+		}
+	}
+
+	void timer_broker_wheel::expire(timer_duration_t& ndelay) {
+		__run_slot(&m_due);
+
+		const timer_timepoint_t now = timer_clock_t::now();
+		const i64_t now_tick = (now - m_base).count() / NETP_TIMER_WHEEL_TICK_NS;
+		while (m_cur < now_tick) {
+			const i64_t next = __next_tick();
+			if (next == TIMER_TIME_INFINITE || next > now_tick) {
+				m_cur = now_tick;
+				break;
+			}
+			m_cur = next;
+			//upper level first, the timers fall into the lower level slot of this tick would be cascaded again
+			for (u32_t lv = NETP_TIMER_WHEEL_LEVEL - 1; lv > 0; --lv) {
+				const u32_t shift = __lv_shift(lv);
+				if ((m_cur & ((i64_t(1) << shift) - 1)) == 0) {
+					__cascade(lv, u32_t(m_cur >> shift) & __lv_mask(lv));
+				}
+			}
+			__run_slot(&m_slots[0][u32_t(m_cur) & __lv_mask(0)]);
+		}
+
+		if (!NETP_LIST_IS_EMPTY(&m_due)) {
+			//launched by callee with a expired expiration
+			ndelay = timer_duration_t();
+			return;
+		}
+		const i64_t next = __next_tick();
+		if (next == TIMER_TIME_INFINITE) {
+			ndelay = _TIMER_DURATION_INFINITE;
+			return;
+		}
+		ndelay = (m_base + timer_duration_t(next * NETP_TIMER_WHEEL_TICK_NS)) - timer_clock_t::now();
+		if (ndelay.count() < 0) {
+			ndelay = timer_duration_t();
+		}
+	}
+
 	/*
 	timer_broker_ts::~timer_broker_ts()
 	{
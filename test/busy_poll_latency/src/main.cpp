@@ -0,0 +1,134 @@
+// This is a ping-pong latency benchmark of the busy poll loop over loopback
+// usage: busy_poll_latency [round count] [busy_poll_us] [loop count] [port]
+
+// server: echo every read back
+// client: one 64 bytes message in flight, the next one is sent once the whole echo is read, we record the round trip of each
+// the client and the server are on different loops if there are more than one, so every round trip has two loop hops to wake up
+// run it with busy_poll_us=0 for the blocking loop, the spin/sleep rounds of each loop are dumped at the end
+
+#include <netp.hpp>
+
+static const netp::u32_t PING_SIZE = 64;
+static const netp::byte_t s_ping[PING_SIZE] = { 0 };
+
+class echo :
+	public netp::channel_handler_abstract
+{
+public:
+	echo() :
+		channel_handler_abstract(netp::CH_INBOUND_READ)
+	{}
+
+	void read(NRP<netp::channel_handler_context> const& ctx, NRP<netp::packet> const& income) {
+		ctx->write(income);
+	}
+};
+
+class ping :
+	public netp::channel_handler_abstract
+{
+	const long m_rounds;
+	netp::u32_t m_pending;
+	std::chrono::steady_clock::time_point m_begin;
+	std::vector<long long> m_lat;
+	NRP<netp::promise<int>> m_done;
+
+public:
+	ping(long rounds) :
+		channel_handler_abstract(netp::CH_ACTIVITY_CONNECTED | netp::CH_INBOUND_READ),
+		m_rounds(rounds),
+		m_pending(0),
+		m_done(netp::make_ref<netp::promise<int>>())
+	{
+		m_lat.reserve(rounds);
+	}
+
+	void do_ping(NRP<netp::channel_handler_context> const& ctx) {
+		NRP<netp::packet> outp = netp::make_ref<netp::packet>(s_ping, PING_SIZE);
+		m_pending = PING_SIZE;
+		m_begin = std::chrono::steady_clock::now();
+		ctx->write(outp);
+	}
+
+	void connected(NRP<netp::channel_handler_context> const& ctx) {
+		do_ping(ctx);
+	}
+
+	void read(NRP<netp::channel_handler_context> const& ctx, NRP<netp::packet> const& income) {
+		NETP_ASSERT(income->len() <= m_pending);
+		m_pending -= income->len();
+		if (m_pending != 0) {
+			return;
+		}
+		m_lat.push_back((std::chrono::steady_clock::now() - m_begin).count());
+		if (long(m_lat.size()) == m_rounds) {
+			m_done->set(netp::OK);
+			return;
+		}
+		do_ping(ctx);
+	}
+
+	NRP<netp::promise<int>> const& done() const { return m_done; }
+	std::vector<long long>& lat() { return m_lat; }
+};
+
+int main(int argc, char** argv) {
+	const long rounds = (argc > 1) ? NETP_MAX(std::atol(argv[1]), 100L) : 100000L;
+	const netp::u32_t busy_poll_us = (argc > 2) ? netp::u32_t(std::atoi(argv[2])) : 0;
+	const netp::u32_t loops = (argc > 3) ? netp::u32_t(NETP_MAX(std::atoi(argv[3]), 1)) : 2;
+	const std::string host = std::string("tcp://127.0.0.1:") + ((argc > 4) ? argv[4] : "13190");
+
+	netp::app::instance()->cfg_loop_count(loops);
+	netp::app::instance()->cfg_busy_poll(busy_poll_us);
+	netp::app::instance()->init(argc, argv);
+	netp::app::instance()->start_loop();
+
+	NRP<netp::channel_listen_promise> listenp = netp::listen_on(host, [](NRP<netp::channel> const& ch) {
+		ch->ch_set_nodelay();
+		ch->pipeline()->add_last(netp::make_ref<echo>());
+	});
+	const int listenrt = std::get<0>(listenp->get());
+	if (listenrt != netp::OK) {
+		NETP_ERR("[busy_poll_latency]listen on: %s failed: %d", host.c_str(), listenrt);
+		return listenrt;
+	}
+
+	NRP<ping> p = netp::make_ref<ping>(rounds);
+	NRP<netp::channel_dial_promise> dialp = netp::dial(host, [p](NRP<netp::channel> const& ch) {
+		ch->ch_set_nodelay();
+		ch->pipeline()->add_last(p);
+	});
+	const int dialrt = std::get<0>(dialp->get());
+	if (dialrt != netp::OK) {
+		NETP_ERR("[busy_poll_latency]dial: %s failed: %d", host.c_str(), dialrt);
+		return dialrt;
+	}
+	p->done()->wait();
+
+	std::vector<long long>& lat = p->lat();
+	std::sort(lat.begin(), lat.end());
+	long long sum = 0;
+	for (long long l : lat) { sum += l; }
+	NETP_INFO("[busy_poll_latency]busy_poll_us: %u, loops: %u, rounds: %ld, avg: %.2f ns, p50: %lld ns, p99: %lld ns", busy_poll_us, loops, rounds, (sum*1.0)/rounds, lat[rounds/2], lat[(rounds*99)/100]);
+	fprintf(stdout, "busy_poll_us: %u, loops: %u, rounds: %ld, avg: %.0f ns, p50: %lld ns, p99: %lld ns\n", busy_poll_us, loops, rounds, (sum*1.0)/rounds, lat[rounds/2], lat[(rounds*99)/100]);
+	{
+		//the vector is allocated by the netp allocator, release it before destroy_instance
+		netp::event_loop_vector_t L = netp::app::instance()->def_loop_group()->loops();
+		for (netp::size_t i = 0; i < L.size(); ++i) {
+			fprintf(stdout, "loop[%zu]: spin rounds: %llu, sleep rounds: %llu\n", i, (unsigned long long)L[i]->spin_rounds(), (unsigned long long)L[i]->sleep_rounds());
+		}
+		fflush(stdout);
+	}
+
+	std::get<1>(dialp->get())->ch_close();
+	std::get<1>(dialp->get())->ch_close_promise()->wait();
+	std::get<1>(listenp->get())->ch_close();
+	std::get<1>(listenp->get())->ch_close_promise()->wait();
+
+	//the channels hold their loop, release them before the loops exit
+	dialp = nullptr;
+	listenp = nullptr;
+	p = nullptr;
+	netp::app::instance()->destroy_instance();
+	return 0;
+}
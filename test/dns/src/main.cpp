@@ -1,25 +1,251 @@
+// This is a check of the answer cache of the dns resolver against a loopback stand-in name server
+// usage: dns [port]
+
+// ttl: a positive answer lives for the min ttl of its A records, a ttl of 0 is clamped to NETP_DNS_CACHE_TTL_MIN, names are matched case insensitively
+// negative: NXDOMAIN and NODATA are answered by the cache without another query until NETP_DNS_CACHE_NEGATIVE_TTL
+// coalesce: lookups of the same name issued while its query is in flight are merged into one query
+// the stand-in server answers on 127.0.0.1:port over udp, it counts the queries per name
 
 #include <netp.hpp>
+#include <map>
 
-int main(int argc, char** argv) {
+struct zone_record {
+	const char* ip;
+	netp::u32_t ttl;
+};
+
+struct zone_entry {
+	const char* name;
+	netp::u16_t rcode;
+	netp::u32_t delay; //in millis
+	std::vector<zone_record> records;
+};
+
+//the unknown names are answered by NXDOMAIN
+static const std::vector<zone_entry> s_zone = {
+	{ "ttl.netp.test", 0, 0, { {"10.0.0.1", 60}, {"10.0.0.2", 1} } },
+	{ "zero.netp.test", 0, 0, { {"10.0.0.3", 0} } },
+	{ "nodata.netp.test", 0, 0, {} },
+	{ "slow.netp.test", 0, 300, { {"10.0.0.4", 60} } }
+};
+
+static std::mutex s_queries_mtx;
+static std::map<std::string, int> s_queries;
+
+static int queries(const char* name) {
+	std::lock_guard<std::mutex> lg(s_queries_mtx);
+	return s_queries[name];
+}
+
+static void put_u16(std::string& s, netp::u16_t v) {
+	s.push_back(char(v >> 8));
+	s.push_back(char(v & 0xff));
+}
+
+static void put_u32(std::string& s, netp::u32_t v) {
+	put_u16(s, netp::u16_t(v >> 16));
+	put_u16(s, netp::u16_t(v & 0xffff));
+}
+
+//@return the answer, or an empty string for a malformed query
+static std::string answer(const netp::byte_t* q, int len, std::string& name, netp::u32_t& delay) {
+	//header: id, flags, qdcount, ancount, nscount, arcount
+	if (len < 12 || q[4] != 0 || q[5] != 1) {
+		return std::string();
+	}
+	int i = 12;
+	while (i < len && q[i] != 0) {
+		if (name.length()) {
+			name.push_back('.');
+		}
+		name.append((const char*)q + i + 1, NETP_MIN(int(q[i]), len - i - 1));
+		i += q[i] + 1;
+	}
+	//zero label, qtype, qclass
+	const int qend = i + 5;
+	if (qend > len) {
+		return std::string();
+	}
+
+	const zone_entry* e = nullptr;
+	for (zone_entry const& z : s_zone) {
+		if (name == z.name) {
+			e = &z;
+		}
+	}
+	delay = e ? e->delay : 0;
+
+	std::string a((const char*)q, 2);
+	//QR, RD of the query, RA, rcode
+	put_u16(a, netp::u16_t(0x8000 | (((q[2] << 8) | q[3]) & 0x0100) | 0x0080 | (e ? e->rcode : 3)));
+	put_u16(a, 1);
+	put_u16(a, netp::u16_t(e ? e->records.size() : 0));
+	put_u16(a, 0);
+	put_u16(a, 0);
+	a.append((const char*)q + 12, qend - 12);
+	if (e) {
+		for (zone_record const& r : e->records) {
+			//pointer to the name of the question, type A, class IN
+			put_u16(a, 0xc00c);
+			put_u16(a, 1);
+			put_u16(a, 1);
+			put_u32(a, r.ttl);
+			put_u16(a, 4);
+			put_u32(a, netp::dotiptoip(r.ip).u32);
+		}
+	}
+	return a;
+}
+
+//a datagram shorter than the dns header stops it
+static void stand_in_server(netp::SOCKET fd) {
+	netp::byte_t q[512];
+	while (1) {
+		NRP<netp::address> from = netp::make_ref<netp::address>();
+		const int len = netp::recvfrom(fd, q, sizeof(q), from);
+		if (len < 12) {
+			return;
+		}
+		std::string name;
+		netp::u32_t delay = 0;
+		const std::string a = answer(q, len, name, delay);
+		if (a.length() == 0) {
+			continue;
+		}
+		{
+			std::lock_guard<std::mutex> lg(s_queries_mtx);
+			++s_queries[name];
+		}
+		if (delay) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+		}
+		netp::sendto(fd, (const netp::byte_t*)a.data(), netp::u32_t(a.length()), from);
+	}
+}
+
+typedef std::tuple<int, netp::dns_ipv4s_t> dns_result_t;
+
+static dns_result_t resolve(NRP<netp::event_loop> const& L, const char* name) {
+	return L->resolve(name)->get();
+}
+
+static netp::dns_cache_stat stat(NRP<netp::event_loop> const& L) {
+	netp::dns_cache_stat st;
+	L->dns_stat(st);
+	return st;
+}
+
+static int check_ttl(NRP<netp::event_loop> const& L) {
+	const netp::dns_cache_stat st = stat(L);
+	dns_result_t r = resolve(L, "ttl.netp.test");
+	if (std::get<0>(r) != netp::OK || std::get<1>(r).size() != 2) {
+		NETP_ERR("[dns][ttl]resolve ttl.netp.test failed: %d, ipv4s: %u", std::get<0>(r), netp::u32_t(std::get<1>(r).size()));
+		return -1;
+	}
+	//answered by the cache, whatever the case of the name
+	r = resolve(L, "TTL.Netp.Test");
+	if (std::get<0>(r) != netp::OK || std::get<1>(r).size() != 2 || queries("ttl.netp.test") != 1 || stat(L).hit != st.hit + 1) {
+		NETP_ERR("[dns][ttl]cache missed, code: %d, queries: %d", std::get<0>(r), queries("ttl.netp.test"));
+		return -1;
+	}
+
+	//the ttl of 0 is clamped to NETP_DNS_CACHE_TTL_MIN, otherwise it would never be answered by the cache
+	resolve(L, "zero.netp.test");
+	r = resolve(L, "zero.netp.test");
+	if (std::get<0>(r) != netp::OK || queries("zero.netp.test") != 1) {
+		NETP_ERR("[dns][ttl]ttl of 0 not clamped, code: %d, queries: %d", std::get<0>(r), queries("zero.netp.test"));
+		return -1;
+	}
 
+	//both expire after the min ttl of their records
+	std::this_thread::sleep_for(std::chrono::milliseconds(NETP_DNS_CACHE_TTL_MIN*1000 + 100));
+	r = resolve(L, "ttl.netp.test");
+	dns_result_t rz = resolve(L, "zero.netp.test");
+	if (std::get<0>(r) != netp::OK || std::get<0>(rz) != netp::OK || queries("ttl.netp.test") != 2 || queries("zero.netp.test") != 2) {
+		NETP_ERR("[dns][ttl]not expired, queries: %d, %d", queries("ttl.netp.test"), queries("zero.netp.test"));
+		return -1;
+	}
+	NETP_INFO("[dns][ttl]queries: %d, %d", queries("ttl.netp.test"), queries("zero.netp.test"));
+	return netp::OK;
+}
+
+static int check_negative(NRP<netp::event_loop> const& L) {
+	const netp::dns_cache_stat st = stat(L);
+	for (const char* name : { "nx.netp.test", "nodata.netp.test" }) {
+		const dns_result_t first = resolve(L, name);
+		const dns_result_t second = resolve(L, name);
+		if (std::get<0>(first) == netp::OK || std::get<0>(second) != std::get<0>(first) || std::get<1>(second).size() != 0 || queries(name) != 1) {
+			NETP_ERR("[dns][negative]%s, code: %d, %d, queries: %d", name, std::get<0>(first), std::get<0>(second), queries(name));
+			return -1;
+		}
+		NETP_INFO("[dns][negative]%s, code: %d, queries: %d", name, std::get<0>(first), queries(name));
+	}
+	const netp::dns_cache_stat st2 = stat(L);
+	if (st2.negative_hit != st.negative_hit + 2 || st2.miss != st.miss + 2) {
+		NETP_ERR("[dns][negative]negative_hit: %llu, miss: %llu", st2.negative_hit - st.negative_hit, st2.miss - st.miss);
+		return -1;
+	}
+	return netp::OK;
+}
+
+static int check_coalesce(NRP<netp::event_loop> const& L) {
+	//the answer is delayed, all of the lookups arrive while the first query is in flight
+	const netp::dns_cache_stat st = stat(L);
+	std::vector<NRP<netp::dns_query_promise>> ps;
+	for (int i = 0; i < 16; ++i) {
+		ps.push_back(L->resolve("slow.netp.test"));
+	}
+	for (NRP<netp::dns_query_promise> const& p : ps) {
+		dns_result_t const& r = p->get();
+		if (std::get<0>(r) != netp::OK || std::get<1>(r).size() != 1 || std::get<1>(r)[0] != netp::dotiptoip("10.0.0.4")) {
+			NETP_ERR("[dns][coalesce]resolve failed: %d", std::get<0>(r));
+			return -1;
+		}
+	}
+	const netp::dns_cache_stat st2 = stat(L);
+	if (queries("slow.netp.test") != 1 || st2.miss != st.miss + 1 || st2.coalesced != st.coalesced + ps.size() - 1) {
+		NETP_ERR("[dns][coalesce]queries: %d, miss: %llu, coalesced: %llu", queries("slow.netp.test"), st2.miss - st.miss, st2.coalesced - st.coalesced);
+		return -1;
+	}
+	NETP_INFO("[dns][coalesce]queries: %d, coalesced: %llu", queries("slow.netp.test"), st2.coalesced - st.coalesced);
+	return netp::OK;
+}
+
+int main(int argc, char** argv) {
+	const netp::port_t port = netp::port_t((argc > 1) ? std::atoi(argv[1]) : 21053);
+	//the only name server of the loops
+	netp::app::instance()->cfg_add_dns(std::string("127.0.0.1:") + std::to_string(port));
 	netp::app::instance()->init(argc, argv);
+
+	NRP<netp::address> addr = netp::make_ref<netp::address>("127.0.0.1", port, NETP_AF_INET);
+	netp::SOCKET fd = netp::open(NETP_AF_INET, NETP_SOCK_DGRAM, NETP_PROTOCOL_UDP);
+	if (fd == NETP_INVALID_SOCKET || netp::bind(fd, addr) != 0) {
+		NETP_ERR("[dns]bind on 127.0.0.1:%u failed", port);
+		return -1;
+	}
+	NRP<netp::thread> server = netp::make_ref<netp::thread>();
+	server->start(stand_in_server, fd);
 	netp::app::instance()->start_loop();
 
-	NRP<netp::dns_query_promise> dqp = netp::app::instance()->def_loop_group()->next()->resolve("www.163.com");
+	NRP<netp::event_loop> L = netp::app::instance()->def_loop_group()->next();
+	int rt = check_ttl(L);
+	if (rt == netp::OK) {
+		rt = check_negative(L);
+	}
+	if (rt == netp::OK) {
+		rt = check_coalesce(L);
+	}
+	const netp::dns_cache_stat st = stat(L);
+	NETP_INFO("dns cache, hit: %llu, negative_hit: %llu, static_hit: %llu, miss: %llu, coalesced: %llu, size: %u", st.hit, st.negative_hit, st.static_hit, st.miss, st.coalesced, st.size);
 
-	dqp->if_done([](std::tuple<int, std::vector<netp::ipv4_t, netp::allocator<netp::ipv4_t>>> const& query_result) {
-		int code = std::get<0>(query_result);
-		if (code == netp::OK) {
-			std::vector<netp::ipv4_t, netp::allocator<netp::ipv4_t>> const& ipvec = std::get<1>(query_result);
-			for (auto ipv4_ : ipvec) {
-				netp::string_t ipstr = netp::ipv4todotip(ipv4_);
-				NETP_INFO("%s", ipstr.c_str());
-			}
-		}
-		
-	});
+	const netp::byte_t stop = 0;
+	netp::sendto(fd, &stop, 1, addr);
+	server->join();
+	netp::close(fd);
 
-	netp::app::instance()->wait();
-	return 0;
+	server = nullptr;
+	addr = nullptr;
+	L = nullptr;
+	netp::app::instance()->destroy_instance();
+	return rt == netp::OK ? 0 : -1;
 }
\ No newline at end of file
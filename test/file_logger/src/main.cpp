@@ -0,0 +1,219 @@
+// This is a check of the async file_logger
+// usage: file_logger [records per producer] [producer count]
+
+// producers: the producers write records of different lengths into their own ring, the file rotates by size meanwhile,
+//	every record is a whole line in one of the files, the records of a producer are in order in each file, no one is written twice,
+//	the records written plus dropped() make up all of them, and the drop notes of the writer sum up to dropped()
+// overflow: records of nearly a ring, written much faster than the writer drains, dropped() counts the lost ones
+// oversize: a record larger than the ring is written sync rather than dropped
+// the files are ./file_logger.<check>.log and the rotated ones next to them, they are removed before each check
+
+#include <netp.hpp>
+#include <fstream>
+#include <dirent.h>
+
+static const char* DROP_NOTE = "[file_logger]";
+
+//the log file and its rotated ones
+static std::vector<std::string> log_files(std::string const& name) {
+	std::vector<std::string> files;
+	DIR* d = ::opendir(".");
+	if (d == nullptr) {
+		return files;
+	}
+	struct dirent* e;
+	while ((e = ::readdir(d)) != nullptr) {
+		if (std::string(e->d_name).compare(0, name.length(), name) == 0) {
+			files.push_back(e->d_name);
+		}
+	}
+	::closedir(d);
+	return files;
+}
+
+static void remove_log_files(std::string const& name) {
+	for (std::string const& f : log_files(name)) {
+		std::remove(f.c_str());
+	}
+}
+
+static std::string record(netp::u32_t producer, netp::u32_t seq, netp::u32_t pad) {
+	char head[32];
+	snprintf(head, sizeof(head), "p%u %u ", producer, seq);
+	return std::string(head) + std::string(pad, char('a' + (seq % 26)));
+}
+
+struct log_content {
+	std::vector<std::vector<bool>> seen; //[producer][seq]
+	netp::u64_t records;
+	netp::u64_t drop_noted;
+	netp::u32_t files;
+};
+
+//@return false for a torn, unknown, duplicated or out of order record
+static bool parse_logs(std::string const& name, netp::u32_t producers, netp::u32_t count, netp::u32_t (*pad_of)(netp::u32_t), log_content& c) {
+	c.seen.assign(producers, std::vector<bool>(count, false));
+	c.records = 0;
+	c.drop_noted = 0;
+	c.files = 0;
+	for (std::string const& f : log_files(name)) {
+		++c.files;
+		std::vector<long long> last(producers, -1);
+		std::ifstream in(f, std::ios::binary);
+		std::string line;
+		while (std::getline(in, line)) {
+			if (line.find(DROP_NOTE) != std::string::npos) {
+				unsigned long long n = 0;
+				const char* p = std::strstr(line.c_str(), DROP_NOTE) + std::strlen(DROP_NOTE);
+				if (std::sscanf(p, "%llu", &n) != 1) {
+					NETP_ERR("[file_logger]%s: bad drop note: %s", f.c_str(), line.c_str());
+					return false;
+				}
+				c.drop_noted += n;
+				continue;
+			}
+			unsigned int producer = 0;
+			unsigned int seq = 0;
+			if (std::sscanf(line.c_str(), "p%u %u ", &producer, &seq) != 2 || producer >= producers || seq >= count ||
+				line != record(producer, seq, pad_of(seq)) || c.seen[producer][seq] || (long long)seq <= last[producer])
+			{
+				NETP_ERR("[file_logger]%s: bad record: %.64s, len: %u", f.c_str(), line.c_str(), netp::u32_t(line.length()));
+				return false;
+			}
+			c.seen[producer][seq] = true;
+			last[producer] = seq;
+			++c.records;
+		}
+	}
+	return true;
+}
+
+static netp::u32_t pad_mixed(netp::u32_t seq) {
+	return (seq * 37) % 200;
+}
+
+static netp::u32_t pad_overflow(netp::u32_t) {
+	return NETP_FILE_LOGGER_RING_SIZE_MIN / 2;
+}
+
+static netp::u32_t pad_oversize(netp::u32_t) {
+	return NETP_FILE_LOGGER_RING_SIZE_MIN * 2;
+}
+
+//write count records by each producer, then destroy the logger to drain the rest, dropped() is final once the producers are done
+static netp::u64_t produce(std::string const& name, netp::logger::file_logger_cfg const& cfg, netp::u32_t producers, netp::u32_t count, netp::u32_t(*pad_of)(netp::u32_t), netp::u32_t& rotated) {
+	NRP<netp::logger::file_logger> fl = netp::make_ref<netp::logger::file_logger>(netp::string_t(name.c_str()), cfg);
+	fl->set_mask_by_level(netp::logger::LOG_LEVEL_INFO);
+
+	std::vector<NRP<netp::thread>> ths;
+	for (netp::u32_t k = 0; k < producers; ++k) {
+		NRP<netp::thread> th = netp::make_ref<netp::thread>();
+		th->start([fl, k, count, pad_of]() {
+			for (netp::u32_t seq = 0; seq < count; ++seq) {
+				const std::string r = record(k, seq, pad_of(seq));
+				fl->info(r.c_str(), netp::u32_t(r.length()));
+			}
+		});
+		ths.push_back(th);
+	}
+	for (NRP<netp::thread> const& th : ths) {
+		th->join();
+	}
+	const netp::u64_t dropped = fl->dropped();
+	rotated = fl->rotated();
+	return dropped;
+}
+
+static int check_producers(netp::u32_t producers, netp::u32_t count) {
+	const std::string name = "file_logger.producers.log";
+	remove_log_files(name);
+
+	netp::logger::file_logger_cfg cfg;
+	cfg.async = true;
+	cfg.flush_interval = 10;
+	cfg.rotate_size = 256 * 1024;
+	netp::u32_t rotated = 0;
+	const netp::u64_t dropped = produce(name, cfg, producers, count, pad_mixed, rotated);
+
+	log_content c;
+	if (!parse_logs(name, producers, count, pad_mixed, c)) {
+		return -1;
+	}
+	const netp::u64_t total = netp::u64_t(producers) * count;
+	//the last drain of the logger might rotate once more after rotated() is read
+	if ((c.records + dropped) != total || c.drop_noted != dropped || rotated == 0 || c.files < (rotated + 1)) {
+		NETP_ERR("[file_logger][producers]total: %llu, records: %llu, dropped: %llu, drop noted: %llu, rotated: %u, files: %u", total, c.records, dropped, c.drop_noted, rotated, c.files);
+		return -1;
+	}
+	NETP_INFO("[file_logger][producers]total: %llu, records: %llu, dropped: %llu, rotated: %u", total, c.records, dropped, rotated);
+	remove_log_files(name);
+	return netp::OK;
+}
+
+static int check_overflow() {
+	const std::string name = "file_logger.overflow.log";
+	remove_log_files(name);
+
+	//one record takes more than half of a ring, the writer wakes up once a second unless the ring is half full
+	netp::logger::file_logger_cfg cfg;
+	cfg.async = true;
+	cfg.ring_size = NETP_FILE_LOGGER_RING_SIZE_MIN;
+	cfg.flush_interval = 1000;
+	const netp::u32_t count = 2000;
+	netp::u32_t rotated = 0;
+	const netp::u64_t dropped = produce(name, cfg, 1, count, pad_overflow, rotated);
+
+	log_content c;
+	if (!parse_logs(name, 1, count, pad_overflow, c)) {
+		return -1;
+	}
+	if (dropped == 0 || (c.records + dropped) != count || c.drop_noted != dropped) {
+		NETP_ERR("[file_logger][overflow]records: %llu, dropped: %llu, drop noted: %llu", c.records, dropped, c.drop_noted);
+		return -1;
+	}
+	NETP_INFO("[file_logger][overflow]records: %llu, dropped: %llu", c.records, dropped);
+	remove_log_files(name);
+	return netp::OK;
+}
+
+static int check_oversize() {
+	const std::string name = "file_logger.oversize.log";
+	remove_log_files(name);
+
+	netp::logger::file_logger_cfg cfg;
+	cfg.async = true;
+	cfg.ring_size = 0; //clamped to NETP_FILE_LOGGER_RING_SIZE_MIN
+	const netp::u32_t count = 8;
+	netp::u32_t rotated = 0;
+	const netp::u64_t dropped = produce(name, cfg, 2, count, pad_oversize, rotated);
+
+	log_content c;
+	if (!parse_logs(name, 2, count, pad_oversize, c)) {
+		return -1;
+	}
+	if (dropped != 0 || c.records != 2 * count) {
+		NETP_ERR("[file_logger][oversize]records: %llu, dropped: %llu", c.records, dropped);
+		return -1;
+	}
+	NETP_INFO("[file_logger][oversize]records: %llu", c.records);
+	remove_log_files(name);
+	return netp::OK;
+}
+
+int main(int argc, char** argv) {
+	netp::app::instance()->init(argc, argv);
+
+	const netp::u32_t count = (argc > 1) ? netp::u32_t(NETP_MAX(std::atoi(argv[1]), 100)) : 20000;
+	const netp::u32_t producers = (argc > 2) ? netp::u32_t(NETP_MAX(std::atoi(argv[2]), 1)) : 4;
+
+	int rt = check_producers(producers, count);
+	if (rt == netp::OK) {
+		rt = check_overflow();
+	}
+	if (rt == netp::OK) {
+		rt = check_oversize();
+	}
+
+	netp::app::instance()->destroy_instance();
+	return rt == netp::OK ? 0 : -1;
+}
\ No newline at end of file
@@ -0,0 +1,162 @@
+// This is a requests/sec benchmark of the http handler over loopback
+// usage: http_rps [seconds] [connections] [port]
+
+// server: netp::handler::http, reads a few request header lines and replies with a small keep-alive response built by netp::http::message, the same way as test/httpserver
+// client: netp::handler::http on every connection, one request in flight per connection, the next request is sent once the response is parsed
+// the request carries the header lines of a browser, so the cost of the header parse and encode shows
+
+#include <netp.hpp>
+
+static std::atomic<netp::u64_t> s_responses(0);
+static std::atomic<bool> s_stop(false);
+
+static const char s_request[] =
+	"GET /index.html?from=bench HTTP/1.1\r\n"
+	"Host: 127.0.0.1\r\n"
+	"Connection: Keep-Alive\r\n"
+	"User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+	"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+	"Accept-Language: en-US,en;q=0.9\r\n"
+	"Accept-Encoding: gzip, deflate, br\r\n"
+	"Cache-Control: no-cache\r\n"
+	"Pragma: no-cache\r\n"
+	"Referer: http://127.0.0.1/\r\n"
+	"Cookie: session=7f3c2a9e0b1d4c8f; theme=dark; lang=en\r\n"
+	"Cookie: tracking=off\r\n"
+	"Sec-Fetch-Dest: document\r\n"
+	"Sec-Fetch-Mode: navigate\r\n"
+	"Upgrade-Insecure-Requests: 1\r\n"
+	"\r\n";
+
+class http_rps_server :
+	public netp::ref_base
+{
+public:
+	void on_message_header(NRP<netp::channel_handler_context> const& ctx, NRP<netp::http::message> const& m) {
+		ctx->ch->set_ctx(m);
+	}
+
+	void on_read_closed(NRP<netp::channel_handler_context> const& ctx) {
+		ctx->close();
+	}
+
+	void on_message_end(NRP<netp::channel_handler_context> const& ctx) {
+		NRP<netp::http::message> m = ctx->ch->get_ctx<netp::http::message>();
+		NRP<netp::http::message> resp = netp::make_ref<netp::http::message>();
+		resp->H = netp::make_ref<netp::http::header>();
+		resp->type = netp::http::T_RESP;
+		resp->ver = m->ver;
+		resp->code = 200;
+		resp->status = "OK";
+
+		const bool keep_alive = m->H->have("Connection") && m->H->get("Connection") == "Keep-Alive";
+		resp->H->add_header_line("Server", "netplus");
+		resp->H->add_header_line("Content-Type", "text/plain");
+		resp->H->add_header_line("Cache-Control", m->H->get("Cache-Control"));
+		resp->H->add_header_line("Connection", keep_alive ? "Keep-Alive" : "close");
+
+		resp->body = netp::make_ref<netp::packet>();
+		const netp::string_t host = m->H->get("Host");
+		resp->body->write(host.c_str(), netp::u32_t(host.length()));
+
+		NRP<netp::packet> outp;
+		resp->encode(outp);
+		NRP<netp::promise<int>> f_write = ctx->write(outp);
+		if (!keep_alive) {
+			f_write->if_done([ctx](int const&) {
+				ctx->close();
+			});
+		}
+	}
+};
+
+class http_rps_client :
+	public netp::ref_base
+{
+public:
+	void request(NRP<netp::channel_handler_context> const& ctx) {
+		if (s_stop.load(std::memory_order_relaxed)) {
+			ctx->close();
+			return;
+		}
+		ctx->write(netp::make_ref<netp::packet>(s_request, netp::u32_t(sizeof(s_request) - 1)));
+	}
+
+	void on_connected(NRP<netp::channel_handler_context> const& ctx) {
+		request(ctx);
+	}
+
+	void on_message_end(NRP<netp::channel_handler_context> const& ctx) {
+		s_responses.fetch_add(1, std::memory_order_relaxed);
+		request(ctx);
+	}
+};
+
+int main(int argc, char** argv) {
+	netp::app::instance()->init(argc, argv);
+	netp::app::instance()->start_loop();
+
+	const int seconds = (argc > 1) ? NETP_MAX(std::atoi(argv[1]), 1) : 10;
+	const int connections = (argc > 2) ? NETP_MAX(std::atoi(argv[2]), 1) : 16;
+	const std::string host = std::string("tcp://127.0.0.1:") + ((argc > 3) ? argv[3] : "13180");
+
+	NRP<http_rps_server> server = netp::make_ref<http_rps_server>();
+	NRP<netp::channel_listen_promise> listenp = netp::listen_on(host, [server](NRP<netp::channel> const& ch) {
+		NRP<netp::handler::http> h = netp::make_ref<netp::handler::http>();
+		h->bind<netp::handler::http::fn_http_message_header_t>(netp::handler::http::http_event::E_MESSAGE_HEADER, &http_rps_server::on_message_header, server, std::placeholders::_1, std::placeholders::_2);
+		h->bind<netp::handler::http::fn_http_message_end_t>(netp::handler::http::http_event::E_MESSAGE_END, &http_rps_server::on_message_end, server, std::placeholders::_1);
+		h->bind<netp::handler::http::fn_http_activity_t>(netp::handler::http::http_event::E_READ_CLOSED, &http_rps_server::on_read_closed, server, std::placeholders::_1);
+		ch->pipeline()->add_last(h);
+	});
+	const int listenrt = std::get<0>(listenp->get());
+	if (listenrt != netp::OK) {
+		NETP_ERR("[http_rps]listen on: %s failed: %d", host.c_str(), listenrt);
+		return listenrt;
+	}
+
+	NRP<http_rps_client> client = netp::make_ref<http_rps_client>();
+	std::vector<NRP<netp::channel_dial_promise>> dialps;
+	for (int i = 0; i < connections; ++i) {
+		dialps.push_back(netp::dial(host, [client](NRP<netp::channel> const& ch) {
+			NRP<netp::handler::http> h = netp::make_ref<netp::handler::http>();
+			h->bind<netp::handler::http::fn_http_activity_t>(netp::handler::http::http_event::E_CONNECTED, &http_rps_client::on_connected, client, std::placeholders::_1);
+			h->bind<netp::handler::http::fn_http_message_end_t>(netp::handler::http::http_event::E_MESSAGE_END, &http_rps_client::on_message_end, client, std::placeholders::_1);
+			ch->pipeline()->add_last(h);
+		}));
+	}
+	for (auto const& dialp : dialps) {
+		const int dialrt = std::get<0>(dialp->get());
+		if (dialrt != netp::OK) {
+			NETP_ERR("[http_rps]dial: %s failed: %d", host.c_str(), dialrt);
+			return dialrt;
+		}
+	}
+
+	//skip the first second for the warm up
+	std::this_thread::sleep_for(std::chrono::seconds(1));
+	netp::benchmark mk("http_rps", netp::bf_no_mark_output | netp::bf_no_end_output);
+	const netp::u64_t begin = s_responses.load();
+	std::this_thread::sleep_for(std::chrono::seconds(seconds));
+	const netp::u64_t n = s_responses.load() - begin;
+	const long long cost_ns = mk.mark("done").count();
+	s_stop = true;
+
+	NETP_INFO("[http_rps]connections: %d, requests: %llu, cost: %lld ns, %.0f requests/sec", connections, n, cost_ns, (n * 1000000000.0) / cost_ns);
+	fprintf(stdout, "connections: %d, requests: %llu, %.0f requests/sec\n", connections, n, (n * 1000000000.0) / cost_ns);
+	fflush(stdout);
+
+	for (auto const& dialp : dialps) {
+		std::get<1>(dialp->get())->ch_close();
+		std::get<1>(dialp->get())->ch_close_promise()->wait();
+	}
+	std::get<1>(listenp->get())->ch_close();
+	std::get<1>(listenp->get())->ch_close_promise()->wait();
+
+	//the channels hold their loop, release them before the loops exit
+	dialps.clear();
+	listenp = nullptr;
+	client = nullptr;
+	server = nullptr;
+	netp::app::instance()->destroy_instance();
+	return 0;
+}
@@ -0,0 +1,154 @@
+
+// This is a latency benchmark of the poller interrupt
+// usage: interrupt_latency [round count]
+
+// part 1, raw wakeup (linux only)
+//	two threads ping-pong through a pair of interrupters, each side blocks in epoll_wait(EPOLLET) like the loop does
+//	tcp socketpair (nodelay), pipe, eventfd; we record round trip/2 as the wakeup latency
+
+// part 2, event_loop::schedule to run
+//	the loop is idle (in poller wait), we record the time from schedule() to the task running on the loop thread
+
+#include <netp.hpp>
+
+#ifdef _NETP_GNU_LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+enum intr_type {
+	T_SOCKETPAIR,
+	T_PIPE,
+	T_EVENTFD
+};
+
+struct raw_interrupter {
+	intr_type t;
+	int fdr;
+	int fdw;
+	int epfd;
+
+	raw_interrupter(intr_type t_) :t(t_), fdr(-1), fdw(-1), epfd(-1) {
+		int fds[2] = { -1,-1 };
+		switch (t) {
+		case T_SOCKETPAIR:
+		{
+			int rt = netp::socketpair(int(NETP_AF_INET), int(NETP_SOCK_STREAM), int(NETP_PROTOCOL_TCP), fds);
+			NETP_ASSERT(rt == netp::OK, "rt: %d", rt);
+			netp::set_nodelay(fds[1], true);
+		}
+		break;
+		case T_PIPE:
+		{
+			int rt = ::pipe(fds);
+			NETP_ASSERT(rt == 0, "rt: %d", rt);
+		}
+		break;
+		case T_EVENTFD:
+		{
+			fds[0] = fds[1] = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			NETP_ASSERT(fds[0] > 0);
+		}
+		break;
+		}
+		netp::set_nonblocking(fds[0], true);
+		netp::set_nonblocking(fds[1], true);
+		fdr = fds[0];
+		fdw = fds[1];
+
+		epfd = ::epoll_create1(EPOLL_CLOEXEC);
+		struct epoll_event ev;
+		ev.events = EPOLLIN | EPOLLET;
+		ev.data.fd = fdr;
+		int rt = ::epoll_ctl(epfd, EPOLL_CTL_ADD, fdr, &ev);
+		NETP_ASSERT(rt == 0, "rt: %d", rt);
+	}
+
+	~raw_interrupter() {
+		::close(epfd);
+		::close(fdr);
+		if (fdw != fdr) {
+			::close(fdw);
+		}
+	}
+
+	void interrupt() {
+		if (t == T_EVENTFD) {
+			::eventfd_write(fdw, 1);
+		} else {
+			const char i = 'i';
+			while (::write(fdw, &i, 1) != 1) {}
+		}
+	}
+
+	void wait() {
+		struct epoll_event ev;
+		while (::epoll_wait(epfd, &ev, 1, -1) != 1) {}
+		if (t == T_EVENTFD) {
+			eventfd_t v;
+			::eventfd_read(fdr, &v);
+		} else {
+			char tmp[4];
+			while (::read(fdr, tmp, 4) <= 0) {}
+		}
+	}
+};
+
+void bench_raw(const char* name, intr_type t, long rounds) {
+	raw_interrupter ping(t);
+	raw_interrupter pong(t);
+
+	NRP<netp::thread> th = netp::make_ref<netp::thread>();
+	th->start([&]() {
+		for (long i = 0; i < rounds; ++i) {
+			ping.wait();
+			pong.interrupt();
+		}
+	});
+
+	netp::benchmark mk(name, netp::bf_no_mark_output|netp::bf_no_end_output);
+	for (long i = 0; i < rounds; ++i) {
+		ping.interrupt();
+		pong.wait();
+	}
+	const long long cost_ns = mk.mark("done").count();
+	th->join();
+	NETP_INFO("[interrupt_latency][raw][%s]rounds: %ld, avg wakeup: %.2f ns", name, rounds, (cost_ns*1.0)/(rounds*2));
+}
+#endif
+
+void bench_schedule(long rounds) {
+	NRP<netp::event_loop> L = netp::app::instance()->def_loop_group()->next();
+	std::vector<long long> lat;
+	lat.reserve(rounds);
+
+	for (long i = 0; i < rounds; ++i) {
+		NRP<netp::promise<long long>> p = netp::make_ref<netp::promise<long long>>();
+		const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		L->schedule([p, begin]() {
+			p->set((std::chrono::steady_clock::now() - begin).count());
+		});
+		lat.push_back(p->get());
+	}
+
+	std::sort(lat.begin(), lat.end());
+	long long sum = 0;
+	for (long long l : lat) { sum += l; }
+	NETP_INFO("[interrupt_latency][schedule]rounds: %ld, avg: %.2f ns, p50: %lld ns, p99: %lld ns", rounds, (sum*1.0)/rounds, lat[rounds/2], lat[(rounds*99)/100]);
+}
+
+int main(int argc, char** argv) {
+	netp::app::instance()->init(argc, argv);
+	netp::app::instance()->start_loop();
+
+	const long rounds = (argc > 1) ? NETP_MAX(std::atol(argv[1]), 100L) : 100000L;
+
+#ifdef _NETP_GNU_LINUX
+	bench_raw("socketpair", T_SOCKETPAIR, rounds);
+	bench_raw("pipe", T_PIPE, rounds);
+	bench_raw("eventfd", T_EVENTFD, rounds);
+#endif
+	bench_schedule(rounds);
+
+	netp::app::instance()->destroy_instance();
+	return 0;
+}
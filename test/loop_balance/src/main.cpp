@@ -0,0 +1,197 @@
+// This is a skewed load benchmark of event_loop_group::next over loopback
+// usage: loop_balance [by_load 0|1] [seconds] [server loop count] [heavy count] [light count] [heavy burn us] [port]
+
+// server: a group of its own, the accepted channels are spread by event_loop_group::next, round robin or f_group_next_by_load
+// heavy: connected first, every request burns [heavy burn us] of cpu on its server loop, one request in flight per connection
+// light: connected once the heavy ones have run for a second, every request is echoed at once, we record the round trip of each
+// with round robin the light channels share the loops of the heavy ones evenly, the ones behind a burn get the tail
+
+#include <netp.hpp>
+
+static const netp::u32_t REQ_SIZE = 16;
+static const netp::byte_t s_heavy_req[REQ_SIZE] = { 'H' };
+static const netp::byte_t s_light_req[REQ_SIZE] = { 'L' };
+static std::atomic<bool> s_stop(false);
+
+class balance_server :
+	public netp::channel_handler_abstract
+{
+	const long m_burn_us;
+	netp::u32_t m_got;
+	netp::byte_t m_type;
+
+public:
+	balance_server(long burn_us) :
+		channel_handler_abstract(netp::CH_INBOUND_READ),
+		m_burn_us(burn_us),
+		m_got(0),
+		m_type(0)
+	{}
+
+	void read(NRP<netp::channel_handler_context> const& ctx, NRP<netp::packet> const& income) {
+		if (m_got == 0) {
+			m_type = *income->head();
+		}
+		m_got += income->len();
+		if (m_got < REQ_SIZE) {
+			return;
+		}
+		m_got = 0;
+		if (m_type == 'H') {
+			const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::microseconds(m_burn_us);
+			while (std::chrono::steady_clock::now() < end) {}
+		}
+		ctx->write(netp::make_ref<netp::packet>(s_light_req, REQ_SIZE));
+	}
+};
+
+class balance_client :
+	public netp::channel_handler_abstract
+{
+	const netp::byte_t m_type;
+	netp::u32_t m_got;
+	std::chrono::steady_clock::time_point m_begin;
+	std::vector<long long> m_lat;
+
+public:
+	balance_client(netp::byte_t type) :
+		channel_handler_abstract(netp::CH_ACTIVITY_CONNECTED | netp::CH_INBOUND_READ),
+		m_type(type),
+		m_got(0)
+	{}
+
+	void request(NRP<netp::channel_handler_context> const& ctx) {
+		if (s_stop.load(std::memory_order_relaxed)) {
+			return;
+		}
+		NRP<netp::packet> req = netp::make_ref<netp::packet>((m_type == 'H') ? s_heavy_req : s_light_req, REQ_SIZE);
+		m_begin = std::chrono::steady_clock::now();
+		ctx->write(req);
+	}
+
+	void connected(NRP<netp::channel_handler_context> const& ctx) {
+		request(ctx);
+	}
+
+	void read(NRP<netp::channel_handler_context> const& ctx, NRP<netp::packet> const& income) {
+		m_got += income->len();
+		if (m_got < REQ_SIZE) {
+			return;
+		}
+		m_got = 0;
+		if (!s_stop.load(std::memory_order_relaxed)) {
+			m_lat.push_back((std::chrono::steady_clock::now() - m_begin).count());
+		}
+		request(ctx);
+	}
+
+	//read once the loops of the client have stopped sending
+	std::vector<long long> const& lat() const { return m_lat; }
+};
+
+typedef std::vector<NRP<netp::channel_dial_promise>> dial_promise_vector_t;
+
+static int dial_n(std::string const& host, int n, netp::byte_t type, dial_promise_vector_t& dialps, std::vector<NRP<balance_client>>& clients) {
+	for (int i = 0; i < n; ++i) {
+		NRP<balance_client> c = netp::make_ref<balance_client>(type);
+		clients.push_back(c);
+		dialps.push_back(netp::dial(host, [c](NRP<netp::channel> const& ch) {
+			ch->ch_set_nodelay();
+			ch->pipeline()->add_last(c);
+		}));
+	}
+	for (auto const& dialp : dialps) {
+		const int dialrt = std::get<0>(dialp->get());
+		if (dialrt != netp::OK) {
+			NETP_ERR("[loop_balance]dial: %s failed: %d", host.c_str(), dialrt);
+			return dialrt;
+		}
+	}
+	return netp::OK;
+}
+
+int main(int argc, char** argv) {
+	netp::app::instance()->init(argc, argv);
+	netp::app::instance()->start_loop();
+
+	const bool by_load = (argc > 1) ? (std::atoi(argv[1]) != 0) : true;
+	const int seconds = (argc > 2) ? NETP_MAX(std::atoi(argv[2]), 1) : 5;
+	const int loops = (argc > 3) ? NETP_MAX(std::atoi(argv[3]), 2) : 4;
+	const int heavy = (argc > 4) ? NETP_MAX(std::atoi(argv[4]), 0) : 2;
+	const int light = (argc > 5) ? NETP_MAX(std::atoi(argv[5]), 1) : 32;
+	const long burn_us = (argc > 6) ? NETP_MAX(std::atol(argv[6]), 1L) : 2000L;
+	const std::string host = std::string("tcp://127.0.0.1:") + ((argc > 7) ? argv[7] : "13200");
+
+	netp::event_loop_cfg cfg(NETP_DEFAULT_POLLER_TYPE, netp::u8_t(by_load ? netp::f_group_next_by_load : 0), 128 * 1024);
+	NRP<netp::event_loop_group> g = netp::make_ref<netp::event_loop_group>(cfg, netp::default_event_loop_maker);
+	g->start(loops);
+
+	NRP<netp::channel_listen_promise> listenp = netp::listen_on(host, [burn_us](NRP<netp::channel> const& ch) {
+		ch->ch_set_nodelay();
+		ch->pipeline()->add_last(netp::make_ref<balance_server>(burn_us));
+	}, netp::make_ref<netp::socket_cfg>(g->next()));
+	const int listenrt = std::get<0>(listenp->get());
+	if (listenrt != netp::OK) {
+		NETP_ERR("[loop_balance]listen on: %s failed: %d", host.c_str(), listenrt);
+		return listenrt;
+	}
+
+	dial_promise_vector_t dialps;
+	std::vector<NRP<balance_client>> heavy_clients;
+	std::vector<NRP<balance_client>> light_clients;
+	int rt = dial_n(host, heavy, 'H', dialps, heavy_clients);
+	if (rt == netp::OK) {
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+		rt = dial_n(host, light, 'L', dialps, light_clients);
+	}
+	if (rt == netp::OK) {
+		std::this_thread::sleep_for(std::chrono::seconds(seconds));
+	}
+	s_stop = true;
+	//the last in flight request would be done by then
+	std::this_thread::sleep_for(std::chrono::milliseconds(100 + burn_us / 1000));
+
+	if (rt == netp::OK) {
+		std::vector<long long> lat;
+		for (auto const& c : light_clients) {
+			lat.insert(lat.end(), c->lat().begin(), c->lat().end());
+		}
+		std::sort(lat.begin(), lat.end());
+		const std::size_t n = lat.size();
+		if (n > 0) {
+			long long sum = 0;
+			for (long long l : lat) { sum += l; }
+			NETP_INFO("[loop_balance]by_load: %d, loops: %d, heavy: %d, light: %d, requests: %zu, avg: %.0f ns, p50: %lld ns, p99: %lld ns, p999: %lld ns", by_load, loops, heavy, light, n, (sum * 1.0) / n, lat[n / 2], lat[(n * 99) / 100], lat[(n * 999) / 1000]);
+			fprintf(stdout, "by_load: %d, loops: %d, heavy: %d, light: %d, requests: %zu, avg: %.0f ns, p50: %lld ns, p99: %lld ns, p999: %lld ns\n", by_load, loops, heavy, light, n, (sum * 1.0) / n, lat[n / 2], lat[(n * 99) / 100], lat[(n * 999) / 1000]);
+		}
+		//the loops of the heavy channels show up by io_ns and by the few light channels they got
+		netp::event_loop_group_stat st;
+		g->stat(st);
+		for (std::size_t i = 0; i < st.L.size(); ++i) {
+			netp::event_loop_stat const& l = st.L[i];
+			fprintf(stdout, "loop[%zu]: io_ctx: %u, rounds: %llu, poll: %llu ms, task: %llu ms, io: %llu ms, events/wakeup: %.2f, interrupts: %llu, coalesced: %llu\n", i, l.io_ctx,
+				(unsigned long long)l.rounds, (unsigned long long)(l.poll_ns / 1000000), (unsigned long long)(l.task_ns / 1000000), (unsigned long long)(l.io_ns / 1000000),
+				l.io_wakeups ? (l.io_events * 1.0) / l.io_wakeups : 0.0, (unsigned long long)l.interrupts, (unsigned long long)l.coalesced);
+		}
+		fflush(stdout);
+	}
+
+	for (auto const& dialp : dialps) {
+		if (std::get<0>(dialp->get()) == netp::OK) {
+			std::get<1>(dialp->get())->ch_close();
+			std::get<1>(dialp->get())->ch_close_promise()->wait();
+		}
+	}
+	std::get<1>(listenp->get())->ch_close();
+	std::get<1>(listenp->get())->ch_close_promise()->wait();
+
+	//the channels hold their loop, release them before the loops exit
+	dialps.clear();
+	listenp = nullptr;
+	heavy_clients.clear();
+	light_clients.clear();
+	g->stop();
+	g = nullptr;
+	netp::app::instance()->destroy_instance();
+	return 0;
+}
@@ -0,0 +1,447 @@
+// This is a check of the rpc flow control over loopback
+// usage: rpc_flow [port]
+
+// expire: calls of different timeouts expire in deadline order by E_RPC_CALL_TIMEOUT, a call waiting for an in flight slot expires by E_RPC_WRITE_TIMEOUT,
+//	calls of mixed timeouts answered in any order leave no deadline behind
+// backpressure: with set_pending_max(n), the n-th pending call notifies write block, the call beyond it fails by E_CHANNEL_WRITE_BLOCK,
+//	write unblock is notified once the pending ones drop to the half
+// batch: the calls of one loop round go out by one write_chain, the batches are cut by set_batch_bytes_max
+// shared payload: the rpc header is never written into the headroom of a payload the caller still holds, or of a slice of a buffer,
+//	both by rpc_message::encode and on the wire
+// the server holds API_HOLD calls until release_holds(), API_PING is answered at once
+// a wire_tap under the decode only hlen of both sides counts the outbound writes, and splits every read into pieces of 1 to 55 bytes,
+//	so the frames are decoded across the split and the coalesced reads
+
+#include <netp.hpp>
+#include <random>
+
+enum rpc_flow_api {
+	API_PING,
+	API_HOLD
+};
+
+struct held_call {
+	NRP<netp::rpc> r;
+	NRP<netp::rpc_call_promise> f;
+};
+
+static std::mutex s_holds_mtx;
+static std::vector<held_call> s_holds;
+//touched by the loop of the client only
+static std::vector<bool> s_block_events;
+
+class wire_tap :
+	public netp::channel_handler_abstract
+{
+	netp::u32_t m_piece;
+public:
+	netp::u32_t writes;
+	netp::u32_t write_chains;
+	netp::u32_t write_chain_max;
+
+	wire_tap() :
+		channel_handler_abstract(netp::CH_INBOUND_READ | netp::CH_OUTBOUND_WRITE | netp::CH_OUTBOUND_WRITE_CHAIN),
+		m_piece(0),
+		writes(0),
+		write_chains(0),
+		write_chain_max(0)
+	{}
+
+	void read(NRP<netp::channel_handler_context> const& ctx, NRP<netp::packet> const& income) override {
+		static const netp::u32_t pieces[] = { 1, 2, 3, 5, 8, 13, 21, 34, 55 };
+		netp::u32_t off = 0;
+		while (off < income->len()) {
+			const netp::u32_t n = NETP_MIN(pieces[m_piece % (sizeof(pieces) / sizeof(pieces[0]))], income->len() - off);
+			++m_piece;
+			ctx->fire_read(netp::make_ref<netp::packet>(income->head() + off, n));
+			off += n;
+		}
+	}
+
+	void write(NRP<netp::promise<int>> const& intp, NRP<netp::channel_handler_context> const& ctx, NRP<netp::packet> const& outlet) override {
+		++writes;
+		ctx->write(intp, outlet);
+	}
+
+	void write_chain(NRP<netp::promise<int>> const& intp, NRP<netp::channel_handler_context> const& ctx, NRP<netp::packet_chain> const& chain) override {
+		++write_chains;
+		write_chain_max = NETP_MAX(write_chain_max, chain->len());
+		ctx->write_chain(intp, chain);
+	}
+};
+
+//the tap of the client, touched by its loop only
+static NRP<wire_tap> s_client_tap;
+
+static NRP<netp::packet> payload(const char* s) {
+	return netp::make_ref<netp::packet>(s, netp::u32_t(netp::strlen(s)));
+}
+
+static int code(NRP<netp::rpc_call_promise> const& p) {
+	return std::get<0>(p->get());
+}
+
+template <class _Fx>
+static void on_loop(NRP<netp::rpc> const& r, _Fx&& fn) {
+	NRP<netp::promise<int>> p = netp::make_ref<netp::promise<int>>();
+	r->event_loop()->execute([fn, p]() {
+		fn();
+		p->set(netp::OK);
+	});
+	p->wait();
+}
+
+static void wait_holds(::size_t n) {
+	while (1) {
+		{
+			std::lock_guard<std::mutex> lg(s_holds_mtx);
+			if (s_holds.size() >= n) {
+				return;
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+static void release_holds() {
+	std::vector<held_call> holds;
+	{
+		std::lock_guard<std::mutex> lg(s_holds_mtx);
+		holds.swap(s_holds);
+	}
+	for (held_call& h : holds) {
+		h.r->event_loop()->execute([f = h.f]() {
+			f->set(std::make_tuple(netp::OK, payload("released")));
+		});
+	}
+}
+
+static int check_idle(NRP<netp::rpc> const& r, const char* what) {
+	netp::u32_t inflight = 0;
+	netp::u32_t pending = 0;
+	on_loop(r, [r, &inflight, &pending]() {
+		inflight = r->inflight_count();
+		pending = r->pending_count();
+	});
+	if (inflight != 0 || pending != 0) {
+		NETP_ERR("[rpc_flow][%s]inflight: %u, pending: %u", what, inflight, pending);
+		return -1;
+	}
+	return netp::OK;
+}
+
+static int check_expire(NRP<netp::rpc> const& r) {
+	//the later deadline goes first, the earlier one must not wait behind it
+	const netp::timer_timepoint_t begin = netp::timer_clock_t::now();
+	NRP<netp::rpc_call_promise> late = r->call(API_HOLD, payload("late"), std::chrono::seconds(3));
+	NRP<netp::rpc_call_promise> early = r->call(API_HOLD, payload("early"), std::chrono::seconds(1));
+	const int early_rt = code(early);
+	const long long early_ms = std::chrono::duration_cast<std::chrono::milliseconds>(netp::timer_clock_t::now() - begin).count();
+	const int late_rt = code(late);
+	const long long late_ms = std::chrono::duration_cast<std::chrono::milliseconds>(netp::timer_clock_t::now() - begin).count();
+	release_holds();
+	//the deadlines are checked once a second
+	if (early_rt != netp::E_RPC_CALL_TIMEOUT || late_rt != netp::E_RPC_CALL_TIMEOUT || early_ms >= 2900 || late_ms < 3000) {
+		NETP_ERR("[rpc_flow][expire]early: %d in %lld ms, late: %d in %lld ms", early_rt, early_ms, late_rt, late_ms);
+		return -1;
+	}
+	NETP_INFO("[rpc_flow][expire]early: %d in %lld ms, late: %d in %lld ms", early_rt, early_ms, late_rt, late_ms);
+
+	//the call behind the only in flight slot expires before it is written
+	on_loop(r, [r]() { r->set_inflight_max(1); });
+	NRP<netp::rpc_call_promise> inflight = r->call(API_HOLD, payload("inflight"), std::chrono::seconds(3));
+	wait_holds(1);
+	NRP<netp::rpc_call_promise> waiting = r->call(API_PING, payload("waiting"), std::chrono::seconds(1));
+	const int waiting_rt = code(waiting);
+	const int inflight_rt = code(inflight);
+	release_holds();
+	on_loop(r, [r]() { r->set_inflight_max(NETP_RPC_INFLIGHT_MAX); });
+	if (waiting_rt != netp::E_RPC_WRITE_TIMEOUT || inflight_rt != netp::E_RPC_CALL_TIMEOUT) {
+		NETP_ERR("[rpc_flow][expire]waiting: %d, inflight: %d", waiting_rt, inflight_rt);
+		return -1;
+	}
+	NETP_INFO("[rpc_flow][expire]waiting: %d, inflight: %d", waiting_rt, inflight_rt);
+
+	//mixed timeouts, answered in arrival order, the deadlines are removed from anywhere of the heap
+	std::mt19937 rnd(21011);
+	std::uniform_int_distribution<int> dist(5, 60);
+	std::vector<NRP<netp::rpc_call_promise>> calls;
+	for (int i = 0; i < 1000; ++i) {
+		calls.push_back(r->call(API_PING, payload("mixed"), std::chrono::seconds(dist(rnd))));
+	}
+	for (NRP<netp::rpc_call_promise> const& c : calls) {
+		if (code(c) != netp::OK) {
+			NETP_ERR("[rpc_flow][expire]mixed timeouts, call failed: %d", code(c));
+			return -1;
+		}
+	}
+	return check_idle(r, "expire");
+}
+
+static int check_backpressure(NRP<netp::rpc> const& r) {
+	const netp::u32_t pending_max = 8;
+	on_loop(r, [r, pending_max]() {
+		r->set_inflight_max(1);
+		r->set_pending_max(pending_max);
+		r->on_write_block([](NRP<netp::rpc> const&, bool blocked) {
+			s_block_events.push_back(blocked);
+		});
+	});
+
+	//the only in flight slot is taken, the pings wait in the to write list
+	NRP<netp::rpc_call_promise> hold = r->call(API_HOLD, payload("hold"), std::chrono::seconds(30));
+	wait_holds(1);
+	std::vector<NRP<netp::rpc_call_promise>> pings;
+	for (netp::u32_t i = 0; i <= pending_max; ++i) {
+		pings.push_back(r->call(API_PING, payload("ping"), std::chrono::seconds(30)));
+	}
+	const int refused_rt = code(pings.back());
+	pings.pop_back();
+
+	bool blocked = false;
+	netp::u32_t pending = 0;
+	std::vector<bool> events;
+	on_loop(r, [r, &blocked, &pending, &events]() {
+		blocked = r->write_blocked();
+		pending = r->pending_count();
+		events = s_block_events;
+	});
+	if (refused_rt != netp::E_CHANNEL_WRITE_BLOCK || !blocked || pending != pending_max || events != std::vector<bool>{ true }) {
+		NETP_ERR("[rpc_flow][backpressure]refused: %d, blocked: %d, pending: %u, events: %u", refused_rt, blocked, pending, netp::u32_t(events.size()));
+		return -1;
+	}
+	NETP_INFO("[rpc_flow][backpressure]refused: %d, blocked: %d, pending: %u", refused_rt, blocked, pending);
+
+	//the pings go one by one once the hold is answered
+	release_holds();
+	if (code(hold) != netp::OK) {
+		NETP_ERR("[rpc_flow][backpressure]hold failed: %d", code(hold));
+		return -1;
+	}
+	for (NRP<netp::rpc_call_promise> const& p : pings) {
+		if (code(p) != netp::OK) {
+			NETP_ERR("[rpc_flow][backpressure]ping failed: %d", code(p));
+			return -1;
+		}
+	}
+	on_loop(r, [r, &blocked, &events]() {
+		blocked = r->write_blocked();
+		events = s_block_events;
+		r->set_inflight_max(NETP_RPC_INFLIGHT_MAX);
+		r->set_pending_max(NETP_RPC_PENDING_MAX);
+		r->on_write_block(nullptr);
+	});
+	if (blocked || events != std::vector<bool>{ true, false }) {
+		NETP_ERR("[rpc_flow][backpressure]blocked: %d, events: %u", blocked, netp::u32_t(events.size()));
+		return -1;
+	}
+	NETP_INFO("[rpc_flow][backpressure]unblocked, events: %u", netp::u32_t(events.size()));
+	return check_idle(r, "backpressure");
+}
+
+static NRP<netp::packet> pattern(netp::u32_t size, netp::u32_t seed) {
+	NRP<netp::packet> p = netp::make_ref<netp::packet>(size);
+	for (netp::u32_t i = 0; i < size; ++i) {
+		p->write<netp::u8_t>(netp::u8_t(seed * 31 + i));
+	}
+	return p;
+}
+
+//n pings issued in one loop round, write_chains and write_chain_max are counted by the tap of the client for them
+static int burst(NRP<netp::rpc> const& r, netp::u32_t n, netp::u32_t& write_chains, netp::u32_t& write_chain_max) {
+	std::vector<NRP<netp::packet>> ins;
+	for (netp::u32_t i = 0; i < n; ++i) {
+		//one in ten is larger than NETP_RPC_BATCH_INLINE_MAX, it is referenced by the batch rather than copied
+		ins.push_back(pattern((i % 10 == 0) ? 4096 : (64 + i), i));
+	}
+	std::vector<NRP<netp::rpc_call_promise>> calls;
+	netp::u32_t writes = 0;
+	on_loop(r, [r, &ins, &calls, &writes, &write_chains]() {
+		writes = s_client_tap->writes;
+		write_chains = s_client_tap->write_chains;
+		s_client_tap->write_chain_max = 0;
+		for (NRP<netp::packet> const& in : ins) {
+			calls.push_back(r->call(API_PING, in, std::chrono::seconds(30)));
+		}
+	});
+	for (netp::u32_t i = 0; i < n; ++i) {
+		NRP<netp::packet> const& out = std::get<1>(calls[i]->get());
+		if (code(calls[i]) != netp::OK || out == nullptr || out->len() != ins[i]->len() || std::memcmp(out->head(), ins[i]->head(), out->len()) != 0) {
+			NETP_ERR("[rpc_flow][batch]call %u failed: %d", i, code(calls[i]));
+			return -1;
+		}
+	}
+	on_loop(r, [&writes, &write_chains, &write_chain_max]() {
+		writes = s_client_tap->writes - writes;
+		write_chains = s_client_tap->write_chains - write_chains;
+		write_chain_max = s_client_tap->write_chain_max;
+	});
+	if (writes != 0) {
+		NETP_ERR("[rpc_flow][batch]unbatched writes: %u", writes);
+		return -1;
+	}
+	return netp::OK;
+}
+
+static int check_batch(NRP<netp::rpc> const& r) {
+	const netp::u32_t n = 100;
+	netp::u32_t write_chains = 0;
+	netp::u32_t write_chain_max = 0;
+	if (burst(r, n, write_chains, write_chain_max) != netp::OK) {
+		return -1;
+	}
+	if (write_chains != 1) {
+		NETP_ERR("[rpc_flow][batch]calls: %u, write_chain: %u", n, write_chains);
+		return -1;
+	}
+	NETP_INFO("[rpc_flow][batch]calls: %u, write_chain: %u, bytes: %u", n, write_chains, write_chain_max);
+
+	//cut by the max bytes of one batch
+	const netp::u32_t total = write_chain_max;
+	const netp::u32_t batch_max = 16 * 1024;
+	on_loop(r, [r, batch_max]() { r->set_batch_bytes_max(batch_max); });
+	const int rt = burst(r, n, write_chains, write_chain_max);
+	on_loop(r, [r]() { r->set_batch_bytes_max(NETP_RPC_BATCH_BYTES_MAX); });
+	if (rt != netp::OK) {
+		return -1;
+	}
+	if (write_chain_max > batch_max || write_chains < (total + batch_max - 1) / batch_max) {
+		NETP_ERR("[rpc_flow][batch]batch max: %u, write_chain: %u, max bytes: %u", batch_max, write_chains, write_chain_max);
+		return -1;
+	}
+	NETP_INFO("[rpc_flow][batch]batch max: %u, write_chain: %u, max bytes: %u", batch_max, write_chains, write_chain_max);
+	return check_idle(r, "batch");
+}
+
+static const netp::u32_t GUARD_SIZE = 32;
+static const netp::u8_t GUARD_BYTE = 0xa5;
+
+//pattern(size, seed) with GUARD_SIZE bytes of GUARD_BYTE right before head(), enough headroom for any rpc header
+static NRP<netp::packet> guarded(netp::u32_t size, netp::u32_t seed) {
+	NRP<netp::packet> p = netp::make_ref<netp::packet>(GUARD_SIZE + size);
+	p->fill(GUARD_BYTE, GUARD_SIZE);
+	NRP<netp::packet> body = pattern(size, seed);
+	p->write(body->head(), body->len());
+	p->skip(GUARD_SIZE);
+	return p;
+}
+
+static bool guard_intact(NRP<netp::packet> const& p, netp::u32_t size, netp::u32_t seed) {
+	NRP<netp::packet> body = pattern(size, seed);
+	for (netp::u32_t i = 1; i <= GUARD_SIZE; ++i) {
+		if (*(p->head() - i) != GUARD_BYTE) {
+			return false;
+		}
+	}
+	return p->len() == size && std::memcmp(p->head(), body->head(), size) == 0;
+}
+
+static int check_shared_payload(NRP<netp::rpc> const& r) {
+	const netp::u32_t size = 4096;
+
+	//held by the caller too
+	NRP<netp::packet> held = guarded(size, 1);
+	NRP<netp::rpc_message> m = netp::make_ref<netp::rpc_message>(netp::rpc_message_type::T_DATA, 1, netp::OK, held);
+	NRP<netp::packet> outp;
+	m->encode(outp);
+	m = nullptr;
+	NRP<netp::rpc_message> decoded;
+	if (!guard_intact(held, size, 1) || netp::rpc_message::from_packet(outp, decoded) != netp::OK ||
+		decoded->data->len() != size || std::memcmp(decoded->data->head(), held->head(), size) != 0)
+	{
+		NETP_ERR("[rpc_flow][shared]encode wrote a held payload");
+		return -1;
+	}
+
+	//a slice of a buffer held by the caller, the slice itself is held by the message only
+	NRP<netp::packet> whole = guarded(size + 100, 2);
+	m = netp::make_ref<netp::rpc_message>(netp::rpc_message_type::T_DATA, 2, netp::OK, whole->slice(0, size, GUARD_SIZE));
+	m->encode(outp);
+	m = nullptr;
+	if (!guard_intact(whole, size + 100, 2) || netp::rpc_message::from_packet(outp, decoded) != netp::OK ||
+		decoded->data->len() != size || std::memcmp(decoded->data->head(), whole->head(), size) != 0)
+	{
+		NETP_ERR("[rpc_flow][shared]encode wrote a sliced payload");
+		return -1;
+	}
+
+	//larger than NETP_RPC_BATCH_INLINE_MAX, the payload is referenced by the batch, its frame header goes in front of it
+	NRP<netp::packet> held_wire = guarded(size, 3);
+	NRP<netp::packet> whole_wire = guarded(size + 100, 4);
+	NRP<netp::rpc_call_promise> held_call = r->call(API_PING, held_wire);
+	NRP<netp::rpc_call_promise> slice_call = r->call(API_PING, whole_wire->slice(0, size, GUARD_SIZE));
+	if (code(held_call) != netp::OK || code(slice_call) != netp::OK) {
+		NETP_ERR("[rpc_flow][shared]call failed: %d, %d", code(held_call), code(slice_call));
+		return -1;
+	}
+	NRP<netp::packet> const& held_echo = std::get<1>(held_call->get());
+	NRP<netp::packet> const& slice_echo = std::get<1>(slice_call->get());
+	if (!guard_intact(held_wire, size, 3) || !guard_intact(whole_wire, size + 100, 4) ||
+		held_echo->len() != size || std::memcmp(held_echo->head(), held_wire->head(), size) != 0 ||
+		slice_echo->len() != size || std::memcmp(slice_echo->head(), whole_wire->head(), size) != 0)
+	{
+		NETP_ERR("[rpc_flow][shared]the payload held by the caller is written");
+		return -1;
+	}
+	NETP_INFO("[rpc_flow][shared]held and sliced payloads are intact");
+	return check_idle(r, "shared");
+}
+
+int main(int argc, char** argv) {
+	netp::app::instance()->init(argc, argv);
+	netp::app::instance()->start_loop();
+
+	const std::string host = std::string("tcp://127.0.0.1:") + ((argc > 1) ? argv[1] : "21011");
+
+	netp::fn_rpc_activity_notify_t fn_bind_api = [](NRP<netp::rpc> const& r) {
+		r->bindcall(API_PING, [](NRP<netp::rpc> const&, NRP<netp::packet> const& in, NRP<netp::rpc_call_promise> const& f) {
+			f->set(std::make_tuple(netp::OK, netp::make_ref<netp::packet>(in->head(), in->len())));
+		});
+		r->bindcall(API_HOLD, [](NRP<netp::rpc> const& r, NRP<netp::packet> const&, NRP<netp::rpc_call_promise> const& f) {
+			std::lock_guard<std::mutex> lg(s_holds_mtx);
+			s_holds.push_back({ r, f });
+		});
+	};
+	NRP<netp::rpc_listen_promise> lf = netp::rpc::listen(host, fn_bind_api, [](NRP<netp::channel> const& ch) {
+		ch->pipeline()->add_last(netp::make_ref<wire_tap>());
+	});
+	int rt = std::get<0>(lf->get());
+	if (rt != netp::OK) {
+		NETP_ERR("[rpc_flow]listen on: %s failed: %d", host.c_str(), rt);
+		return rt;
+	}
+
+	NRP<netp::rpc_dial_promise> df = netp::rpc::dial(host, [](NRP<netp::channel> const& ch) {
+		s_client_tap = netp::make_ref<wire_tap>();
+		ch->pipeline()->add_last(s_client_tap);
+	});
+	rt = std::get<0>(df->get());
+	if (rt != netp::OK) {
+		NETP_ERR("[rpc_flow]dial: %s failed: %d", host.c_str(), rt);
+		return rt;
+	}
+	NRP<netp::rpc> r = std::get<1>(df->get());
+
+	rt = check_batch(r);
+	if (rt == netp::OK) {
+		rt = check_shared_payload(r);
+	}
+	if (rt == netp::OK) {
+		rt = check_expire(r);
+	}
+	if (rt == netp::OK) {
+		rt = check_backpressure(r);
+	}
+
+	r->close()->wait();
+	std::get<1>(lf->get())->ch_close();
+	std::get<1>(lf->get())->ch_close_promise()->wait();
+
+	//the rpc holds its loop, release it before the loops exit
+	r = nullptr;
+	s_client_tap = nullptr;
+	df = nullptr;
+	lf = nullptr;
+	netp::app::instance()->destroy_instance();
+	return rt == netp::OK ? 0 : -1;
+}
@@ -0,0 +1,175 @@
+
+// This is a contention benchmark of the cross thread task queue of event_loop
+// usage: schedule_contention [producer count] [task count per producer]
+
+// part 1, queue only
+//	legacy: spin_mutex + double buffered std::vector<std::function<void()>> (the design before mpsc_queue)
+//	mpsc: netp::mpsc_queue + netp::task_node (the callable is stored in the queue node)
+//	the task captures a ref and a few args (beyond the small buffer of std::function), as the cross loop tasks usually do
+//	N producer threads push tasks as fast as they can, one consumer thread run them, we record the time of the last task done
+
+// part 2, event_loop::schedule and event_loop::schedule_n (batch of 16) from N producer threads to one loop
+
+#include <netp.hpp>
+
+struct legacy_tq {
+	netp::spin_mutex mtx;
+	netp::io_task_q_t qs[2];
+	netp::io_task_q_t* q;
+	netp::io_task_q_t* standby;
+
+	legacy_tq() :q(&qs[0]), standby(&qs[1]) {}
+
+	template <class fn_task_t>
+	void push(fn_task_t&& f) {
+		netp::lock_guard<netp::spin_mutex> lg(mtx);
+		standby->emplace_back(std::forward<fn_task_t>(f));
+	}
+
+	long run() {
+		mtx.lock();
+		if (!standby->empty()) {
+			std::swap(standby, q);
+		}
+		mtx.unlock();
+
+		const long n = long(q->size());
+		for (long i = 0; i < n; ++i) {
+			(*q)[i]();
+			(*q)[i] = nullptr;
+		}
+		q->clear();
+		return n;
+	}
+};
+
+struct mpsc_tq {
+	netp::mpsc_queue q;
+
+	template <class fn_task_t>
+	void push(fn_task_t&& f) {
+		q.push(netp::task_node::make(std::forward<fn_task_t>(f)));
+	}
+
+	long run() {
+		long n = 0;
+		netp::mpsc_node* node;
+		while ((node = q.pop()) != nullptr) {
+			static_cast<netp::task_node*>(node)->run();
+			++n;
+		}
+		return n;
+	}
+};
+
+template <class tq_t>
+void bench_tq(const char* name, int producers, long per_producer) {
+	tq_t tq;
+	std::atomic<bool> go(false);
+	std::atomic<long> sum(0);
+	const long total = producers * per_producer;
+	long long cost_ns = 0;
+
+	NRP<netp::thread> consumer = netp::make_ref<netp::thread>();
+	consumer->start([&]() {
+		while (!go.load(std::memory_order_acquire)) {}
+		netp::benchmark mk(name, netp::bf_no_mark_output|netp::bf_no_end_output);
+		long done = 0;
+		while (done < total) {
+			done += tq.run();
+		}
+		cost_ns = mk.mark("done").count();
+	});
+
+	std::vector<NRP<netp::thread>> ths;
+	for (int p = 0; p < producers; ++p) {
+		NRP<netp::thread> th = netp::make_ref<netp::thread>();
+		NRP<netp::promise<int>> ref = netp::make_ref<netp::promise<int>>();
+		th->start([&, ref]() {
+			while (!go.load(std::memory_order_acquire)) {}
+			for (long i = 0; i < per_producer; ++i) {
+				//a typical cross loop task captures a channel ref and a few args, beyond the small buffer of std::function
+				tq.push([&sum, i, ch = ref, a = i + 1, b = i + 2]() {
+					sum.fetch_add((i ^ a ^ b) & 1, std::memory_order_relaxed);
+					(void)ch;
+				});
+			}
+		});
+		ths.push_back(th);
+	}
+
+	go.store(true, std::memory_order_release);
+	for (auto& th : ths) {
+		th->join();
+	}
+	consumer->join();
+
+	NETP_INFO("[schedule_contention][%s]producer: %d, tasks: %ld, cost: %lld ns, %.2f ns/task, %.2f M tasks/s", name, producers, total, cost_ns, (cost_ns*1.0)/total, (total*1000.0)/cost_ns);
+}
+
+struct counter_task {
+	struct counter {
+		long n;
+		long total;
+		NRP<netp::promise<int>> donep;
+	};
+	counter* c;
+	void operator()() const {
+		if (++c->n == c->total) {
+			c->donep->set(netp::OK);
+		}
+	}
+};
+
+void bench_loop(const char* name, int producers, long per_producer, long batch) {
+	NRP<netp::event_loop> L = netp::app::instance()->def_loop_group()->next();
+	counter_task::counter c = { 0, producers * per_producer, netp::make_ref<netp::promise<int>>() };
+	std::atomic<bool> go(false);
+
+	std::vector<NRP<netp::thread>> ths;
+	for (int p = 0; p < producers; ++p) {
+		NRP<netp::thread> th = netp::make_ref<netp::thread>();
+		th->start([&]() {
+			while (!go.load(std::memory_order_acquire)) {}
+			if (batch <= 1) {
+				for (long i = 0; i < per_producer; ++i) {
+					L->schedule(counter_task{ &c });
+				}
+				return;
+			}
+			std::vector<counter_task> tasks;
+			for (long i = 0; i < per_producer; i += batch) {
+				tasks.assign(std::size_t(NETP_MIN(batch, per_producer - i)), counter_task{ &c });
+				L->schedule_n(tasks);
+			}
+		});
+		ths.push_back(th);
+	}
+
+	netp::benchmark mk(name, netp::bf_no_mark_output|netp::bf_no_end_output);
+	go.store(true, std::memory_order_release);
+	for (auto& th : ths) {
+		th->join();
+	}
+	c.donep->wait();
+	const long long cost_ns = mk.mark("done").count();
+	NETP_INFO("[schedule_contention][%s]producer: %d, tasks: %ld, cost: %lld ns, %.2f ns/task, %.2f M tasks/s", name, producers, c.total, cost_ns, (cost_ns*1.0)/c.total, (c.total*1000.0)/cost_ns);
+}
+
+int main(int argc, char** argv) {
+	netp::app::instance()->init(argc, argv);
+	netp::app::instance()->start_loop();
+
+	const int producers = (argc > 1) ? NETP_MAX(std::atoi(argv[1]), 1) : 4;
+	const long per_producer = (argc > 2) ? NETP_MAX(std::atol(argv[2]), 1L) : 500000L;
+
+	for (int p = 1; p <= producers; p *= 2) {
+		bench_tq<legacy_tq>("legacy", p, per_producer);
+		bench_tq<mpsc_tq>("mpsc", p, per_producer);
+		bench_loop("loop_schedule", p, per_producer, 1);
+		bench_loop("loop_schedule_n", p, per_producer, 16);
+	}
+
+	netp::app::instance()->destroy_instance();
+	return 0;
+}
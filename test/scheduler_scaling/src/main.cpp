@@ -0,0 +1,181 @@
+// This is a scaling benchmark of netp::scheduler (cpu bound jobs off the event_loop)
+// usage: scheduler_scaling [max worker count] [task count] [spin per task]
+
+// legacy: one global std::deque<std::function<void()>> guarded by a spin_mutex, workers wait on a condition_variable_any (the design before work stealing)
+// ws: netp::scheduler, per worker fifo, stealing, the callable is stored in the task node
+// for each worker count of 1..N:
+//	flat: an outside thread schedules all the tasks
+//	fork: one root task schedules all the tasks from a worker, they land on one worker and the others have to steal
+//	submit: tasks are submitted from an event_loop, the promise is set on that loop
+
+#include <deque>
+#include <netp.hpp>
+
+static __NETP_NO_INLINE long cpu_work(long spin, long seed) {
+	long x = seed;
+	for (long i = 0; i < spin; ++i) {
+		x = x * 6364136223846793005LL + 1442695040888963407LL;
+	}
+	return x;
+}
+
+class legacy_pool {
+	netp::spin_mutex m_mtx;
+	netp::condition_variable_any m_cond;
+	std::deque<std::function<void()>> m_tasks[netp::P_MAX];
+	std::vector<NRP<netp::thread>> m_ths;
+	bool m_exit;
+
+	void run() {
+		while (1) {
+			std::function<void()> t;
+			{
+				netp::unique_lock<netp::spin_mutex> ulk(m_mtx);
+				while (m_tasks[netp::P_HIGH].empty() && m_tasks[netp::P_NORMAL].empty() && !m_exit) {
+					m_cond.no_interrupt_wait(ulk);
+				}
+				std::deque<std::function<void()>>& q = m_tasks[netp::P_HIGH].empty() ? m_tasks[netp::P_NORMAL] : m_tasks[netp::P_HIGH];
+				if (q.empty()) {
+					return;
+				}
+				t = std::move(q.front());
+				q.pop_front();
+			}
+			t();
+		}
+	}
+
+public:
+	legacy_pool(int n) :m_exit(false) {
+		for (int i = 0; i < n; ++i) {
+			NRP<netp::thread> th = netp::make_ref<netp::thread>();
+			th->start(&legacy_pool::run, this);
+			m_ths.push_back(th);
+		}
+	}
+
+	~legacy_pool() {
+		{
+			netp::lock_guard<netp::spin_mutex> lg(m_mtx);
+			m_exit = true;
+			m_cond.no_interrupt_notify_all();
+		}
+		for (auto& th : m_ths) {
+			th->join();
+		}
+	}
+
+	template <class fn_task_t>
+	void schedule(fn_task_t&& f, netp::u8_t p = netp::P_NORMAL) {
+		netp::lock_guard<netp::spin_mutex> lg(m_mtx);
+		m_tasks[p].emplace_back(std::forward<fn_task_t>(f));
+		m_cond.no_interrupt_notify_one();
+	}
+};
+
+struct bench_ctx {
+	std::atomic<long> done;
+	std::atomic<long> sum;
+	long total;
+	long spin;
+	NRP<netp::promise<int>> donep;
+
+	bench_ctx(long total_, long spin_) :done(0), sum(0), total(total_), spin(spin_), donep(netp::make_ref<netp::promise<int>>()) {}
+
+	void task(long i) {
+		sum.fetch_add(cpu_work(spin, i) & 1, std::memory_order_relaxed);
+		if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == total) {
+			donep->set(netp::OK);
+		}
+	}
+};
+
+template <class pool_t>
+void schedule_all(pool_t& pool, bench_ctx& c) {
+	//c might be gone once the last task is done (fork)
+	const long total = c.total;
+	for (long i = 0; i < total; ++i) {
+		//a typical job captures a ref and a few args
+		pool.schedule([&c, i, ref = c.donep]() {
+			c.task(i);
+			(void)ref;
+		}, (i & 7) ? netp::P_NORMAL : netp::P_HIGH);
+	}
+}
+
+template <class pool_t>
+long long bench(pool_t& pool, long total, long spin, bool fork) {
+	bench_ctx c(total, spin);
+	netp::benchmark mk("bench", netp::bf_no_mark_output | netp::bf_no_end_output);
+	if (fork) {
+		pool.schedule([&pool, &c]() {
+			schedule_all(pool, c);
+		});
+	} else {
+		schedule_all(pool, c);
+	}
+	c.donep->wait();
+	return mk.mark("done").count();
+}
+
+long long bench_submit(netp::scheduler& s, long total, long spin) {
+	NRP<netp::event_loop> L = netp::app::instance()->def_loop_group()->next();
+	NRP<netp::promise<int>> donep = netp::make_ref<netp::promise<int>>();
+	netp::benchmark mk("submit", netp::bf_no_mark_output | netp::bf_no_end_output);
+	L->execute([L, &s, total, spin, donep]() {
+		long* left = new long(total);
+		for (long i = 0; i < total; ++i) {
+			NRP<netp::promise<long>> p = s.submit([i, spin]() {
+				return cpu_work(spin, i);
+			});
+			p->if_done([L, left, donep](long const&) {
+				//set on the loop that submitted, no lock on left
+				NETP_ASSERT(L->in_event_loop());
+				if (--(*left) == 0) {
+					delete left;
+					donep->set(netp::OK);
+				}
+			});
+		}
+	});
+	donep->wait();
+	return mk.mark("done").count();
+}
+
+void report(const char* name, int workers, long total, long long cost_ns, unsigned long long stolen) {
+	NETP_INFO("[scheduler_scaling][%s]workers: %d, tasks: %ld, cost: %lld ns, %.2f ns/task, %.2f M tasks/s, stolen: %llu", name, workers, total, cost_ns, (cost_ns * 1.0) / total, (total * 1000.0) / cost_ns, stolen);
+}
+
+int main(int argc, char** argv) {
+	netp::app::instance()->init(argc, argv);
+	netp::app::instance()->start_loop();
+
+	const int max_workers = (argc > 1) ? NETP_MAX(std::atoi(argv[1]), 1) : int(std::thread::hardware_concurrency());
+	const long total = (argc > 2) ? NETP_MAX(std::atol(argv[2]), 1L) : 200000L;
+	const long spin = (argc > 3) ? NETP_MAX(std::atol(argv[3]), 0L) : 256L;
+
+	for (int w = 1; w <= max_workers; ++w) {
+		{
+			legacy_pool pool(w);
+			report("legacy_flat", w, total, bench(pool, total, spin, false), 0);
+			report("legacy_fork", w, total, bench(pool, total, spin, true), 0);
+		}
+		{
+			netp::scheduler s(static_cast<netp::u8_t>(w));
+			s.start();
+			unsigned long long stolen = s.stolen();
+			long long cost_ns = bench(s, total, spin, false);
+			report("ws_flat", w, total, cost_ns, s.stolen() - stolen);
+			stolen = s.stolen();
+			cost_ns = bench(s, total, spin, true);
+			report("ws_fork", w, total, cost_ns, s.stolen() - stolen);
+			stolen = s.stolen();
+			cost_ns = bench_submit(s, total, spin);
+			report("ws_submit", w, total, cost_ns, s.stolen() - stolen);
+			s.stop();
+		}
+	}
+
+	netp::app::instance()->destroy_instance();
+	return 0;
+}
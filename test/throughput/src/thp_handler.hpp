@@ -52,6 +52,10 @@ _again:
 		break;
 		case m_rps:
 		{
+			if (g_param.post) {
+				ctx->post_write(income);
+				break;
+			}
 			NRP<netp::promise<int>> wp = ctx->write(income);
 			wp->if_done([](int const& rt) {
 				if (rt != netp::OK) {
@@ -103,6 +107,10 @@ public:
 			}
 			return;
 		}
+		if (g_param.post) {
+			ctx->post_write(income);
+			return;
+		}
 		NRP<netp::promise<int>> wp = ctx->write(income);
 		wp->if_done([](int const& rt) {
 			if (rt != netp::OK) {
@@ -22,6 +22,7 @@ public:
 	long for_max;
 	long mode;
 	long ackdelta;
+	long post; //write by post_write (no promise)
 
 	thp_param() :
 		client_max(1),
@@ -33,7 +34,8 @@ public:
 		thread(0),
 		for_max(1),
 		mode(m_rps),
-		ackdelta(10000)
+		ackdelta(10000),
+		post(0)
 	{}
 };
 
@@ -49,11 +51,13 @@ public:
 		{"for", optional_argument, 0, 'f'},
 		{"mode", optional_argument, 0, 'm'},
 		{"ack-delta", optional_argument, 0, 'a'},
+		{"post", optional_argument, 0, 'p'},
+		{"netp-poller", optional_argument, 0, 'P'}, //taken by netp::app
 		{"help", optional_argument, 0, 'h'},
 		{0,0,0,0}
 	};
 
-	const char* optstring = "l:n:c:r:s:b:t:f:m:a:h::";
+	const char* optstring = "l:n:c:r:s:b:t:f:m:a:p:h::";
 
 	int opt;
 	int opt_idx;
@@ -109,9 +113,18 @@ public:
 			p.ackdelta = std::atol(optarg);
 		}
 		break;
+		case 'p':
+		{
+			p.post = std::atol(optarg);
+		}
+		break;
+		case 'P':
+		{
+		}
+		break;
 		case 'h':
 		{
-			printf("usage:  -c max_clients -l bytes_len -n packet_number\nexample: thp.exe -c 1 -l 64 -n 1000000 -m 0\n");
+			printf("usage:  -c max_clients -l bytes_len -n packet_number -p post_write(0|1) --netp-poller=epoll|io_uring\nexample: thp.exe -c 1 -l 64 -n 1000000 -m 0\n");
 			exit(-1);
 			break;
 		}
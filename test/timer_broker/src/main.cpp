@@ -0,0 +1,142 @@
+
+// This is a benchmark of timer_broker_heap vs timer_broker_wheel
+// usage: timer_broker [max timer count]
+
+// for 10k/100k/1M timers (random delay in [1s, 60s], as the idle|keepalive timer of the connections)
+//	launch: launch all
+//	reset: relaunch every timer once in place, the heap leaves a stale entry for each, and drops them once they outnumber the live ones
+//	cancel: cancel all
+//	drain: expire_all, the cancelled one would not be invoked
+// fire: timers with random delay in [0, 100ms], drive the broker by expire(ndelay) + sleep, record the cost of expire only
+// relaunch: cancel -> relaunch -> expire, and relaunch a timer that is still in the broker, each one fires once at its last expiration
+
+#include <netp.hpp>
+#include <random>
+
+static long g_fired = 0;
+void on_timer(NRP<netp::timer> const&) {
+	++g_fired;
+}
+
+template <class broker_t>
+void bench_broker(const char* name, long count) {
+	NRP<netp::timer_broker> tb = netp::make_ref<broker_t>();
+	std::vector<NRP<netp::timer>> tms;
+	tms.reserve(count);
+	std::mt19937 rnd(count);
+	std::uniform_int_distribution<long> dist(1000, 60000);
+	for (long i = 0; i < count; ++i) {
+		tms.push_back(netp::make_ref<netp::timer>(std::chrono::milliseconds(dist(rnd)), &on_timer));
+	}
+
+	netp::benchmark mk(name, netp::bf_no_mark_output|netp::bf_no_end_output);
+	for (long i = 0; i < count; ++i) {
+		tms[i]->update_expiration();
+		tb->launch(tms[i]);
+	}
+	const long long launch_ns = mk.mark("launch").count();
+
+	for (long i = 0; i < count; ++i) {
+		tms[i]->update_expiration();
+		tb->launch(tms[i]);
+	}
+	const long long reset_ns = mk.mark("reset").count() - launch_ns;
+	const netp::size_t size_after_reset = tb->size();
+
+	for (long i = 0; i < count; ++i) {
+		tb->cancel(tms[i]);
+	}
+	const long long cancel_ns = mk.mark("cancel").count() - launch_ns - reset_ns;
+
+	g_fired = 0;
+	tb->expire_all();
+	const long long drain_ns = mk.mark("drain").count() - launch_ns - reset_ns - cancel_ns;
+	NETP_ASSERT(g_fired == 0 && tb->size() == 0);
+
+	NETP_INFO("[timer_broker][%s]count: %ld, launch: %.2f ns/op, reset: %.2f ns/op, cancel: %.2f ns/op, drain: %.2f ns/op, size after reset: %u",
+		name, count, (launch_ns*1.0)/count, (reset_ns*1.0)/count, (cancel_ns*1.0)/count, (drain_ns*1.0)/count, netp::u32_t(size_after_reset));
+}
+
+template <class broker_t>
+void bench_fire(const char* name, long count) {
+	NRP<netp::timer_broker> tb = netp::make_ref<broker_t>();
+	std::mt19937 rnd(count);
+	std::uniform_int_distribution<long> dist(0, 100);
+	for (long i = 0; i < count; ++i) {
+		NRP<netp::timer> tm = netp::make_ref<netp::timer>(std::chrono::milliseconds(dist(rnd)), &on_timer);
+		tm->update_expiration();
+		tb->launch(std::move(tm));
+	}
+
+	g_fired = 0;
+	long long expire_ns = 0;
+	long rounds = 0;
+	while (tb->size() != 0) {
+		netp::timer_duration_t ndelay;
+		netp::benchmark mk(name, netp::bf_no_mark_output|netp::bf_no_end_output);
+		tb->expire(ndelay);
+		expire_ns += mk.mark("expire").count();
+		++rounds;
+		if (ndelay.count() > 0 && ndelay != netp::_TIMER_DURATION_INFINITE) {
+			std::this_thread::sleep_for(ndelay);
+		}
+	}
+	NETP_ASSERT(g_fired == count);
+	NETP_INFO("[timer_broker][%s][fire]count: %ld, expire rounds: %ld, expire cost: %.2f ns/timer", name, count, rounds, (expire_ns*1.0)/count);
+}
+
+template <class broker_t>
+int check_relaunch(const char* name) {
+	NRP<netp::timer_broker> tb = netp::make_ref<broker_t>();
+	NRP<netp::timer> cancelled_relaunched = netp::make_ref<netp::timer>(std::chrono::milliseconds(50), &on_timer);
+	NRP<netp::timer> relaunched = netp::make_ref<netp::timer>(std::chrono::milliseconds(5), &on_timer);
+	NRP<netp::timer> cancelled = netp::make_ref<netp::timer>(std::chrono::milliseconds(20), &on_timer);
+	cancelled_relaunched->update_expiration();
+	tb->launch(cancelled_relaunched);
+	relaunched->update_expiration();
+	tb->launch(relaunched);
+	cancelled->update_expiration();
+	tb->launch(cancelled);
+
+	tb->cancel(cancelled_relaunched);
+	cancelled_relaunched->set_delay(std::chrono::milliseconds(5));
+	cancelled_relaunched->update_expiration();
+	tb->launch(cancelled_relaunched);
+	relaunched->set_delay(std::chrono::milliseconds(30));
+	relaunched->update_expiration();
+	tb->launch(relaunched);
+	tb->cancel(cancelled);
+
+	g_fired = 0;
+	while (tb->size() != 0) {
+		netp::timer_duration_t ndelay;
+		tb->expire(ndelay);
+		if (ndelay.count() > 0 && ndelay != netp::_TIMER_DURATION_INFINITE) {
+			std::this_thread::sleep_for(ndelay);
+		}
+	}
+	const bool ok = (g_fired == 2) && (cancelled_relaunched->invoke_count() == 1) && (relaunched->invoke_count() == 1) && (cancelled->invoke_count() == 0)
+		&& cancelled_relaunched->is_expired_invocation() && relaunched->is_expired_invocation();
+	NETP_ASSERT(ok);
+	NETP_INFO("[timer_broker][%s][relaunch]fired: %ld, cancelled then relaunched: %u, relaunched: %u, cancelled: %u, %s", name, g_fired,
+		cancelled_relaunched->invoke_count(), relaunched->invoke_count(), cancelled->invoke_count(), ok ? "ok" : "failed");
+	return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+	netp::app::instance()->init(argc, argv);
+	const long max = (argc > 1) ? NETP_MAX(std::atol(argv[1]), 10000L) : 1000000L;
+
+	int rt = check_relaunch<netp::timer_broker_heap>("heap");
+	rt |= check_relaunch<netp::timer_broker_wheel>("wheel");
+
+	for (long count = 10000; count <= max; count *= 10) {
+		bench_broker<netp::timer_broker_heap>("heap", count);
+		bench_broker<netp::timer_broker_wheel>("wheel", count);
+		bench_fire<netp::timer_broker_heap>("heap", count);
+		bench_fire<netp::timer_broker_wheel>("wheel", count);
+	}
+
+	netp::app::instance()->destroy_instance();
+	return rt;
+}
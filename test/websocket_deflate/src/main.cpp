@@ -0,0 +1,220 @@
+// This is a check of the websocket permessage-deflate, refer to https://tools.ietf.org/html/rfc7692
+// usage: websocket_deflate
+
+// negotiation: Sec-WebSocket-Extensions offers against netp::handler::websocket_deflate_negotiate, the params and the response line are checked
+// round trip: the server codec deflates, a client codec made of the mirrored params inflates, with context takeover on and off
+// the round trip needs a build with NETP_WITH_ZLIB (make zlib=yes, or cmake -DNETP_WITH_ZLIB=ON), it is skipped otherwise
+
+#include <netp.hpp>
+#include <netp/handler/websocket_deflate.hpp>
+
+using netp::handler::websocket_deflate_cfg;
+using netp::handler::websocket_deflate_params;
+using netp::handler::websocket_deflate_codec;
+using netp::handler::websocket_deflate_codec_cfg;
+
+struct negotiate_case {
+	const char* offers;
+	int rt;
+	const char* response;
+	netp::u8_t server_max_window_bits;
+	netp::u8_t client_max_window_bits;
+};
+
+static int check_negotiate(websocket_deflate_cfg const& cfg, negotiate_case const& c) {
+	websocket_deflate_params params;
+	netp::string_t response;
+	const int rt = netp::handler::websocket_deflate_negotiate(cfg, netp::string_t(c.offers), params, response);
+	if (rt != c.rt) {
+		NETP_ERR("[websocket_deflate]offers: %s, rt: %d, expect: %d", c.offers, rt, c.rt);
+		return -1;
+	}
+	if (rt != netp::OK) {
+		return netp::OK;
+	}
+	if (response != c.response || params.server_max_window_bits != c.server_max_window_bits || params.client_max_window_bits != c.client_max_window_bits) {
+		NETP_ERR("[websocket_deflate]offers: %s, response: %s, sw: %u, cw: %u, expect: %s, sw: %u, cw: %u", c.offers, response.c_str(),
+			params.server_max_window_bits, params.client_max_window_bits, c.response, c.server_max_window_bits, c.client_max_window_bits);
+		return -1;
+	}
+	NETP_INFO("[websocket_deflate]offers: %s, response: %s", c.offers, response.c_str());
+	return netp::OK;
+}
+
+static int test_negotiate() {
+	websocket_deflate_cfg cfg;
+	//no codec is made by the negotiation, a stub keeps it running without zlib
+	cfg.codec_maker = [](websocket_deflate_codec_cfg const&) -> NRP<websocket_deflate_codec> { return nullptr; };
+
+	const negotiate_case cases[] = {
+		{ "permessage-deflate", netp::OK, "permessage-deflate", 15, 15 },
+		{ "permessage-deflate; client_max_window_bits", netp::OK, "permessage-deflate; client_max_window_bits=15", 15, 15 },
+		{ "permessage-deflate; server_max_window_bits=10; client_max_window_bits=12", netp::OK, "permessage-deflate; server_max_window_bits=10; client_max_window_bits=12", 10, 12 },
+		{ "permessage-deflate; client_max_window_bits=\"11\"", netp::OK, "permessage-deflate; client_max_window_bits=11", 15, 11 },
+		{ "permessage-deflate; server_no_context_takeover; client_no_context_takeover", netp::OK, "permessage-deflate; server_no_context_takeover; client_no_context_takeover", 15, 15 },
+		//zlib has no 8 bits raw window, and the response could not exceed the offer
+		{ "permessage-deflate; client_max_window_bits=8", netp::E_WEBSOCKET_EXTENSION_DECLINED, "", 0, 0 },
+		{ "permessage-deflate; server_max_window_bits=8", netp::E_WEBSOCKET_EXTENSION_DECLINED, "", 0, 0 },
+		{ "permessage-deflate; client_max_window_bits=8, permessage-deflate; client_max_window_bits=9", netp::OK, "permessage-deflate; client_max_window_bits=9", 15, 9 },
+		{ "permessage-deflate; server_max_window_bits=16", netp::E_WEBSOCKET_EXTENSION_DECLINED, "", 0, 0 },
+		{ "permessage-deflate; server_max_window_bits", netp::E_WEBSOCKET_EXTENSION_DECLINED, "", 0, 0 },
+		{ "permessage-deflate; server_no_context_takeover; server_no_context_takeover", netp::E_WEBSOCKET_EXTENSION_DECLINED, "", 0, 0 },
+		{ "permessage-deflate; x_unknown", netp::E_WEBSOCKET_EXTENSION_DECLINED, "", 0, 0 },
+		{ "x-webkit-deflate-frame, permessage-deflate", netp::OK, "permessage-deflate", 15, 15 },
+		{ "x-webkit-deflate-frame", netp::E_WEBSOCKET_EXTENSION_DECLINED, "", 0, 0 },
+	};
+	for (negotiate_case const& c : cases) {
+		if (check_negotiate(cfg, c) != netp::OK) {
+			return -1;
+		}
+	}
+
+	//the server side settings are added to the response
+	{
+		websocket_deflate_cfg scfg = cfg;
+		scfg.server_no_context_takeover = true;
+		scfg.client_max_window_bits = 10;
+		const negotiate_case c = { "permessage-deflate; client_max_window_bits", netp::OK, "permessage-deflate; server_no_context_takeover; client_max_window_bits=10", 15, 10 };
+		if (check_negotiate(scfg, c) != netp::OK) {
+			return -1;
+		}
+	}
+
+	//the windows are lowered to fit memory_max
+	{
+		websocket_deflate_cfg scfg = cfg;
+		scfg.memory_max = 64 * 1024;
+		websocket_deflate_params params;
+		netp::string_t response;
+		if (netp::handler::websocket_deflate_negotiate(scfg, netp::string_t("permessage-deflate; client_max_window_bits"), params, response) != netp::OK) {
+			NETP_ERR("[websocket_deflate]memory_max: %u, declined", scfg.memory_max);
+			return -1;
+		}
+		const websocket_deflate_codec_cfg ccfg = { params.server_max_window_bits, false, params.client_max_window_bits, false, params.mem_level };
+		if (netp::handler::websocket_deflate_memory(ccfg) > scfg.memory_max) {
+			NETP_ERR("[websocket_deflate]memory_max: %u, memory: %u", scfg.memory_max, netp::handler::websocket_deflate_memory(ccfg));
+			return -1;
+		}
+
+		scfg.memory_max = 1024;
+		if (netp::handler::websocket_deflate_negotiate(scfg, netp::string_t("permessage-deflate"), params, response) != netp::E_WEBSOCKET_EXTENSION_DECLINED) {
+			NETP_ERR("[websocket_deflate]memory_max: %u, accepted", scfg.memory_max);
+			return -1;
+		}
+	}
+
+	{
+		websocket_deflate_cfg scfg;
+		scfg.codec_maker = nullptr;
+		websocket_deflate_params params;
+		netp::string_t response;
+		if (netp::handler::websocket_deflate_negotiate(scfg, netp::string_t("permessage-deflate"), params, response) != netp::E_WEBSOCKET_EXTENSION_DECLINED) {
+			NETP_ERR("[websocket_deflate]no codec_maker, accepted");
+			return -1;
+		}
+	}
+	return netp::OK;
+}
+
+#ifdef NETP_WITH_ZLIB
+static void make_message(netp::u32_t size, netp::u32_t seed, NRP<netp::packet>& m) {
+	static const char words[] = "the quick brown fox jumps over the lazy dog, permessage-deflate of netplus ";
+	m = netp::make_ref<netp::packet>(size);
+	netp::u32_t x = seed;
+	for (netp::u32_t i = 0; i < size; ++i) {
+		//mostly text with a little noise
+		x = x * 1103515245 + 12345;
+		m->write<netp::u8_t>(((x >> 16) % 16) == 0 ? netp::u8_t(x >> 24) : netp::u8_t(words[(i + seed) % (sizeof(words) - 1)]));
+	}
+}
+
+static bool same(NRP<netp::packet> const& a, NRP<netp::packet> const& b) {
+	return a->len() == b->len() && (a->len() == 0 || std::memcmp(a->head(), b->head(), a->len()) == 0);
+}
+
+static int test_round_trip(char const* offers) {
+	websocket_deflate_cfg cfg;
+	websocket_deflate_params params;
+	netp::string_t response;
+	if (netp::handler::websocket_deflate_negotiate(cfg, netp::string_t(offers), params, response) != netp::OK) {
+		NETP_ERR("[websocket_deflate]offers: %s, declined", offers);
+		return -1;
+	}
+
+	//the server deflates by server_max_window_bits, the client inflates by the same
+	const websocket_deflate_codec_cfg scfg = { params.server_max_window_bits, params.server_no_context_takeover, params.client_max_window_bits, params.client_no_context_takeover, params.mem_level };
+	const websocket_deflate_codec_cfg ccfg = { params.client_max_window_bits, params.client_no_context_takeover, params.server_max_window_bits, params.server_no_context_takeover, params.mem_level };
+	NRP<websocket_deflate_codec> server = cfg.codec_maker(scfg);
+	NRP<websocket_deflate_codec> client = cfg.codec_maker(ccfg);
+
+	const netp::u32_t sizes[] = { 1, 300, 4096, 70000, 1024 * 1024 };
+	for (netp::u32_t size : sizes) {
+		NRP<netp::packet> m;
+		make_message(size, size, m);
+
+		//the same message twice, the second one shrinks by the window kept from the first one only if the context is taken over
+		NRP<netp::packet> z[2];
+		for (int i = 0; i < 2; ++i) {
+			NRP<netp::packet> out;
+			if (server->compress(m->head(), m->len(), z[i]) != netp::OK || client->decompress(z[i]->head(), z[i]->len(), out, m->len()) != netp::OK || !same(m, out)) {
+				NETP_ERR("[websocket_deflate]offers: %s, size: %u, round: %d, server to client failed", offers, size, i);
+				return -1;
+			}
+		}
+
+		if (params.server_no_context_takeover) {
+			//each message is a stream on its own, a fresh inflater takes the second one
+			NRP<websocket_deflate_codec> fresh = cfg.codec_maker(ccfg);
+			NRP<netp::packet> out;
+			if (!same(z[0], z[1]) || fresh->decompress(z[1]->head(), z[1]->len(), out, m->len()) != netp::OK || !same(m, out)) {
+				NETP_ERR("[websocket_deflate]offers: %s, size: %u, server_no_context_takeover, the second message depends on the first one", offers, size);
+				return -1;
+			}
+		} else if (size >= 300 && size <= (1u << params.server_max_window_bits) && z[1]->len() >= z[0]->len()) {
+			NETP_ERR("[websocket_deflate]offers: %s, size: %u, context takeover, compressed: %u, then: %u", offers, size, z[0]->len(), z[1]->len());
+			return -1;
+		}
+
+		//the other direction
+		NRP<netp::packet> cz;
+		NRP<netp::packet> out;
+		if (client->compress(m->head(), m->len(), cz) != netp::OK || server->decompress(cz->head(), cz->len(), out, m->len()) != netp::OK || !same(m, out)) {
+			NETP_ERR("[websocket_deflate]offers: %s, size: %u, client to server failed", offers, size);
+			return -1;
+		}
+
+		//inflating beyond max is refused, by a pair of its own to keep the pair above in step
+		NRP<websocket_deflate_codec> fresh_server = cfg.codec_maker(scfg);
+		NRP<websocket_deflate_codec> fresh_client = cfg.codec_maker(ccfg);
+		if (size > 1 && (fresh_server->compress(m->head(), m->len(), cz) != netp::OK || fresh_client->decompress(cz->head(), cz->len(), out, m->len() - 1) != netp::E_WEBSOCKET_FRAME_TOO_BIG)) {
+			NETP_ERR("[websocket_deflate]offers: %s, size: %u, max not checked", offers, size);
+			return -1;
+		}
+
+		NETP_INFO("[websocket_deflate]offers: %s, size: %u, compressed: %u, then: %u", offers, size, z[0]->len(), z[1]->len());
+	}
+	return netp::OK;
+}
+#endif
+
+int main(int argc, char** argv) {
+	netp::app::instance()->init(argc, argv);
+
+	int rt = test_negotiate();
+#ifdef NETP_WITH_ZLIB
+	const char* offers[] = {
+		"permessage-deflate",
+		"permessage-deflate; server_no_context_takeover; client_no_context_takeover",
+		"permessage-deflate; server_max_window_bits=9; client_max_window_bits=9",
+		"permessage-deflate; server_max_window_bits=10; server_no_context_takeover; client_max_window_bits=12",
+	};
+	for (::size_t i = 0; rt == netp::OK && i < sizeof(offers) / sizeof(offers[0]); ++i) {
+		rt = test_round_trip(offers[i]);
+	}
+#else
+	NETP_INFO("[websocket_deflate]no NETP_WITH_ZLIB, round trip skipped");
+#endif
+
+	netp::app::instance()->destroy_instance();
+	return rt == netp::OK ? 0 : -1;
+}
@@ -0,0 +1,241 @@
+// This is a throughput benchmark of the websocket frame decoding
+// usage: websocket_frame [total bytes per case] [bytes per read]
+
+// legacy: queue every read, walk the header one byte at a time, unmask and copy the payload into the frame buffer, then hand it over as a new message (the state machine before websocket_frame_decoder)
+// decoder: netp::handler::websocket_frame_decoder, header parsed in place, payload unmasked in place and delivered by a slice of the read, only the frame split across reads is buffered
+// a stream of masked frames of the given payload size is cut into reads of the given size, the reads are prepared before the timing starts
+// both decoders must deliver the same message count, bytes, and checksum
+
+#include <netp.hpp>
+#include <netp/handler/websocket_frame.hpp>
+#include <netp/handler/websocket_mask.hpp>
+
+using netp::handler::ws_frame;
+
+static const netp::u8_t mask_key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+
+struct bench_result {
+	netp::u64_t messages;
+	netp::u64_t bytes;
+	netp::u64_t sum;
+	long long cost_ns;
+
+	bench_result() :messages(0), bytes(0), sum(0), cost_ns(0) {}
+
+	void on_message(NRP<netp::packet> const& m) {
+		++messages;
+		bytes += m->len();
+		if (m->len()) {
+			sum += m->head()[0] + m->head()[m->len() - 1];
+		}
+	}
+};
+
+class legacy_decoder {
+	enum state {
+		S_FRAME_READ_H_B1,
+		S_FRAME_READ_H_B2,
+		S_FRAME_READ_PAYLOAD_LEN,
+		S_FRAME_READ_MASKING_KEY,
+		S_FRAME_READ_PAYLOAD
+	};
+
+	netp::packet_queue_t m_in_q;
+	netp::u32_t m_in_q_nbytes;
+	state m_state;
+	ws_frame m_frame;
+	NRP<netp::packet> m_appdata;
+	NRP<netp::packet> m_message;
+
+	//one byte at a time across the queue
+	netp::u8_t _read_u8() {
+		NRP<netp::packet>& in = m_in_q.front();
+		const netp::u8_t b = in->read<netp::u8_t>();
+		--m_in_q_nbytes;
+		if (in->len() == 0) {
+			m_in_q.pop();
+		}
+		return b;
+	}
+
+public:
+	legacy_decoder() :m_in_q_nbytes(0), m_state(S_FRAME_READ_H_B1), m_appdata(netp::make_ref<netp::packet>()), m_message(netp::make_ref<netp::packet>()) {}
+
+	void read(NRP<netp::packet> const& income, bench_result& r) {
+		m_in_q_nbytes += income->len();
+		m_in_q.push(income);
+
+		while (1) {
+			switch (m_state) {
+			case S_FRAME_READ_H_B1:
+			{
+				if (m_in_q_nbytes < 1) { return; }
+				m_frame.H.B1.B = _read_u8();
+				m_state = S_FRAME_READ_H_B2;
+			}
+			break;
+			case S_FRAME_READ_H_B2:
+			{
+				if (m_in_q_nbytes < 1) { return; }
+				m_frame.H.B2.B = _read_u8();
+				m_state = S_FRAME_READ_PAYLOAD_LEN;
+			}
+			break;
+			case S_FRAME_READ_PAYLOAD_LEN:
+			{
+				const netp::u32_t n = (m_frame.H.B2.Bit.len == 126) ? 2 : (m_frame.H.B2.Bit.len == 127) ? 8 : 0;
+				if (m_in_q_nbytes < n) { return; }
+				m_frame.payload_len = (n == 0) ? m_frame.H.B2.Bit.len : 0;
+				for (netp::u32_t i = 0; i < n; ++i) {
+					m_frame.payload_len = (m_frame.payload_len << 8) | _read_u8();
+				}
+				m_state = S_FRAME_READ_MASKING_KEY;
+			}
+			break;
+			case S_FRAME_READ_MASKING_KEY:
+			{
+				if (m_in_q_nbytes < 4) { return; }
+				for (netp::u32_t i = 0; i < 4; ++i) {
+					m_frame.masking_key_arr[i] = _read_u8();
+				}
+				m_state = S_FRAME_READ_PAYLOAD;
+			}
+			break;
+			case S_FRAME_READ_PAYLOAD:
+			{
+				while (m_appdata->len() < m_frame.payload_len) {
+					if (m_in_q_nbytes == 0) { return; }
+					NRP<netp::packet>& in = m_in_q.front();
+					const netp::u32_t n = netp::u32_t(NETP_MIN(netp::u64_t(in->len()), m_frame.payload_len - m_appdata->len()));
+					netp::handler::websocket_mask(in->head(), n, m_frame.masking_key_arr, m_appdata->len());
+					m_appdata->write(in->head(), n);
+					in->skip(n);
+					m_in_q_nbytes -= n;
+					if (in->len() == 0) {
+						m_in_q.pop();
+					}
+				}
+				m_message.swap(m_appdata);
+				NRP<netp::packet> message = netp::make_ref<netp::packet>();
+				message.swap(m_message);
+				r.on_message(message);
+				m_appdata->reset();
+				m_state = S_FRAME_READ_H_B1;
+			}
+			break;
+			}
+		}
+	}
+};
+
+void make_frames(netp::u32_t size, netp::u64_t total, NRP<netp::packet>& stream) {
+	stream = netp::make_ref<netp::packet>(netp::u32_t(total + (total / size + 1) * 14));
+	NRP<netp::packet> payload = netp::make_ref<netp::packet>(size);
+	for (netp::u32_t i = 0; i < size; ++i) {
+		payload->write<netp::u8_t>(netp::u8_t(i * 131 + 7));
+	}
+	netp::handler::websocket_mask(payload->head(), size, mask_key);
+
+	for (netp::u64_t n = 0; n < total; n += size) {
+		ws_frame f;
+		f.H.B1.B = 0;
+		f.H.B1.Bit.fin = 0x1;
+		f.H.B1.Bit.opcode = netp::handler::OP_BINARY;
+		f.H.B2.B = 0;
+		f.H.B2.Bit.mask = 0x1;
+		stream->write<netp::u8_t>(f.H.B1.B);
+		if (size > 0xFFFF) {
+			f.H.B2.Bit.len = 127;
+			stream->write<netp::u8_t>(f.H.B2.B);
+			stream->write<netp::u64_t, netp::bytes_helper::big_endian>(size);
+		} else if (size > 125) {
+			f.H.B2.Bit.len = 126;
+			stream->write<netp::u8_t>(f.H.B2.B);
+			stream->write<netp::u16_t, netp::bytes_helper::big_endian>(netp::u16_t(size));
+		} else {
+			f.H.B2.Bit.len = size;
+			stream->write<netp::u8_t>(f.H.B2.B);
+		}
+		stream->write(mask_key, 4);
+		stream->write(payload->head(), size);
+	}
+}
+
+//cut the stream into reads of rsize, one copy for one run
+void make_reads(NRP<netp::packet> const& stream, netp::u32_t rsize, std::vector<NRP<netp::packet>>& reads) {
+	reads.clear();
+	for (netp::u32_t off = 0; off < stream->len(); off += rsize) {
+		const netp::u32_t n = NETP_MIN(rsize, stream->len() - off);
+		reads.push_back(netp::make_ref<netp::packet>(stream->head() + off, n));
+	}
+}
+
+template <class decoder_t>
+void bench(std::vector<NRP<netp::packet>> const& reads, decoder_t& d, bench_result& r);
+
+template <>
+void bench<legacy_decoder>(std::vector<NRP<netp::packet>> const& reads, legacy_decoder& d, bench_result& r) {
+	netp::benchmark mk("legacy", netp::bf_no_mark_output | netp::bf_no_end_output);
+	for (auto const& in : reads) {
+		d.read(in, r);
+	}
+	r.cost_ns = mk.mark("done").count();
+}
+
+template <>
+void bench<netp::handler::websocket_frame_decoder>(std::vector<NRP<netp::packet>> const& reads, netp::handler::websocket_frame_decoder& d, bench_result& r) {
+	netp::benchmark mk("decoder", netp::bf_no_mark_output | netp::bf_no_end_output);
+	ws_frame f;
+	NRP<netp::packet> payload;
+	for (auto const& in : reads) {
+		d.feed(in);
+		int rt;
+		while ((rt = d.next(f, payload)) == netp::OK) {
+			r.on_message(payload);
+		}
+		NETP_ASSERT(rt == netp::E_WEBSOCKET_FRAME_INCOMPLETE);
+	}
+	r.cost_ns = mk.mark("done").count();
+}
+
+void report(const char* name, netp::u32_t size, bench_result const& r) {
+	NETP_INFO("[websocket_frame][%s]payload: %u, messages: %llu, bytes: %llu, cost: %lld ns, %.2f ns/message, %.2f MB/s", name, size, r.messages, r.bytes, r.cost_ns, (r.cost_ns * 1.0) / r.messages, (r.bytes * 1000.0) / r.cost_ns);
+}
+
+int main(int argc, char** argv) {
+	netp::app::instance()->init(argc, argv);
+
+	const netp::u64_t total = (argc > 1) ? NETP_MAX(std::atoll(argv[1]), 1LL) : (64LL * 1024 * 1024);
+	const netp::u32_t rsize = (argc > 2) ? NETP_MAX(std::atoi(argv[2]), 1) : (64 * 1024);
+
+	const netp::u32_t sizes[] = { 64, 4096, 1024 * 1024 };
+	for (netp::u32_t size : sizes) {
+		NRP<netp::packet> stream;
+		make_frames(size, NETP_MAX(total, netp::u64_t(size)), stream);
+
+		std::vector<NRP<netp::packet>> reads;
+		bench_result legacy_r;
+		{
+			make_reads(stream, rsize, reads);
+			legacy_decoder d;
+			bench(reads, d, legacy_r);
+		}
+		report("legacy", size, legacy_r);
+
+		bench_result decoder_r;
+		{
+			make_reads(stream, rsize, reads);
+			netp::handler::websocket_frame_decoder d;
+			bench(reads, d, decoder_r);
+		}
+		report("decoder", size, decoder_r);
+
+		if (legacy_r.messages != decoder_r.messages || legacy_r.bytes != decoder_r.bytes || legacy_r.sum != decoder_r.sum) {
+			NETP_ERR("[websocket_frame]payload: %u, check failed", size);
+			return -1;
+		}
+	}
+
+	netp::app::instance()->destroy_instance();
+	return 0;
+}
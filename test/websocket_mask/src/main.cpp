@@ -0,0 +1,72 @@
+// This is a benchmark of the websocket payload masking kernel
+// usage: websocket_mask [total bytes per case]
+
+// legacy: xor one byte at a time, and append it to another packet by packet::write<u8_t> (the unmask loop before the kernel)
+// scalar: xor one byte at a time, in place
+// kernel: netp::handler::websocket_mask, in place, avx2|sse2|word picked at runtime
+// every case masks the same total bytes by payloads of the given size, the output of the kernel is checked against the scalar one
+
+#include <netp.hpp>
+#include <netp/handler/websocket_mask.hpp>
+
+static const netp::u8_t mask_key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+
+long long bench_legacy(netp::u32_t size, netp::u64_t total, NRP<netp::packet> const& in) {
+	NRP<netp::packet> out = netp::make_ref<netp::packet>(size);
+	netp::benchmark mk("legacy", netp::bf_no_mark_output | netp::bf_no_end_output);
+	for (netp::u64_t n = 0; n < total; n += size) {
+		out->reset();
+		for (netp::u32_t i = 0; i < size; ++i) {
+			out->write<netp::u8_t>(in->head()[i] ^ mask_key[i % 4]);
+		}
+	}
+	return mk.mark("done").count();
+}
+
+long long bench_inplace(netp::u32_t size, netp::u64_t total, NRP<netp::packet> const& in, void(*fn)(netp::byte_t*, netp::u32_t, netp::u8_t const*, netp::u64_t)) {
+	netp::benchmark mk("inplace", netp::bf_no_mark_output | netp::bf_no_end_output);
+	for (netp::u64_t n = 0; n < total; n += size) {
+		fn(in->head(), size, mask_key, 0);
+	}
+	return mk.mark("done").count();
+}
+
+bool check(netp::u32_t size) {
+	//odd length and odd offset, for the tail and the phase of the key
+	NRP<netp::packet> a = netp::make_ref<netp::packet>(size + 3);
+	for (netp::u32_t i = 0; i < size + 3; ++i) {
+		a->write<netp::u8_t>(netp::u8_t(i * 131 + 7));
+	}
+	NRP<netp::packet> b = a->clone();
+	netp::handler::websocket_mask_scalar(a->head() + 1, size + 1, mask_key, 3);
+	netp::handler::websocket_mask(b->head() + 1, size + 1, mask_key, 3);
+	return std::memcmp(a->head(), b->head(), a->len()) == 0;
+}
+
+void report(const char* name, netp::u32_t size, netp::u64_t total, long long cost_ns) {
+	NETP_INFO("[websocket_mask][%s]payload: %u, total: %llu, cost: %lld ns, %.2f MB/s", name, size, total, cost_ns, (total * 1000.0) / cost_ns);
+}
+
+int main(int argc, char** argv) {
+	netp::app::instance()->init(argc, argv);
+
+	const netp::u64_t total = (argc > 1) ? NETP_MAX(std::atoll(argv[1]), 1LL) : (256LL * 1024 * 1024);
+	NETP_INFO("[websocket_mask]sse2: %d, avx2: %d", netp::CPUID::SSE2(), netp::CPUID::AVX2());
+
+	const netp::u32_t sizes[] = { 16, 64, 256, 1024, 4096, 65536, 1024 * 1024 };
+	for (netp::u32_t size : sizes) {
+		if (!check(size)) {
+			NETP_ERR("[websocket_mask]payload: %u, check failed", size);
+			return -1;
+		}
+		NRP<netp::packet> in = netp::make_ref<netp::packet>(size);
+		in->incre_write_idx(size);
+		const netp::u64_t n = NETP_MAX(total, netp::u64_t(size));
+		report("legacy", size, n, bench_legacy(size, n, in));
+		report("scalar", size, n, bench_inplace(size, n, in, netp::handler::websocket_mask_scalar));
+		report("kernel", size, n, bench_inplace(size, n, in, netp::handler::websocket_mask));
+	}
+
+	netp::app::instance()->destroy_instance();
+	return 0;
+}